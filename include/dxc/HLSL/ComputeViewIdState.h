@@ -14,6 +14,9 @@
 #pragma once
 #include "llvm/Pass.h"
 #include "dxc/HLSL/ControlDependence.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/GenericDomTree.h"
 
 #include <memory>
@@ -104,8 +107,14 @@ private:
     FunctionSetType Functions;
     // Outputs to analyze.
     InstructionSetType Outputs;
-    // Contributing instructions per output.
-    std::unordered_map<unsigned, InstructionSetType> ContributingInstructions[kNumStreams];
+    // ViewID and input loads reached from outputs; bit vectors index these.
+    std::vector<llvm::Instruction *> SourceInsts;
+    // Strongly connected component of each instruction reached, and the
+    // sources reachable from each component.
+    llvm::DenseMap<llvm::Instruction *, unsigned> InstSCC;
+    std::vector<llvm::BitVector> SCCSources;
+    // Contributing sources per output.
+    std::unordered_map<unsigned, llvm::BitVector> ContributingSources[kNumStreams];
 
     void Clear();
   };
@@ -138,18 +147,22 @@ private:
   void ComputeReachableFunctionsRec(llvm::CallGraph &CG, llvm::CallGraphNode *pNode, FunctionSetType &FuncSet);
   void AnalyzeFunctions(EntryInfo &Entry);
   void CollectValuesContributingToOutputs(EntryInfo &Entry);
-  void CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                            llvm::Value *pContributingValue,
-                                            InstructionSetType &ContributingInstructions);
-  void CollectPhiCFValuesContributingToOutputRec(llvm::PHINode *pPhi,
-                                                 EntryInfo &Entry,
-                                                 InstructionSetType &ContributingInstructions);
+  const llvm::BitVector &GetContributingSources(EntryInfo &Entry, llvm::Instruction *pRoot);
+  void AddContributingValue(EntryInfo &Entry, llvm::Value *pContributingValue,
+                            llvm::SmallVectorImpl<llvm::Instruction *> &Insts);
+  void AddControlDependence(llvm::BasicBlock *pBB,
+                            llvm::SmallVectorImpl<llvm::Instruction *> &Insts);
+  void CollectContributingInstructions(EntryInfo &Entry,
+                                       llvm::Instruction *pContributingInst,
+                                       llvm::SmallVectorImpl<llvm::Instruction *> &Insts);
+  void CollectPhiCFValuesContributingToOutput(llvm::PHINode *pPhi,
+                                              EntryInfo &Entry,
+                                              llvm::SmallVectorImpl<llvm::Instruction *> &Insts);
   const ValueSetType &CollectReachingDecls(llvm::Value *pValue);
-  void CollectReachingDeclsRec(llvm::Value *pValue, ValueSetType &ReachingDecls, ValueSetType &Visited);
   const ValueSetType &CollectStores(llvm::Value *pValue);
-  void CollectStoresRec(llvm::Value *pValue, ValueSetType &Stores, ValueSetType &Visited);
   void UpdateDynamicIndexUsageState() const;
-  void CreateViewIdSets(const std::unordered_map<unsigned, InstructionSetType> &ContributingInstructions,
+  void CreateViewIdSets(const EntryInfo &Entry,
+                        const std::unordered_map<unsigned, llvm::BitVector> &ContributingSources,
                         OutputsDependentOnViewIdType &OutputsDependentOnViewId,
                         InputsContributingToOutputType &InputsContributingToOutputs, bool bPC);
 
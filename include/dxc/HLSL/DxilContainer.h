@@ -320,6 +320,57 @@ struct DxilPartIterator : public std::iterator<std::input_iterator_tag,
 DxilPartIterator begin(const DxilContainerHeader *pHeader);
 DxilPartIterator end(const DxilContainerHeader *pHeader);
 
+/// Non-owning span over bytes held in a container.
+struct DxilPartSpan {
+  const char *pData = nullptr;
+  uint32_t Size = 0;
+  DxilPartSpan() {}
+  DxilPartSpan(const char *data, uint32_t size) : pData(data), Size(size) {}
+  bool empty() const { return pData == nullptr; }
+};
+
+/// Read-only view over a container held in memory.
+///
+/// The view checks the container once and then hands out pointers and spans
+/// into the caller's buffer; nothing is copied, and the buffer must outlive
+/// the view and anything obtained from it.
+class DxilContainerView {
+private:
+  const DxilContainerHeader *m_pHeader = nullptr;
+public:
+  DxilContainerView() {}
+
+  /// Checks that the bytes hold a valid container and points the view at it.
+  /// On failure the view is left empty and false is returned.
+  bool Initialize(const void *pData, size_t length);
+  void Reset() { m_pHeader = nullptr; }
+
+  bool IsValid() const { return m_pHeader != nullptr; }
+  const DxilContainerHeader *GetHeader() const { return m_pHeader; }
+  uint32_t GetPartCount() const {
+    return m_pHeader ? m_pHeader->PartCount : 0;
+  }
+  /// Gets a part header by index; the index must be in range.
+  const DxilPartHeader *GetPart(uint32_t index) const {
+    return GetDxilContainerPart(m_pHeader, index);
+  }
+  /// Gets the payload of a part.
+  static DxilPartSpan GetPartSpan(const DxilPartHeader *pPart) {
+    return DxilPartSpan(GetDxilPartData(pPart), pPart->PartSize);
+  }
+
+  /// Returns the first part of the given kind, or nullptr if absent.
+  const DxilPartHeader *FindPart(DxilFourCC fourCC) const;
+  /// Returns the payload of the first part of the given kind, or an empty span.
+  DxilPartSpan FindPartSpan(DxilFourCC fourCC) const;
+  /// Returns the program header of a DXIL part if the part is present and its
+  /// bitcode lies within it, or nullptr otherwise.
+  const DxilProgramHeader *FindProgramHeader(DxilFourCC fourCC) const;
+
+  DxilPartIterator begin() const { return hlsl::begin(m_pHeader); }
+  DxilPartIterator end() const { return hlsl::end(m_pHeader); }
+};
+
 inline bool IsValidDxilBitcodeHeader(const DxilBitcodeHeader *pHeader,
                                      uint32_t length) {
   return length > sizeof(DxilBitcodeHeader) &&
@@ -19,6 +19,7 @@ class FunctionPass;
 class Instruction;
 class PassRegistry;
 class StringRef;
+class TargetIRAnalysis;
 }
 
 namespace hlsl {
@@ -69,6 +70,10 @@ ModulePass *createNoPausePassesPass();
 ModulePass *createPausePassesPass();
 ModulePass *createResumePassesPass();
 
+/// \brief Create a target analysis that gives the costs of DXIL operations to
+/// passes run once the module has a DxilModule.
+TargetIRAnalysis createDxilTargetIRAnalysis();
+
 void initializeDxilCondenseResourcesPass(llvm::PassRegistry&);
 void initializeDxilEliminateOutputDynamicIndexingPass(llvm::PassRegistry&);
 void initializeDxilGenerationPassPass(llvm::PassRegistry&);
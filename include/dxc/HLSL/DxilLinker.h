@@ -13,8 +13,10 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include <memory>
+#include <string>
 #include "llvm/Support/ErrorOr.h"
 
 namespace llvm {
@@ -52,4 +54,22 @@ protected:
   unsigned m_valMajor, m_valMinor;
 };
 
+// An output element written to stream output, as named by an entry of a
+// stream output declaration.
+struct DxilStreamOutputElement {
+  unsigned Stream;
+  std::string SemanticName;
+  unsigned SemanticIndex;
+};
+
+// Links two consecutive stages of a graphics pipeline: removes the
+// user-defined outputs of Producer that the consumer doesn't read, along with
+// the code computing them, and repacks both signatures to line up. Without a
+// consumer, as for the last stage of a pipeline without a pixel shader, no
+// user-defined outputs are read. Outputs named in StreamOutput are always
+// kept. Returns true if the modules changed.
+bool RemoveUnusedStageOutputs(
+    DxilModule &Producer, DxilModule *pConsumer,
+    llvm::ArrayRef<DxilStreamOutputElement> StreamOutput = llvm::None);
+
 } // namespace hlsl
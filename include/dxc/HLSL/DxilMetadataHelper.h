@@ -293,6 +293,7 @@ public:
   llvm::MDTuple *EmitSignatureElement(const DxilSignatureElement &SE);
   void LoadSignatureElement(const llvm::MDOperand &MDO, DxilSignatureElement &SE);
   void LoadRootSignature(RootSignatureHandle &RootSig);
+  void LoadRootSignatureNode(const llvm::MDNode &MDN, RootSignatureHandle &RootSig);
 
   // Resources.
   llvm::MDTuple *EmitDxilResourceTuple(llvm::MDTuple *pSRVs, llvm::MDTuple *pUAVs, 
@@ -347,6 +348,7 @@ public:
   // ViewId state.
   void EmitDxilViewIdState(DxilViewIdState &ViewIdState);
   void LoadDxilViewIdState(DxilViewIdState &ViewIdState);
+  void LoadDxilViewIdStateNode(const llvm::MDNode &MDN, DxilViewIdState &ViewIdState);
 
   // Control flow hints.
   static llvm::MDNode *EmitControlFlowHints(llvm::LLVMContext &Ctx, std::vector<DXIL::ControlFlowHint> &hints);
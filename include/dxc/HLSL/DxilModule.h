@@ -19,6 +19,8 @@
 #include "dxc/HLSL/DxilConstants.h"
 #include "dxc/HLSL/DxilTypeSystem.h"
 #include "dxc/HLSL/ComputeViewIdState.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/TrackingMDRef.h"
 
 
 
@@ -156,8 +158,11 @@ public:
   void EmitDxilMetadata();
   /// Update resource metadata.
   void ReEmitDxilResources();
-  /// Deserialize DXIL metadata form into in-memory form.
+  /// Deserialize DXIL metadata form into in-memory form. The type system,
+  /// root signature and view ID state are deserialized on first use.
   void LoadDxilMetadata();
+  /// Deserialize the metadata that LoadDxilMetadata leaves for first use.
+  void LoadLazyDxilMetadata();
   /// Check if a Named meta data node is known by dxil module.
   static bool IsKnownNamedMetaData(llvm::NamedMDNode &Node);
 
@@ -439,6 +444,22 @@ private:
   // ViewId state.
   std::unique_ptr<DxilViewIdState> m_pViewIdState;
 
+  // Metadata categories deserialized on first use. Until then, the nodes
+  // they would be loaded from are kept, and emitted again as they are.
+  enum LazyMetadataKind {
+    LazyTypeSystem,
+    LazyRootSignature,
+    LazyViewIdState,
+    LazyMetadataKindCount
+  };
+  mutable unsigned m_LazyMetadata; // Bit for each kind not loaded yet.
+  mutable llvm::SmallVector<llvm::TrackingMDNodeRef, 2>
+      m_LazyMetadataNodes[LazyMetadataKindCount];
+  void CaptureLazyMetadata(LazyMetadataKind Kind, llvm::StringRef Name,
+                           unsigned MaxNodes);
+  void LoadLazyMetadata(LazyMetadataKind Kind) const;
+  bool EmitLazyMetadata(LazyMetadataKind Kind, llvm::StringRef Name);
+
   // DXIL metadata serialization/deserialization.
   llvm::MDTuple *EmitDxilResources();
   void LoadDxilResources(const llvm::MDOperand &MDO);
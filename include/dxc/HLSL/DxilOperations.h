@@ -20,8 +20,10 @@ class Function;
 class Constant;
 class Value;
 class Instruction;
+class CallInst;
 };
 #include "llvm/IR/Attributes.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 
 #include "DxilConstants.h"
@@ -44,6 +46,12 @@ public:
   llvm::Function *GetOpFunc(OpCode OpCode, llvm::Type *pOverloadType);
   llvm::ArrayRef<llvm::Function *> GetOpFuncList(OpCode OpCode) const;
   void RemoveFunction(llvm::Function *F);
+
+  // Appends the calls to an operation, or to every operation of a class,
+  // from the users of its overload functions rather than by scanning the
+  // module. Calls is a snapshot, so callers may erase calls as they go.
+  void GetOpCalls(OpCode OpCode, llvm::SmallVectorImpl<llvm::CallInst *> &Calls);
+  void GetOpCalls(OpCodeClass opClass, llvm::SmallVectorImpl<llvm::CallInst *> &Calls);
   llvm::Type *GetOverloadType(OpCode OpCode, llvm::Function *F);
   llvm::LLVMContext &GetCtx() { return m_Ctx; }
   llvm::Type *GetHandleType() const;
@@ -126,6 +134,8 @@ private:
   OpCodeCacheItem m_OpCodeClassCache[(unsigned)OpCodeClass::NumOpClasses];
   std::unordered_map<const llvm::Function *, OpCodeClass> m_FunctionToOpClass;
   void UpdateCache(OpCodeClass opClass, unsigned typeSlot, llvm::Function *F);
+  void CollectOpCalls(OpCodeClass opClass, OpCode OpCode,
+                      llvm::SmallVectorImpl<llvm::CallInst *> &Calls);
 private:
   // Static properties.
   struct OpCodeProperty {
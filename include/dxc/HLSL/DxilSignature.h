@@ -40,9 +40,19 @@ public:
   const DxilSignatureElement &GetElement(unsigned idx) const;
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
 
+  // Removes the elements flagged in Delete, indexed by element ID, and renumbers
+  // the rest in order. NewIDs receives the new ID of each old element, or -1 if
+  // it was removed; the caller updates references to the old IDs.
+  void DeleteElements(const std::vector<bool> &Delete, std::vector<int> &NewIDs);
+
   // Packs the signature elements per DXIL constraints and returns the number of rows used for the signature
   unsigned PackElements(DXIL::PackingStrategy packing);
 
+  // Packs input elements to line up with the outputs of the prior stage: elements
+  // with the semantic of an output take its location, and the rest are packed
+  // around the outputs. Returns the number of rows used for the signature.
+  unsigned PackElementsToMatch(const DxilSignature &Prior);
+
   // Returns true if all signature elements that should be allocated are allocated
   bool IsFullyAllocated() const;
 
@@ -243,8 +243,30 @@ enum class ValidationRule : unsigned {
 
 const char *GetValidationRuleText(ValidationRule value);
 void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor);
+
+// Remembers functions that passed validation, so that a module sharing most
+// of its code with one validated earlier, such as a library that is relinked
+// repeatedly, only has its changed functions validated again. Functions are
+// matched by a hash of their body and of the module state their validation
+// depends on. May be shared by validations running on several threads.
+class DxilValidationCache {
+public:
+  DxilValidationCache();
+  ~DxilValidationCache();
+  // Function bodies validated, and bodies skipped as they validated cleanly
+  // before, since the cache was created or the counts last reset.
+  uint64_t GetValidatedFunctionCount() const;
+  uint64_t GetCachedFunctionCount() const;
+  void ResetStatistics();
+  struct Impl;
+  Impl &GetImpl() { return *m_pImpl; }
+private:
+  std::unique_ptr<Impl> m_pImpl;
+};
+
 HRESULT ValidateDxilModule(_In_ llvm::Module *pModule,
-                           _In_opt_ llvm::Module *pDebugModule);
+                           _In_opt_ llvm::Module *pDebugModule,
+                           _In_opt_ DxilValidationCache *pCache = nullptr);
 
 // DXIL Container Verification Functions (return false on failure)
 
@@ -300,7 +322,8 @@ HRESULT ValidateDxilBitcode(_In_reads_bytes_(ILLength) const char *pIL,
 // Full container validation, including ValidateDxilModule
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              _In_opt_ DxilValidationCache *pCache = nullptr);
 
 class PrintDiagnosticContext {
 private:
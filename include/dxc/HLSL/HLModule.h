@@ -147,6 +147,24 @@ public:
   void LoadHLMetadata();
   /// Delete any HLDXIR from the specified module.
   static void ClearHLMetadata(llvm::Module &M);
+
+  // Specialization constants, left unresolved with -specialize-constant.
+  /// Records a static const global whose value is bound after codegen; GV is
+  /// nullptr if the program doesn't use it.
+  static void AddSpecializationConstant(llvm::Module &M, llvm::StringRef Name,
+                                        llvm::GlobalVariable *GV);
+  /// Gets the recorded constants by name.
+  static void GetSpecializationConstants(
+      llvm::Module &M,
+      std::vector<std::pair<llvm::StringRef, llvm::GlobalVariable *>> &Constants);
+  /// Records the -Odump style pass list that finishes the compilation.
+  static void SetSpecializationPasses(llvm::Module &M, llvm::StringRef Passes);
+  /// Gets the recorded pass list, or an empty string.
+  static llvm::StringRef GetSpecializationPasses(llvm::Module &M);
+  /// Records the SerializeDxilFlags of the compilation, for the container.
+  static void SetSpecializationSerializeFlags(llvm::Module &M, unsigned Flags);
+  /// Gets the recorded SerializeDxilFlags, or zero.
+  static unsigned GetSpecializationSerializeFlags(llvm::Module &M);
   /// Create Metadata from a resource.
   llvm::MDNode *DxilSamplerToMDNode(const DxilSampler &S);
   llvm::MDNode *DxilSRVToMDNode(const DxilResource &SRV);
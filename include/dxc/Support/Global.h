@@ -70,6 +70,38 @@ struct DxcThreadMalloc {
   IMalloc *pPrior;
 };
 
+// An arena allocator carves allocations out of large blocks obtained from a
+// parent IMalloc, and returns all blocks to the parent at once when it's
+// released. Freeing the most recent allocation returns its memory to the
+// block; other small allocations are kept for reuse by later allocations of
+// the same size. Allocations that didn't come from the arena (for
+// example, made before it was installed on the thread) are forwarded to the
+// parent, as are large allocations.
+//
+// The arena isn't thread-safe: threads that work for the same compilation
+// must share it through an allocator from DxcCreateSerializedMalloc. It must
+// outlive everything allocated from it; in particular, nothing allocated
+// while it's installed may be cached in global state.
+struct DxcArenaMallocStats {
+  unsigned long long AllocationCount; // Allocations served from blocks.
+  unsigned long long LiveBytes;       // Bytes currently allocated from blocks.
+  unsigned long long PeakLiveBytes;   // High-water mark of LiveBytes.
+  unsigned long long ReservedBytes;   // Bytes in blocks obtained from the parent.
+  unsigned long long BlockCount;      // Blocks obtained from the parent.
+};
+HRESULT DxcCreateArenaMalloc(IMalloc *pParent, IMalloc **ppArena) throw();
+void DxcGetArenaMallocStats(IMalloc *pArena, DxcArenaMallocStats *pStats) throw();
+
+// Creates an allocator that forwards to pParent and counts the bytes
+// requested through it, for reporting memory use per compilation phase.
+HRESULT DxcCreateCountingMalloc(IMalloc *pParent, IMalloc **ppCounting) throw();
+unsigned long long DxcGetCountingMallocBytes(IMalloc *pCounting) throw();
+
+// Creates an allocator that forwards to pParent one call at a time, for
+// threads that work together on something allocated from a parent that isn't
+// thread-safe. The parent only pays for the lock while it is shared.
+HRESULT DxcCreateSerializedMalloc(IMalloc *pParent, IMalloc **ppSerialized) throw();
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error handling support.
 namespace std { class error_code; }
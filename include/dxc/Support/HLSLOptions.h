@@ -98,6 +98,7 @@ public:
   llvm::StringRef ExtractPrivateFile; // OPT_getprivate
   llvm::StringRef ForceRootSigVer; // OPT_force_rootsig_ver
   llvm::StringRef InputFile; // OPT_INPUT
+  llvm::SmallVector<llvm::StringRef, 1> InputFiles; // OPT_INPUT, several with -dumpbin
   llvm::StringRef OutputHeader; // OPT_Fh
   llvm::StringRef OutputObject; // OPT_Fo
   llvm::StringRef OutputWarningsFile; // OPT_Fe
@@ -109,6 +110,8 @@ public:
   llvm::StringRef VerifyRootSignatureSource; //OPT_verifyrootsignature
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
   llvm::StringRef FloatDenormalMode; // OPT_denorm
+  llvm::StringRef CacheDirectory; // OPT_cache_dir
+  llvm::SmallVector<llvm::StringRef, 4> SpecializationConstants; // OPT_specialize_constant
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
   bool AstDump = false; // OPT_ast_dump
@@ -121,6 +124,8 @@ public:
   bool WarningAsError = false; // OPT__SLASH_WX
   bool IEEEStrict = false;     // OPT_Gis
   bool IgnoreLineDirectives = false; // OPT_ignore_line_directives
+  bool ArenaAlloc = false; // OPT_arena_alloc
+  bool TimeReport = false; // OPT_ftime_report
   bool DefaultColMajor = false;  // OPT_Zpc
   bool DefaultRowMajor = false;  // OPT_Zpr
   bool DisableValidation = false; // OPT_VD
@@ -130,6 +135,7 @@ public:
   bool PreferFlowControl = false;    // OPT_Gfp
   bool EnableStrictMode = false;     // OPT_Ges
   unsigned long HLSLVersion = 0; // OPT_hlsl_version (2015-2018)
+  unsigned long CacheMaxSizeInMB = 1024; // OPT_cache_max_size
   bool Enable16BitTypes = false; // OPT_enable_16bit_types
   bool OptDump = false; // OPT_ODump - dump optimizer commands
   bool OutputWarnings = true; // OPT_no_warnings
@@ -172,6 +178,7 @@ public:
   llvm::SmallVector<int32_t, 4> VkUShift;  // OPT_fvk_u_shift
   llvm::SmallVector<llvm::StringRef, 4> SpvExtensions; // OPT_fspv_extension
   llvm::StringRef SpvTargetEnv;                        // OPT_fspv_target_env
+  llvm::SmallVector<llvm::StringRef, 4> SpvOconfig;    // OPT_Oconfig
 #endif
   // SPIRV Change Ends
 };
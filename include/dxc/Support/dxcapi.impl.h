@@ -32,7 +32,7 @@ public:
   }
 };
 
-class DxcOperationResult : public IDxcOperationResult {
+class DxcOperationResult : public IDxcOperationResult, public IDxcTimeReport {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 
@@ -50,9 +50,11 @@ public:
   HRESULT m_status;
   CComPtr<IDxcBlob> m_result;
   CComPtr<IDxcBlobEncoding> m_errors;
+  CComPtr<IDxcBlobEncoding> m_timeReport; // Set when -ftime-report is used.
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcOperationResult>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOperationResult, IDxcTimeReport>(
+        this, iid, ppvObject);
   }
 
   static HRESULT CreateFromResultErrorStatus(_In_opt_ IDxcBlob *pResultBlob,
@@ -114,6 +116,14 @@ public:
     GetErrorBuffer(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppErrors) {
     return m_errors.CopyTo(ppErrors);
   }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetTimeReport(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) {
+    if (ppReport == nullptr)
+      return E_INVALIDARG;
+    m_timeReport.CopyTo(ppReport);
+    return m_timeReport ? S_OK : S_FALSE;
+  }
 };
 
 #endif
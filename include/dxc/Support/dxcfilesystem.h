@@ -13,6 +13,8 @@
 
 #include "dxc/dxcapi.h"
 #include "llvm/Support/MSFileSystem.h"
+#include <string>
+#include <vector>
 
 namespace clang {
 class CompilerInstance;
@@ -31,6 +33,8 @@ class MSFileSystem;
 
 namespace dxcutil {
 
+struct DxcIncludedFileRecord;
+
 class DxcArgsFileSystem : public ::llvm::sys::fs::MSFileSystem {
 public:
   virtual ~DxcArgsFileSystem(){};
@@ -40,6 +44,12 @@ public:
   virtual void EnableDisplayIncludeProcess() = 0;
   virtual HRESULT CreateStdStreams(_In_ IMalloc *pMalloc) = 0;
   virtual HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) = 0;
+  // Appends every file requested from the include handler, including the
+  // ones it could not find, in the order they were first requested.
+  virtual void GetIncludedFiles(std::vector<DxcIncludedFileRecord> &files) = 0;
+  // Provides files already loaded through the include handler (a nullptr
+  // blob meaning not found); they are served without asking it again.
+  virtual void AddPreloadedFiles(std::vector<DxcIncludedFileRecord> &files) = 0;
 };
 
 DxcArgsFileSystem *
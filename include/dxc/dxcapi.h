@@ -138,6 +138,37 @@ IDxcIncludeHandler : public IUnknown {
     ) = 0;
 };
 
+static const UINT32 DxcIncludeCacheFlags_None = 0;
+// Files the cache read from disk are served only while their size and last
+// write time are unchanged.
+static const UINT32 DxcIncludeCacheFlags_ValidateTimestamp = 1;
+// Files are loaded again on every request and served from the cache only if
+// the contents hash the same, so compilations share one copy.
+static const UINT32 DxcIncludeCacheFlags_ValidateContent = 2;
+static const UINT32 DxcIncludeCacheFlags_ValidMask = 0x3;
+
+// A cache of included files that can be shared by concurrent compilations.
+struct __declspec(uuid("40d1d20d-3b71-44c7-be12-1ea34edc4ef7"))
+IDxcIncludeCache : public IUnknown {
+  // Creates a handler that serves files from the cache, loading misses through
+  // pInnerHandler or, if it is null, by reading a copy of the file from disk.
+  // Entries are keyed by file name within pNamespace, so handlers created with
+  // the same namespace share them even if their inner handlers differ; callers
+  // must only share a namespace between inner handlers that return the same
+  // contents for a name, or ask for validation. With a null namespace, files
+  // from an inner handler are only shared with other handlers created for
+  // that same inner handler, which the cache keeps alive until its entries
+  // are evicted, Clear is called or the cache is released.
+  virtual HRESULT STDMETHODCALLTYPE CreateIncludeHandler(
+    _In_opt_ IDxcIncludeHandler *pInnerHandler,     // Handler for files not in the cache.
+    _In_opt_z_ LPCWSTR pNamespace,                  // Entries to share; null for pInnerHandler's own.
+    UINT32 flags,                                   // DxcIncludeCacheFlags_* values.
+    _COM_Outptr_ IDxcIncludeHandler **ppResult
+    ) = 0;
+  // Drops every cached file, including those not found.
+  virtual HRESULT STDMETHODCALLTYPE Clear() = 0;
+};
+
 struct DxcDefine {
   LPCWSTR Name;
   _Maybenull_ LPCWSTR Value;
@@ -197,6 +228,131 @@ IDxcCompiler2 : public IDxcCompiler {
   ) = 0;
 };
 
+struct DxcCompileCacheStatistics {
+  UINT64 Hits;      // Compilations served from the cache.
+  UINT64 Misses;    // Cacheable compilations that had to be performed.
+  UINT64 Stores;    // Results written to the cache.
+  UINT64 Evictions; // Entries removed to stay within the cache size.
+};
+
+// Available on the compiler object; counts activity for compilations that
+// specify a cache directory with -cache-dir.
+struct __declspec(uuid("c6e5a6e9-1ee5-47c7-9835-85f2368916d5"))
+IDxcCompileCacheStatistics : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ DxcCompileCacheStatistics *pStats) = 0;
+  virtual HRESULT STDMETHODCALLTYPE ResetStatistics() = 0;
+};
+
+struct DxcArenaStatistics {
+  UINT64 Compilations;       // Compilations that used an arena.
+  UINT64 PeakLiveBytes;      // Largest number of live arena bytes in any compilation.
+  UINT64 PeakReservedBytes;  // Largest arena footprint of any compilation.
+  UINT64 TotalReservedBytes; // Arena footprint summed over all compilations.
+};
+
+// Available on the compiler object; reports memory use of compilations that
+// specify -arena-alloc.
+struct __declspec(uuid("9ec98c45-2687-4ca8-8927-47da06078b9a"))
+IDxcArenaStatistics : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetArenaStatistics(_Out_ DxcArenaStatistics *pStats) = 0;
+  virtual HRESULT STDMETHODCALLTYPE ResetArenaStatistics() = 0;
+};
+
+struct DxcValidationCacheStatistics {
+  UINT64 FunctionsValidated; // Function bodies that had to be validated.
+  UINT64 FunctionsCached;    // Function bodies skipped as they validated cleanly before.
+};
+
+// Available on the compiler object; counts validation work for compiler
+// sessions, which keep the functions that passed validation across
+// compilations. Other compiler objects don't keep functions and report zero.
+struct __declspec(uuid("0e1f6a5c-4c1b-4b8e-a7d2-93c58e2f4b16"))
+IDxcValidationCacheStatistics : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetValidationCacheStatistics(_Out_ DxcValidationCacheStatistics *pStats) = 0;
+  virtual HRESULT STDMETHODCALLTYPE ResetValidationCacheStatistics() = 0;
+};
+
+// Available on the result of a compilation; returns the phase timing report
+// requested with -ftime-report. GetTimeReport returns S_FALSE and a null blob
+// when no report was requested.
+struct __declspec(uuid("5d3b2f8c-7c44-4a1e-9b0e-3f6a1d2c8e47"))
+IDxcTimeReport : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetTimeReport(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) = 0;
+};
+
+// Receives the text produced by IDxcBatchDisassembler::DisassembleMany.
+// Calls are made one at a time and in the order the programs were given, but
+// not necessarily on the calling thread.
+struct __declspec(uuid("11ed64b4-cd24-4a1d-b543-bb48377992d1"))
+IDxcDisassemblyWriter : public IUnknown {
+  // status is the result of disassembling program index; the text is empty
+  // if it failed. Returning a failure stops the batch.
+  virtual HRESULT STDMETHODCALLTYPE WriteDisassembly(UINT32 index,
+    HRESULT status, _In_reads_(textSize) LPCSTR pText, SIZE_T textSize) = 0;
+};
+
+// Available on the compiler object.
+struct __declspec(uuid("4930162a-1f3d-400c-ba0d-67487195db5b"))
+IDxcBatchDisassembler : public IUnknown {
+  // Disassembles several programs on up to threadCount threads (zero for one
+  // per processor), as IDxcCompiler::Disassemble would. Each text is passed
+  // to pWriter as soon as it and the ones before it are done, so only a few
+  // texts per thread are held at any time. Returns the failure from
+  // pWriter, if any; errors in individual programs are reported through it.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleMany(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _In_ IDxcDisassemblyWriter *pWriter) = 0;
+};
+
+// Available on the compiler object. Finishes compiling a high-level module
+// produced with /fcgl and /specialize-constant, once for each set of values
+// of its specialization constants.
+struct __declspec(uuid("b36ae650-268f-4205-9535-f712f079931f"))
+IDxcSpecializer : public IUnknown {
+  // pValues holds specializationCount rows of constantCount values, as text
+  // (e.g. L"3", L"true", L"0.5"), for the constants named in pConstantNames;
+  // other constants keep the value they were declared with. Specializations
+  // are compiled on up to threadCount threads (zero for one per processor),
+  // and each gets its own result, holding a validated container on success.
+  virtual HRESULT STDMETHODCALLTYPE Specialize(
+    _In_ IDxcBlob *pHighLevelModule,
+    UINT32 constantCount, _In_count_(constantCount) LPCWSTR *pConstantNames,
+    UINT32 specializationCount,
+    _In_count_(constantCount * specializationCount) LPCWSTR *pValues,
+    UINT32 threadCount,
+    _Out_writes_(specializationCount) IDxcOperationResult **ppResults) = 0;
+};
+
+// An entry of the stream output declaration of a pipeline, naming an output
+// element of the last stage before the rasterizer, as in
+// D3D12_SO_DECLARATION_ENTRY.
+struct DxcStreamOutputEntry {
+  UINT32 Stream;
+  LPCWSTR SemanticName;
+  UINT32 SemanticIndex;
+};
+
+// Available on the compiler object. Links the compiled stages of a graphics
+// pipeline: user-defined outputs that the next stage doesn't read are
+// removed, along with the code computing them, and the signatures on both
+// sides are repacked to line up.
+struct __declspec(uuid("bd731ab6-e3a6-4b4f-aa24-950bebd1dcaf"))
+IDxcPipelineLinker : public IUnknown {
+  // ppStages holds stageCount shaders in pipeline order: a vertex shader,
+  // optionally a hull and domain shader, optionally a geometry shader, and
+  // optionally a pixel shader. pStreamOutputEntries holds the stream output
+  // declaration of the pipeline, if any; the outputs it names are kept
+  // whether or not the pixel shader reads them. Without a pixel shader, no
+  // other user-defined outputs of the last stage are kept. Each stage gets
+  // its own result, holding a validated container; stages that didn't
+  // change hold the shader as given.
+  virtual HRESULT STDMETHODCALLTYPE LinkPipeline(
+    UINT32 stageCount, _In_count_(stageCount) IDxcBlob **ppStages,
+    UINT32 streamOutputEntryCount,
+    _In_count_(streamOutputEntryCount) const DxcStreamOutputEntry *pStreamOutputEntries,
+    _Out_writes_(stageCount) IDxcOperationResult **ppResults) = 0;
+};
+
 struct __declspec(uuid("F1B5BE2A-62DD-4327-A1C2-42AC1E1E78E6"))
 IDxcLinker : public IUnknown {
 public:
@@ -222,6 +378,29 @@ public:
   ) = 0;
 };
 
+struct __declspec(uuid("b3f0a7c1-4e2d-4f6b-8a95-2c7d1e6f3b08"))
+IDxcLinker2 : public IDxcLinker {
+  // Links several entry points against the same libraries. The libraries
+  // are attached once for the whole batch, and each entry point gets its own
+  // result, in the order given; a failure to link one entry point doesn't
+  // affect the others.
+  virtual HRESULT STDMETHODCALLTYPE LinkMany(
+      _In_ UINT32 entryCount,       // Number of entry points to link
+      _In_count_(entryCount)
+          const LPCWSTR *pEntryNames, // Array of entry point names
+      _In_count_(entryCount)
+          const LPCWSTR *pTargetProfiles, // Shader profile for each entry point
+      _In_count_(libCount)
+          const LPCWSTR *pLibNames, // Array of library names to link
+      UINT32 libCount,              // Number of libraries to link
+      _In_count_(argCount)
+          const LPCWSTR *pArguments, // Array of pointers to arguments
+      _In_ UINT32 argCount,          // Number of arguments
+      _Out_writes_(entryCount) IDxcOperationResult *
+          *ppResults // Linker output status, buffer, and errors per entry
+  ) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
@@ -284,6 +463,49 @@ IDxcOptimizer : public IUnknown {
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+// A module loaded by IDxcOptimizerPipeline::LoadModule. Pipelines can be run
+// over it repeatedly without writing it out as bitcode in between.
+struct __declspec(uuid("b3a3665f-a4ad-40c9-badf-ca78e7229ad8"))
+IDxcOptimizerModule : public IUnknown {
+  // Writes the module out as bitcode.
+  virtual HRESULT STDMETHODCALLTYPE GetBitcode(_COM_Outptr_ IDxcBlob **ppResult) = 0;
+};
+
+// A pass list parsed once by IDxcOptimizer2::CreatePipeline, to be run over
+// many modules. Options are interpreted as in IDxcOptimizer::RunOptimizer.
+// A pipeline may be used from several threads at once, as long as each
+// module is only used by one thread at a time.
+struct __declspec(uuid("0356d975-ecb1-42f4-abcf-adde89fa502c"))
+IDxcOptimizerPipeline : public IUnknown {
+  // Loads a module from a DXIL container, bitcode or textual IR.
+  virtual HRESULT STDMETHODCALLTYPE LoadModule(_In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcOptimizerModule **ppModule) = 0;
+  // Runs the passes over a module returned by LoadModule, in place.
+  virtual HRESULT STDMETHODCALLTYPE RunOnModule(_In_ IDxcOptimizerModule *pModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+  // Runs the passes over a module blob; same as IDxcOptimizer::RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE Run(_In_ IDxcBlob *pBlob,
+    _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+  // Runs the passes over several module blobs on up to threadCount threads
+  // (zero for one per processor). Each module gets its own status in
+  // pStatus; a failure in one module doesn't affect the others.
+  virtual HRESULT STDMETHODCALLTYPE RunMany(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) HRESULT *pStatus,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) = 0;
+};
+
+struct __declspec(uuid("a0cfaeb7-7c1f-4882-a4b0-8c553192315e"))
+IDxcOptimizer2 : public IDxcOptimizer {
+  // Parses and looks up the passes in ppOptions once, for use on many
+  // modules.
+  virtual HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppResult) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal = 2; // Internal Validator (non-signing)
@@ -302,6 +524,28 @@ __declspec(selectany) extern const CLSID CLSID_DxcCompiler = {
   { 0xb5, 0xbf, 0xf0, 0x66, 0x4f, 0x39, 0xc1, 0xb0 }
 };
 
+// {f438da1b-f7b5-4250-968e-753e8c705845}
+// A compiler with a persistent validator: the validator instance and its
+// version are created once and reused by every compilation, for callers that
+// compile many small shaders. Each compilation still builds its own
+// LLVMContext, HLSL builtin declarations and DXIL operation tables. Results
+// are identical to those of CLSID_DxcCompiler. Unlike CLSID_DxcCompiler, a
+// session must only be used by one thread at a time.
+__declspec(selectany) extern const CLSID CLSID_DxcCompilerSession = {
+  0xf438da1b,
+  0xf7b5,
+  0x4250,
+  { 0x96, 0x8e, 0x75, 0x3e, 0x8c, 0x70, 0x58, 0x45 }
+};
+
+// {5aeff93e-6e1d-4aac-a752-f8590b6e5cbd}
+__declspec(selectany) extern const CLSID CLSID_DxcIncludeCache = {
+  0x5aeff93e,
+  0x6e1d,
+  0x4aac,
+  { 0xa7, 0x52, 0xf8, 0x59, 0x0b, 0x6e, 0x5c, 0xbd }
+};
+
 // {EF6A8087-B0EA-4D56-9E45-D07E1A8B7806}
 __declspec(selectany) extern const GUID CLSID_DxcLinker = {
     0xef6a8087,
@@ -19,6 +19,8 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/PhaseTimeReport.h" // HLSL Change
+#include "llvm/Support/Timer.h"           // HLSL Change
 #include <map>
 #include <vector>
 
@@ -474,6 +476,28 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+// HLSL Change Starts
+/// Times a pass run with its -time-passes timer, and as a phase of the phase
+/// time report installed for the calling thread, if any.
+class PassTimeRegion {
+  TimeRegion PassTimer;
+  PhaseTimeReport *Report;
+  PassTimeRegion(const PassTimeRegion &) = delete;
+  void operator=(const PassTimeRegion &) = delete;
+
+public:
+  explicit PassTimeRegion(Pass *P)
+      : PassTimer(getPassTimer(P)), Report(PhaseTimeReport::getCurrent()) {
+    if (Report)
+      Report->startPhase(P->getPassName());
+  }
+  ~PassTimeRegion() {
+    if (Report)
+      Report->stopPhase();
+  }
+};
+// HLSL Change Ends
+
 }
 
 #endif
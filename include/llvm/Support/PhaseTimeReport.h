@@ -0,0 +1,118 @@
+//===-- llvm/Support/PhaseTimeReport.h - Nested phase timing ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// PhaseTimeReport collects wall-clock times for a tree of named phases within
+// a single compilation. Unlike TimerGroup, a report is only visible to the
+// thread that installed it, so several compilations can be timed concurrently
+// in the same process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PHASETIMEREPORT_H
+#define LLVM_SUPPORT_PHASETIMEREPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+class PhaseTimeReport {
+public:
+  /// Returns the number of bytes allocated so far; sampled when a phase
+  /// starts and stops.
+  typedef std::function<uint64_t()> AllocationCounter;
+
+private:
+  struct Phase {
+    std::string Name;
+    Phase *Parent;
+    std::vector<std::unique_ptr<Phase>> Children;
+    unsigned Calls = 0;
+    double Seconds = 0;
+    uint64_t AllocatedBytes = 0;
+    // Values sampled when the currently open invocation started.
+    double StartSeconds = 0;
+    uint64_t StartBytes = 0;
+
+    Phase(StringRef Name, Phase *Parent) : Name(Name), Parent(Parent) {}
+    Phase *getChild(StringRef Name);
+  };
+
+  Phase Root;
+  Phase *Current;
+  AllocationCounter Counter;
+
+  PhaseTimeReport(const PhaseTimeReport &) = delete;
+  void operator=(const PhaseTimeReport &) = delete;
+  void printPhase(raw_ostream &OS, const Phase &P, unsigned Depth,
+                  double TotalSeconds) const;
+
+public:
+  PhaseTimeReport();
+  ~PhaseTimeReport();
+
+  void setAllocationCounter(AllocationCounter C) { Counter = std::move(C); }
+
+  /// Opens a phase nested in the current one. Phases with the same name under
+  /// the same parent are aggregated.
+  void startPhase(StringRef Name);
+  /// Closes the most recently opened phase.
+  void stopPhase();
+
+  /// Prints the phase tree with wall time, share of the total, self time
+  /// (excluding nested phases), call count and allocated bytes.
+  void print(raw_ostream &OS) const;
+
+  /// The report installed for the calling thread, or nullptr.
+  static PhaseTimeReport *getCurrent();
+  /// Installs a report for the calling thread and returns the prior one.
+  static PhaseTimeReport *setCurrent(PhaseTimeReport *Report);
+};
+
+/// Times a phase in the report installed for the calling thread, if any.
+class PhaseTimeRegion {
+  PhaseTimeReport *Report;
+  PhaseTimeRegion(const PhaseTimeRegion &) = delete;
+  void operator=(const PhaseTimeRegion &) = delete;
+
+public:
+  explicit PhaseTimeRegion(StringRef Name)
+      : Report(PhaseTimeReport::getCurrent()) {
+    if (Report)
+      Report->startPhase(Name);
+  }
+  ~PhaseTimeRegion() {
+    if (Report)
+      Report->stopPhase();
+  }
+};
+
+/// Installs a report for the calling thread for the lifetime of the object.
+class PhaseTimeReportScope {
+  PhaseTimeReport *Prior;
+  PhaseTimeReportScope(const PhaseTimeReportScope &) = delete;
+  void operator=(const PhaseTimeReportScope &) = delete;
+
+public:
+  explicit PhaseTimeReportScope(PhaseTimeReport *Report)
+      : Prior(PhaseTimeReport::setCurrent(Report)) {}
+  ~PhaseTimeReportScope() { PhaseTimeReport::setCurrent(Prior); }
+};
+
+} // end namespace llvm
+
+#endif
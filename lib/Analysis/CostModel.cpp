@@ -512,7 +512,7 @@ unsigned CostModelAnalysis::getInstructionCost(const Instruction *I) const {
       return TTI->getIntrinsicInstrCost(II->getIntrinsicID(), II->getType(),
                                         Tys);
     }
-    return -1;
+    return TTI->getUserCost(I); // HLSL Change - cost calls such as DXIL ops
   default:
     // We don't have any information on this instruction.
     return -1;
@@ -126,7 +126,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
     }
 
     {
-      TimeRegion PassTimer(getPassTimer(CGSP));
+      PassTimeRegion PassTimer(CGSP); // HLSL Change
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
@@ -150,7 +150,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
     if (Function *F = CGN->getFunction()) {
       dumpPassInfo(P, EXECUTION_MSG, ON_FUNCTION_MSG, F->getName());
       {
-        TimeRegion PassTimer(getPassTimer(FPP));
+        PassTimeRegion PassTimer(FPP); // HLSL Change
         Changed |= FPP->runOnFunction(*F);
       }
       F->getContext().yield();
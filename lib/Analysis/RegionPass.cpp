@@ -95,7 +95,7 @@ bool RGPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
-        TimeRegion PassTimer(getPassTimer(P));
+        PassTimeRegion PassTimer(P); // HLSL Change
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
@@ -307,11 +307,15 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.Preprocess = Args.getLastArgValue(OPT_P);
   opts.AstDump = Args.hasFlag(OPT_ast_dump, OPT_INVALID, false);
   opts.CodeGenHighLevel = Args.hasFlag(OPT_fcgl, OPT_INVALID, false);
+  for (const Arg *A : Args.filtered(OPT_specialize_constant))
+    opts.SpecializationConstants.push_back(A->getValue());
   opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false);
   opts.DebugNameForBinary = Args.hasFlag(OPT_Zsb, OPT_INVALID, false);
   opts.DebugNameForSource = Args.hasFlag(OPT_Zss, OPT_INVALID, false);
   opts.VariableName = Args.getLastArgValue(OPT_Vn);
   opts.InputFile = Args.getLastArgValue(OPT_INPUT);
+  for (const Arg *A : Args.filtered(OPT_INPUT))
+    opts.InputFiles.push_back(A->getValue());
   opts.ForceRootSigVer = Args.getLastArgValue(OPT_force_rootsig_ver);
   opts.PrivateSource = Args.getLastArgValue(OPT_setprivate);
   opts.RootSignatureSource = Args.getLastArgValue(OPT_setrootsignature);
@@ -329,6 +333,25 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
 
   opts.IgnoreLineDirectives = Args.hasFlag(OPT_ignore_line_directives, OPT_INVALID, false);
 
+  opts.ArenaAlloc = Args.hasFlag(OPT_arena_alloc, OPT_INVALID, false);
+  opts.TimeReport = Args.hasFlag(OPT_ftime_report, OPT_INVALID, false);
+
+  opts.CacheDirectory = Args.getLastArgValue(OPT_cache_dir);
+  llvm::StringRef cacheMaxSize = Args.getLastArgValue(OPT_cache_max_size);
+  if (!cacheMaxSize.empty()) {
+    try {
+      opts.CacheMaxSizeInMB = std::stoul(std::string(cacheMaxSize));
+    }
+    catch (const std::invalid_argument &) {
+      errors << "Invalid cache size";
+      return 1;
+    }
+    catch (const std::out_of_range &) {
+      errors << "Invalid cache size";
+      return 1;
+    }
+  }
+
   opts.FloatDenormalMode = Args.getLastArgValue(OPT_denorm);
   // Check if a given denormalized value is valid
   if (!opts.FloatDenormalMode.empty()) {
@@ -417,6 +440,10 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     errors << "Cannot specify /Gfa and /Gfp together, use /? to get usage information";
     return 1;
   }
+  if (!opts.SpecializationConstants.empty() && !opts.CodeGenHighLevel) {
+    errors << "Specialization constants can only be left unresolved in high-level code (/fcgl).";
+    return 1;
+  }
   if (opts.PackPrefixStable && opts.PackOptimized) {
     errors << "Cannot specify /pack_prefix_stable and /pack_optimized together, use /? to get usage information";
     return 1;
@@ -462,6 +489,16 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       errors << "Cannot specify compilation options when reading a binary file.";
       return 1;
     }
+    // Several binaries are disassembled in one batch; the other actions
+    // write a single output.
+    if (opts.InputFiles.size() > 1 &&
+        (!opts.OutputObject.empty() || !opts.OutputHeader.empty() ||
+         !opts.DebugFile.empty() || !opts.ExtractPrivateFile.empty() ||
+         !opts.VerifyRootSignatureSource.empty() ||
+         opts.ExtractRootSignature || opts.OptDump)) {
+      errors << "Only disassembly can be output when reading several binary files.";
+      return 1;
+    }
   }
 
   if ((flagsToInclude & hlsl::options::DriverOption) &&
@@ -545,6 +582,23 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   opts.SpvTargetEnv = Args.getLastArgValue(OPT_fspv_target_env_EQ, "vulkan1.0");
+
+  // Each -Oconfig= may carry several comma-separated passes; they accumulate
+  // in command line order.
+  for (const Arg *A : Args.filtered(OPT_Oconfig)) {
+    for (const char *pass : A->getValues())
+      opts.SpvOconfig.push_back(pass);
+  }
+  if (!opts.SpvOconfig.empty()) {
+    if (!genSpirv) {
+      errors << "-Oconfig requires -spirv";
+      return 1;
+    }
+    if (Args.getLastArg(OPT_O0, OPT_O1, OPT_O2, OPT_O3, OPT_Od)) {
+      errors << "-Oconfig should not be specified together with -O";
+      return 1;
+    }
+  }
 #else
   if (Args.hasFlag(OPT_spirv, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_invert_y, OPT_INVALID, false) ||
@@ -554,6 +608,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       !Args.getLastArgValue(OPT_fvk_stage_io_order_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_extension_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_target_env_EQ).empty() ||
+      Args.hasArg(OPT_Oconfig) ||
       !Args.getLastArgValue(OPT_fvk_b_shift).empty() ||
       !Args.getLastArgValue(OPT_fvk_t_shift).empty() ||
       !Args.getLastArgValue(OPT_fvk_s_shift).empty() ||
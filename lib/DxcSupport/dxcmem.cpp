@@ -13,7 +13,11 @@
 #include <specstrings.h>
 
 #include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/microcom.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 static DWORD g_ThreadMallocTlsIndex;
 static IMalloc *g_pDefaultMalloc;
@@ -92,3 +96,355 @@ IMalloc *DxcSwapThreadMalloc(IMalloc *pMalloc, IMalloc **ppPrior) {
 IMalloc *DxcSwapThreadMallocOrDefault(IMalloc *pMallocOrNull, IMalloc **ppPrior) {
   return DxcSwapThreadMalloc(pMallocOrNull ? pMallocOrNull : g_pDefaultMalloc, ppPrior);
 }
+
+namespace {
+class DxcArenaMalloc : public IMalloc {
+private:
+  // m_pMalloc is the parent allocator.
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  struct Block {
+    char *Begin;
+    char *End;
+  };
+  // Each allocation is preceded by its size; the header is padded so that
+  // allocations are aligned as they would be from the default allocator.
+  struct AllocHeader {
+    SIZE_T Size;
+    AllocHeader *pNextFree; // Set while the allocation is on a free list.
+  };
+  static const SIZE_T Alignment = sizeof(AllocHeader);
+  static const SIZE_T MinBlockSize = 64 * 1024;
+  static const SIZE_T MaxBlockSize = 4 * 1024 * 1024;
+  static const SIZE_T LargeAllocationSize = 256 * 1024;
+  // Freed allocations up to this size are kept on a free list per aligned
+  // size, so that containers that grow by reallocating don't use up the
+  // arena with the buffers they leave behind.
+  static const SIZE_T MaxFreeListSize = 4 * 1024;
+  static const SIZE_T FreeListCount = MaxFreeListSize / Alignment + 1;
+
+  // Blocks are sorted by address so ownership can be checked by a binary
+  // search. The array is allocated from the parent, as allocating it from
+  // the arena itself would recurse.
+  Block *m_pBlocks = nullptr;
+  SIZE_T m_blockCount = 0;
+  SIZE_T m_blockCapacity = 0;
+  char *m_pBlockBegin = nullptr; // Block being allocated from.
+  char *m_pCur = nullptr;
+  char *m_pEnd = nullptr;
+  char *m_pLast = nullptr; // Header of the most recent live allocation.
+  AllocHeader *m_pFreeLists[FreeListCount] = {};
+  DxcArenaMallocStats m_stats = {};
+
+  static SIZE_T AlignSize(SIZE_T cb) {
+    return (cb + Alignment - 1) & ~(Alignment - 1);
+  }
+  static AllocHeader *HeaderOf(void *pv) {
+    return reinterpret_cast<AllocHeader *>(pv) - 1;
+  }
+
+  bool IsOwned(void *pv) const {
+    char *p = reinterpret_cast<char *>(pv);
+    if (m_pBlockBegin <= p && p < m_pCur)
+      return true;
+    const Block *pEnd = m_pBlocks + m_blockCount;
+    const Block *pUpper = std::upper_bound(
+        m_pBlocks, pEnd, p,
+        [](const char *p, const Block &b) { return p < b.Begin; });
+    return pUpper != m_pBlocks && p < (pUpper - 1)->End;
+  }
+
+  bool NewBlock(SIZE_T minSize) {
+    if (m_blockCount == m_blockCapacity) {
+      SIZE_T newCapacity = m_blockCapacity ? m_blockCapacity * 2 : 16;
+      Block *pNewBlocks = reinterpret_cast<Block *>(
+          m_pMalloc->Realloc(m_pBlocks, newCapacity * sizeof(Block)));
+      if (pNewBlocks == nullptr)
+        return false;
+      m_pBlocks = pNewBlocks;
+      m_blockCapacity = newCapacity;
+    }
+    // Grow block sizes with the arena, so that large compilations don't end
+    // up with many small blocks.
+    SIZE_T size = std::min<SIZE_T>(
+        MaxBlockSize,
+        std::max<SIZE_T>(MinBlockSize, (SIZE_T)m_stats.ReservedBytes));
+    size = std::max(size, minSize);
+    char *pBlock = reinterpret_cast<char *>(m_pMalloc->Alloc(size));
+    if (pBlock == nullptr)
+      return false;
+    Block block = { pBlock, pBlock + size };
+    Block *pEnd = m_pBlocks + m_blockCount;
+    Block *pInsert = std::upper_bound(
+        m_pBlocks, pEnd, block,
+        [](const Block &a, const Block &b) { return a.Begin < b.Begin; });
+    std::move_backward(pInsert, pEnd, pEnd + 1);
+    *pInsert = block;
+    ++m_blockCount;
+    m_pBlockBegin = m_pCur = pBlock;
+    m_pEnd = pBlock + size;
+    m_pLast = nullptr;
+    m_stats.ReservedBytes += size;
+    ++m_stats.BlockCount;
+    return true;
+  }
+
+  void AddLiveBytes(SIZE_T cb) {
+    m_stats.LiveBytes += cb;
+    if (m_stats.LiveBytes > m_stats.PeakLiveBytes)
+      m_stats.PeakLiveBytes = m_stats.LiveBytes;
+  }
+
+  void *AllocFromBlocks(SIZE_T cb) {
+    if (cb > LargeAllocationSize)
+      return m_pMalloc->Alloc(cb);
+    if (AlignSize(cb) <= MaxFreeListSize) {
+      AllocHeader *&pFree = m_pFreeLists[AlignSize(cb) / Alignment];
+      if (pFree != nullptr) {
+        AllocHeader *pHeader = pFree;
+        pFree = pHeader->pNextFree;
+        pHeader->Size = cb;
+        ++m_stats.AllocationCount;
+        AddLiveBytes(cb);
+        return pHeader + 1;
+      }
+    }
+    SIZE_T total = sizeof(AllocHeader) + AlignSize(cb);
+    if ((SIZE_T)(m_pEnd - m_pCur) < total && !NewBlock(total))
+      return nullptr;
+    AllocHeader *pHeader = reinterpret_cast<AllocHeader *>(m_pCur);
+    pHeader->Size = cb;
+    m_pLast = m_pCur;
+    m_pCur += total;
+    ++m_stats.AllocationCount;
+    AddLiveBytes(cb);
+    return pHeader + 1;
+  }
+
+  void FreeToBlocks(void *pv) {
+    if (!IsOwned(pv)) {
+      m_pMalloc->Free(pv);
+      return;
+    }
+    AllocHeader *pHeader = HeaderOf(pv);
+    m_stats.LiveBytes -= pHeader->Size;
+    if (reinterpret_cast<char *>(pHeader) == m_pLast) {
+      m_pCur = m_pLast;
+      m_pLast = nullptr;
+    } else if (AlignSize(pHeader->Size) <= MaxFreeListSize) {
+      AllocHeader *&pFree = m_pFreeLists[AlignSize(pHeader->Size) / Alignment];
+      pHeader->pNextFree = pFree;
+      pFree = pHeader;
+    }
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR_ONLY(DxcArenaMalloc)
+
+  ~DxcArenaMalloc() {
+    for (SIZE_T i = 0; i < m_blockCount; ++i)
+      m_pMalloc->Free(m_pBlocks[i].Begin);
+    m_pMalloc->Free(m_pBlocks);
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    return AllocFromBlocks(cb);
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (pv == nullptr)
+      return AllocFromBlocks(cb);
+    if (cb == 0) {
+      FreeToBlocks(pv);
+      return nullptr;
+    }
+    if (!IsOwned(pv))
+      return m_pMalloc->Realloc(pv, cb);
+
+    AllocHeader *pHeader = HeaderOf(pv);
+    SIZE_T oldSize = pHeader->Size;
+    if (cb <= AlignSize(oldSize) ||
+        (reinterpret_cast<char *>(pHeader) == m_pLast &&
+         cb <= LargeAllocationSize &&
+         (SIZE_T)(m_pEnd - m_pLast) >= sizeof(AllocHeader) + AlignSize(cb))) {
+      // Resize in place; the most recent allocation can grow into the rest
+      // of the block.
+      if (reinterpret_cast<char *>(pHeader) == m_pLast)
+        m_pCur = m_pLast + sizeof(AllocHeader) + AlignSize(cb);
+      pHeader->Size = cb;
+      m_stats.LiveBytes -= oldSize;
+      AddLiveBytes(cb);
+      return pv;
+    }
+
+    void *pNew = AllocFromBlocks(cb);
+    if (pNew == nullptr)
+      return nullptr;
+    memcpy(pNew, pv, std::min(oldSize, cb));
+    FreeToBlocks(pv);
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    if (pv == nullptr)
+      return;
+    FreeToBlocks(pv);
+  }
+
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    if (pv == nullptr)
+      return (SIZE_T)-1;
+    if (!IsOwned(pv))
+      return m_pMalloc->GetSize(pv);
+    return HeaderOf(pv)->Size;
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    if (pv == nullptr)
+      return -1;
+    return IsOwned(pv) ? 1 : m_pMalloc->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize() override {
+    m_pMalloc->HeapMinimize();
+  }
+
+  void GetStats(DxcArenaMallocStats *pStats) const {
+    *pStats = m_stats;
+  }
+};
+} // namespace
+
+namespace {
+class DxcCountingMalloc : public IMalloc {
+private:
+  // m_pMalloc is the parent allocator.
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::atomic<unsigned long long> m_allocatedBytes;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DxcCountingMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_allocatedBytes(0) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    m_allocatedBytes += cb;
+    return m_pMalloc->Alloc(cb);
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    m_allocatedBytes += cb;
+    return m_pMalloc->Realloc(pv, cb);
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override { m_pMalloc->Free(pv); }
+
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    return m_pMalloc->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    return m_pMalloc->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize() override { m_pMalloc->HeapMinimize(); }
+
+  unsigned long long GetAllocatedBytes() const { return m_allocatedBytes; }
+};
+} // namespace
+
+namespace {
+class DxcSerializedMalloc : public IMalloc {
+private:
+  // m_pMalloc is the parent allocator.
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::mutex m_lock;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR_ONLY(DxcSerializedMalloc)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pMalloc->Alloc(cb);
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pMalloc->Realloc(pv, cb);
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pMalloc->Free(pv);
+  }
+
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pMalloc->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pMalloc->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize() override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pMalloc->HeapMinimize();
+  }
+};
+} // namespace
+
+HRESULT DxcCreateCountingMalloc(IMalloc *pParent, IMalloc **ppCounting) {
+  if (pParent == nullptr || ppCounting == nullptr)
+    return E_INVALIDARG;
+  *ppCounting = CreateOnMalloc<DxcCountingMalloc>(pParent);
+  if (*ppCounting == nullptr)
+    return E_OUTOFMEMORY;
+  (*ppCounting)->AddRef();
+  return S_OK;
+}
+
+HRESULT DxcCreateSerializedMalloc(IMalloc *pParent, IMalloc **ppSerialized) {
+  if (pParent == nullptr || ppSerialized == nullptr)
+    return E_INVALIDARG;
+  *ppSerialized = CreateOnMalloc<DxcSerializedMalloc>(pParent);
+  if (*ppSerialized == nullptr)
+    return E_OUTOFMEMORY;
+  (*ppSerialized)->AddRef();
+  return S_OK;
+}
+
+// pCounting must have been created by DxcCreateCountingMalloc.
+unsigned long long DxcGetCountingMallocBytes(IMalloc *pCounting) {
+  return static_cast<DxcCountingMalloc *>(pCounting)->GetAllocatedBytes();
+}
+
+HRESULT DxcCreateArenaMalloc(IMalloc *pParent, IMalloc **ppArena) {
+  if (pParent == nullptr || ppArena == nullptr)
+    return E_INVALIDARG;
+  *ppArena = CreateOnMalloc<DxcArenaMalloc>(pParent);
+  if (*ppArena == nullptr)
+    return E_OUTOFMEMORY;
+  (*ppArena)->AddRef();
+  return S_OK;
+}
+
+// pArena must have been created by DxcCreateArenaMalloc.
+void DxcGetArenaMallocStats(IMalloc *pArena, DxcArenaMallocStats *pStats) {
+  static_cast<DxcArenaMalloc *>(pArena)->GetStats(pStats);
+}
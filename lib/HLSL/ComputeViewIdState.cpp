@@ -13,6 +13,7 @@
 #include "dxc/HLSL/DxilOperations.h"
 #include "dxc/HLSL/DxilInstructions.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
@@ -85,17 +86,17 @@ void DxilViewIdState::Compute() {
 
   // 5. Construct dependency sets.
   for (unsigned StreamId = 0; StreamId < (pSM->IsGS() ? kNumStreams : 1u); StreamId++) {
-    CreateViewIdSets(m_Entry.ContributingInstructions[StreamId],
+    CreateViewIdSets(m_Entry, m_Entry.ContributingSources[StreamId],
                      m_OutputsDependentOnViewId[StreamId],
                      m_InputsContributingToOutputs[StreamId], false);
   }
   if (pSM->IsHS()) {
-    CreateViewIdSets(m_PCEntry.ContributingInstructions[0],
+    CreateViewIdSets(m_PCEntry, m_PCEntry.ContributingSources[0],
                      m_PCOutputsDependentOnViewId,
                      m_InputsContributingToPCOutputs, true);
   } else if (pSM->IsDS()) {
     OutputsDependentOnViewIdType OutputsDependentOnViewId;
-    CreateViewIdSets(m_Entry.ContributingInstructions[0],
+    CreateViewIdSets(m_Entry, m_Entry.ContributingSources[0],
                      OutputsDependentOnViewId,
                      m_PCInputsContributingToOutputs, true);
     DXASSERT_NOMSG(OutputsDependentOnViewId == m_OutputsDependentOnViewId[0]);
@@ -206,6 +207,7 @@ void DxilViewIdState::Clear() {
   m_PCEntry.Clear();
   m_FuncInfo.clear();
   m_ReachingDeclsCache.clear();
+  m_StoresPerDeclCache.clear();
   m_SerializedState.clear();
 }
 
@@ -213,8 +215,11 @@ void DxilViewIdState::EntryInfo::Clear() {
   pEntryFunc = nullptr;
   Functions.clear();
   Outputs.clear();
+  SourceInsts.clear();
+  InstSCC.clear();
+  SCCSources.clear();
   for (unsigned i = 0; i < kNumStreams; i++)
-    ContributingInstructions[i].clear();
+    ContributingSources[i].clear();
 }
 
 void DxilViewIdState::FuncInfo::Clear() {
@@ -400,38 +405,126 @@ void DxilViewIdState::CollectValuesContributingToOutputs(EntryInfo &Entry) {
       endRow = SigElem.GetRows() - 1;
     }
 
-    InstructionSetType ContributingInstructionsAllRows;
-    InstructionSetType *pContributingInstructions = &ContributingInstructionsAllRows;
-    if (startRow == endRow) {
-      // Scalar or indexable with known index.
-      unsigned index = GetLinearIndex(SigElem, startRow, col);
-      pContributingInstructions = &Entry.ContributingInstructions[StreamId][index];
+    // The stored value and the control dependence of this instruction BB.
+    SmallVector<Instruction *, 8> Contributors;
+    AddContributingValue(Entry, pContributingValue, Contributors);
+    AddControlDependence(CI->getParent(), Contributors);
+
+    BitVector Sources;
+    for (Instruction *pInst : Contributors) {
+      Sources |= GetContributingSources(Entry, pInst);
+    }
+
+    // Dynamically indexed output contributions are written to all rows.
+    for (int row = startRow; row <= endRow; row++) {
+      unsigned index = GetLinearIndex(SigElem, row, col);
+      Entry.ContributingSources[StreamId][index] |= Sources;
     }
+  }
+}
 
-    CollectValuesContributingToOutputRec(Entry, pContributingValue, *pContributingInstructions);
+static bool IsContributingSource(Instruction *pInst) {
+  return DxilInst_ViewID(pInst) || DxilInst_LoadInput(pInst) ||
+         DxilInst_LoadOutputControlPoint(pInst) ||
+         DxilInst_LoadPatchConstant(pInst);
+}
 
-    // Handle control dependence of this instruction BB.
-    BasicBlock *pBB = CI->getParent();
-    Function *F = pBB->getParent();
-    FuncInfo *pFuncInfo = m_FuncInfo[F].get();
-    const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
-    for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), *pContributingInstructions);
+// Outputs depend on every instruction reachable from the stored value over
+// the edges given by CollectContributingInstructions; what they record is the
+// ViewID and input loads among them. The edges may form cycles through phis
+// and memory, so instructions are grouped into strongly connected components
+// and each component gets the set of sources reachable from it. The sets are
+// kept for the entry, so an instruction is visited once, however many outputs
+// depend on it.
+const BitVector &DxilViewIdState::GetContributingSources(EntryInfo &Entry,
+                                                         Instruction *pRoot) {
+  auto itSCC = Entry.InstSCC.find(pRoot);
+  if (itSCC != Entry.InstSCC.end())
+    return Entry.SCCSources[itSCC->second];
+
+  // Iterative Tarjan; nodes are numbered in DFS order.
+  struct Node {
+    Instruction *pInst;
+    unsigned LowLink;
+    SmallVector<Instruction *, 8> Deps;
+  };
+  std::vector<Node> Nodes;
+  DenseMap<Instruction *, unsigned> NodeNum;
+  std::vector<unsigned> SCCStack;
+  std::vector<std::pair<unsigned, unsigned>> DFSStack; // node, next dep
+
+  auto PushNode = [&](Instruction *pInst) {
+    unsigned Num = Nodes.size();
+    NodeNum[pInst] = Num;
+    Nodes.emplace_back();
+    Nodes.back().pInst = pInst;
+    Nodes.back().LowLink = Num;
+    CollectContributingInstructions(Entry, pInst, Nodes.back().Deps);
+    SCCStack.push_back(Num);
+    DFSStack.emplace_back(Num, 0);
+  };
+
+  PushNode(pRoot);
+  while (!DFSStack.empty()) {
+    unsigned Num = DFSStack.back().first;
+    unsigned NextDep = DFSStack.back().second;
+    if (NextDep < Nodes[Num].Deps.size()) {
+      DFSStack.back().second++;
+      Instruction *pDep = Nodes[Num].Deps[NextDep];
+      if (Entry.InstSCC.count(pDep))
+        continue;
+      auto itNum = NodeNum.find(pDep);
+      if (itNum == NodeNum.end()) {
+        PushNode(pDep);
+      } else {
+        // Still on the stack, so part of the component being built.
+        Nodes[Num].LowLink = std::min(Nodes[Num].LowLink, itNum->second);
+      }
+      continue;
     }
 
-    if (pContributingInstructions == &ContributingInstructionsAllRows) {
-      // Write dynamically indexed output contributions to all rows.
-      for (int row = startRow; row <= endRow; row++) {
-        unsigned index = GetLinearIndex(SigElem, row, col);
-        Entry.ContributingInstructions[StreamId][index].insert(ContributingInstructionsAllRows.begin(), ContributingInstructionsAllRows.end());
+    DFSStack.pop_back();
+    if (!DFSStack.empty()) {
+      unsigned Parent = DFSStack.back().first;
+      Nodes[Parent].LowLink = std::min(Nodes[Parent].LowLink, Nodes[Num].LowLink);
+    }
+    if (Nodes[Num].LowLink != Num)
+      continue;
+
+    // Num roots a component made of the nodes above it on the stack. Deps
+    // outside of it are in components completed before.
+    unsigned SCCId = Entry.SCCSources.size();
+    size_t First = SCCStack.size();
+    do {
+      --First;
+      Entry.InstSCC[Nodes[SCCStack[First]].pInst] = SCCId;
+    } while (SCCStack[First] != Num);
+
+    BitVector Sources;
+    for (size_t i = First; i < SCCStack.size(); i++) {
+      const Node &N = Nodes[SCCStack[i]];
+      if (IsContributingSource(N.pInst)) {
+        unsigned SourceId = Entry.SourceInsts.size();
+        Entry.SourceInsts.push_back(N.pInst);
+        Sources.resize(SourceId + 1);
+        Sources.set(SourceId);
+      }
+      for (Instruction *pDep : N.Deps) {
+        unsigned DepSCCId = Entry.InstSCC[pDep];
+        if (DepSCCId != SCCId)
+          Sources |= Entry.SCCSources[DepSCCId];
       }
     }
+    SCCStack.resize(First);
+    Entry.SCCSources.emplace_back(std::move(Sources));
   }
+
+  return Entry.SCCSources[Entry.InstSCC[pRoot]];
 }
 
-void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                                           Value *pContributingValue,
-                                                           InstructionSetType &ContributingInstructions) {
+void DxilViewIdState::AddContributingValue(EntryInfo &Entry,
+                                           Value *pContributingValue,
+                                           SmallVectorImpl<Instruction *> &Insts) {
   if (Argument *pArg = dyn_cast<Argument>(pContributingValue)) {
     // This must be a leftover signature argument of an entry function.
     DXASSERT_NOMSG(Entry.pEntryFunc == m_pModule->GetEntryFunction() ||
@@ -446,13 +539,24 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
     return;
   }
 
-  auto itInst = ContributingInstructions.emplace(pContributingInst);
-  // Already visited instruction.
-  if (!itInst.second) return;
+  Insts.push_back(pContributingInst);
+}
 
+void DxilViewIdState::AddControlDependence(BasicBlock *pBB,
+                                           SmallVectorImpl<Instruction *> &Insts) {
+  FuncInfo *pFuncInfo = m_FuncInfo[pBB->getParent()].get();
+  const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
+  for (BasicBlock *B : CtrlDepSet) {
+    Insts.push_back(B->getTerminator());
+  }
+}
+
+void DxilViewIdState::CollectContributingInstructions(EntryInfo &Entry,
+                                                      Instruction *pContributingInst,
+                                                      SmallVectorImpl<Instruction *> &Insts) {
   // Handle special cases.
   if (PHINode *phi = dyn_cast<PHINode>(pContributingInst)) {
-    CollectPhiCFValuesContributingToOutputRec(phi, Entry, ContributingInstructions);
+    CollectPhiCFValuesContributingToOutput(phi, Entry, Insts);
   } else if (isa<LoadInst>(pContributingInst) || 
              isa<AtomicCmpXchgInst>(pContributingInst) ||
              isa<AtomicRMWInst>(pContributingInst)) {
@@ -463,7 +567,7 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
     for (Value *pDeclValue : ReachingDecls) {
       const ValueSetType &Stores = CollectStores(pDeclValue);
       for (Value *V : Stores) {
-        CollectValuesContributingToOutputRec(Entry, V, ContributingInstructions);
+        AddContributingValue(Entry, V, Insts);
       }
     }
   } else if (CallInst *CI = dyn_cast<CallInst>(pContributingInst)) {
@@ -474,7 +578,7 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
         if (Entry.Functions.find(F) != Entry.Functions.end()) {
           const FuncInfo &FI = *m_FuncInfo[F];
           for (ReturnInst *pRetInst : FI.Returns) {
-            CollectValuesContributingToOutputRec(Entry, pRetInst, ContributingInstructions);
+            Insts.push_back(pRetInst);
           }
         }
       }
@@ -485,17 +589,11 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
   unsigned NumOps = pContributingInst->getNumOperands();
   for (unsigned i = 0; i < NumOps; i++) {
     Value *O = pContributingInst->getOperand(i);
-    CollectValuesContributingToOutputRec(Entry, O, ContributingInstructions);
+    AddContributingValue(Entry, O, Insts);
   }
 
   // Handle control dependence of this instruction BB.
-  BasicBlock *pBB = pContributingInst->getParent();
-  Function *F = pBB->getParent();
-  FuncInfo *pFuncInfo = m_FuncInfo[F].get();
-  const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
-  for (BasicBlock *B : CtrlDepSet) {
-    CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
-  }
+  AddControlDependence(pContributingInst->getParent(), Insts);
 }
 
 // Only process control-dependent basic blocks for constant operands of the phi-function.
@@ -503,9 +601,9 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
 // However, this may be too conservative and, as such, pick up extra control dependent BBs.
 // A better "definition" point is the highest dominator where it is still legal to "insert" constant assignment.
 // In this context, "legal" means that only one value "leaves" the dominator and reaches Phi.
-void DxilViewIdState::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
-                                                                EntryInfo &Entry,
-                                                                InstructionSetType &ContributingInstructions) {
+void DxilViewIdState::CollectPhiCFValuesContributingToOutput(PHINode *pPhi,
+                                                             EntryInfo &Entry,
+                                                             SmallVectorImpl<Instruction *> &Insts) {
   Function *F = pPhi->getParent()->getParent();
   FuncInfo *pFuncInfo = m_FuncInfo[F].get();
   unordered_map<DomTreeNodeBase<BasicBlock> *, Value *> DomTreeMarkers;
@@ -577,114 +675,106 @@ void DxilViewIdState::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
     }
 
     // Handle control dependence of this constant argument highest legal "definition" point.
-    pBB = pDefDomNode->getBlock();
-    const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
-    for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
-    }
+    AddControlDependence(pDefDomNode->getBlock(), Insts);
   }
 }
 
 const DxilViewIdState::ValueSetType &DxilViewIdState::CollectReachingDecls(Value *pValue) {
   auto it = m_ReachingDeclsCache.emplace(pValue, ValueSetType());
-  if (it.second) {
-    // We have not seen this value before.
-    ValueSetType Visited;
-    CollectReachingDeclsRec(pValue, it.first->second, Visited);
-  }
-  return it.first->second;
-}
-
-void DxilViewIdState::CollectReachingDeclsRec(Value *pValue, ValueSetType &ReachingDecls, ValueSetType &Visited) {
-  if (Visited.find(pValue) != Visited.end())
-    return;
-
-  bool bInitialValue = Visited.size() == 0;
-  Visited.emplace(pValue);
-
-  if (!bInitialValue) {
-    auto it = m_ReachingDeclsCache.find(pValue);
-    if (it != m_ReachingDeclsCache.end()) {
-      ReachingDecls.insert(it->second.begin(), it->second.end());
-      return;
+  if (!it.second)
+    return it.first->second;
+
+  // We have not seen this value before.
+  ValueSetType &ReachingDecls = it.first->second;
+  SmallPtrSet<Value *, 16> Visited;
+  SmallVector<Value *, 16> Worklist;
+  auto AddPtrValue = [&](Value *pPtrValue) {
+    if (Visited.insert(pPtrValue).second)
+      Worklist.push_back(pPtrValue);
+  };
+  AddPtrValue(pValue);
+
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    if (V != pValue) {
+      auto itCached = m_ReachingDeclsCache.find(V);
+      if (itCached != m_ReachingDeclsCache.end()) {
+        ReachingDecls.insert(itCached->second.begin(), itCached->second.end());
+        continue;
+      }
     }
-  }
 
-  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(pValue)) {
-    ReachingDecls.emplace(pValue);
-    return;
-  }
-
-  if (GetElementPtrInst *pGepInst = dyn_cast<GetElementPtrInst>(pValue)) {
-    Value *pPtrValue = pGepInst->getPointerOperand();
-    CollectReachingDeclsRec(pPtrValue, ReachingDecls, Visited);
-  } else if (GEPOperator *pGepOp = dyn_cast<GEPOperator>(pValue)) {
-    Value *pPtrValue = pGepOp->getPointerOperand();
-    CollectReachingDeclsRec(pPtrValue, ReachingDecls, Visited);
-  } else if (AllocaInst *AI = dyn_cast<AllocaInst>(pValue)) {
-    ReachingDecls.emplace(pValue);
-  } else if (PHINode *phi = dyn_cast<PHINode>(pValue)) {
-    for (Value *pPtrValue : phi->operands()) {
-      CollectReachingDeclsRec(pPtrValue, ReachingDecls, Visited);
+    if (isa<GlobalVariable>(V) || isa<AllocaInst>(V) || isa<Argument>(V)) {
+      ReachingDecls.emplace(V);
+    } else if (GetElementPtrInst *pGepInst = dyn_cast<GetElementPtrInst>(V)) {
+      AddPtrValue(pGepInst->getPointerOperand());
+    } else if (GEPOperator *pGepOp = dyn_cast<GEPOperator>(V)) {
+      AddPtrValue(pGepOp->getPointerOperand());
+    } else if (PHINode *phi = dyn_cast<PHINode>(V)) {
+      for (Value *pPtrValue : phi->operands()) {
+        AddPtrValue(pPtrValue);
+      }
+    } else if (SelectInst *SelI = dyn_cast<SelectInst>(V)) {
+      AddPtrValue(SelI->getTrueValue());
+      AddPtrValue(SelI->getFalseValue());
+    } else {
+      IFT(DXC_E_GENERAL_INTERNAL_ERROR);
     }
-  } else if (SelectInst *SelI = dyn_cast<SelectInst>(pValue)) {
-    CollectReachingDeclsRec(SelI->getTrueValue(), ReachingDecls, Visited);
-    CollectReachingDeclsRec(SelI->getFalseValue(), ReachingDecls, Visited);
-  } else if (Argument *pArg = dyn_cast<Argument>(pValue)) {
-    ReachingDecls.emplace(pValue);
-  } else {
-    IFT(DXC_E_GENERAL_INTERNAL_ERROR);
   }
+  return ReachingDecls;
 }
 
 const DxilViewIdState::ValueSetType &DxilViewIdState::CollectStores(llvm::Value *pValue) {
   auto it = m_StoresPerDeclCache.emplace(pValue, ValueSetType());
-  if (it.second) {
-    // We have not seen this value before.
-    ValueSetType Visited;
-    CollectStoresRec(pValue, it.first->second, Visited);
-  }
-  return it.first->second;
-}
-
-void DxilViewIdState::CollectStoresRec(llvm::Value *pValue, ValueSetType &Stores, ValueSetType &Visited) {
-  if (Visited.find(pValue) != Visited.end())
-    return;
-
-  bool bInitialValue = Visited.size() == 0;
-  Visited.emplace(pValue);
-
-  if (!bInitialValue) {
-    auto it = m_StoresPerDeclCache.find(pValue);
-    if (it != m_StoresPerDeclCache.end()) {
-      Stores.insert(it->second.begin(), it->second.end());
-      return;
+  if (!it.second)
+    return it.first->second;
+
+  // We have not seen this value before.
+  ValueSetType &Stores = it.first->second;
+  SmallPtrSet<Value *, 16> Visited;
+  SmallVector<Value *, 16> Worklist;
+  Visited.insert(pValue);
+  Worklist.push_back(pValue);
+
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    if (V != pValue) {
+      auto itCached = m_StoresPerDeclCache.find(V);
+      if (itCached != m_StoresPerDeclCache.end()) {
+        Stores.insert(itCached->second.begin(), itCached->second.end());
+        continue;
+      }
     }
-  }
 
-  if (isa<LoadInst>(pValue)) {
-    return;
-  } else if (isa<StoreInst>(pValue) ||
-             isa<AtomicCmpXchgInst>(pValue) ||
-             isa<AtomicRMWInst>(pValue)) {
-    Stores.emplace(pValue);
-    return;
-  }
+    if (isa<LoadInst>(V)) {
+      continue;
+    } else if (isa<StoreInst>(V) ||
+               isa<AtomicCmpXchgInst>(V) ||
+               isa<AtomicRMWInst>(V)) {
+      Stores.emplace(V);
+      continue;
+    }
 
-  for (auto *U : pValue->users()) {
-    CollectStoresRec(U, Stores, Visited);
+    for (auto *U : V->users()) {
+      if (Visited.insert(U).second)
+        Worklist.push_back(U);
+    }
   }
+  return Stores;
 }
 
-void DxilViewIdState::CreateViewIdSets(const std::unordered_map<unsigned, InstructionSetType> &ContributingInstructions, 
+void DxilViewIdState::CreateViewIdSets(const EntryInfo &Entry,
+                                       const std::unordered_map<unsigned, BitVector> &ContributingSources,
                                        OutputsDependentOnViewIdType &OutputsDependentOnViewId,
                                        InputsContributingToOutputType &InputsContributingToOutputs,
                                        bool bPC) {
   const ShaderModel *pSM = m_pModule->GetShaderModel();
 
-  for (auto &itOut : ContributingInstructions) {
+  for (auto &itOut : ContributingSources) {
     unsigned outIdx = itOut.first;
-    for (Instruction *pInst : itOut.second) {
+    const BitVector &Sources = itOut.second;
+    for (int i = Sources.find_first(); i != -1; i = Sources.find_next(i)) {
+      Instruction *pInst = Entry.SourceInsts[i];
       // Set output dependence on ViewId.
       if (DxilInst_ViewID VID = DxilInst_ViewID(pInst)) {
         DXASSERT(m_bUsesViewId, "otherwise, DxilModule flag not set properly");
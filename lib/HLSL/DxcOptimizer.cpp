@@ -36,10 +36,11 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Analysis/CFGPrinter.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <atomic>
 #include <vector>
 
 // This is pretty ugly; should be refactored to a proper library
@@ -80,6 +81,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeComputeViewIdStatePass(Registry);
     initializeConstantMergePass(Registry);
     initializeCorrelatedValuePropagationPass(Registry);
+    initializeCostModelAnalysisPass(Registry);
     initializeDAEPass(Registry);
     initializeDAHPass(Registry);
     initializeDCEPass(Registry);
@@ -480,7 +482,411 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
+namespace {
+// A pass or module printer given in the options, with the pass arguments
+// already parsed.
+struct DxcOptimizerStep {
+  const PassInfo *PassInf; // nullptr for -print-module.
+  bool FunctionPass;       // Added to the per-function pass manager.
+  std::string Banner;      // -print-module banner.
+  std::vector<std::pair<std::string, std::string>> Options;
+};
+
+// Options given to RunOptimizer or CreatePipeline, parsed once; the pass
+// managers are built from this for each module, as passes keep per-module
+// state and pass managers can't be shared across threads.
+struct DxcOptimizerPipelineDesc {
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+  std::vector<DxcOptimizerStep> Steps;
+};
+
+struct DxcOptimizerWorker {
+  const DxcOptimizerPipelineDesc *pDesc;
+  IMalloc *pMalloc;
+  IDxcBlob **ppBlobs;
+  HRESULT *pStatus;
+  IDxcBlob **ppOutputModules;
+  IDxcBlobEncoding **ppOutputTexts;
+  const std::vector<UINT32> *pOrder;
+  std::atomic<unsigned> *pNext;
+};
+} // namespace
+
+// Setup input buffer.
+//
+// The ir parsing requires the buffer to be null terminated. We deal with
+// both source and bitcode input, so the input buffer may not be null
+// terminated; we create a new membuf that copies and appends for this.
+//
+// If we have the beginning of a DXIL program header, skip to the bitcode.
+//
+static std::unique_ptr<Module> LoadOptimizerModule(IDxcBlob *pBlob,
+                                                   LLVMContext &Context) {
+  SMDiagnostic Err;
+  std::unique_ptr<MemoryBuffer> memBuf;
+  std::unique_ptr<Module> M;
+  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
+  unsigned blobSize = pBlob->GetBufferSize();
+  const DxilProgramHeader *pProgramHeader =
+    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
+  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
+    std::string DiagStr;
+    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
+    M = hlsl::dxilutil::LoadModuleFromBitcode(
+      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
+  }
+  else {
+    StringRef bufStrRef(pBlobContent, blobSize);
+    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
+    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+  }
+  return M;
+}
+
+// Builds the pass managers for M from the parsed options and runs them.
+static void RunOptimizerPipeline(const DxcOptimizerPipelineDesc &desc,
+                                 Module &M, raw_ostream &outStream) {
+  legacy::PassManager ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(&M);
+  SmallVector<PassOption, 2> options;
+
+  // Give passes the costs of DXIL operations, as during compilation, rather
+  // than the target-independent ones the pass managers would create.
+  ModulePasses.add(
+      createTargetTransformInfoWrapperPass(createDxilTargetIRAnalysis()));
+  FunctionPasses.add(
+      createTargetTransformInfoWrapperPass(createDxilTargetIRAnalysis()));
+
+  for (const DxcOptimizerStep &step : desc.Steps) {
+    legacy::PassManagerBase *pPassManager = &ModulePasses;
+    if (step.FunctionPass)
+      pPassManager = &FunctionPasses;
+
+    if (step.PassInf == nullptr) {
+      pPassManager->add(llvm::createPrintModulePass(outStream, step.Banner));
+      continue;
+    }
+
+    options.clear();
+    for (const auto &option : step.Options)
+      options.push_back(PassOption(option.first, option.second));
+
+    const llvm::PassInfo *PassInf = step.PassInf;
+    // The target analysis has been added up front.
+    if (PassInf->getTypeInfo() == &TargetTransformInfoWrapperPass::ID)
+      continue;
+    Pass *pass = PassInf->getNormalCtor()();
+    pass->setOSOverride(&outStream);
+    pass->applyOptions(options);
+    pPassManager->add(pass);
+    if (desc.AnalyzeOnly) {
+      const bool Quiet = false;
+      PassKind Kind = pass->getPassKind();
+      switch (Kind) {
+      case PT_BasicBlock:
+        pPassManager->add(createBasicBlockPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Region:
+        pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Loop:
+        pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Function:
+        pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_CallGraphSCC:
+        pPassManager->add(createCallGraphPassPrinter(PassInf, outStream, Quiet));
+        break;
+      default:
+        pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
+        break;
+      }
+    }
+  }
+
+  ModulePasses.add(createVerifierPass());
+
+  if (desc.OutputAssembly) {
+    ModulePasses.add(llvm::createPrintModulePass(outStream));
+  }
+
+  // Now that we have all of the passes ready, run them.
+  {
+    raw_ostream *err_ostream = &outStream;
+    ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
+
+    FunctionPasses.doInitialization();
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        FunctionPasses.run(F);
+    FunctionPasses.doFinalization();
+    ModulePasses.run(M);
+  }
+}
+
+static HRESULT RunOptimizerOnModule(IMalloc *pMalloc,
+                                    const DxcOptimizerPipelineDesc &desc,
+                                    Module &M,
+                                    IDxcBlobEncoding **ppOutputText) {
+  try {
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    raw_stream_ostream outStream(pOutputStream.p);
+    RunOptimizerPipeline(desc, M, outStream);
+
+    outStream.flush();
+    if (ppOutputText != nullptr) {
+      IFT(DxcCreateBlobWithEncodingSet(pOutputBlob, CP_UTF8, ppOutputText));
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return S_OK;
+}
+
+static HRESULT WriteOptimizerModule(IMalloc *pMalloc, Module &M,
+                                    IDxcBlob **ppOutputModule) {
+  try {
+    CComPtr<AbstractMemoryStream> pProgramStream;
+    IFT(CreateMemoryStream(pMalloc, &pProgramStream));
+    {
+      raw_stream_ostream outStream(pProgramStream.p);
+      WriteBitcodeToFile(&M, outStream, true);
+    }
+    IFT(pProgramStream.QueryInterface(ppOutputModule));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return S_OK;
+}
+
+static HRESULT RunOptimizerOnBlob(IMalloc *pMalloc,
+                                  const DxcOptimizerPipelineDesc &desc,
+                                  IDxcBlob *pBlob,
+                                  IDxcBlob **ppOutputModule,
+                                  IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  try {
+    M = LoadOptimizerModule(pBlob, Context);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  if (M == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  CComPtr<IDxcBlobEncoding> pOutputText;
+  CComPtr<IDxcBlob> pOutputModule;
+  IFR(RunOptimizerOnModule(pMalloc, desc, *M,
+                           ppOutputText ? &pOutputText : nullptr));
+  if (ppOutputModule != nullptr) {
+    IFR(WriteOptimizerModule(pMalloc, *M, &pOutputModule));
+    *ppOutputModule = pOutputModule.Detach();
+  }
+  if (ppOutputText != nullptr) {
+    *ppOutputText = pOutputText.Detach();
+  }
+  return S_OK;
+}
+
+static DWORD WINAPI OptimizerThreadProc(LPVOID pParam) {
+  DxcOptimizerWorker *pWorker = reinterpret_cast<DxcOptimizerWorker *>(pParam);
+  // Allocations must go to the same IMalloc as the calling thread's, as
+  // the results are freed there.
+  DxcThreadMalloc TM(pWorker->pMalloc);
+  const std::vector<UINT32> &order = *pWorker->pOrder;
+  for (;;) {
+    unsigned next = (*pWorker->pNext)++;
+    if (next >= order.size())
+      break;
+    UINT32 i = order[next];
+    pWorker->pStatus[i] = RunOptimizerOnBlob(
+        pWorker->pMalloc, *pWorker->pDesc, pWorker->ppBlobs[i],
+        pWorker->ppOutputModules ? &pWorker->ppOutputModules[i] : nullptr,
+        pWorker->ppOutputTexts ? &pWorker->ppOutputTexts[i] : nullptr);
+  }
+  return 0;
+}
+
+class DxcOptimizerModule : public IDxcOptimizerModule {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+public:
+  // The context outlives the module.
+  std::unique_ptr<LLVMContext> m_pContext;
+  std::unique_ptr<Module> m_pModule;
+
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerModule)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcOptimizerModule>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE GetBitcode(_COM_Outptr_ IDxcBlob **ppResult) {
+    if (ppResult == nullptr)
+      return E_POINTER;
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    return WriteOptimizerModule(m_pMalloc, *m_pModule, ppResult);
+  }
+};
+
+class DxcOptimizerPipeline : public IDxcOptimizerPipeline {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+public:
+  DxcOptimizerPipelineDesc m_desc;
+
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerPipeline)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcOptimizerPipeline>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadModule(_In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcOptimizerModule **ppModule);
+  __override HRESULT STDMETHODCALLTYPE RunOnModule(_In_ IDxcOptimizerModule *pModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+  __override HRESULT STDMETHODCALLTYPE Run(_In_ IDxcBlob *pBlob,
+    _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+    DxcThreadMalloc TM(m_pMalloc);
+    return RunOptimizerOnBlob(m_pMalloc, m_desc, pBlob, ppOutputModule,
+                              ppOutputText);
+  }
+  __override HRESULT STDMETHODCALLTYPE RunMany(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) HRESULT *pStatus,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts);
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::LoadModule(
+    _In_ IDxcBlob *pBlob, _COM_Outptr_ IDxcOptimizerModule **ppModule) {
+  if (ppModule == nullptr)
+    return E_POINTER;
+  *ppModule = nullptr;
+  if (pBlob == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<DxcOptimizerModule> result = DxcOptimizerModule::Alloc(m_pMalloc);
+    IFROOM(result.p);
+    result->m_pContext.reset(new LLVMContext());
+    result->m_pModule = LoadOptimizerModule(pBlob, *result->m_pContext);
+    if (result->m_pModule == nullptr)
+      return DXC_E_IR_VERIFICATION_FAILED;
+    *ppModule = result.Detach();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::RunOnModule(
+    _In_ IDxcOptimizerModule *pModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pModule == nullptr)
+    return E_POINTER;
+
+  // Modules are only created by LoadModule.
+  DxcOptimizerModule *pOptModule = static_cast<DxcOptimizerModule *>(pModule);
+  DxcThreadMalloc TM(m_pMalloc);
+  return RunOptimizerOnModule(m_pMalloc, m_desc, *pOptModule->m_pModule,
+                              ppOutputText);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::RunMany(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) HRESULT *pStatus,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) {
+  if (pStatus == nullptr || (blobCount > 0 && ppBlobs == nullptr))
+    return E_POINTER;
+  for (UINT32 i = 0; i < blobCount; ++i) {
+    pStatus[i] = E_FAIL;
+    if (ppOutputModules != nullptr)
+      ppOutputModules[i] = nullptr;
+    if (ppOutputTexts != nullptr)
+      ppOutputTexts[i] = nullptr;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    // Each module is loaded into a context of its own, so modules are
+    // independent and run concurrently. The largest are started first so
+    // that a big module near the end doesn't run alone.
+    std::vector<UINT32> order(blobCount);
+    for (UINT32 i = 0; i < blobCount; ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [ppBlobs](UINT32 a, UINT32 b) {
+      SIZE_T sizeA = ppBlobs[a] ? ppBlobs[a]->GetBufferSize() : 0;
+      SIZE_T sizeB = ppBlobs[b] ? ppBlobs[b]->GetBufferSize() : 0;
+      return sizeA > sizeB;
+    });
+
+    std::atomic<unsigned> next(0);
+    DxcOptimizerWorker worker;
+    worker.pDesc = &m_desc;
+    worker.pMalloc = m_pMalloc;
+    worker.ppBlobs = ppBlobs;
+    worker.pStatus = pStatus;
+    worker.ppOutputModules = ppOutputModules;
+    worker.ppOutputTexts = ppOutputTexts;
+    worker.pOrder = &order;
+    worker.pNext = &next;
+
+    if (threadCount == 0) {
+      SYSTEM_INFO sysInfo;
+      GetSystemInfo(&sysInfo);
+      threadCount = sysInfo.dwNumberOfProcessors;
+    }
+    threadCount = std::min<unsigned>(threadCount, blobCount);
+    std::vector<HANDLE> threads;
+    for (unsigned i = 1; i < threadCount; ++i) {
+      HANDLE hThread = CreateThread(nullptr, 0, OptimizerThreadProc, &worker,
+                                    0, nullptr);
+      // If a thread can't be started, the others pick up its share.
+      if (hThread == nullptr)
+        break;
+      threads.push_back(hThread);
+    }
+    OptimizerThreadProc(&worker);
+    for (HANDLE hThread : threads) {
+      WaitForSingleObject(hThread, INFINITE);
+      CloseHandle(hThread);
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+// Runs a pipeline created by IDxcOptimizer2::CreatePipeline over a module
+// the caller already has in memory, without a trip through bitcode. Used by
+// the specializer in dxcompiler; allocations go to the calling thread's
+// IMalloc.
+HRESULT RunDxcOptimizerPipeline(IDxcOptimizerPipeline *pPipeline, Module &M) {
+  // Pipelines are only created by DxcOptimizer::CreatePipeline.
+  DxcOptimizerPipeline *pImpl = static_cast<DxcOptimizerPipeline *>(pPipeline);
+  return RunOptimizerOnModule(DxcGetThreadMallocNoRef(), pImpl->m_desc, M,
+                              nullptr);
+}
+
+class DxcOptimizer : public IDxcOptimizer2 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   PassRegistry *m_registry;
@@ -490,12 +896,14 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcOptimizer)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOptimizer, IDxcOptimizer2>(this, iid, ppvObject);
   }
 
   HRESULT Initialize();
   const PassInfo *getPassByID(llvm::AnalysisID PassID);
   const PassInfo *getPassByName(const char *pName);
+  HRESULT ParseOptions(_In_count_(optionCount) LPCWSTR *ppOptions,
+                       UINT32 optionCount, DxcOptimizerPipelineDesc &desc);
   __override HRESULT STDMETHODCALLTYPE GetAvailablePassCount(_Out_ UINT32 *pCount) {
     return AssignToOut<UINT32>(m_passes.size(), pCount);
   }
@@ -504,6 +912,9 @@ public:
     _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
     _COM_Outptr_ IDxcBlob **ppOutputModule,
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+  __override HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppResult);
 };
 
 class CapturePassManager : public llvm::legacy::PassManagerBase {
@@ -566,64 +977,10 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
       GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
 }
 
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
-
-  DxcThreadMalloc TM(m_pMalloc);
-
-  // Setup input buffer.
-  //
-  // The ir parsing requires the buffer to be null terminated. We deal with
-  // both source and bitcode input, so the input buffer may not be null
-  // terminated; we create a new membuf that copies and appends for this.
-  //
-  // If we have the beginning of a DXIL program header, skip to the bitcode.
-  //
-  LLVMContext Context;
-  SMDiagnostic Err;
-  std::unique_ptr<MemoryBuffer> memBuf;
-  std::unique_ptr<Module> M;
-  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
-  unsigned blobSize = pBlob->GetBufferSize();
-  const DxilProgramHeader *pProgramHeader =
-    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
-  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
-    std::string DiagStr;
-    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
-    M = hlsl::dxilutil::LoadModuleFromBitcode(
-      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
-  }
-  else {
-    StringRef bufStrRef(pBlobContent, blobSize);
-    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
-    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
-  }
-
-  if (M == nullptr) {
-    return DXC_E_IR_VERIFICATION_FAILED;
-  }
-
-  legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
-
+HRESULT DxcOptimizer::ParseOptions(_In_count_(optionCount) LPCWSTR *ppOptions,
+                                   UINT32 optionCount,
+                                   DxcOptimizerPipelineDesc &desc) {
   try {
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
-
-    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
-
-    raw_stream_ostream outStream(pOutputStream.p);
-
     //
     // Consider some differences from opt.exe:
     //
@@ -638,26 +995,23 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
     // No TargetInfo.
     // No DataLayout.
     //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
+    bool FunctionPasses = false;
 
     // First gather flags, wherever they may be.
     SmallVector<UINT32, 2> handled;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
+        desc.OutputAssembly = true;
         handled.push_back(i);
         continue;
       }
       if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
+        desc.AnalyzeOnly = true;
         handled.push_back(i);
         continue;
       }
     }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
     SmallVector<PassOption, 2> options;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
@@ -676,18 +1030,23 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
           Banner += name8.m_psz;
           Banner += "\n";
         }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
+        if (!FunctionPasses) {
+          DxcOptimizerStep step;
+          step.PassInf = nullptr;
+          step.FunctionPass = false;
+          step.Banner = std::move(Banner);
+          desc.Steps.push_back(std::move(step));
+        }
         continue;
       }
 
       // Handle special switches to toggle per-function prepasses vs. module passes.
       if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
+        FunctionPasses = true;
         continue;
       }
       if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
+        FunctionPasses = false;
         continue;
       }
 
@@ -744,72 +1103,57 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       }
 
       DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
-      Pass *pass = PassInf->getNormalCtor()();
-      pass->setOSOverride(&outStream);
-      pass->applyOptions(options);
+      // The option values point into optName, so they are copied out.
+      DxcOptimizerStep step;
+      step.PassInf = PassInf;
+      step.FunctionPass = FunctionPasses;
+      for (const PassOption &option : options)
+        step.Options.emplace_back(option.first.str(), option.second.str());
+      desc.Steps.push_back(std::move(step));
       options.clear();
-      pPassManager->add(pass);
-      if (AnalyzeOnly) {
-        const bool Quiet = false;
-        PassKind Kind = pass->getPassKind();
-        switch (Kind) {
-        case PT_BasicBlock:
-          pPassManager->add(createBasicBlockPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Region:
-          pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Loop:
-          pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Function:
-          pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_CallGraphSCC:
-          pPassManager->add(createCallGraphPassPrinter(PassInf, outStream, Quiet));
-          break;
-        default:
-          pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
-          break;
-        }
-      }
     }
+  }
+  CATCH_CPP_RETURN_HRESULT();
 
-    ModulePasses.add(createVerifierPass());
+  return S_OK;
+}
 
-    if (OutputAssembly) {
-      ModulePasses.add(llvm::createPrintModulePass(outStream));
-    }
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
 
-    // Now that we have all of the passes ready, run them.
-    {
-      raw_ostream *err_ostream = &outStream;
-      ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
-
-      FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
-        if (!F.isDeclaration())
-          FunctionPasses.run(F);
-      FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
-    }
+  DxcThreadMalloc TM(m_pMalloc);
 
-    outStream.flush();
-    if (ppOutputText != nullptr) {
-      IFT(DxcCreateBlobWithEncodingSet(pOutputBlob, CP_UTF8, ppOutputText));
-    }
-    if (ppOutputModule != nullptr) {
-      CComPtr<AbstractMemoryStream> pProgramStream;
-      IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
-      {
-        raw_stream_ostream outStream(pProgramStream.p);
-        WriteBitcodeToFile(M.get(), outStream, true);
-      }
-      IFT(pProgramStream.QueryInterface(ppOutputModule));
-    }
+  DxcOptimizerPipelineDesc desc;
+  IFR(ParseOptions(ppOptions, optionCount, desc));
+  return RunOptimizerOnBlob(m_pMalloc, desc, pBlob, ppOutputModule,
+                            ppOutputText);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<DxcOptimizerPipeline> result = DxcOptimizerPipeline::Alloc(m_pMalloc);
+    IFROOM(result.p);
+    IFR(ParseOptions(ppOptions, optionCount, result->m_desc));
+    *ppResult = result.Detach();
   }
   CATCH_CPP_RETURN_HRESULT();
-
   return S_OK;
 }
 
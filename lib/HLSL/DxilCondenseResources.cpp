@@ -20,7 +20,6 @@
 
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
-#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/ADT/BitVector.h"
@@ -112,31 +111,23 @@ private:
 };
 
 void DxilCondenseResources::ApplyRewriteMap(DxilModule &DM) {
-  for (Function &F : DM.GetModule()->functions()) {
-    if (F.isDeclaration()) {
+  SmallVector<CallInst *, 16> Calls;
+  DM.GetOP()->GetOpCalls(DXIL::OpCode::CreateHandle, Calls);
+  for (CallInst *CI : Calls) {
+    DxilInst_CreateHandle CH(CI);
+
+    ResourceID RId;
+    RId.Class = (DXIL::ResourceClass)CH.get_resourceClass_val();
+    RId.ID = (unsigned)llvm::dyn_cast<llvm::ConstantInt>(CH.get_rangeId())
+                 ->getZExtValue();
+    RemapEntryCollection::iterator it = m_rewrites.find(RId);
+    if (it == m_rewrites.end()) {
       continue;
     }
 
-    for (inst_iterator iter = inst_begin(F), E = inst_end(F); iter != E; ++iter) {
-      llvm::Instruction &I = *iter;
-      DxilInst_CreateHandle CH(&I);
-      if (!CH)
-        continue;
-
-      ResourceID RId;
-      RId.Class = (DXIL::ResourceClass)CH.get_resourceClass_val();
-      RId.ID = (unsigned)llvm::dyn_cast<llvm::ConstantInt>(CH.get_rangeId())
-                   ->getZExtValue();
-      RemapEntryCollection::iterator it = m_rewrites.find(RId);
-      if (it == m_rewrites.end()) {
-        continue;
-      }
-
-      CallInst *CI = cast<CallInst>(&I);
-      Value *newRangeID = DM.GetOP()->GetU32Const(it->second.Index);
-      CI->setArgOperand(DXIL::OperandIndex::kCreateHandleResIDOpIdx,
-                        newRangeID);
-    }
+    Value *newRangeID = DM.GetOP()->GetU32Const(it->second.Index);
+    CI->setArgOperand(DXIL::OperandIndex::kCreateHandleResIDOpIdx,
+                      newRangeID);
   }
 
   for (auto &entry : m_rewrites) {
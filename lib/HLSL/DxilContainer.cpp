@@ -117,6 +117,42 @@ const DxilProgramHeader *GetDxilProgramHeader(const DxilContainerHeader *pHeader
              : nullptr;
 }
 
+bool DxilContainerView::Initialize(const void *pData, size_t length) {
+  m_pHeader = nullptr;
+  const DxilContainerHeader *pHeader = IsDxilContainerLike(pData, length);
+  if (!IsValidDxilContainer(pHeader, length))
+    return false;
+  m_pHeader = pHeader;
+  return true;
+}
+
+const DxilPartHeader *DxilContainerView::FindPart(DxilFourCC fourCC) const {
+  if (!m_pHeader)
+    return nullptr;
+  const DxilPartIterator partIter =
+      find_if(begin(), end(), DxilPartIsType(fourCC));
+  if (partIter == end())
+    return nullptr;
+  return *partIter;
+}
+
+DxilPartSpan DxilContainerView::FindPartSpan(DxilFourCC fourCC) const {
+  const DxilPartHeader *pPart = FindPart(fourCC);
+  return pPart ? GetPartSpan(pPart) : DxilPartSpan();
+}
+
+const DxilProgramHeader *
+DxilContainerView::FindProgramHeader(DxilFourCC fourCC) const {
+  const DxilPartHeader *pPart = FindPart(fourCC);
+  if (!pPart)
+    return nullptr;
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart));
+  return IsValidDxilProgramHeader(pProgramHeader, pPart->PartSize)
+             ? pProgramHeader
+             : nullptr;
+}
+
 DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC fourCC) {
   return const_cast<DxilProgramHeader *>(
       GetDxilProgramHeader(static_cast<const DxilContainerHeader *>(pHeader), fourCC));
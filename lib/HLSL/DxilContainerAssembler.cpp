@@ -700,12 +700,19 @@ DxilPartWriter *hlsl::NewPSVWriter(const DxilModule &M, uint32_t PSVVersion) {
 }
 
 class DxilContainerWriter_impl : public DxilContainerWriter  {
+public:
+  typedef std::function<void(char *)> PatchFn;
+
 private:
   class DxilPart {
   public:
     DxilPartHeader Header;
     WriteFn Write;
-    DxilPart(uint32_t fourCC, uint32_t size, WriteFn write) : Write(write) {
+    PatchFn Patch;
+    bool Streamed;
+    DxilPart(uint32_t fourCC, uint32_t size, WriteFn write, PatchFn patch,
+             bool streamed)
+        : Write(write), Patch(patch), Streamed(streamed) {
       Header.PartFourCC = fourCC;
       Header.PartSize = size;
     }
@@ -715,9 +722,25 @@ private:
 
 public:
   __override void AddPart(uint32_t FourCC, uint32_t Size, WriteFn Write) {
-    m_Parts.emplace_back(FourCC, Size, Write);
+    m_Parts.emplace_back(FourCC, Size, Write, nullptr, false);
+  }
+
+  // Adds a part whose size is only known once it has been written, such as
+  // bitcode serialized straight into the container. The part header and the
+  // offsets of later parts are fixed up after writing.
+  void AddStreamedPart(uint32_t FourCC, WriteFn Write) {
+    m_Parts.emplace_back(FourCC, 0, Write, nullptr, true);
   }
 
+  // Adds a part whose contents depend on parts written after it. Write emits
+  // a placeholder of the given size, and Patch overwrites it in place once
+  // every part has been written.
+  void AddPatchedPart(uint32_t FourCC, uint32_t Size, WriteFn Write,
+                      PatchFn Patch) {
+    m_Parts.emplace_back(FourCC, Size, Write, Patch, false);
+  }
+
+  // Size of the container, counting streamed parts as empty.
   __override uint32_t size() const {
     uint32_t partSize = 0;
     for (auto &part : m_Parts) {
@@ -727,24 +750,72 @@ public:
   }
 
   __override void write(AbstractMemoryStream *pStream) {
+    write(pStream, 0);
+  }
+
+  // Writes the container, reserving room for streamedSizeHint bytes of
+  // streamed part contents on top of the known part sizes.
+  void write(AbstractMemoryStream *pStream, uint32_t streamedSizeHint) {
     DxilContainerHeader header;
     const uint32_t PartCount = (uint32_t)m_Parts.size();
     uint32_t containerSizeInBytes = size();
+    bool hasLateFixups = false;
+    for (auto &&part : m_Parts)
+      hasLateFixups |= part.Streamed || part.Patch;
     InitDxilContainer(&header, PartCount, containerSizeInBytes);
-    IFT(pStream->Reserve(header.ContainerSizeInBytes));
+    uint64_t reserveSize = containerSizeInBytes;
+    if (hasLateFixups)
+      reserveSize += streamedSizeHint;
+    IFT(pStream->Reserve(
+        (ULONG)std::min<uint64_t>(reserveSize, DxilContainerMaxSize)));
+    const size_t containerStart = (size_t)pStream->GetPosition();
     IFT(WriteStreamValue(pStream, header));
     uint32_t offset = sizeof(header) + (uint32_t)GetOffsetTableSize(PartCount);
     for (auto &&part : m_Parts) {
       IFT(WriteStreamValue(pStream, offset));
       offset += sizeof(DxilPartHeader) + part.Header.PartSize;
     }
+    if (!hasLateFixups) {
+      for (auto &&part : m_Parts) {
+        IFT(WriteStreamValue(pStream, part.Header));
+        size_t start = pStream->GetPosition();
+        part.Write(pStream);
+        DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
+      }
+      DXASSERT(containerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
+      return;
+    }
+
+    // Write the parts, recording where each one lands, then fix up sizes,
+    // offsets and patched contents in the output buffer. The buffer may move
+    // while writing, so only offsets are kept until the end.
+    llvm::SmallVector<uint32_t, 8> partOffsets;
     for (auto &&part : m_Parts) {
+      partOffsets.push_back((uint32_t)(pStream->GetPosition() - containerStart));
       IFT(WriteStreamValue(pStream, part.Header));
       size_t start = pStream->GetPosition();
       part.Write(pStream);
-      DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
+      size_t written = pStream->GetPosition() - start;
+      if (part.Streamed) {
+        IFTBOOL(written <= DxilContainerMaxSize, DXC_E_DATA_TOO_LARGE);
+        part.Header.PartSize = (uint32_t)written;
+      }
+      DXASSERT(written == (size_t)part.Header.PartSize, "out of bound");
+    }
+    containerSizeInBytes = (uint32_t)(pStream->GetPosition() - containerStart);
+    IFTBOOL(containerSizeInBytes <= DxilContainerMaxSize, DXC_E_DATA_TOO_LARGE);
+
+    char *pContainer = (char *)pStream->GetPtr() + containerStart;
+    DxilContainerHeader *pHeader = (DxilContainerHeader *)pContainer;
+    pHeader->ContainerSizeInBytes = containerSizeInBytes;
+    uint32_t *pPartOffsetTable = (uint32_t *)(pHeader + 1);
+    for (uint32_t i = 0; i < PartCount; ++i) {
+      pPartOffsetTable[i] = partOffsets[i];
+      DxilPartHeader *pPartHeader = (DxilPartHeader *)(pContainer + partOffsets[i]);
+      pPartHeader->PartSize = m_Parts[i].Header.PartSize;
+      if (m_Parts[i].Patch)
+        m_Parts[i].Patch(GetDxilPartData(pPartHeader));
     }
-    DXASSERT(containerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
   }
 };
 
@@ -771,30 +842,83 @@ static void GetPaddedProgramPartSize(AbstractMemoryStream *pStream,
   bitcodeInUInt32 = (bitcodeInUInt32 / 4) + (bitcodePaddingBytes ? 1 : 0);
 }
 
-static void WriteProgramPart(const ShaderModel *pModel,
-                             AbstractMemoryStream *pModuleBitcode,
-                             AbstractMemoryStream *pStream) {
+static void InitProgramHeaderForModel(const ShaderModel *pModel,
+                                      DxilProgramHeader &programHeader,
+                                      uint32_t bitcodeSize) {
   DXASSERT(pModel != nullptr, "else generation should have failed");
-  DxilProgramHeader programHeader;
   uint32_t shaderVersion =
       EncodeVersion(pModel->GetKind(), pModel->GetMajor(), pModel->GetMinor());
   unsigned dxilMajor, dxilMinor;
   pModel->GetDxilVersion(dxilMajor, dxilMinor);
   uint32_t dxilVersion = DXIL::MakeDxilVersion(dxilMajor, dxilMinor);
-  InitProgramHeader(programHeader, shaderVersion, dxilVersion, pModuleBitcode->GetPtrSize());
+  InitProgramHeader(programHeader, shaderVersion, dxilVersion, bitcodeSize);
+}
+
+static void WriteProgramPartPadding(AbstractMemoryStream *pStream,
+                                    uint32_t bitcodeSize) {
+  uint32_t paddingBytes = (4 - (bitcodeSize % 4)) % 4;
+  if (paddingBytes) {
+    ULONG cbWritten;
+    uint32_t paddingValue = 0;
+    IFT(pStream->Write(&paddingValue, paddingBytes, &cbWritten));
+  }
+}
 
-  uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pModuleBitcode, programInUInt32,
-                           programPaddingBytes);
+static void WriteProgramPart(const ShaderModel *pModel,
+                             AbstractMemoryStream *pModuleBitcode,
+                             AbstractMemoryStream *pStream) {
+  DxilProgramHeader programHeader;
+  InitProgramHeaderForModel(pModel, programHeader, pModuleBitcode->GetPtrSize());
 
   ULONG cbWritten;
   IFT(WriteStreamValue(pStream, programHeader));
   IFT(pStream->Write(pModuleBitcode->GetPtr(), pModuleBitcode->GetPtrSize(),
                      &cbWritten));
-  if (programPaddingBytes) {
-    uint32_t paddingValue = 0;
-    IFT(pStream->Write(&paddingValue, programPaddingBytes, &cbWritten));
+  WriteProgramPartPadding(pStream, pModuleBitcode->GetPtrSize());
+}
+
+namespace {
+/// Forwards writes to a stream, optionally updating a hash with the bytes.
+class raw_hashing_stream_ostream : public llvm::raw_ostream {
+private:
+  AbstractMemoryStream *m_pStream;
+  llvm::MD5 *m_pHash;
+  void write_impl(const char *Ptr, size_t Size) override {
+    ULONG cbWritten;
+    IFT(m_pStream->Write(Ptr, Size, &cbWritten));
+    if (m_pHash)
+      m_pHash->update(ArrayRef<uint8_t>((const uint8_t *)Ptr, Size));
+  }
+  uint64_t current_pos() const override { return m_pStream->GetPosition(); }
+public:
+  raw_hashing_stream_ostream(AbstractMemoryStream *pStream, llvm::MD5 *pHash)
+      : raw_ostream(/*unbuffered*/ true), m_pStream(pStream), m_pHash(pHash) {}
+  ~raw_hashing_stream_ostream() override { flush(); }
+};
+}
+
+// Serializes the module straight into the part being written, rather than
+// into an intermediate stream that is then copied. The header is written with
+// a placeholder size and rewritten in place once the bitcode size is known.
+static void WriteProgramPart(const ShaderModel *pModel, const Module *pModule,
+                             AbstractMemoryStream *pStream,
+                             llvm::MD5 *pBitcodeHash) {
+  DxilProgramHeader programHeader;
+  InitProgramHeaderForModel(pModel, programHeader, 0);
+  const size_t headerPos = (size_t)pStream->GetPosition();
+  IFT(WriteStreamValue(pStream, programHeader));
+
+  {
+    raw_hashing_stream_ostream outStream(pStream, pBitcodeHash);
+    WriteBitcodeToFile(pModule, outStream, true);
   }
+  size_t bitcodeSize =
+      (size_t)pStream->GetPosition() - headerPos - sizeof(programHeader);
+  IFTBOOL(bitcodeSize < DxilContainerMaxSize, DXC_E_DATA_TOO_LARGE);
+  WriteProgramPartPadding(pStream, (uint32_t)bitcodeSize);
+
+  InitProgramHeaderForModel(pModel, programHeader, (uint32_t)bitcodeSize);
+  memcpy(pStream->GetPtr() + headerPos, &programHeader, sizeof(programHeader));
 }
 
 void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
@@ -854,84 +978,105 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     PSVWriter.write(pStream);
   });
 
-  // Write the root signature (RTS0) part.
+  // Write the root signature (RTS0) part. The caller's bitcode still carries
+  // the root signature, so once it is stripped the module is serialized
+  // again, straight into the parts that need it.
   DxilProgramRootSignatureWriter rootSigWriter(pModule->GetRootSignature());
-  CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
-  if (!pModule->GetRootSignature().IsEmpty()) {
+  const bool bitcodeIsCurrent = pModule->GetRootSignature().IsEmpty();
+  if (!bitcodeIsCurrent) {
     writer.AddPart(
         DFCC_RootSignature, rootSigWriter.size(),
         [&](AbstractMemoryStream *pStream) { rootSigWriter.write(pStream); });
     pModule->StripRootSignatureFromMetadata();
-    pInputProgramStream.Release();
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
-    raw_stream_ostream outStream(pInputProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
-  }
-
-  // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
-  CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
-  if (HasDebugInfo(*pModule->GetModule())) {
-    uint32_t debugInUInt32, debugPaddingBytes;
-    GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
-    if (Flags & SerializeDxilFlags::IncludeDebugInfoPart) {
+  }
+
+  // If we have debug information present, serialize it to a debug part, then
+  // use the stripped version as the canonical program version. Parts are
+  // written in order, so the debug part is serialized before the program
+  // part's writer strips the module.
+  const bool hasDebugInfo = HasDebugInfo(*pModule->GetModule());
+  const ShaderModel *pSM = pModule->GetShaderModel();
+  if (hasDebugInfo && (Flags & SerializeDxilFlags::IncludeDebugInfoPart)) {
+    if (bitcodeIsCurrent) {
+      uint32_t debugInUInt32, debugPaddingBytes;
+      GetPaddedProgramPartSize(pModuleBitcode, debugInUInt32, debugPaddingBytes);
       writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-        WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
+        WriteProgramPart(pSM, pModuleBitcode, pStream);
       });
-    }
-
-    pProgramStream.Release();
-
-    llvm::StripDebugInfo(*pModule->GetModule());
-    pModule->StripDebugRelatedCode();
-
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pProgramStream));
-    raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
-
-    if (Flags & SerializeDxilFlags::IncludeDebugNamePart) {
-      CComPtr<AbstractMemoryStream> pHashStream;
-      // If the debug name should be specific to the sources, base the name on the debug
-      // bitcode, which will include the source references, line numbers, etc. Otherwise,
-      // do it exclusively on the target shader bitcode.
-      pHashStream = (int)(Flags & SerializeDxilFlags::DebugNameDependOnSource) ? pModuleBitcode : pProgramStream;
-      const uint32_t DebugInfoNameHashLen = 32;   // 32 chars of MD5
-      const uint32_t DebugInfoNameSuffix = 4;     // '.lld'
-      const uint32_t DebugInfoNameNullAndPad = 4; // '\0\0\0\0'
-      const uint32_t DebugInfoContentLen =
-          sizeof(DxilShaderDebugName) + DebugInfoNameHashLen +
-          DebugInfoNameSuffix + DebugInfoNameNullAndPad;
-      writer.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen, [&](AbstractMemoryStream *pStream) {
-        DxilShaderDebugName NameContent;
-        NameContent.Flags = 0;
-        NameContent.NameLength = DebugInfoNameHashLen + DebugInfoNameSuffix;
-        IFT(WriteStreamValue(pStream, NameContent));
-
-        ArrayRef<uint8_t> Data((uint8_t *)pHashStream->GetPtr(), pHashStream->GetPtrSize());
-        llvm::MD5 md5;
-        llvm::MD5::MD5Result md5Result;
-        SmallString<32> Hash;
-        md5.update(Data);
-        md5.final(md5Result);
-        md5.stringifyResult(md5Result, Hash);
-
-        ULONG cbWritten;
-        IFT(pStream->Write(Hash.data(), Hash.size(), &cbWritten));
-        const char SuffixAndPad[] = ".lld\0\0\0";
-        IFT(pStream->Write(SuffixAndPad, _countof(SuffixAndPad), &cbWritten));
+    } else {
+      writer.AddStreamedPart(DFCC_ShaderDebugInfoDXIL, [&](AbstractMemoryStream *pStream) {
+        WriteProgramPart(pSM, pModule->GetModule(), pStream, nullptr);
       });
     }
   }
 
-  // Compute padded bitcode size.
-  uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
+  // The debug name is a hash of either the source-level bitcode or the
+  // stripped program. The latter is only produced when the program part is
+  // written, so the name is hashed on the way out and patched in afterwards.
+  llvm::MD5 programHash;
+  llvm::MD5 *pProgramHash = nullptr;
+  const bool nameDependsOnSource =
+      (int)(Flags & SerializeDxilFlags::DebugNameDependOnSource) != 0;
+  if (hasDebugInfo && (Flags & SerializeDxilFlags::IncludeDebugNamePart)) {
+    if (!nameDependsOnSource)
+      pProgramHash = &programHash;
+    const uint32_t DebugInfoNameHashLen = 32;   // 32 chars of MD5
+    const uint32_t DebugInfoNameSuffix = 4;     // '.lld'
+    const uint32_t DebugInfoNameNullAndPad = 4; // '\0\0\0\0'
+    const uint32_t DebugInfoContentLen =
+        sizeof(DxilShaderDebugName) + DebugInfoNameHashLen +
+        DebugInfoNameSuffix + DebugInfoNameNullAndPad;
+    writer.AddPatchedPart(DFCC_ShaderDebugName, DebugInfoContentLen, [&](AbstractMemoryStream *pStream) {
+      DxilShaderDebugName NameContent;
+      NameContent.Flags = 0;
+      NameContent.NameLength = DebugInfoNameHashLen + DebugInfoNameSuffix;
+      IFT(WriteStreamValue(pStream, NameContent));
+
+      // The hash is filled in by the patch below.
+      ULONG cbWritten;
+      const char HashPlaceholder[32] = {};
+      IFT(pStream->Write(HashPlaceholder, sizeof(HashPlaceholder), &cbWritten));
+      const char SuffixAndPad[] = ".lld\0\0\0";
+      IFT(pStream->Write(SuffixAndPad, _countof(SuffixAndPad), &cbWritten));
+    }, [&](char *pPartData) {
+      if (nameDependsOnSource) {
+        ArrayRef<uint8_t> Data((uint8_t *)pModuleBitcode->GetPtr(), pModuleBitcode->GetPtrSize());
+        programHash.update(Data);
+      }
+      llvm::MD5::MD5Result md5Result;
+      SmallString<32> Hash;
+      programHash.final(md5Result);
+      programHash.stringifyResult(md5Result, Hash);
+      DXASSERT_NOMSG(Hash.size() == 32);
+      memcpy(pPartData + sizeof(DxilShaderDebugName), Hash.data(), Hash.size());
+    });
+  }
 
   // Write the program part.
-  writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-    WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
-  });
+  if (bitcodeIsCurrent && !hasDebugInfo) {
+    // Compute padded bitcode size.
+    uint32_t programInUInt32, programPaddingBytes;
+    GetPaddedProgramPartSize(pModuleBitcode, programInUInt32, programPaddingBytes);
+    writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
+      WriteProgramPart(pSM, pModuleBitcode, pStream);
+    });
+  } else {
+    writer.AddStreamedPart(DFCC_DXIL, [&](AbstractMemoryStream *pStream) {
+      if (hasDebugInfo) {
+        llvm::StripDebugInfo(*pModule->GetModule());
+        pModule->StripDebugRelatedCode();
+      }
+      WriteProgramPart(pSM, pModule->GetModule(), pStream, pProgramHash);
+    });
+  }
 
-  writer.write(pFinalStream);
+  // Streamed parts are at most the size of the caller's bitcode each;
+  // reserving for that up front avoids growing the output while writing.
+  uint32_t streamedSizeHint = pModuleBitcode->GetPtrSize();
+  if (hasDebugInfo && !bitcodeIsCurrent &&
+      (Flags & SerializeDxilFlags::IncludeDebugInfoPart))
+    streamedSizeHint *= 2;
+  writer.write(pFinalStream, streamedSizeHint);
 }
 
 void hlsl::SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
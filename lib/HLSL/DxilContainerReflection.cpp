@@ -17,6 +17,7 @@
 #include "dxc/HLSL/DxilShaderModel.h"
 #include "dxc/HLSL/DxilOperations.h"
 #include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilPipelineStateValidation.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinIncludes.h"
@@ -48,9 +49,8 @@ class DxilContainerReflection : public IDxcContainerReflection {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   CComPtr<IDxcBlob> m_container;
-  const DxilContainerHeader *m_pHeader = nullptr;
-  uint32_t m_headerLen = 0;
-  bool IsLoaded() const { return m_pHeader != nullptr; }
+  DxilContainerView m_view;
+  bool IsLoaded() const { return m_view.IsValid(); }
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxilContainerReflection)
@@ -72,9 +72,12 @@ class DxilShaderReflection : public ID3D12ShaderReflection {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   CComPtr<IDxcBlob> m_pContainer;
+  DxilContainerView m_ContainerView; // Points into m_pContainer.
+  const DxilProgramHeader *m_pProgramHeader = nullptr;
   LLVMContext Context;
   std::unique_ptr<Module> m_pModule; // Must come after LLVMContext, otherwise unique_ptr will over-delete.
   DxilModule *m_pDxilModule = nullptr;
+  HRESULT m_ModuleLoadResult = S_FALSE; // S_FALSE until the module is loaded.
   std::vector<CShaderReflectionConstantBuffer>    m_CBs;
   std::vector<D3D12_SHADER_INPUT_BIND_DESC>       m_Resources;
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_InputSignature;
@@ -90,6 +93,7 @@ private:
       std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs);
   LPCSTR CreateUpperCase(LPCSTR pValue);
   void MarkUsedSignatureElements();
+  HRESULT EnsureModule();
 public:
   enum class PublicAPI { D3D12 = 0, D3D11_47 = 1, D3D11_43 = 2 };
   PublicAPI m_PublicAPI;
@@ -120,7 +124,8 @@ public:
     return hr;
   }
 
-  HRESULT Load(IDxcBlob *pBlob, const DxilPartHeader *pPart);
+  HRESULT Load(IDxcBlob *pBlob, const DxilContainerView &View,
+               const DxilPartHeader *pPart);
 
   // ID3D12ShaderReflection
   STDMETHODIMP GetDesc(THIS_ _Out_ D3D12_SHADER_DESC *pDesc);
@@ -166,24 +171,18 @@ _Use_decl_annotations_
 HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
   if (pContainer == nullptr) {
     m_container.Release();
-    m_pHeader = nullptr;
-    m_headerLen = 0;
+    m_view.Reset();
     return S_OK;
   }
 
-  uint32_t bufLen = pContainer->GetBufferSize();
-  const DxilContainerHeader *pHeader =
-      IsDxilContainerLike(pContainer->GetBufferPointer(), bufLen);
-  if (pHeader == nullptr) {
-    return E_INVALIDARG;
-  }
-  if (!IsValidDxilContainer(pHeader, bufLen)) {
+  DxilContainerView view;
+  if (!view.Initialize(pContainer->GetBufferPointer(),
+                       pContainer->GetBufferSize())) {
     return E_INVALIDARG;
   }
 
   m_container = pContainer;
-  m_headerLen = bufLen;
-  m_pHeader = pHeader;
+  m_view = view;
 
   return S_OK;
 }
@@ -192,7 +191,7 @@ _Use_decl_annotations_
 HRESULT DxilContainerReflection::GetPartCount(UINT32 *pResult) {
   if (pResult == nullptr) return E_POINTER;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  *pResult = m_pHeader->PartCount;
+  *pResult = m_view.GetPartCount();
   return S_OK;
 }
 
@@ -200,9 +199,8 @@ _Use_decl_annotations_
 HRESULT DxilContainerReflection::GetPartKind(UINT32 idx, _Out_ UINT32 *pResult) {
   if (pResult == nullptr) return E_POINTER;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  if (idx >= m_pHeader->PartCount) return E_BOUNDS;
-  const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
-  *pResult = pPart->PartFourCC;
+  if (idx >= m_view.GetPartCount()) return E_BOUNDS;
+  *pResult = m_view.GetPart(idx)->PartFourCC;
   return S_OK;
 }
 
@@ -211,13 +209,12 @@ HRESULT DxilContainerReflection::GetPartContent(UINT32 idx, _COM_Outptr_ IDxcBlo
   if (ppResult == nullptr) return E_POINTER;
   *ppResult = nullptr;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  if (idx >= m_pHeader->PartCount) return E_BOUNDS;
-  const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
-  const char *pData = GetDxilPartData(pPart);
-  uint32_t offset = (uint32_t)(pData - (char*)m_container->GetBufferPointer()); // Offset from the beginning.
-  uint32_t length = pPart->PartSize;
+  if (idx >= m_view.GetPartCount()) return E_BOUNDS;
+  // The part blob shares the container's storage rather than copying it.
+  DxilPartSpan data = DxilContainerView::GetPartSpan(m_view.GetPart(idx));
+  uint32_t offset = (uint32_t)(data.pData - (char*)m_container->GetBufferPointer()); // Offset from the beginning.
   DxcThreadMalloc TM(m_pMalloc);
-  return DxcCreateBlobFromBlob(m_container, offset, length, ppResult);
+  return DxcCreateBlobFromBlob(m_container, offset, data.Size, ppResult);
 }
 
 _Use_decl_annotations_
@@ -225,8 +222,8 @@ HRESULT DxilContainerReflection::FindFirstPartKind(UINT32 kind, _Out_ UINT32 *pR
   if (pResult == nullptr) return E_POINTER;
   *pResult = 0;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  DxilPartIterator it = std::find_if(begin(m_pHeader), end(m_pHeader), DxilPartIsType(kind));
-  if (it == end(m_pHeader)) return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+  DxilPartIterator it = std::find_if(m_view.begin(), m_view.end(), DxilPartIsType(kind));
+  if (it == m_view.end()) return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
   *pResult = it.index;
   return S_OK;
 }
@@ -236,8 +233,8 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   if (ppvObject == nullptr) return E_POINTER;
   *ppvObject = nullptr;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  if (idx >= m_pHeader->PartCount) return E_BOUNDS;
-  const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
+  if (idx >= m_view.GetPartCount()) return E_BOUNDS;
+  const DxilPartHeader *pPart = m_view.GetPart(idx);
   if (pPart->PartFourCC != DFCC_DXIL && pPart->PartFourCC != DFCC_ShaderDebugInfoDXIL) {
     return E_NOTIMPL;
   }
@@ -249,7 +246,7 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   DxilShaderReflection::PublicAPI api = DxilShaderReflection::IIDToAPI(iid);
   pReflection->SetPublicAPI(api);
 
-  IFC(pReflection->Load(m_container, pPart));
+  IFC(pReflection->Load(m_container, m_view, pPart));
   IFC(pReflection.p->QueryInterface(iid, ppvObject));
 Cleanup:
   return hr;
@@ -1635,38 +1632,62 @@ LPCSTR DxilShaderReflection::CreateUpperCase(LPCSTR pValue) {
 }
 
 HRESULT DxilShaderReflection::Load(IDxcBlob *pBlob,
+                                   const DxilContainerView &View,
                                    const DxilPartHeader *pPart) {
   DXASSERT_NOMSG(pBlob != nullptr);
   DXASSERT_NOMSG(pPart != nullptr);
+  // Only the program header is checked here; the bitcode is parsed on the
+  // first query that needs the module, as many callers only look at parts
+  // that are available directly from the container.
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart));
+  if (!IsValidDxilProgramHeader(pProgramHeader, pPart->PartSize)) {
+    return E_INVALIDARG;
+  }
+  const unsigned char *pBitcode =
+      reinterpret_cast<const unsigned char *>(GetDxilBitcodeData(pProgramHeader));
+  if (!isBitcode(pBitcode, pBitcode + GetDxilBitcodeSize(pProgramHeader))) {
+    return E_INVALIDARG;
+  }
   m_pContainer = pBlob;
-  const char *pData = GetDxilPartData(pPart);
+  m_ContainerView = View;
+  m_pProgramHeader = pProgramHeader;
+  return S_OK;
+}
+
+HRESULT DxilShaderReflection::EnsureModule() {
+  if (m_ModuleLoadResult != S_FALSE)
+    return m_ModuleLoadResult;
+  DxcThreadMalloc TM(m_pMalloc);
+  m_ModuleLoadResult = E_FAIL;
   try {
     const char *pBitcode;
     uint32_t bitcodeLength;
-    GetDxilProgramBitcode((DxilProgramHeader *)pData, &pBitcode, &bitcodeLength);
-    std::unique_ptr<MemoryBuffer> pMemBuffer =
-        MemoryBuffer::getMemBufferCopy(StringRef(pBitcode, bitcodeLength));
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
+    GetDxilProgramBitcode(m_pProgramHeader, &pBitcode, &bitcodeLength);
+    // The container blob is held for the lifetime of this object, so the
+    // bitcode can be read in place.
+    MemoryBufferRef BitcodeBuffer(StringRef(pBitcode, bitcodeLength), "");
+    // We materialize eagerly, because we'll need to walk instructions to look
+    // for usage information.
     ErrorOr<std::unique_ptr<Module>> module =
-        getLazyBitcodeModule(std::move(pMemBuffer), Context);
-#else
-    ErrorOr<std::unique_ptr<Module>> module =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, nullptr);
-#endif
+      parseBitcodeFile(BitcodeBuffer, Context, nullptr);
     if (!module) {
-      return E_INVALIDARG;
+      m_ModuleLoadResult = E_INVALIDARG;
+      return m_ModuleLoadResult;
     }
     std::swap(m_pModule, module.get());
     m_pDxilModule = &m_pModule->GetOrCreateDxilModule();
     CreateReflectionObjects();
+    m_ModuleLoadResult = S_OK;
     return S_OK;
   }
   CATCH_CPP_RETURN_HRESULT();
-};
+}
 
 _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   IFR(ZeroMemoryToOut(pDesc));
+  IFR(EnsureModule());
   const DxilModule &M = *m_pDxilModule;
   const ShaderModel *pSM = M.GetShaderModel();
 
@@ -1788,7 +1809,7 @@ void DxilShaderReflection::MarkUsedSignatureElements() {
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByIndex(UINT Index) {
-  if (Index >= m_CBs.size()) {
+  if (FAILED(EnsureModule()) || Index >= m_CBs.size()) {
     return &g_InvalidSRConstantBuffer;
   }
   return &m_CBs[Index];
@@ -1796,7 +1817,7 @@ ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByI
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByName(LPCSTR Name) {
-  if (!Name) {
+  if (!Name || FAILED(EnsureModule())) {
     return &g_InvalidSRConstantBuffer;
   }
   for (UINT index = 0; index < m_CBs.size(); ++index) {
@@ -1811,6 +1832,7 @@ _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetResourceBindingDesc(UINT ResourceIndex,
   _Out_ D3D12_SHADER_INPUT_BIND_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
+  IFR(EnsureModule());
   IFRBOOL(ResourceIndex < m_Resources.size(), E_INVALIDARG);
   if (m_PublicAPI != PublicAPI::D3D12) {
     memcpy(pDesc, &m_Resources[ResourceIndex], sizeof(D3D11_SHADER_INPUT_BIND_DESC));
@@ -1825,6 +1847,7 @@ _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetInputParameterDesc(UINT ParameterIndex,
   _Out_ D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
+  IFR(EnsureModule());
   IFRBOOL(ParameterIndex < m_InputSignature.size(), E_INVALIDARG);
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_InputSignature[ParameterIndex];
@@ -1840,6 +1863,7 @@ _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetOutputParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
+  IFR(EnsureModule());
   IFRBOOL(ParameterIndex < m_OutputSignature.size(), E_INVALIDARG);
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_OutputSignature[ParameterIndex];
@@ -1855,6 +1879,7 @@ _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
+  IFR(EnsureModule());
   IFRBOOL(ParameterIndex < m_PatchConstantSignature.size(), E_INVALIDARG);
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_PatchConstantSignature[ParameterIndex];
@@ -1868,7 +1893,7 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionVariable* DxilShaderReflection::GetVariableByName(LPCSTR Name) {
-  if (Name != nullptr) {
+  if (Name != nullptr && SUCCEEDED(EnsureModule())) {
     // Iterate through all cbuffers to find the variable.
     for (UINT i = 0; i < m_CBs.size(); i++) {
       ID3D12ShaderReflectionVariable *pVar = m_CBs[i].GetVariableByName(Name);
@@ -1885,6 +1910,7 @@ _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetResourceBindingDescByName(LPCSTR Name,
   D3D12_SHADER_INPUT_BIND_DESC *pDesc) {
   IFRBOOL(Name != nullptr, E_INVALIDARG);
+  IFR(EnsureModule());
 
   for (UINT i = 0; i < m_Resources.size(); i++) {
     if (strcmp(m_Resources[i].Name, Name) == 0) {
@@ -1907,6 +1933,17 @@ UINT DxilShaderReflection::GetConversionInstructionCount() { return 0; }
 UINT DxilShaderReflection::GetBitwiseInstructionCount() { return 0; }
 
 D3D_PRIMITIVE DxilShaderReflection::GetGSInputPrimitive() {
+  // Only geometry shaders declare an input primitive, and PSV0 records it.
+  if (GetVersionShaderType(m_pProgramHeader->ProgramVersion) !=
+      DXIL::ShaderKind::Geometry)
+    return D3D_PRIMITIVE_UNDEFINED;
+  DxilPartSpan PSVData =
+      m_ContainerView.FindPartSpan(DFCC_PipelineStateValidation);
+  DxilPipelineStateValidation PSV;
+  if (!PSVData.empty() && PSV.InitFromPSV0(PSVData.pData, PSVData.Size))
+    return (D3D_PRIMITIVE)PSV.GetPSVRuntimeInfo0()->GS.InputPrimitive;
+  if (FAILED(EnsureModule()))
+    return D3D_PRIMITIVE_UNDEFINED;
   return (D3D_PRIMITIVE)m_pDxilModule->GetInputPrimitive();
 }
 
@@ -1925,6 +1962,12 @@ HRESULT DxilShaderReflection::GetMinFeatureLevel(enum D3D_FEATURE_LEVEL* pLevel)
 
 _Use_decl_annotations_
 UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *pSizeZ) {
+  if (FAILED(EnsureModule())) {
+    AssignToOutOpt(0u, pSizeX);
+    AssignToOutOpt(0u, pSizeY);
+    AssignToOutOpt(0u, pSizeZ);
+    return 0;
+  }
   UINT *pNumThreads = m_pDxilModule->m_NumThreads;
   AssignToOutOpt(pNumThreads[0], pSizeX);
   AssignToOutOpt(pNumThreads[1], pSizeY);
@@ -1934,7 +1977,17 @@ UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *
 
 UINT64 DxilShaderReflection::GetRequiresFlags() {
   UINT64 result = 0;
-  uint64_t features = m_pDxilModule->m_ShaderFlags.GetFeatureInfo();
+  uint64_t features;
+  // SFI0 holds the same flags as the module, without parsing the bitcode.
+  DxilPartSpan FeatureInfo = m_ContainerView.FindPartSpan(DFCC_FeatureInfo);
+  if (FeatureInfo.Size >= sizeof(DxilShaderFeatureInfo)) {
+    features = reinterpret_cast<const DxilShaderFeatureInfo *>(
+                   FeatureInfo.pData)->FeatureFlags;
+  } else {
+    if (FAILED(EnsureModule()))
+      return 0;
+    features = m_pDxilModule->m_ShaderFlags.GetFeatureInfo();
+  }
   if (features & ShaderFeatureInfo_Doubles) result |= D3D_SHADER_REQUIRES_DOUBLES;
   if (features & ShaderFeatureInfo_UAVsAtEveryStage) result |= D3D_SHADER_REQUIRES_UAVS_AT_EVERY_STAGE;
   if (features & ShaderFeatureInfo_64UAVs) result |= D3D_SHADER_REQUIRES_64_UAVS;
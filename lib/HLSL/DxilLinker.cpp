@@ -23,6 +23,9 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MD5.h"
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -87,6 +90,9 @@ namespace {
 struct DxilFunctionLinkInfo {
   DxilFunctionLinkInfo(llvm::Function *F);
   llvm::Function *func;
+  // Set once the body is materialized and usedFunctions is built; a library
+  // stays loaded across links, so this is only done once per function.
+  bool loaded = false;
   std::unordered_set<llvm::Function *> usedFunctions;
   std::unordered_set<llvm::GlobalVariable *> usedGVs;
   std::unordered_set<DxilResourceBase *> usedResources;
@@ -107,6 +113,7 @@ public:
   DxilResourceBase *GetResource(const llvm::Constant *GV);
 
   DxilModule &GetDxilModule() { return m_DM; }
+  StringRef GetName() const { return m_pModule->getModuleIdentifier(); }
   void LazyLoadFunction(Function *F);
   void BuildGlobalUsage();
   void CollectUsedInitFunctions(StringSet<> &addedFunctionSet,
@@ -121,6 +128,8 @@ private:
   std::unordered_map<const llvm::Constant *, DxilResourceBase *> m_resourceMap;
   // Set of initialize functions for global variable.
   std::unordered_set<llvm::Function *> m_initFuncSet;
+  // Whether functions were loaded since global usage was last built.
+  bool m_bGlobalUsageStale = true;
 };
 
 struct DxilLinkJob;
@@ -145,6 +154,14 @@ private:
   bool AddFunctions(SmallVector<StringRef, 4> &workList,
                     DenseSet<DxilLib *> &libSet, StringSet<> &addedFunctionSet,
                     DxilLinkJob &linkJob, bool bLazyLoadDone);
+  void AddLinkedModuleToCache(StringRef key, const llvm::Module &M);
+  // Linked modules after the prepare passes, keyed by the entry, the profile
+  // and the closure of functions linked for it. Registered libraries never
+  // change, so the same closure always links to the same module.
+  llvm::StringMap<std::unique_ptr<llvm::Module>> m_linkedModuleCache;
+  // Cache keys in insertion order, for eviction.
+  std::deque<std::string> m_linkedModuleCacheOrder;
+  static const unsigned kMaxLinkedModuleCacheSize = 64;
   // Attached libs to link.
   std::unordered_set<DxilLib *> m_attachedLibs;
   // Owner of all DxilLib.
@@ -197,6 +214,11 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
 void DxilLib::LazyLoadFunction(Function *F) {
   DXASSERT(m_functionNameMap.count(F->getName()), "else invalid Function");
   DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
+  if (linkInfo->loaded)
+    return;
+  linkInfo->loaded = true;
+  m_bGlobalUsageStale = true;
+
   std::error_code EC = F->materialize();
   DXASSERT_LOCALVAR(EC, !EC, "else fail to materialize");
 
@@ -221,6 +243,9 @@ void DxilLib::LazyLoadFunction(Function *F) {
 }
 
 void DxilLib::BuildGlobalUsage() {
+  // Usage only changes when more function bodies are loaded.
+  if (!m_bGlobalUsageStale)
+    return;
   Module &M = *m_pModule;
 
   // Collect init functions for static globals.
@@ -265,6 +290,10 @@ void DxilLib::BuildGlobalUsage() {
                  m_resourceMap, m_DM);
   AddResourceMap(m_DM.GetSamplers(), DXIL::ResourceClass::Sampler,
                  m_resourceMap, m_DM);
+
+  // Loading the init functions above doesn't leave usage stale, as they were
+  // loaded before globals were walked.
+  m_bGlobalUsageStale = false;
 }
 
 void DxilLib::CollectUsedInitFunctions(StringSet<> &addedFunctionSet,
@@ -322,6 +351,8 @@ struct DxilLinkJob {
   void RunPreparePass(llvm::Module &M);
   void AddFunction(std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair);
   void AddFunction(llvm::Function *F);
+  void HashClosure(StringRef entry, StringRef profile,
+                   llvm::MD5::MD5Result &key);
 
 private:
   bool AddResource(DxilResourceBase *res, llvm::GlobalVariable *GV);
@@ -721,6 +752,30 @@ void DxilLinkJob::AddFunction(llvm::Function *F) {
   m_dxilFunctions[F->getName()] = F;
 }
 
+// Hashes everything the linked module depends on. Functions are identified by
+// library and name; the globals and resources they use follow from that.
+void DxilLinkJob::HashClosure(StringRef entry, StringRef profile,
+                              MD5::MD5Result &key) {
+  std::vector<std::string> names;
+  names.reserve(m_functionDefs.size());
+  for (auto &it : m_functionDefs) {
+    std::string name = it.second->GetName();
+    name += '\0';
+    name += it.first->func->getName();
+    names.emplace_back(std::move(name));
+  }
+  std::sort(names.begin(), names.end());
+
+  MD5 hash;
+  hash.update(entry);
+  hash.update(StringRef("", 1));
+  hash.update(profile);
+  for (const std::string &name : names) {
+    hash.update(StringRef(name.c_str(), name.size() + 1));
+  }
+  hash.final(key);
+}
+
 void DxilLinkJob::RunPreparePass(Module &M) {
   legacy::PassManager PM;
 
@@ -926,10 +981,32 @@ std::unique_ptr<llvm::Module> DxilLinkerImpl::Link(StringRef entry,
                     /*bLazyLoadDone*/ true))
     return nullptr;
 
+  MD5::MD5Result hash;
+  linkJob.HashClosure(entry, profile, hash);
+  StringRef key((const char *)hash, sizeof(hash));
+  auto cached = m_linkedModuleCache.find(key);
+  if (cached != m_linkedModuleCache.end())
+    return std::unique_ptr<Module>(CloneModule(cached->second.get()));
+
   std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair =
       m_functionNameMap[entry];
 
-  return linkJob.Link(entryLinkPair, profile);
+  std::unique_ptr<Module> pM = linkJob.Link(entryLinkPair, profile);
+  if (pM)
+    AddLinkedModuleToCache(key, *pM);
+  return pM;
+}
+
+void DxilLinkerImpl::AddLinkedModuleToCache(StringRef key, const Module &M) {
+  if (m_linkedModuleCacheOrder.size() >= kMaxLinkedModuleCacheSize) {
+    m_linkedModuleCache.erase(m_linkedModuleCacheOrder.front());
+    m_linkedModuleCacheOrder.pop_front();
+  }
+  // The caller owns the returned module and may change it, so a copy is kept.
+  // The copy carries the DXIL metadata emitted by the prepare passes, which
+  // is all a clone needs to rebuild its DxilModule.
+  m_linkedModuleCache[key].reset(CloneModule(&M));
+  m_linkedModuleCacheOrder.emplace_back(key);
 }
 
 namespace hlsl {
@@ -353,9 +353,12 @@ void DxilMDHelper::LoadRootSignature(RootSignatureHandle &Sig) {
 
   IFTBOOL(pRootSignatureNamedMD->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
 
-  MDNode *pNode = pRootSignatureNamedMD->getOperand(0);
-  IFTBOOL(pNode->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
-  const MDOperand &MDO = pNode->getOperand(0);
+  LoadRootSignatureNode(*pRootSignatureNamedMD->getOperand(0), Sig);
+}
+
+void DxilMDHelper::LoadRootSignatureNode(const MDNode &MDN, RootSignatureHandle &Sig) {
+  IFTBOOL(MDN.getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
+  const MDOperand &MDO = MDN.getOperand(0);
 
   const ConstantAsMetadata *pMetaData = dyn_cast<ConstantAsMetadata>(MDO.get());
   IFTBOOL(pMetaData != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
@@ -1083,9 +1086,12 @@ void DxilMDHelper::LoadDxilViewIdState(DxilViewIdState &ViewIdState) {
 
   IFTBOOL(pViewIdStateNamedMD->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
 
-  MDNode *pNode = pViewIdStateNamedMD->getOperand(0);
-  IFTBOOL(pNode->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
-  const MDOperand &MDO = pNode->getOperand(0);
+  LoadDxilViewIdStateNode(*pViewIdStateNamedMD->getOperand(0), ViewIdState);
+}
+
+void DxilMDHelper::LoadDxilViewIdStateNode(const MDNode &MDN, DxilViewIdState &ViewIdState) {
+  IFTBOOL(MDN.getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
+  const MDOperand &MDO = MDN.getOperand(0);
 
   const ConstantAsMetadata *pMetaData = dyn_cast<ConstantAsMetadata>(MDO.get());
   IFTBOOL(pMetaData != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
@@ -27,6 +27,7 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <unordered_set>
 
 using namespace llvm;
@@ -83,7 +84,8 @@ DxilModule::DxilModule(Module *pModule)
 , m_TessellatorPartitioning(DXIL::TessellatorPartitioning::Undefined)
 , m_TessellatorOutputPrimitive(DXIL::TessellatorOutputPrimitive::Undefined)
 , m_MaxTessellationFactor(0.f)
-, m_RootSignature(nullptr) {
+, m_RootSignature(nullptr)
+, m_LazyMetadata(0) {
   DXASSERT_NOMSG(m_pModule != nullptr);
 
   m_NumThreads[0] = m_NumThreads[1] = m_NumThreads[2] = 0;
@@ -973,8 +975,11 @@ void DxilModule::RemoveFunction(llvm::Function *F) {
   DXASSERT_NOMSG(F != nullptr);
   m_DxilFunctionPropsMap.erase(F);
   m_DxilEntrySignatureMap.erase(F);
-  if (m_pTypeSystem.get()->GetFunctionAnnotation(F))
-    m_pTypeSystem.get()->EraseFunctionAnnotation(F);
+  // Loads the type system if needed; otherwise the kept metadata would be
+  // emitted with the annotation of the deleted function.
+  DxilTypeSystem &TypeSystem = GetTypeSystem();
+  if (TypeSystem.GetFunctionAnnotation(F))
+    TypeSystem.EraseFunctionAnnotation(F);
   m_pOP->RemoveFunction(F);
 }
 
@@ -1067,6 +1072,7 @@ const DxilSignature &DxilModule::GetPatchConstantSignature() const {
 }
 
 const RootSignatureHandle &DxilModule::GetRootSignature() const {
+  LoadLazyMetadata(LazyRootSignature);
   return *m_RootSignature;
 }
 
@@ -1118,21 +1124,28 @@ void DxilModule::ResetEntrySignature(DxilEntrySignature *pValue) {
 }
 
 void DxilModule::ResetRootSignature(RootSignatureHandle *pValue) {
+  m_LazyMetadata &= ~(1u << LazyRootSignature);
+  m_LazyMetadataNodes[LazyRootSignature].clear();
   m_RootSignature.reset(pValue);
 }
 
 DxilTypeSystem &DxilModule::GetTypeSystem() {
+  LoadLazyMetadata(LazyTypeSystem);
   return *m_pTypeSystem;
 }
 
 DxilViewIdState &DxilModule::GetViewIdState() {
+  LoadLazyMetadata(LazyViewIdState);
   return *m_pViewIdState;
 }
 const DxilViewIdState &DxilModule::GetViewIdState() const {
+  LoadLazyMetadata(LazyViewIdState);
   return *m_pViewIdState;
 }
 
 void DxilModule::ResetTypeSystem(DxilTypeSystem *pValue) {
+  m_LazyMetadata &= ~(1u << LazyTypeSystem);
+  m_LazyMetadataNodes[LazyTypeSystem].clear();
   m_pTypeSystem.reset(pValue);
 }
 
@@ -1234,11 +1247,13 @@ void DxilModule::EmitDxilMetadata() {
   MDTuple *pMDResources = EmitDxilResources();
   if (pMDResources)
     m_pMDHelper->EmitDxilResources(pMDResources);
-  m_pMDHelper->EmitDxilTypeSystem(GetTypeSystem(), m_LLVMUsed);
+  if (!EmitLazyMetadata(LazyTypeSystem, DxilMDHelper::kDxilTypeSystemMDName))
+    m_pMDHelper->EmitDxilTypeSystem(GetTypeSystem(), m_LLVMUsed);
   if (!m_pSM->IsLib() && !m_pSM->IsCS() &&
       ((m_ValMajor == 0 &&  m_ValMinor == 0) ||
        (m_ValMajor > 1 || (m_ValMajor == 1 && m_ValMinor >= 1)))) {
-    m_pMDHelper->EmitDxilViewIdState(GetViewIdState());
+    if (!EmitLazyMetadata(LazyViewIdState, DxilMDHelper::kDxilViewIdStateMDName))
+      m_pMDHelper->EmitDxilViewIdState(GetViewIdState());
   }
   EmitLLVMUsed();
   MDTuple *pEntry = m_pMDHelper->EmitDxilEntryPointTuple(GetEntryFunction(), m_EntryName, pMDSignatures, pMDResources, pMDProperties);
@@ -1246,7 +1261,8 @@ void DxilModule::EmitDxilMetadata() {
   Entries.emplace_back(pEntry);
   m_pMDHelper->EmitDxilEntryPoints(Entries);
 
-  if (!m_RootSignature->IsEmpty()) {
+  if (!EmitLazyMetadata(LazyRootSignature, DxilMDHelper::kDxilRootSignatureMDName) &&
+      !m_RootSignature->IsEmpty()) {
     m_pMDHelper->EmitRootSignature(*m_RootSignature.get());
   }
   if (m_pSM->IsLib()) {
@@ -1299,11 +1315,11 @@ void DxilModule::LoadDxilMetadata() {
   m_pMDHelper->LoadDxilSignatures(*pSignatures, *m_EntrySignature);
   LoadDxilResources(*pResources);
 
-  m_pMDHelper->LoadDxilTypeSystem(*m_pTypeSystem.get());
-
-  m_pMDHelper->LoadRootSignature(*m_RootSignature.get());
-
-  m_pMDHelper->LoadDxilViewIdState(*m_pViewIdState.get());
+  // Libraries can carry annotations for thousands of types that most
+  // consumers never look at, so these are deserialized on first use.
+  CaptureLazyMetadata(LazyTypeSystem, DxilMDHelper::kDxilTypeSystemMDName, 2);
+  CaptureLazyMetadata(LazyRootSignature, DxilMDHelper::kDxilRootSignatureMDName, 1);
+  CaptureLazyMetadata(LazyViewIdState, DxilMDHelper::kDxilViewIdStateMDName, 1);
 
   if (loadedModule->IsLib()) {
     LoadDxilResourcesLinkInfo();
@@ -1345,6 +1361,95 @@ void DxilModule::LoadDxilMetadata() {
   }
 }
 
+void DxilModule::LoadLazyDxilMetadata() {
+  LoadLazyMetadata(LazyTypeSystem);
+  LoadLazyMetadata(LazyRootSignature);
+  LoadLazyMetadata(LazyViewIdState);
+}
+
+void DxilModule::CaptureLazyMetadata(LazyMetadataKind Kind, StringRef Name,
+                                     unsigned MaxNodes) {
+  m_LazyMetadataNodes[Kind].clear();
+  m_LazyMetadata &= ~(1u << Kind);
+  NamedMDNode *pNamedMD = m_pModule->getNamedMetadata(Name);
+  if (pNamedMD == nullptr || pNamedMD->getNumOperands() == 0)
+    return;
+  IFTBOOL(pNamedMD->getNumOperands() <= MaxNodes, DXC_E_INCORRECT_DXIL_METADATA);
+  for (MDNode *pNode : pNamedMD->operands()) {
+    IFTBOOL(isa<MDTuple>(pNode), DXC_E_INCORRECT_DXIL_METADATA);
+    m_LazyMetadataNodes[Kind].emplace_back(pNode);
+  }
+  m_LazyMetadata |= 1u << Kind;
+}
+
+// Drops the annotations of deleted functions from a type system node; they
+// stay in kept metadata if a function is deleted without RemoveFunction.
+static const MDTuple *RemoveDeletedFunctions(LLVMContext &Ctx,
+                                             const MDTuple *pTupleMD) {
+  if (std::none_of(pTupleMD->op_begin(), pTupleMD->op_end(),
+                   [](const MDOperand &MDO) { return MDO.get() == nullptr; }))
+    return pTupleMD;
+  SmallVector<Metadata *, 16> MDVals;
+  MDVals.push_back(pTupleMD->getOperand(0));
+  for (unsigned i = 1; i + 1 < pTupleMD->getNumOperands(); i += 2) {
+    if (pTupleMD->getOperand(i).get() == nullptr)
+      continue;
+    MDVals.push_back(pTupleMD->getOperand(i));
+    MDVals.push_back(pTupleMD->getOperand(i + 1));
+  }
+  return MDTuple::get(Ctx, MDVals);
+}
+
+void DxilModule::LoadLazyMetadata(LazyMetadataKind Kind) const {
+  if ((m_LazyMetadata & (1u << Kind)) == 0)
+    return;
+  m_LazyMetadata &= ~(1u << Kind);
+  SmallVector<TrackingMDNodeRef, 2> Nodes;
+  Nodes.swap(m_LazyMetadataNodes[Kind]);
+  for (const TrackingMDNodeRef &Node : Nodes) {
+    if (!Node)
+      continue;
+    switch (Kind) {
+    case LazyTypeSystem:
+      m_pMDHelper->LoadDxilTypeSystemNode(
+          *RemoveDeletedFunctions(m_Ctx, cast<MDTuple>(Node.get())),
+          *m_pTypeSystem);
+      break;
+    case LazyRootSignature:
+      m_pMDHelper->LoadRootSignatureNode(*Node, *m_RootSignature);
+      break;
+    case LazyViewIdState:
+      m_pMDHelper->LoadDxilViewIdStateNode(*Node, *m_pViewIdState);
+      break;
+    default:
+      DXASSERT(false, "else unknown lazy metadata kind");
+    }
+  }
+}
+
+// Emits the nodes kept for a category that hasn't been loaded, and so can't
+// have changed. Returns false if the category has to be serialized.
+bool DxilModule::EmitLazyMetadata(LazyMetadataKind Kind, StringRef Name) {
+  if ((m_LazyMetadata & (1u << Kind)) == 0)
+    return false;
+  // Nodes that lost an operand, such as a deleted function, are reloaded
+  // and serialized again.
+  for (const TrackingMDNodeRef &Node : m_LazyMetadataNodes[Kind]) {
+    if (!Node || std::any_of(Node->op_begin(), Node->op_end(),
+                             [](const MDOperand &MDO) { return MDO.get() == nullptr; })) {
+      LoadLazyMetadata(Kind);
+      return false;
+    }
+  }
+
+  if (NamedMDNode *pNamedMD = m_pModule->getNamedMetadata(Name))
+    m_pModule->eraseNamedMetadata(pNamedMD);
+  NamedMDNode *pNamedMD = m_pModule->getOrInsertNamedMetadata(Name);
+  for (const TrackingMDNodeRef &Node : m_LazyMetadataNodes[Kind])
+    pNamedMD->addOperand(Node.get());
+  return true;
+}
+
 MDTuple *DxilModule::EmitDxilResources() {
   // Emit SRV records.
   MDTuple *pTupleSRVs = nullptr;
@@ -1396,7 +1501,7 @@ MDTuple *DxilModule::EmitDxilResources() {
 void DxilModule::ReEmitDxilResources() {
   ClearDxilMetadata(*m_pModule);
   if (!m_pSM->IsCS() && !m_pSM->IsLib())
-    m_pViewIdState->Compute();
+    GetViewIdState().Compute();
   EmitDxilMetadata();
 }
 
@@ -1698,7 +1803,10 @@ hlsl::DxilModule *hlsl::DxilModule::TryGetDxilModule(llvm::Module *pModule) {
   hlsl::DxilModule *pDxilModule = nullptr;
   // TODO: add detail error in DxilMDHelper.
   try {
-    pDxilModule = &pModule->GetOrCreateDxilModule();
+    // Load everything up front, so metadata errors are reported here.
+    DxilModule &DM = pModule->GetOrCreateDxilModule();
+    DM.LoadLazyDxilMetadata();
+    pDxilModule = &DM;
   } catch (const ::hlsl::Exception &hlslException) {
     diagStream << "load dxil metadata failed -";
     try {
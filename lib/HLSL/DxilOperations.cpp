@@ -486,6 +486,9 @@ OP::OP(LLVMContext &Ctx, Module *pModule)
 }
 
 void OP::RefreshCache() {
+  // Rebuilt from scratch, so functions deleted since are dropped.
+  memset(m_OpCodeClassCache, 0, sizeof(m_OpCodeClassCache));
+  m_FunctionToOpClass.clear();
   for (Function &F : m_pModule->functions()) {
     if (OP::IsDxilOpFunc(&F) && !F.user_empty()) {
       CallInst *CI = cast<CallInst>(*F.user_begin());
@@ -817,6 +820,54 @@ void OP::RemoveFunction(Function *F) {
   }
 }
 
+void OP::GetOpCalls(OpCode OpCode, SmallVectorImpl<CallInst *> &Calls) {
+  DXASSERT(0 <= (unsigned)OpCode && OpCode < OpCode::NumOpCodes, "otherwise caller passed OOB OpCode");
+  _Analysis_assume_(0 <= (unsigned)OpCode && OpCode < OpCode::NumOpCodes);
+  CollectOpCalls(m_OpCodeProps[(unsigned)OpCode].OpCodeClass, OpCode, Calls);
+}
+
+void OP::GetOpCalls(OpCodeClass opClass, SmallVectorImpl<CallInst *> &Calls) {
+  DXASSERT(opClass < OpCodeClass::NumOpClasses, "otherwise caller passed OOB OpCodeClass");
+  CollectOpCalls(opClass, OpCode::NumOpCodes, Calls);
+}
+
+// OpCode is NumOpCodes to collect calls to any operation of the class.
+void OP::CollectOpCalls(OpCodeClass opClass, OpCode OpCode,
+                        SmallVectorImpl<CallInst *> &Calls) {
+  const char *pClassName = nullptr;
+  for (const OpCodeProperty &Prop : m_OpCodeProps) {
+    if (Prop.OpCodeClass == opClass) {
+      pClassName = Prop.pOpCodeClassName;
+      break;
+    }
+  }
+  if (pClassName == nullptr)
+    return;
+
+  for (unsigned TypeSlot = 0; TypeSlot < kNumTypeOverloads; ++TypeSlot) {
+    Function *F = m_OpCodeClassCache[(unsigned)opClass].pOverloads[TypeSlot];
+    if (F == nullptr) {
+      // Overloads that haven't been requested through this object may still
+      // be in the module; look them up without creating them.
+      std::string funcName = (Twine(OP::m_NamePrefix) + Twine(pClassName)).str();
+      if (TypeSlot != 0)
+        funcName = Twine(funcName).concat(".").concat(GetOverloadTypeName(TypeSlot)).str();
+      F = m_pModule->getFunction(funcName);
+      if (F == nullptr)
+        continue;
+      UpdateCache(opClass, TypeSlot, F);
+    }
+    for (User *U : F->users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      if (CI == nullptr)
+        continue;
+      if (OpCode != OpCode::NumOpCodes && GetDxilOpFuncCallInst(CI) != OpCode)
+        continue;
+      Calls.push_back(CI);
+    }
+  }
+}
+
 bool OP::GetOpCodeClass(const Function *F, OP::OpCodeClass &opClass) {
   auto iter = m_FunctionToOpClass.find(F);
   if (iter == m_FunctionToOpClass.end()) {
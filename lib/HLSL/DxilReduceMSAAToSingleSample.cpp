@@ -35,40 +35,30 @@ bool DxilReduceMSAAToSingleSample::runOnModule(Module &M)
 {
   DxilModule &DM = M.GetOrCreateDxilModule();
 
-  LLVMContext & Ctx = M.getContext();
   OP *HlslOP = DM.GetOP();
 
-  // FP16 type doesn't have its own identity, and is covered by float type... 
-
-
-  auto TextureLoadOverloads = std::vector<Type*>{ Type::getFloatTy(Ctx), Type::getInt16Ty(Ctx), Type::getInt32Ty(Ctx) };
-
   bool Modified = false;
 
-  for (const auto & Overload : TextureLoadOverloads) {
-
-    Function * TexLoadFunction = HlslOP->GetOpFunc(DXIL::OpCode::TextureLoad, Overload);
-    auto TexLoadFunctionUses = TexLoadFunction->uses();
-
-    for (auto FI = TexLoadFunctionUses.begin(); FI != TexLoadFunctionUses.end(); ) {
-      auto & FunctionUse = *FI++;
-      auto FunctionUser = FunctionUse.getUser();
-      auto instruction = cast<Instruction>(FunctionUser);
-      DxilInst_TextureLoad LoadInstruction(instruction);
-      auto TextureHandle = LoadInstruction.get_srv();
-      auto TextureHandleInst = cast<CallInst>(TextureHandle);
-      DxilInst_CreateHandle createHandle(TextureHandleInst);
-      // Dynamic rangeId is not supported 
-      if (isa<ConstantInt>(createHandle.get_rangeId())){
-        unsigned rangeId = cast<ConstantInt>(createHandle.get_rangeId())->getLimitedValue();
-        if (static_cast<DXIL::ResourceClass>(createHandle.get_resourceClass_val()) == DXIL::ResourceClass::SRV) {
-          auto Resource = DM.GetSRV(rangeId);
-          if (Resource.GetKind() == DXIL::ResourceKind::Texture2DMS || Resource.GetKind() == DXIL::ResourceKind::Texture2DMSArray) {
-            // "2" is the mip-level/sample-index operand index:
-            // https://github.com/Microsoft/DirectXShaderCompiler/blob/master/docs/DXIL.rst#textureload
-            instruction->setOperand(2, HlslOP->GetI32Const(0));
-            Modified = true;
-          }
+  // Every overload in use is visited, including FP16, which shares the
+  // float overload when min precision is used.
+  SmallVector<CallInst *, 16> TexLoads;
+  HlslOP->GetOpCalls(DXIL::OpCode::TextureLoad, TexLoads);
+
+  for (CallInst *instruction : TexLoads) {
+    DxilInst_TextureLoad LoadInstruction(instruction);
+    auto TextureHandle = LoadInstruction.get_srv();
+    auto TextureHandleInst = cast<CallInst>(TextureHandle);
+    DxilInst_CreateHandle createHandle(TextureHandleInst);
+    // Dynamic rangeId is not supported 
+    if (isa<ConstantInt>(createHandle.get_rangeId())){
+      unsigned rangeId = cast<ConstantInt>(createHandle.get_rangeId())->getLimitedValue();
+      if (static_cast<DXIL::ResourceClass>(createHandle.get_resourceClass_val()) == DXIL::ResourceClass::SRV) {
+        auto Resource = DM.GetSRV(rangeId);
+        if (Resource.GetKind() == DXIL::ResourceKind::Texture2DMS || Resource.GetKind() == DXIL::ResourceKind::Texture2DMSArray) {
+          // "2" is the mip-level/sample-index operand index:
+          // https://github.com/Microsoft/DirectXShaderCompiler/blob/master/docs/DXIL.rst#textureload
+          instruction->setOperand(2, HlslOP->GetI32Const(0));
+          Modified = true;
         }
       }
     }
@@ -34,22 +34,15 @@ bool DxilRemoveDiscards::runOnModule(Module &M)
   // This pass removes all instances of the discard instruction within the shader.
   DxilModule &DM = M.GetOrCreateDxilModule();
 
-  LLVMContext & Ctx = M.getContext();
   OP *HlslOP = DM.GetOP();
-  Function * DiscardFunction = HlslOP->GetOpFunc(DXIL::OpCode::Discard, Type::getVoidTy(Ctx));
-  auto DiscardFunctionUses = DiscardFunction->uses();
+  SmallVector<CallInst *, 8> Discards;
+  HlslOP->GetOpCalls(DXIL::OpCode::Discard, Discards);
 
-  bool Modified = false;
-
-  for (auto FI = DiscardFunctionUses.begin(); FI != DiscardFunctionUses.end(); ) {
-    auto & FunctionUse = *FI++;
-    auto FunctionUser = FunctionUse.getUser();
-    auto instruction = cast<Instruction>(FunctionUser);
+  for (CallInst *instruction : Discards) {
     instruction->eraseFromParent();
-    Modified = true;
   }
 
-  return Modified;
+  return !Discards.empty();
 }
 
 char DxilRemoveDiscards::ID = 0;
@@ -355,12 +355,9 @@ bool DxilShaderAccessTracking::runOnModule(Module &M)
 
     bool FoundDynamicIndexing = false;
 
-    auto CreateHandleFn = HlslOP->GetOpFunc(DXIL::OpCode::CreateHandle, Type::getVoidTy(Ctx));
-    auto CreateHandleUses = CreateHandleFn->uses();
-    for (auto FI = CreateHandleUses.begin(); FI != CreateHandleUses.end(); ) {
-      auto & FunctionUse = *FI++;
-      auto FunctionUser = FunctionUse.getUser();
-      auto instruction = cast<Instruction>(FunctionUser);
+    SmallVector<CallInst *, 16> CreateHandleCalls;
+    HlslOP->GetOpCalls(DXIL::OpCode::CreateHandle, CreateHandleCalls);
+    for (CallInst *instruction : CreateHandleCalls) {
       Value * index = instruction->getOperand(3);
       if (!isa<Constant>(index)) {
         FoundDynamicIndexing = true;
@@ -434,65 +431,51 @@ bool DxilShaderAccessTracking::runOnModule(Module &M)
       DXIL::OpCode opcode;
       ShaderAccessFlags readWrite;
       bool functionUsesSamplerAtIndex2;
-      std::vector<Type*> overloads;
     };
 
-    std::vector<Type*> voidType = { Type::getVoidTy(Ctx) };
-    std::vector<Type*> i32 = { Type::getInt32Ty(Ctx) };
-    std::vector<Type*> f16f32 = { Type::getHalfTy(Ctx), Type::getFloatTy(Ctx) };
-    std::vector<Type*> f32i32 = { Type::getFloatTy(Ctx), Type::getInt32Ty(Ctx) };
-    std::vector<Type*> f32i32f64 = { Type::getFloatTy(Ctx), Type::getInt32Ty(Ctx), Type::getDoubleTy(Ctx) };
-    std::vector<Type*> f16f32i16i32 = { Type::getHalfTy(Ctx), Type::getFloatTy(Ctx), Type::getInt16Ty(Ctx), Type::getInt32Ty(Ctx) };
-    std::vector<Type*> f16f32f64i16i32i64 = { Type::getHalfTy(Ctx), Type::getFloatTy(Ctx), Type::getDoubleTy(Ctx), Type::getInt16Ty(Ctx), Type::getInt32Ty(Ctx), Type::getInt64Ty(Ctx) };
-
-
     // todo: should "GetDimensions" mean a resource access?
     ResourceAccessFunction raFunctions[] = {
-      { DXIL::OpCode::CBufferLoadLegacy     , ShaderAccessFlags::Read   , false, f32i32f64 },
-      { DXIL::OpCode::CBufferLoad           , ShaderAccessFlags::Read   , false, f16f32f64i16i32i64 },
-      { DXIL::OpCode::Sample                , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::SampleBias            , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::SampleLevel           , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::SampleGrad            , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::SampleCmp             , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::SampleCmpLevelZero    , ShaderAccessFlags::Read   , true , f16f32 },
-      { DXIL::OpCode::TextureLoad           , ShaderAccessFlags::Read   , false, f16f32i16i32 },
-      { DXIL::OpCode::TextureStore          , ShaderAccessFlags::Write  , false, f16f32i16i32 },
-      { DXIL::OpCode::TextureGather         , ShaderAccessFlags::Read   , true , f32i32 }, // todo: SM6: f16f32i16i32 },
-      { DXIL::OpCode::TextureGatherCmp      , ShaderAccessFlags::Read   , false, f32i32 }, // todo: SM6: f16f32i16i32 },
-      { DXIL::OpCode::BufferLoad            , ShaderAccessFlags::Read   , false, f32i32 },
-      { DXIL::OpCode::RawBufferLoad         , ShaderAccessFlags::Read   , false, f32i32 },
-      { DXIL::OpCode::BufferStore           , ShaderAccessFlags::Write  , false, f32i32 },
-      { DXIL::OpCode::BufferUpdateCounter   , ShaderAccessFlags::Counter, false, voidType },
-      { DXIL::OpCode::AtomicBinOp           , ShaderAccessFlags::Write  , false, i32 },
-      { DXIL::OpCode::AtomicCompareExchange , ShaderAccessFlags::Write  , false, i32 },
+      { DXIL::OpCode::CBufferLoadLegacy     , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::CBufferLoad           , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::Sample                , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::SampleBias            , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::SampleLevel           , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::SampleGrad            , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::SampleCmp             , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::SampleCmpLevelZero    , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::TextureLoad           , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::TextureStore          , ShaderAccessFlags::Write  , false },
+      { DXIL::OpCode::TextureGather         , ShaderAccessFlags::Read   , true  },
+      { DXIL::OpCode::TextureGatherCmp      , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::BufferLoad            , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::RawBufferLoad         , ShaderAccessFlags::Read   , false },
+      { DXIL::OpCode::BufferStore           , ShaderAccessFlags::Write  , false },
+      { DXIL::OpCode::BufferUpdateCounter   , ShaderAccessFlags::Counter, false },
+      { DXIL::OpCode::AtomicBinOp           , ShaderAccessFlags::Write  , false },
+      { DXIL::OpCode::AtomicCompareExchange , ShaderAccessFlags::Write  , false },
     };
 
     for (const auto & raFunction : raFunctions) {
-      for (const auto & Overload : raFunction.overloads) {
-        Function * TheFunction = HlslOP->GetOpFunc(raFunction.opcode, Overload);
-        auto TexLoadFunctionUses = TheFunction->uses();
-        for (auto FI = TexLoadFunctionUses.begin(); FI != TexLoadFunctionUses.end(); ) {
-          auto & FunctionUse = *FI++;
-          auto FunctionUser = FunctionUse.getUser();
-          auto instruction = cast<Instruction>(FunctionUser);
-
-          auto res = GetResourceFromHandle(instruction->getOperand(1), DM);
-
-          // Don't instrument the accesses to the UAV that we just added
-          if (res.resource->GetSpaceID() == (unsigned)-2) {
-            continue;
-          }
+      // Every overload in use is visited; calls added while instrumenting
+      // aren't in the list.
+      SmallVector<CallInst *, 16> Calls;
+      HlslOP->GetOpCalls(raFunction.opcode, Calls);
+      for (CallInst *instruction : Calls) {
+        auto res = GetResourceFromHandle(instruction->getOperand(1), DM);
+
+        // Don't instrument the accesses to the UAV that we just added
+        if (res.resource->GetSpaceID() == (unsigned)-2) {
+          continue;
+        }
 
-          if (EmitResourceAccess(res, instruction, HlslOP, Ctx, raFunction.readWrite)) {
-            Modified = true;
-          }
+        if (EmitResourceAccess(res, instruction, HlslOP, Ctx, raFunction.readWrite)) {
+          Modified = true;
+        }
 
-          if (raFunction.functionUsesSamplerAtIndex2) {
-            auto sampler = GetResourceFromHandle(instruction->getOperand(2), DM);
-            if (EmitResourceAccess(sampler, instruction, HlslOP, Ctx, ShaderAccessFlags::Read)) {
-              Modified = true;
-            }
+        if (raFunction.functionUsesSamplerAtIndex2) {
+          auto sampler = GetResourceFromHandle(instruction->getOperand(2), DM);
+          if (EmitResourceAccess(sampler, instruction, HlslOP, Ctx, ShaderAccessFlags::Read)) {
+            Modified = true;
           }
         }
       }
@@ -83,6 +83,22 @@ const std::vector<std::unique_ptr<DxilSignatureElement> > &DxilSignature::GetEle
   return m_Elements;
 }
 
+void DxilSignature::DeleteElements(const std::vector<bool> &Delete,
+                                   std::vector<int> &NewIDs) {
+  DXASSERT_NOMSG(Delete.size() == m_Elements.size());
+  NewIDs.assign(m_Elements.size(), -1);
+  vector<unique_ptr<DxilSignatureElement> > Elements;
+  for (auto &SE : m_Elements) {
+    DXASSERT(SE->GetID() < Delete.size(), "otherwise, element IDs aren't dense");
+    if (Delete[SE->GetID()])
+      continue;
+    NewIDs[SE->GetID()] = (int)Elements.size();
+    SE->SetID((unsigned)Elements.size());
+    Elements.emplace_back(std::move(SE));
+  }
+  m_Elements.swap(Elements);
+}
+
 namespace {
 
 static bool ShouldBeAllocated(const DxilSignatureElement *SE) {
@@ -222,6 +238,49 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
   return rowsUsed;
 }
 
+unsigned DxilSignature::PackElementsToMatch(const DxilSignature &Prior) {
+  DXASSERT(IsInput() && Prior.IsOutput(), "otherwise, signatures don't link");
+  DxilSignatureAllocator alloc(32, UseMinPrecision());
+  unsigned rowsUsed = 0;
+
+  // Outputs of the prior stage occupy their registers whether or not this
+  // signature reads them. Only the rasterized stream reaches the next stage.
+  // The elements are only read here, never relocated.
+  vector<DxilPackElement> priorElements;
+  for (auto &SE : Prior.GetElements()) {
+    if (ShouldBeAllocated(SE.get()) && SE->IsAllocated() &&
+        SE->GetOutputStream() == 0)
+      priorElements.emplace_back(const_cast<DxilSignatureElement *>(SE.get()),
+                                 Prior.UseMinPrecision());
+  }
+  for (auto &PE : priorElements) {
+    alloc.PlaceElement(&PE, PE.GetStartRow(), PE.GetStartCol());
+    rowsUsed = std::max(rowsUsed, PE.GetStartRow() + PE.GetRows());
+  }
+
+  vector<DxilPackElement> packElements;
+  for (auto &SE : m_Elements) {
+    if (ShouldBeAllocated(SE.get()))
+      packElements.emplace_back(SE.get(), m_UseMinPrecision);
+  }
+  vector<DxilSignatureAllocator::PackElement*> unmatched;
+  for (auto &SE : packElements) {
+    DxilSignatureElement *pSE = SE.Get();
+    auto it = std::find_if(priorElements.begin(), priorElements.end(),
+                           [&](DxilPackElement &PE) {
+      return PE.Get()->GetSemanticName().equals_lower(pSE->GetSemanticName()) &&
+             PE.Get()->GetSemanticStartIndex() == pSE->GetSemanticStartIndex();
+    });
+    if (it != priorElements.end())
+      SE.SetLocation(it->GetStartRow(), it->GetStartCol());
+    else
+      unmatched.push_back(&SE);
+  }
+  for (auto &SE : unmatched)
+    rowsUsed = std::max(rowsUsed, alloc.PackNext(SE, 0, 32));
+  return rowsUsed;
+}
+
 //------------------------------------------------------------------------------
 //
 // EntrySingnature methods.
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilStageLinker.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Removes outputs that the next stage of a pipeline doesn't read.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilLinker.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/HLSL/DxilSignature.h"
+#include "dxc/Support/Global.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Scalar.h"
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Operations naming an input signature element. All of them take the element
+// ID in the same operand as loadInput.
+const DXIL::OpCode kInputSigOps[] = {
+    DXIL::OpCode::LoadInput,       DXIL::OpCode::EvalSnapped,
+    DXIL::OpCode::EvalSampleIndex, DXIL::OpCode::EvalCentroid,
+    DXIL::OpCode::AttributeAtVertex,
+};
+
+unsigned GetSigOpElementID(CallInst *CI) {
+  Value *ID = CI->getOperand(DXIL::OperandIndex::kLoadInputIDOpIdx);
+  return (unsigned)cast<ConstantInt>(ID)->getLimitedValue();
+}
+
+void RemapSigOpElementIDs(ArrayRef<CallInst *> Calls,
+                          const std::vector<int> &NewIDs) {
+  for (CallInst *CI : Calls) {
+    int NewID = NewIDs[GetSigOpElementID(CI)];
+    DXASSERT(NewID >= 0, "otherwise, a removed element is still referenced");
+    Value *ID = CI->getOperand(DXIL::OperandIndex::kLoadInputIDOpIdx);
+    CI->setOperand(DXIL::OperandIndex::kLoadInputIDOpIdx,
+                   ConstantInt::get(ID->getType(), NewID));
+  }
+}
+
+// Elements link when they share a semantic name and any semantic index.
+bool SemanticsOverlap(const DxilSignatureElement &A,
+                      const DxilSignatureElement &B) {
+  if (!A.GetSemanticName().equals_lower(B.GetSemanticName()))
+    return false;
+  for (unsigned i : A.GetSemanticIndexVec()) {
+    for (unsigned j : B.GetSemanticIndexVec()) {
+      if (i == j)
+        return true;
+    }
+  }
+  return false;
+}
+
+bool IsStreamOutput(const DxilSignatureElement &Out,
+                    ArrayRef<DxilStreamOutputElement> StreamOutput) {
+  for (const DxilStreamOutputElement &SO : StreamOutput) {
+    if (SO.Stream != Out.GetOutputStream() ||
+        !Out.GetSemanticName().equals_lower(SO.SemanticName))
+      continue;
+    for (unsigned i : Out.GetSemanticIndexVec()) {
+      if (i == SO.SemanticIndex)
+        return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool hlsl::RemoveUnusedStageOutputs(
+    DxilModule &Producer, DxilModule *pConsumer,
+    ArrayRef<DxilStreamOutputElement> StreamOutput) {
+  // Hull shader outputs are also read by its patch constant function, and
+  // other streams of a geometry shader can only go to stream output.
+  const ShaderModel *pSM = Producer.GetShaderModel();
+  if (pSM->IsHS() || (pSM->IsGS() && Producer.GetActiveStreamMask() != 1))
+    return false;
+
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+  // Without a consumer, this stands in for an input signature with nothing.
+  DxilSignature NoInputs(DXIL::ShaderKind::Pixel, DXIL::SignatureKind::Input,
+                         Outputs.UseMinPrecision());
+  DxilSignature &Inputs =
+      pConsumer ? pConsumer->GetInputSignature() : NoInputs;
+
+  SmallVector<CallInst *, 16> Loads;
+  if (pConsumer) {
+    for (DXIL::OpCode opcode : kInputSigOps)
+      pConsumer->GetOP()->GetOpCalls(opcode, Loads);
+  }
+  std::vector<bool> InputRead(Inputs.GetElements().size());
+  for (CallInst *CI : Loads)
+    InputRead[GetSigOpElementID(CI)] = true;
+
+  // System values may be consumed by fixed-function stages whether or not
+  // the consumer reads them, so only user-defined outputs are removed.
+  std::vector<bool> DeadOutputs(Outputs.GetElements().size());
+  bool bAnyDead = false;
+  for (auto &Out : Outputs.GetElements()) {
+    if (!Out->IsArbitrary() || IsStreamOutput(*Out, StreamOutput))
+      continue;
+    bool bRead = false;
+    for (auto &In : Inputs.GetElements()) {
+      if (InputRead[In->GetID()] && SemanticsOverlap(*Out, *In)) {
+        bRead = true;
+        break;
+      }
+    }
+    if (!bRead) {
+      DeadOutputs[Out->GetID()] = true;
+      bAnyDead = true;
+    }
+  }
+  if (!bAnyDead)
+    return false;
+
+  // Every input must be written by the prior stage, so inputs declared for
+  // the removed outputs go too; none of them are read.
+  std::vector<bool> DeadInputs(Inputs.GetElements().size());
+  for (auto &In : Inputs.GetElements()) {
+    for (auto &Out : Outputs.GetElements()) {
+      if (DeadOutputs[Out->GetID()] && SemanticsOverlap(*Out, *In)) {
+        DeadInputs[In->GetID()] = true;
+        break;
+      }
+    }
+  }
+
+  SmallVector<CallInst *, 16> Stores;
+  Producer.GetOP()->GetOpCalls(DXIL::OpCode::StoreOutput, Stores);
+  SmallVector<CallInst *, 16> LiveStores;
+  for (CallInst *CI : Stores) {
+    if (DeadOutputs[GetSigOpElementID(CI)])
+      CI->eraseFromParent();
+    else
+      LiveStores.push_back(CI);
+  }
+
+  std::vector<int> NewIDs;
+  Outputs.DeleteElements(DeadOutputs, NewIDs);
+  RemapSigOpElementIDs(LiveStores, NewIDs);
+  Inputs.DeleteElements(DeadInputs, NewIDs);
+  RemapSigOpElementIDs(Loads, NewIDs);
+
+  // Remove the code that only computed the removed outputs. Its own inputs
+  // may become unread, for the link with the stage before it to remove.
+  legacy::PassManager PM;
+  PM.add(createAggressiveDCEPass());
+  PM.add(createCFGSimplificationPass());
+  PM.run(*Producer.GetModule());
+
+  // Signatures, and with them the view ID state, are emitted again.
+  Outputs.PackElements(DXIL::PackingStrategy::Optimized);
+  Producer.ReEmitDxilResources();
+  if (pConsumer) {
+    Inputs.PackElementsToMatch(Outputs);
+    pConsumer->ReEmitDxilResources();
+  }
+  return true;
+}
@@ -9,14 +9,20 @@
 //
 // \file
 // This file implements a TargetTransformInfo analysis pass specific to the
-// DXIL. Only implemented isSourceOfDivergence for DivergenceAnalysis.
+// DXIL. Implements isSourceOfDivergence for DivergenceAnalysis, and the costs
+// of DXIL operations and unrolling preferences used by the optimizer.
 //
 //===----------------------------------------------------------------------===//
 
 #include "DxilTargetTransformInfo.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilOperations.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/BasicTTIImpl.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
 
 using namespace llvm;
 using namespace hlsl;
@@ -29,11 +35,23 @@ cl::opt<unsigned>
                                     cl::desc("Threshold for partial unrolling"),
                                     cl::Hidden);
 
-DxilTTIImpl::DxilTTIImpl(const TargetMachine *TM, const Function &F,
-                         hlsl::DxilModule &DM, bool ThreadGroup)
-    : BaseT(TM, F.getParent()->getDataLayout()), m_pHlslOP(DM.GetOP()),
+DxilTTIImpl::DxilTTIImpl(const Function &F, hlsl::DxilModule &DM,
+                         bool ThreadGroup)
+    : BaseT(F.getParent()->getDataLayout()), m_pHlslOP(DM.GetOP()),
       m_isThreadGroup(ThreadGroup) {}
 
+TargetIRAnalysis llvm::createDxilTargetIRAnalysis() {
+  return TargetIRAnalysis([](Function &F) -> TargetTransformInfo {
+    // High-level modules have no DXIL operations yet, so they keep the
+    // target-independent costs.
+    Module *M = F.getParent();
+    if (!M->HasDxilModule())
+      return TargetTransformInfo(M->getDataLayout());
+    return TargetTransformInfo(
+        DxilTTIImpl(F, M->GetDxilModule(), /*ThreadGroup*/ false));
+  });
+}
+
 namespace {
 bool IsDxilOpSourceOfDivergence(const CallInst *CI, OP *hlslOP,
                                 bool ThreadGroup) {
@@ -94,3 +112,103 @@ bool DxilTTIImpl::isSourceOfDivergence(const Value *V) const {
 
   return false;
 }
+
+namespace {
+// Throughput classes of DXIL operations, relative to a full-rate ALU one.
+enum class DxilOpCostClass { Free, ALU, Derivative, Complex, Wave, Memory, Sample };
+
+DxilOpCostClass GetDxilOpCostClass(unsigned op) {
+  /* <py::lines('OPCODE-COST')>hctdb_instrhelp.get_op_cost_classes("op")</py>*/
+  // OPCODE-COST:BEGIN
+  // Free: SampleIndex=90, Coverage=91, InnerCoverage=92, ThreadId=93,
+  // GroupId=94, ThreadIdInGroup=95, FlattenedThreadIdInGroup=96,
+  // GSInstanceID=100, MakeDouble=101, SplitDouble=102, DomainLocation=105,
+  // OutputControlPointID=107, PrimitiveID=108, BitcastI16toF16=124,
+  // BitcastF16toI16=125, BitcastI32toF32=126, BitcastF32toI32=127,
+  // BitcastI64toF64=128, BitcastF64toI64=129, ViewID=138
+  if (90 <= op && op <= 96 || 100 <= op && op <= 102 || op == 105 || 107 <= op && op <= 108 || 124 <= op && op <= 129 || op == 138)
+    return DxilOpCostClass::Free;
+  // Derivative: CalculateLOD=81, DerivCoarseX=83, DerivCoarseY=84,
+  // DerivFineX=85, DerivFineY=86
+  if (op == 81 || 83 <= op && op <= 86)
+    return DxilOpCostClass::Derivative;
+  // Complex: Cos=12, Sin=13, Tan=14, Acos=15, Asin=16, Atan=17, Hcos=18,
+  // Hsin=19, Htan=20, Exp=21, Log=23, Sqrt=24, Rsqrt=25, UDiv=43, Fma=47,
+  // LegacyDoubleToFloat=132, LegacyDoubleToSInt32=133, LegacyDoubleToUInt32=134
+  if (12 <= op && op <= 21 || 23 <= op && op <= 25 || op == 43 || op == 47 || 132 <= op && op <= 134)
+    return DxilOpCostClass::Complex;
+  // Wave: WaveIsFirstLane=110, WaveGetLaneIndex=111, WaveGetLaneCount=112,
+  // WaveAnyTrue=113, WaveAllTrue=114, WaveActiveAllEqual=115,
+  // WaveActiveBallot=116, WaveReadLaneAt=117, WaveReadLaneFirst=118,
+  // WaveActiveOp=119, WaveActiveBit=120, WavePrefixOp=121, QuadReadLaneAt=122,
+  // QuadOp=123, WaveAllBitCount=135, WavePrefixBitCount=136
+  if (110 <= op && op <= 123 || 135 <= op && op <= 136)
+    return DxilOpCostClass::Wave;
+  // Memory: TempRegLoad=0, TempRegStore=1, MinPrecXRegLoad=2,
+  // MinPrecXRegStore=3, TextureLoad=66, TextureStore=67, BufferLoad=68,
+  // BufferStore=69, BufferUpdateCounter=70, GetDimensions=72, AtomicBinOp=78,
+  // AtomicCompareExchange=79, RawBufferLoad=139, RawBufferStore=140
+  if (0 <= op && op <= 3 || 66 <= op && op <= 70 || op == 72 || 78 <= op && op <= 79 || 139 <= op && op <= 140)
+    return DxilOpCostClass::Memory;
+  // Sample: Sample=60, SampleBias=61, SampleLevel=62, SampleGrad=63,
+  // SampleCmp=64, SampleCmpLevelZero=65, TextureGather=73, TextureGatherCmp=74
+  if (60 <= op && op <= 65 || 73 <= op && op <= 74)
+    return DxilOpCostClass::Sample;
+  return DxilOpCostClass::ALU;
+  // OPCODE-COST:END
+}
+
+unsigned GetDxilOpCost(DxilOpCostClass costClass) {
+  switch (costClass) {
+  case DxilOpCostClass::Free:       return TargetTransformInfo::TCC_Free;
+  case DxilOpCostClass::ALU:        return TargetTransformInfo::TCC_Basic;
+  case DxilOpCostClass::Derivative: return 2 * TargetTransformInfo::TCC_Basic;
+  case DxilOpCostClass::Complex:
+  case DxilOpCostClass::Wave:
+  case DxilOpCostClass::Memory:     return TargetTransformInfo::TCC_Expensive;
+  case DxilOpCostClass::Sample:     return 2 * TargetTransformInfo::TCC_Expensive;
+  }
+  return TargetTransformInfo::TCC_Basic;
+}
+}
+
+/// DXIL operations are instructions of the target, not calls.
+bool DxilTTIImpl::isLoweredToCall(const Function *F) {
+  if (OP::IsDxilOpFunc(F))
+    return false;
+  return BaseT::isLoweredToCall(F);
+}
+
+/// \returns the cost of a DXIL operation by its opcode, rather than by its
+/// number of arguments.
+unsigned DxilTTIImpl::getCallCost(const Function *F,
+                                  ArrayRef<const Value *> Arguments) {
+  if (OP::IsDxilOpFunc(F) && !Arguments.empty()) {
+    if (const ConstantInt *opcode = dyn_cast<ConstantInt>(Arguments[0]))
+      return GetDxilOpCost(GetDxilOpCostClass((unsigned)opcode->getZExtValue()));
+  }
+  return BaseT::getCallCost(F, Arguments);
+}
+
+void DxilTTIImpl::getUnrollingPreferences(Loop *L,
+                                          TTI::UnrollingPreferences &UP) {
+  // Partial and runtime unrolling keep the loop and its branch, and add a
+  // remainder; only full unrolling pays for the code it adds.
+  UP.Partial = false;
+  UP.Runtime = false;
+
+  // Local arrays indexed by the loop are kept in indexable registers, which
+  // are much slower than the rest. Unrolling lets the indices fold, so that
+  // the arrays can be split into scalars.
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (Instruction &I : *BB) {
+      GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I);
+      if (!GEP || GEP->hasAllConstantIndices())
+        continue;
+      if (isa<AllocaInst>(GetUnderlyingObject(GEP->getPointerOperand(), DL))) {
+        UP.Threshold *= 4;
+        return;
+      }
+    }
+  }
+}
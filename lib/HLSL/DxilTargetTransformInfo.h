@@ -8,13 +8,14 @@
 //===----------------------------------------------------------------------===//
 /// \file
 /// This file declares a TargetTransformInfo analysis pass specific to the DXIL.
-/// Only implemented isSourceOfDivergence for DivergenceAnalysis.
+/// Implements isSourceOfDivergence for DivergenceAnalysis, and the costs of
+/// DXIL operations and unrolling preferences used by the optimizer.
 ///
 //===----------------------------------------------------------------------===//
 
 #pragma once
 
-#include "llvm/CodeGen/BasicTTIImpl.h"
+#include "llvm/Analysis/TargetTransformInfoImpl.h"
 
 namespace hlsl {
 class DxilModule;
@@ -23,21 +24,26 @@ class OP;
 
 namespace llvm {
 
-class DxilTTIImpl final : public BasicTTIImplBase<DxilTTIImpl> {
-  typedef BasicTTIImplBase<DxilTTIImpl> BaseT;
+// DXIL has no target lowering, so the costs of LLVM instructions are the
+// target-independent ones; only DXIL operations are modeled here.
+class DxilTTIImpl final : public TargetTransformInfoImplCRTPBase<DxilTTIImpl> {
+  typedef TargetTransformInfoImplCRTPBase<DxilTTIImpl> BaseT;
   typedef TargetTransformInfo TTI;
   friend BaseT;
   hlsl::OP *m_pHlslOP;
   bool m_isThreadGroup;
-  const TargetSubtargetInfo *getST() const { return nullptr; }
-  const TargetLowering *getTLI() const { return nullptr; }
 
 public:
-  explicit DxilTTIImpl(const TargetMachine *TM, const Function &F,
-                       hlsl::DxilModule &DM, bool ThreadGroup);
+  explicit DxilTTIImpl(const Function &F, hlsl::DxilModule &DM,
+                       bool ThreadGroup);
 
   bool hasBranchDivergence() { return true; }
   bool isSourceOfDivergence(const Value *V) const;
+
+  bool isLoweredToCall(const Function *F);
+  using BaseT::getCallCost;
+  unsigned getCallCost(const Function *F, ArrayRef<const Value *> Arguments);
+  void getUnrollingPreferences(Loop *L, TTI::UnrollingPreferences &UP);
 };
 
 } // end namespace llvm
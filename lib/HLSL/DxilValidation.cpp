@@ -27,17 +27,23 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include <unordered_set>
+#include <atomic>
+#include <mutex>
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Analysis/PostDominators.h"
@@ -361,6 +367,12 @@ struct ValidationContext {
   const unsigned kLLVMLoopMDKind;
   bool m_bCoverageIn, m_bInnerCoverageIn;
   unsigned m_DxilMajor, m_DxilMinor;
+  // Set when a function used state whose diagnostics depend on the order in
+  // which functions are validated.
+  bool UsedOrderedState = false;
+  // Serializes OP lookups that may create types, while function bodies are
+  // validated concurrently.
+  std::mutex *pOPLock = nullptr;
 
   ValidationContext(Module &llvmModule, Module *DebugModule,
                     DxilModule &dxilModule,
@@ -384,6 +396,30 @@ struct ValidationContext {
     patchConstCols.resize(DxilMod.GetPatchConstantSignature().GetElements().size(), 0);
   }
 
+  // Creates a context to validate function bodies alongside Parent. The
+  // module-level state is copied; diagnostics and signature usage are
+  // collected separately, for the caller to merge back.
+  ValidationContext(const ValidationContext &Parent,
+                    DiagnosticPrinterRawOStream &DiagPrn)
+      : M(Parent.M), pDebugModule(Parent.pDebugModule),
+        DxilMod(Parent.DxilMod), DL(Parent.DL), DiagPrinter(DiagPrn),
+        PSExec(Parent.PSExec), LastRuleEmit((ValidationRule)-1),
+        entryFuncCallSet(Parent.entryFuncCallSet),
+        patchConstFuncCallSet(Parent.patchConstFuncCallSet),
+        hasViewID(false), outputCols(Parent.outputCols.size(), 0),
+        patchConstCols(Parent.patchConstCols.size(), 0),
+        domainLocSize(Parent.domainLocSize),
+        kDxilControlFlowHintMDKind(Parent.kDxilControlFlowHintMDKind),
+        kDxilPreciseMDKind(Parent.kDxilPreciseMDKind),
+        kLLVMLoopMDKind(Parent.kLLVMLoopMDKind), m_bCoverageIn(false),
+        m_bInnerCoverageIn(false), m_DxilMajor(Parent.m_DxilMajor),
+        m_DxilMinor(Parent.m_DxilMinor), pOPLock(Parent.pOPLock) {
+    for (unsigned i = 0; i < DXIL::kNumOutputStreams; i++) {
+      hasOutputPosition[i] = Parent.hasOutputPosition[i];
+      OutputPositionMask[i] = 0;
+    }
+  }
+
   // Provide direct access to the raw_ostream in DiagPrinter.
   raw_ostream &DiagStream() {
     struct DiagnosticPrinterRawOStream_Pub : public DiagnosticPrinterRawOStream {
@@ -1863,6 +1899,7 @@ static void ValidateDxilOperationCallInProfile(CallInst *CI,
     Value *inc = updateCounter.get_inc();
     if (ConstantInt *cInc = dyn_cast<ConstantInt>(inc)) {
       bool isInc = cInc->getLimitedValue() == 1;
+      ValCtx.UsedOrderedState = true;
       if (ValCtx.UavCounterIncMap.count(resIndex)) {
         if (isInc != ValCtx.UavCounterIncMap[resIndex]) {
           ValCtx.EmitInstrError(CI, ValidationRule::InstrOnlyOneAllocConsume);
@@ -1913,9 +1950,11 @@ static void ValidateDxilOperationCallInProfile(CallInst *CI,
   } break;
   case DXIL::OpCode::Coverage:
     ValCtx.m_bCoverageIn = true;
+    ValCtx.UsedOrderedState = true;
     break;
   case DXIL::OpCode::InnerCoverage:
     ValCtx.m_bInnerCoverageIn = true;
+    ValCtx.UsedOrderedState = true;
     break;
   case DXIL::OpCode::ViewID:
     ValCtx.hasViewID = true;
@@ -2048,7 +2087,12 @@ static bool IsLLVMInstructionAllowed(llvm::Instruction &I) {
   // OPCODE-ALLOWED:END
 }
 
-static bool IsDxilBuiltinStructType(StructType *ST, hlsl::OP *hlslOP) {
+static bool IsDxilBuiltinStructType(StructType *ST, ValidationContext &ValCtx) {
+  // The OP creates the resource and cbuffer return types on first use.
+  std::unique_lock<std::mutex> OPLock;
+  if (ValCtx.pOPLock)
+    OPLock = std::unique_lock<std::mutex>(*ValCtx.pOPLock);
+  hlsl::OP *hlslOP = ValCtx.DxilMod.GetOP();
   if (ST == hlslOP->GetBinaryWithCarryType())
     return true;
   if (ST == hlslOP->GetBinaryWithTwoOutputsType())
@@ -2100,8 +2144,7 @@ static bool ValidateType(Type *Ty, ValidationContext &ValCtx) {
 
     StringRef Name = ST->getName();
     if (Name.startswith("dx.")) {
-      hlsl::OP *hlslOP = ValCtx.DxilMod.GetOP();
-      if (IsDxilBuiltinStructType(ST, hlslOP)) {
+      if (IsDxilBuiltinStructType(ST, ValCtx)) {
         ValCtx.EmitTypeError(Ty, ValidationRule::InstrDxilStructUser);
         result = false;
       }
@@ -2534,7 +2577,7 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
         if (StructType *ST = dyn_cast<StructType>(Ty)) {
           Value *Agg = EV->getAggregateOperand();
           if (!isa<AtomicCmpXchgInst>(Agg) &&
-              !IsDxilBuiltinStructType(ST, ValCtx.DxilMod.GetOP())) {
+              !IsDxilBuiltinStructType(ST, ValCtx)) {
             ValCtx.EmitInstrError(EV, ValidationRule::InstrExtractValue);
           }
         } else {
@@ -4268,8 +4311,649 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
   *pMinor = 3;
 }
 
+// Function bodies are validated on worker threads when there are several and
+// enough code between them to make it worthwhile, such as a hull shader with
+// a large patch constant function.
+static const size_t kMinParallelValidationInstructions = 4096;
+
+namespace {
+// Signature usage recorded while validating a function, which is all the
+// state a function that validates cleanly leaves behind for the module-level
+// checks.
+struct FunctionSignatureUsage {
+  std::vector<unsigned> OutputCols;
+  std::vector<unsigned> PatchConstCols;
+  unsigned OutputPositionMask[DXIL::kNumOutputStreams] = {};
+  bool HasViewID = false;
+
+  void Save(const ValidationContext &ValCtx) {
+    OutputCols = ValCtx.outputCols;
+    PatchConstCols = ValCtx.patchConstCols;
+    for (unsigned i = 0; i < DXIL::kNumOutputStreams; ++i)
+      OutputPositionMask[i] = ValCtx.OutputPositionMask[i];
+    HasViewID = ValCtx.hasViewID;
+  }
+
+  void MergeInto(ValidationContext &ValCtx) const {
+    for (unsigned i = 0; i < ValCtx.outputCols.size(); ++i)
+      ValCtx.outputCols[i] |= OutputCols[i];
+    for (unsigned i = 0; i < ValCtx.patchConstCols.size(); ++i)
+      ValCtx.patchConstCols[i] |= PatchConstCols[i];
+    for (unsigned i = 0; i < DXIL::kNumOutputStreams; ++i)
+      ValCtx.OutputPositionMask[i] |= OutputPositionMask[i];
+    ValCtx.hasViewID |= HasViewID;
+  }
+};
+
+struct FunctionValidationKey {
+  uint64_t Lo, Hi;
+  bool operator==(const FunctionValidationKey &other) const {
+    return Lo == other.Lo && Hi == other.Hi;
+  }
+};
+
+struct FunctionValidationKeyHash {
+  size_t operator()(const FunctionValidationKey &key) const {
+    return (size_t)key.Lo;
+  }
+};
+} // namespace
+
+struct DxilValidationCache::Impl {
+  // The cache is dropped when it fills up, rather than tracking use.
+  static const size_t kMaxEntries = 16 * 1024;
+
+  std::mutex Lock;
+  std::unordered_map<FunctionValidationKey, FunctionSignatureUsage,
+                     FunctionValidationKeyHash> Entries;
+  std::atomic<uint64_t> ValidatedFunctions;
+  std::atomic<uint64_t> CachedFunctions;
+
+  Impl() : ValidatedFunctions(0), CachedFunctions(0) {}
+
+  bool Lookup(const FunctionValidationKey &key, FunctionSignatureUsage &usage) {
+    std::lock_guard<std::mutex> lock(Lock);
+    auto it = Entries.find(key);
+    if (it == Entries.end())
+      return false;
+    usage = it->second;
+    return true;
+  }
+
+  void Insert(const FunctionValidationKey &key,
+              const FunctionSignatureUsage &usage) {
+    std::lock_guard<std::mutex> lock(Lock);
+    if (Entries.size() >= kMaxEntries)
+      Entries.clear();
+    Entries[key] = usage;
+  }
+};
+
+DxilValidationCache::DxilValidationCache() : m_pImpl(new Impl()) {}
+DxilValidationCache::~DxilValidationCache() {}
+
+uint64_t DxilValidationCache::GetValidatedFunctionCount() const {
+  return m_pImpl->ValidatedFunctions;
+}
+
+uint64_t DxilValidationCache::GetCachedFunctionCount() const {
+  return m_pImpl->CachedFunctions;
+}
+
+void DxilValidationCache::ResetStatistics() {
+  m_pImpl->ValidatedFunctions = 0;
+  m_pImpl->CachedFunctions = 0;
+}
+
+namespace {
+// Computes the keys under which functions are kept in a DxilValidationCache.
+// Besides the function itself, a key covers the parts of the module that
+// validating a function body reads: named metadata other than debug info,
+// global variables, struct types and the declarations of all functions.
+// Debug info is left out, as it only affects the text of diagnostics, and
+// only functions without diagnostics are cached.
+class FunctionValidationHasher {
+public:
+  FunctionValidationHasher(Module &M) {
+    M.getMDKindNames(MDKindNames);
+    MD5 H;
+    H.update(M.getTargetTriple());
+    H.update(M.getDataLayoutStr());
+    for (StructType *ST : M.getIdentifiedStructTypes()) {
+      H.update(ST->getName());
+      AddUInt(H, ST->isPacked());
+      for (Type *EltTy : ST->elements())
+        AddType(H, EltTy);
+    }
+    MetadataIds MDIds;
+    for (NamedMDNode &NMD : M.named_metadata()) {
+      if (NMD.getName().startswith("llvm.dbg."))
+        continue;
+      H.update(NMD.getName());
+      for (MDNode *Node : NMD.operands())
+        AddMetadata(H, Node, MDIds, nullptr);
+    }
+    for (GlobalVariable &GV : M.globals()) {
+      H.update(GV.getName());
+      AddType(H, GV.getType());
+      AddUInt(H, GV.getLinkage());
+      AddUInt(H, GV.isConstant());
+      AddUInt(H, GV.getThreadLocalMode());
+      AddUInt(H, GV.getAlignment());
+      AddUInt(H, GV.hasInitializer());
+      if (GV.hasInitializer())
+        AddConstant(H, GV.getInitializer());
+    }
+    for (Function &F : M.functions()) {
+      AddFunctionDecl(H, F);
+      AddUInt(H, F.isDeclaration());
+    }
+    H.final(ModuleHash);
+  }
+
+  FunctionValidationKey GetKey(Function &F, const ValidationContext &ValCtx) {
+    MD5 H;
+    H.update(ModuleHash);
+    AddFunctionDecl(H, F);
+    AddUInt(H, ValCtx.entryFuncCallSet.count(&F));
+    AddUInt(H, ValCtx.patchConstFuncCallSet.count(&F));
+
+    LocalIds Locals;
+    unsigned LocalId = 0;
+    for (Argument &Arg : F.args())
+      Locals[&Arg] = LocalId++;
+    for (BasicBlock &BB : F) {
+      Locals[&BB] = LocalId++;
+      for (Instruction &I : BB)
+        Locals[&I] = LocalId++;
+    }
+
+    MetadataIds MDIds;
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    F.getAllMetadata(MDs);
+    AddMetadataAttachments(H, MDs, MDIds, &Locals);
+
+    for (BasicBlock &BB : F) {
+      AddUInt(H, BB.size());
+      for (Instruction &I : BB) {
+        AddInstruction(H, I, MDIds, Locals);
+        if (I.hasMetadataOtherThanDebugLoc()) {
+          I.getAllMetadataOtherThanDebugLoc(MDs);
+          AddMetadataAttachments(H, MDs, MDIds, &Locals);
+        }
+      }
+    }
+
+    MD5::MD5Result Result;
+    H.final(Result);
+    FunctionValidationKey Key;
+    memcpy(&Key.Lo, Result, sizeof(Key.Lo));
+    memcpy(&Key.Hi, Result + sizeof(Key.Lo), sizeof(Key.Hi));
+    return Key;
+  }
+
+private:
+  typedef DenseMap<const Value *, unsigned> LocalIds;
+  typedef DenseMap<const Metadata *, unsigned> MetadataIds;
+
+  MD5::MD5Result ModuleHash;
+  SmallVector<StringRef, 16> MDKindNames;
+  DenseMap<Type *, std::string> TypeNames;
+
+  static void AddUInt(MD5 &H, uint64_t V) {
+    H.update(ArrayRef<uint8_t>((const uint8_t *)&V, sizeof(V)));
+  }
+
+  void AddType(MD5 &H, Type *Ty) {
+    std::string &Name = TypeNames[Ty];
+    if (Name.empty()) {
+      raw_string_ostream OS(Name);
+      Ty->print(OS);
+      OS.flush();
+    }
+    H.update(Name);
+  }
+
+  void AddAttributes(MD5 &H, AttributeSet Attrs) {
+    AddUInt(H, Attrs.getNumSlots());
+    for (unsigned i = 0; i < Attrs.getNumSlots(); ++i) {
+      unsigned Index = Attrs.getSlotIndex(i);
+      AddUInt(H, Index);
+      H.update(Attrs.getAsString(Index));
+    }
+  }
+
+  void AddFunctionDecl(MD5 &H, Function &F) {
+    H.update(F.getName());
+    AddType(H, F.getFunctionType());
+    AddUInt(H, F.getLinkage());
+    AddUInt(H, F.getCallingConv());
+    AddAttributes(H, F.getAttributes());
+  }
+
+  void AddAPInt(MD5 &H, const APInt &V) {
+    AddUInt(H, V.getBitWidth());
+    H.update(ArrayRef<uint8_t>((const uint8_t *)V.getRawData(),
+                               V.getNumWords() * sizeof(uint64_t)));
+  }
+
+  void AddConstant(MD5 &H, const Constant *C) {
+    AddUInt(H, C->getValueID());
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+      // The global itself is part of the module hash.
+      H.update(GV->getName());
+      return;
+    }
+    AddType(H, C->getType());
+    if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+      AddAPInt(H, CI->getValue());
+    } else if (const ConstantFP *CFP = dyn_cast<ConstantFP>(C)) {
+      AddAPInt(H, CFP->getValueAPF().bitcastToAPInt());
+    } else if (const ConstantDataSequential *CDS =
+                   dyn_cast<ConstantDataSequential>(C)) {
+      H.update(CDS->getRawDataValues());
+    } else if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+      AddUInt(H, CE->getOpcode());
+      AddUInt(H, CE->getRawSubclassOptionalData());
+      if (CE->isCompare())
+        AddUInt(H, CE->getPredicate());
+      if (CE->hasIndices())
+        for (unsigned Idx : CE->getIndices())
+          AddUInt(H, Idx);
+      for (const Use &Op : CE->operands())
+        AddConstant(H, cast<Constant>(Op));
+    } else {
+      // Aggregates; other kinds of constants have no operands.
+      AddUInt(H, C->getNumOperands());
+      for (const Use &Op : C->operands())
+        AddConstant(H, cast<Constant>(Op));
+    }
+  }
+
+  void AddMetadata(MD5 &H, const Metadata *MD, MetadataIds &MDIds,
+                   LocalIds *pLocals) {
+    if (MD == nullptr) {
+      AddUInt(H, ~0ULL);
+      return;
+    }
+    AddUInt(H, MD->getMetadataID());
+    // Nodes may be shared or refer back to themselves, as loop metadata
+    // does, so repeated visits hash the order of the first one.
+    auto Inserted = MDIds.insert(std::make_pair(MD, MDIds.size()));
+    if (!Inserted.second) {
+      AddUInt(H, Inserted.first->second);
+      return;
+    }
+    if (const MDString *S = dyn_cast<MDString>(MD)) {
+      H.update(S->getString());
+    } else if (const ConstantAsMetadata *CMD = dyn_cast<ConstantAsMetadata>(MD)) {
+      AddConstant(H, CMD->getValue());
+    } else if (const LocalAsMetadata *LMD = dyn_cast<LocalAsMetadata>(MD)) {
+      if (pLocals)
+        AddUInt(H, pLocals->lookup(LMD->getValue()));
+    } else if (isa<DINode>(MD) || isa<DILocation>(MD) ||
+               isa<DIExpression>(MD)) {
+      // Debug info; see the class comment.
+    } else if (const MDNode *N = dyn_cast<MDNode>(MD)) {
+      AddUInt(H, N->isDistinct());
+      AddUInt(H, N->getNumOperands());
+      for (const MDOperand &Op : N->operands())
+        AddMetadata(H, Op, MDIds, pLocals);
+    }
+  }
+
+  void AddMetadataAttachments(
+      MD5 &H, ArrayRef<std::pair<unsigned, MDNode *>> MDs,
+      MetadataIds &MDIds, LocalIds *pLocals) {
+    for (auto &KindAndNode : MDs) {
+      if (KindAndNode.first == LLVMContext::MD_dbg)
+        continue;
+      H.update(MDKindNames[KindAndNode.first]);
+      AddMetadata(H, KindAndNode.second, MDIds, pLocals);
+    }
+  }
+
+  void AddOperand(MD5 &H, const Value *V, MetadataIds &MDIds,
+                  LocalIds &Locals) {
+    AddUInt(H, V->getValueID());
+    if (isa<Instruction>(V) || isa<Argument>(V) || isa<BasicBlock>(V))
+      AddUInt(H, Locals.lookup(V));
+    else if (const Constant *C = dyn_cast<Constant>(V))
+      AddConstant(H, C);
+    else if (const MetadataAsValue *MV = dyn_cast<MetadataAsValue>(V))
+      AddMetadata(H, MV->getMetadata(), MDIds, &Locals);
+    else if (const InlineAsm *IA = dyn_cast<InlineAsm>(V))
+      H.update(IA->getAsmString());
+  }
+
+  void AddInstruction(MD5 &H, Instruction &I, MetadataIds &MDIds,
+                      LocalIds &Locals) {
+    AddUInt(H, I.getOpcode());
+    AddType(H, I.getType());
+    AddUInt(H, I.getRawSubclassOptionalData());
+    // State kept in the instruction rather than in its operands.
+    if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+      AddUInt(H, LI->isVolatile());
+      AddUInt(H, LI->getAlignment());
+      AddUInt(H, LI->getOrdering());
+      AddUInt(H, LI->getSynchScope());
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+      AddUInt(H, SI->isVolatile());
+      AddUInt(H, SI->getAlignment());
+      AddUInt(H, SI->getOrdering());
+      AddUInt(H, SI->getSynchScope());
+    } else if (CmpInst *CI = dyn_cast<CmpInst>(&I)) {
+      AddUInt(H, CI->getPredicate());
+    } else if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+      AddUInt(H, CI->getCallingConv());
+      AddUInt(H, CI->getTailCallKind());
+      AddAttributes(H, CI->getAttributes());
+    } else if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+      AddType(H, AI->getAllocatedType());
+      AddUInt(H, AI->getAlignment());
+    } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+      AddType(H, GEP->getSourceElementType());
+    } else if (ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(&I)) {
+      for (unsigned Idx : EVI->getIndices())
+        AddUInt(H, Idx);
+    } else if (InsertValueInst *IVI = dyn_cast<InsertValueInst>(&I)) {
+      for (unsigned Idx : IVI->getIndices())
+        AddUInt(H, Idx);
+    } else if (AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(&I)) {
+      AddUInt(H, CXI->isVolatile());
+      AddUInt(H, CXI->isWeak());
+      AddUInt(H, CXI->getSuccessOrdering());
+      AddUInt(H, CXI->getFailureOrdering());
+      AddUInt(H, CXI->getSynchScope());
+    } else if (AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(&I)) {
+      AddUInt(H, RMWI->getOperation());
+      AddUInt(H, RMWI->isVolatile());
+      AddUInt(H, RMWI->getOrdering());
+      AddUInt(H, RMWI->getSynchScope());
+    } else if (FenceInst *FI = dyn_cast<FenceInst>(&I)) {
+      AddUInt(H, FI->getOrdering());
+      AddUInt(H, FI->getSynchScope());
+    } else if (PHINode *PN = dyn_cast<PHINode>(&I)) {
+      for (unsigned i = 0; i < PN->getNumIncomingValues(); ++i)
+        AddUInt(H, Locals.lookup(PN->getIncomingBlock(i)));
+    }
+    AddUInt(H, I.getNumOperands());
+    for (const Use &Op : I.operands())
+      AddOperand(H, Op, MDIds, Locals);
+  }
+};
+
+// Outcome of validating a function body on a worker. Its diagnostics are a
+// range of the worker's buffer, replayed in module order once all workers are
+// done.
+struct FunctionValidationResult {
+  unsigned Worker = 0;
+  size_t DiagBegin = 0;
+  size_t DiagEnd = 0;
+  bool Failed = false;
+  // Set if the function must be validated again on the calling thread: it
+  // wasn't reached, validating it threw, or its diagnostics depend on the
+  // functions validated before it.
+  bool NeedsSerial = true;
+  ValidationRule LastRuleEmit = (ValidationRule)-1;
+  DebugLoc LastDebugLocEmit;
+  FunctionSignatureUsage Usage;
+};
+
+struct FunctionValidationWorker {
+  unsigned Index;
+  IMalloc *pMalloc;
+  ArrayRef<Function *> Functions;
+  ArrayRef<unsigned> Order;
+  std::atomic<unsigned> *pNext;
+  std::vector<FunctionValidationResult> *pResults;
+  std::string DiagStr;
+  raw_string_ostream DiagStream;
+  DiagnosticPrinterRawOStream DiagPrinter;
+  ValidationContext ValCtx;
+
+  FunctionValidationWorker(const ValidationContext &Parent)
+      : DiagStream(DiagStr), DiagPrinter(DiagStream),
+        ValCtx(Parent, DiagPrinter) {}
+
+  void Run() {
+    for (;;) {
+      unsigned next = (*pNext)++;
+      if (next >= Order.size())
+        break;
+      unsigned i = Order[next];
+      ValCtx.Failed = false;
+      ValCtx.LastRuleEmit = (ValidationRule)-1;
+      ValCtx.LastDebugLocEmit = DebugLoc();
+      ValCtx.UavCounterIncMap.clear();
+      ValCtx.m_bCoverageIn = ValCtx.m_bInnerCoverageIn = false;
+      ValCtx.UsedOrderedState = false;
+      std::fill(ValCtx.outputCols.begin(), ValCtx.outputCols.end(), 0);
+      std::fill(ValCtx.patchConstCols.begin(), ValCtx.patchConstCols.end(), 0);
+      for (unsigned s = 0; s < DXIL::kNumOutputStreams; ++s)
+        ValCtx.OutputPositionMask[s] = 0;
+      ValCtx.hasViewID = false;
+      size_t diagBegin = DiagStream.str().size();
+      try {
+        ValidateFunction(*Functions[i], ValCtx);
+        FunctionValidationResult &R = (*pResults)[i];
+        R.Usage.Save(ValCtx);
+        R.Worker = Index;
+        R.DiagBegin = diagBegin;
+        R.DiagEnd = DiagStream.str().size();
+        R.Failed = ValCtx.Failed;
+        R.NeedsSerial = ValCtx.UsedOrderedState;
+        R.LastRuleEmit = ValCtx.LastRuleEmit;
+        R.LastDebugLocEmit = ValCtx.LastDebugLocEmit;
+      } catch (...) {
+        continue;
+      }
+    }
+  }
+};
+} // namespace
+
+static DWORD WINAPI FunctionValidationThreadProc(LPVOID pParam) {
+  FunctionValidationWorker *pWorker =
+      reinterpret_cast<FunctionValidationWorker *>(pParam);
+  // Allocations must go to the calling thread's IMalloc, as the results are
+  // freed there; pMalloc forwards to it one thread at a time.
+  DxcThreadMalloc TM(pWorker->pMalloc);
+  pWorker->Run();
+  return 0;
+}
+
+static unsigned GetValidationThreadCount(ArrayRef<size_t> FunctionSizes) {
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  unsigned threadCount = std::min<unsigned>(sysInfo.dwNumberOfProcessors,
+                                            FunctionSizes.size());
+  size_t instructionCount = 0;
+  for (size_t size : FunctionSizes)
+    instructionCount += size;
+  if (threadCount < 2 || instructionCount < kMinParallelValidationInstructions)
+    return 1;
+  return threadCount;
+}
+
+// DataLayout computes struct layouts on first use and caches them without a
+// lock, so every layout the workers can ask for (through getTypeAllocSize or
+// getIndexedOffset) is computed up front on the calling thread.
+static void ComputeStructLayouts(Module &M, const DataLayout &DL) {
+  TypeFinder StructTypes;
+  StructTypes.run(M, /*onlyNamed*/ false);
+  for (StructType *ST : StructTypes) {
+    if (ST->isSized())
+      DL.getStructLayout(ST);
+  }
+}
+
+// Validates the bodies of Functions selected by Pending on ThreadCount
+// threads, the calling thread being one of them. Results are indexed like
+// Functions, and are merged into ValCtx by ValidateFunctions.
+static void ValidateFunctionBodies(
+    ArrayRef<Function *> Functions, ArrayRef<size_t> FunctionSizes,
+    std::vector<unsigned> Pending, unsigned ThreadCount,
+    ValidationContext &ValCtx,
+    std::vector<std::unique_ptr<FunctionValidationWorker>> &Workers,
+    std::vector<FunctionValidationResult> &Results) {
+  // Start with the largest functions, so that no thread is left working on a
+  // big one after the others are done.
+  std::stable_sort(Pending.begin(), Pending.end(),
+                   [FunctionSizes](unsigned a, unsigned b) {
+                     return FunctionSizes[a] > FunctionSizes[b];
+                   });
+
+  // The calling thread's IMalloc may be an arena, which isn't thread-safe, so
+  // the threads share it through a lock that is only taken while they run.
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  CComPtr<IMalloc> pSerializedMalloc;
+  if (ThreadCount > 1) {
+    IFT(DxcCreateSerializedMalloc(pMalloc, &pSerializedMalloc));
+    pMalloc = pSerializedMalloc;
+  }
+
+  std::atomic<unsigned> next(0);
+  Results.resize(Functions.size());
+  Workers.reserve(ThreadCount);
+  for (unsigned i = 0; i < ThreadCount; ++i) {
+    Workers.emplace_back(new FunctionValidationWorker(ValCtx));
+    FunctionValidationWorker &W = *Workers.back();
+    W.Index = i;
+    W.pMalloc = pMalloc;
+    W.Functions = Functions;
+    W.Order = Pending;
+    W.pNext = &next;
+    W.pResults = &Results;
+  }
+
+  if (ThreadCount > 1)
+    ComputeStructLayouts(ValCtx.M, ValCtx.DL);
+
+  std::vector<HANDLE> threads;
+  threads.reserve(ThreadCount - 1);
+  for (unsigned i = 1; i < ThreadCount; ++i) {
+    HANDLE hThread = CreateThread(nullptr, 0, FunctionValidationThreadProc,
+                                  Workers[i].get(), 0, nullptr);
+    // If a thread can't be started, the others pick up its share.
+    if (hThread == nullptr)
+      break;
+    threads.push_back(hThread);
+  }
+  {
+    DxcThreadMalloc TM(pMalloc);
+    Workers[0]->Run();
+  }
+  for (HANDLE hThread : threads) {
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+  }
+}
+
+// Validates every function in the module, producing the same diagnostics,
+// in the same order, as validating them one after the other. Bodies found in
+// pCache are skipped, and bodies that validate cleanly are added to it.
+static void ValidateFunctions(Module &M, ValidationContext &ValCtx,
+                              DxilValidationCache *pCache) {
+  std::vector<Function *> bodies;
+  std::vector<size_t> bodySizes;
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    size_t size = 0;
+    for (BasicBlock &BB : F)
+      size += BB.size();
+    bodies.push_back(&F);
+    bodySizes.push_back(size);
+  }
+
+  std::vector<FunctionValidationKey> keys;
+  std::vector<FunctionSignatureUsage> cachedUsage;
+  std::vector<bool> cached(bodies.size(), false);
+  std::vector<unsigned> pending;
+  std::vector<size_t> pendingSizes;
+  if (pCache) {
+    FunctionValidationHasher hasher(M);
+    keys.reserve(bodies.size());
+    cachedUsage.resize(bodies.size());
+    for (unsigned i = 0; i < bodies.size(); ++i) {
+      keys.push_back(hasher.GetKey(*bodies[i], ValCtx));
+      cached[i] = pCache->GetImpl().Lookup(keys[i], cachedUsage[i]);
+    }
+  }
+  for (unsigned i = 0; i < bodies.size(); ++i) {
+    if (!cached[i]) {
+      pending.push_back(i);
+      pendingSizes.push_back(bodySizes[i]);
+    }
+  }
+  if (pCache) {
+    pCache->GetImpl().ValidatedFunctions += pending.size();
+    pCache->GetImpl().CachedFunctions += bodies.size() - pending.size();
+  }
+
+  unsigned threadCount = GetValidationThreadCount(pendingSizes);
+  if (!pCache && threadCount < 2) {
+    for (Function &F : M.functions())
+      ValidateFunction(F, ValCtx);
+    return;
+  }
+
+  std::mutex OPLock;
+  std::vector<std::unique_ptr<FunctionValidationWorker>> workers;
+  std::vector<FunctionValidationResult> results(bodies.size());
+  if (!pending.empty()) {
+    ValCtx.pOPLock = &OPLock;
+    ValidateFunctionBodies(bodies, bodySizes, pending, threadCount, ValCtx,
+                           workers, results);
+    ValCtx.pOPLock = nullptr;
+  }
+
+  // Replay results in module order. Declarations are validated here, as
+  // that may add functions and types to the module. A body is validated
+  // again when its diagnostics could differ from a serial run: an earlier
+  // function may have recorded a diagnostic that would suppress its first
+  // one, or enabled the coverage check that fires on every DXIL operation.
+  unsigned bodyIndex = 0;
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration()) {
+      ValidateFunction(F, ValCtx);
+      continue;
+    }
+    unsigned i = bodyIndex++;
+    if (ValCtx.m_bCoverageIn && ValCtx.m_bInnerCoverageIn) {
+      ValidateFunction(F, ValCtx);
+      continue;
+    }
+    if (cached[i]) {
+      cachedUsage[i].MergeInto(ValCtx);
+      continue;
+    }
+    FunctionValidationResult &R = results[i];
+    bool hasDiags = R.DiagBegin != R.DiagEnd;
+    if (R.NeedsSerial ||
+        (hasDiags && ValCtx.LastRuleEmit != (ValidationRule)-1)) {
+      ValidateFunction(F, ValCtx);
+      continue;
+    }
+    R.Usage.MergeInto(ValCtx);
+    if (hasDiags) {
+      StringRef diags(workers[R.Worker]->DiagStream.str());
+      ValCtx.DiagStream() << diags.slice(R.DiagBegin, R.DiagEnd);
+    }
+    ValCtx.Failed |= R.Failed;
+    if (R.LastRuleEmit != (ValidationRule)-1) {
+      ValCtx.LastRuleEmit = R.LastRuleEmit;
+      ValCtx.LastDebugLocEmit = R.LastDebugLocEmit;
+    }
+    if (pCache && !R.Failed && !hasDiags)
+      pCache->GetImpl().Insert(keys[i], R.Usage);
+  }
+}
+
 _Use_decl_annotations_ HRESULT
-ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
+ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule,
+                   DxilValidationCache *pCache) {
   std::string diagStr;
   raw_string_ostream diagStream(diagStr);
   DiagnosticPrinterRawOStream DiagPrinter(diagStream);
@@ -4294,9 +4978,7 @@ ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
   ValidateFlowControl(ValCtx);
 
   // Validate functions.
-  for (Function &F : pModule->functions()) {
-    ValidateFunction(F, ValCtx);
-  }
+  ValidateFunctions(*pModule, ValCtx, pCache);
 
   ValidateUninitializedOutput(ValCtx);
 
@@ -4591,29 +5273,21 @@ static HRESULT FindDxilPart(_In_reads_bytes_(ContainerSize) const void *pContain
                             _In_ DxilFourCC FourCC,
                             _In_ const DxilPartHeader **ppPart) {
 
-  const DxilContainerHeader *pContainer =
-    IsDxilContainerLike(pContainerBytes, ContainerSize);
-
-  if (!pContainer) {
-    IFR(DXC_E_CONTAINER_INVALID);
-  }
-  if (!IsValidDxilContainer(pContainer, ContainerSize)) {
+  DxilContainerView Container;
+  if (!Container.Initialize(pContainerBytes, ContainerSize)) {
     IFR(DXC_E_CONTAINER_INVALID);
   }
 
-  DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer),
-    DxilPartIsType(FourCC));
-  if (it == end(pContainer)) {
+  const DxilPartHeader *pPart = Container.FindPart(FourCC);
+  if (pPart == nullptr) {
     IFR(DXC_E_CONTAINER_MISSING_DXIL);
   }
 
-  const DxilProgramHeader *pProgramHeader =
-    reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-  if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
+  if (Container.FindProgramHeader(FourCC) == nullptr) {
     IFR(DXC_E_CONTAINER_INVALID);
   }
 
-  *ppPart = *it;
+  *ppPart = pPart;
   return S_OK;
 }
 
@@ -4770,7 +5444,8 @@ _Use_decl_annotations_ HRESULT ValidateLoadModuleFromContainerLazy(
 _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
-                              llvm::raw_ostream &DiagStream) {
+                              llvm::raw_ostream &DiagStream,
+                              DxilValidationCache *pCache) {
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -4785,7 +5460,7 @@ HRESULT ValidateDxilContainer(const void *pContainer,
       Ctx, DbgCtx, DiagStream));
 
   // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get(), pCache));
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
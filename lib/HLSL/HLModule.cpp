@@ -404,6 +404,9 @@ void HLModule::SetFloat32DenormMode(const DXIL::Float32DenormMode mode) {
 static const StringRef kHLDxilFunctionPropertiesMDName           = "dx.fnprops";
 static const StringRef kHLDxilOptionsMDName                      = "dx.options";
 static const StringRef kHLDxilResourceTypeAnnotationMDName       = "dx.resource.type.annotation";
+static const StringRef kHLDxilSpecializationConstantsMDName      = "dx.specialization.constants";
+static const StringRef kHLDxilSpecializationPassesMDName         = "dx.specialization.passes";
+static const StringRef kHLDxilSpecializationFlagsMDName          = "dx.specialization.flags";
 
 // DXIL metadata serialization/deserialization.
 void HLModule::EmitHLMetadata() {
@@ -507,6 +510,9 @@ void HLModule::ClearHLMetadata(llvm::Module &M) {
         name == kHLDxilFunctionPropertiesMDName || // TODO: adjust to proper name
         name == kHLDxilResourceTypeAnnotationMDName ||
         name == kHLDxilOptionsMDName ||
+        name == kHLDxilSpecializationConstantsMDName ||
+        name == kHLDxilSpecializationPassesMDName ||
+        name == kHLDxilSpecializationFlagsMDName ||
         name.startswith(DxilMDHelper::kDxilTypeSystemHelperVariablePrefix)) {
       nodes.push_back(b);
     }
@@ -516,6 +522,70 @@ void HLModule::ClearHLMetadata(llvm::Module &M) {
   }
 }
 
+void HLModule::AddSpecializationConstant(llvm::Module &M, StringRef Name,
+                                         GlobalVariable *GV) {
+  LLVMContext &Ctx = M.getContext();
+  Metadata *MDs[] = {MDString::get(Ctx, Name),
+                     GV ? ValueAsMetadata::get(GV) : nullptr};
+  M.getOrInsertNamedMetadata(kHLDxilSpecializationConstantsMDName)
+      ->addOperand(MDNode::get(Ctx, MDs));
+}
+
+void HLModule::GetSpecializationConstants(
+    llvm::Module &M,
+    std::vector<std::pair<StringRef, GlobalVariable *>> &Constants) {
+  NamedMDNode *N = M.getNamedMetadata(kHLDxilSpecializationConstantsMDName);
+  if (N == nullptr)
+    return;
+  for (MDNode *MD : N->operands()) {
+    MDString *MDName = dyn_cast<MDString>(MD->getOperand(0).get());
+    if (MDName == nullptr)
+      continue;
+    Constants.emplace_back(
+        MDName->getString(),
+        mdconst::dyn_extract_or_null<GlobalVariable>(MD->getOperand(1)));
+  }
+}
+
+void HLModule::SetSpecializationPasses(llvm::Module &M, StringRef Passes) {
+  LLVMContext &Ctx = M.getContext();
+  NamedMDNode *N = M.getOrInsertNamedMetadata(kHLDxilSpecializationPassesMDName);
+  Metadata *MDs[] = {MDString::get(Ctx, Passes)};
+  if (N->getNumOperands() == 0)
+    N->addOperand(MDNode::get(Ctx, MDs));
+  else
+    N->setOperand(0, MDNode::get(Ctx, MDs));
+}
+
+StringRef HLModule::GetSpecializationPasses(llvm::Module &M) {
+  NamedMDNode *N = M.getNamedMetadata(kHLDxilSpecializationPassesMDName);
+  if (N == nullptr || N->getNumOperands() == 0)
+    return StringRef();
+  MDString *MDPasses = dyn_cast<MDString>(N->getOperand(0)->getOperand(0).get());
+  return MDPasses ? MDPasses->getString() : StringRef();
+}
+
+void HLModule::SetSpecializationSerializeFlags(llvm::Module &M,
+                                               unsigned Flags) {
+  LLVMContext &Ctx = M.getContext();
+  NamedMDNode *N = M.getOrInsertNamedMetadata(kHLDxilSpecializationFlagsMDName);
+  Metadata *MDs[] = {ConstantAsMetadata::get(
+      ConstantInt::get(Type::getInt32Ty(Ctx), Flags))};
+  if (N->getNumOperands() == 0)
+    N->addOperand(MDNode::get(Ctx, MDs));
+  else
+    N->setOperand(0, MDNode::get(Ctx, MDs));
+}
+
+unsigned HLModule::GetSpecializationSerializeFlags(llvm::Module &M) {
+  NamedMDNode *N = M.getNamedMetadata(kHLDxilSpecializationFlagsMDName);
+  if (N == nullptr || N->getNumOperands() == 0)
+    return 0;
+  ConstantInt *Flags =
+      mdconst::dyn_extract_or_null<ConstantInt>(N->getOperand(0)->getOperand(0));
+  return Flags ? (unsigned)Flags->getLimitedValue() : 0;
+}
+
 MDTuple *HLModule::EmitHLResources() {
   // Emit SRV records.
   MDTuple *pTupleSRVs = nullptr;
@@ -1317,7 +1317,7 @@ bool BBPassManager::runOnFunction(Function &F) {
       {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
-        TimeRegion PassTimer(getPassTimer(BP));
+        PassTimeRegion PassTimer(BP); // HLSL Change
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1544,7 +1544,7 @@ bool FPPassManager::runOnFunction(Function &F) {
 
     {
       PassManagerPrettyStackEntry X(FP, F);
-      TimeRegion PassTimer(getPassTimer(FP));
+      PassTimeRegion PassTimer(FP); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1620,7 +1620,7 @@ MPPassManager::runOnModule(Module &M) {
 
     {
       PassManagerPrettyStackEntry X(MP, M);
-      TimeRegion PassTimer(getPassTimer(MP));
+      PassTimeRegion PassTimer(MP); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
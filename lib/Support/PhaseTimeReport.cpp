@@ -0,0 +1,110 @@
+//===-- PhaseTimeReport.cpp - Nested phase timing -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/PhaseTimeReport.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+#include <chrono>
+
+using namespace llvm;
+
+static LLVM_THREAD_LOCAL PhaseTimeReport *CurrentReport = nullptr;
+
+static double getWallSeconds() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+PhaseTimeReport::Phase *PhaseTimeReport::Phase::getChild(StringRef ChildName) {
+  for (auto &Child : Children)
+    if (Child->Name == ChildName)
+      return Child.get();
+  Children.emplace_back(new Phase(ChildName, this));
+  return Children.back().get();
+}
+
+PhaseTimeReport::PhaseTimeReport() : Root("Total", nullptr), Current(&Root) {
+  Root.StartSeconds = getWallSeconds();
+}
+
+PhaseTimeReport::~PhaseTimeReport() {
+  assert(CurrentReport != this && "report destroyed while installed");
+}
+
+void PhaseTimeReport::startPhase(StringRef Name) {
+  Phase *P = Current->getChild(Name);
+  P->StartBytes = Counter ? Counter() : 0;
+  P->StartSeconds = getWallSeconds();
+  Current = P;
+}
+
+void PhaseTimeReport::stopPhase() {
+  assert(Current != &Root && "unbalanced stopPhase");
+  Phase *P = Current;
+  P->Seconds += getWallSeconds() - P->StartSeconds;
+  if (Counter)
+    P->AllocatedBytes += Counter() - P->StartBytes;
+  ++P->Calls;
+  Current = P->Parent;
+}
+
+template <typename ChildrenT>
+static double sumChildSeconds(const ChildrenT &Children) {
+  double Seconds = 0;
+  for (const auto &Child : Children)
+    Seconds += Child->Seconds;
+  return Seconds;
+}
+
+static void printRow(raw_ostream &OS, StringRef Name, unsigned Depth,
+                     double Seconds, double ChildSeconds, unsigned Calls,
+                     uint64_t AllocatedBytes, double TotalSeconds) {
+  double SelfSeconds = Seconds > ChildSeconds ? Seconds - ChildSeconds : 0;
+  double Percent = TotalSeconds > 0 ? Seconds * 100 / TotalSeconds : 0;
+  OS << format("%10.3f %6.1f%% %10.3f %7u %12" PRIu64 "  ", Seconds * 1000,
+               Percent, SelfSeconds * 1000, Calls, AllocatedBytes / 1024);
+  OS.indent(Depth * 2) << Name << '\n';
+}
+
+void PhaseTimeReport::printPhase(raw_ostream &OS, const Phase &P,
+                                 unsigned Depth, double TotalSeconds) const {
+  printRow(OS, P.Name, Depth, P.Seconds, sumChildSeconds(P.Children), P.Calls,
+           P.AllocatedBytes, TotalSeconds);
+  for (const auto &Child : P.Children)
+    printPhase(OS, *Child, Depth + 1, TotalSeconds);
+}
+
+void PhaseTimeReport::print(raw_ostream &OS) const {
+  // The root covers the lifetime of the report so far; its allocation count
+  // is the sum over the top-level phases.
+  double TotalSeconds = getWallSeconds() - Root.StartSeconds;
+  uint64_t TotalBytes = 0;
+  for (const auto &Child : Root.Children)
+    TotalBytes += Child->AllocatedBytes;
+
+  OS << "   Wall ms  Share    Self ms   Calls     Alloc KB  Phase\n";
+  printRow(OS, Root.Name, 0, TotalSeconds, sumChildSeconds(Root.Children), 1,
+           TotalBytes, TotalSeconds);
+  for (const auto &Child : Root.Children)
+    printPhase(OS, *Child, 1, TotalSeconds);
+}
+
+PhaseTimeReport *PhaseTimeReport::getCurrent() { return CurrentReport; }
+
+PhaseTimeReport *PhaseTimeReport::setCurrent(PhaseTimeReport *Report) {
+  PhaseTimeReport *Prior = CurrentReport;
+  CurrentReport = Report;
+  return Prior;
+}
@@ -35,6 +35,7 @@ namespace clang {
   class NamedDecl;
   class TypeSourceInfo;
   class TypedefDecl;
+  class VarDecl;
 }
 
 namespace hlsl {
@@ -389,6 +390,10 @@ bool IsIntrinsicOp(const clang::FunctionDecl *FD);
 bool GetIntrinsicOp(const clang::FunctionDecl *FD, unsigned &opcode,
                     llvm::StringRef &group);
 bool GetIntrinsicLowering(const clang::FunctionDecl *FD, llvm::StringRef &S);
+/// Whether the variable is a static const global named with
+/// -specialize-constant; its value is bound after code generation, so it
+/// must not be folded by the front end.
+bool IsSpecializationConstant(const clang::VarDecl *VD);
 
 /// <summary>Adds a function declaration to the specified class record.</summary>
 /// <param name="context">ASTContext that owns declarations.</param>
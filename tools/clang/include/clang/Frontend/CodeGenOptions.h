@@ -198,6 +198,9 @@ public:
   std::shared_ptr<hlsl::HLSLExtensionsCodegenHelper> HLSLExtensionsCodegen;
   /// Signature packing mode (0 == default for target)
   unsigned HLSLSignaturePackingStrategy = 0;
+  /// Container flags (hlsl::SerializeDxilFlags) recorded in a high-level
+  /// module with specialization constants.
+  unsigned HLSLSpecializationSerializeFlags = 0;
   /// denormalized number mode ("ieee" for default)
   hlsl::DXIL::Float32DenormMode HLSLFloat32DenormMode;
   // HLSL Change Ends
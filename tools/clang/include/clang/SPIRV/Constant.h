@@ -31,11 +31,16 @@ class SPIRVContext;
 /// needed constant. A unique constant has a unique pointer (e.g. calling
 /// 'getTrue' function will always return the same pointer for the given
 /// context).
+///
+/// Constants are interned by the SPIRVContext, which also records the
+/// <result-id> defined for a constant in the constant itself.
 class Constant {
 public:
   spv::Op getOpcode() const { return opcode; }
   uint32_t getTypeId() const { return typeId; }
   const llvm::SmallVector<uint32_t, 4> &getArgs() const { return args; }
+  /// \brief Returns a hash of the opcode, type and arguments.
+  size_t getHash() const { return hash; }
 
   // OpConstantTrue and OpConstantFalse are boolean.
   // OpSpecConstantTrue and OpSpecConstantFalse are boolean.
@@ -79,8 +84,8 @@ public:
   static const Constant *getNull(SPIRVContext &ctx, uint32_t type_id);
 
   bool operator==(const Constant &other) const {
-    return opcode == other.opcode && typeId == other.typeId &&
-           args == other.args;
+    return hash == other.hash && opcode == other.opcode &&
+           typeId == other.typeId && args == other.args;
   }
 
   // \brief Construct the SPIR-V words for this constant with the given
@@ -88,6 +93,8 @@ public:
   std::vector<uint32_t> withResultId(uint32_t resultId) const;
 
 private:
+  friend class SPIRVContext;
+
   /// \brief Private constructor.
   Constant(spv::Op, uint32_t type, llvm::ArrayRef<uint32_t> arg = {});
 
@@ -98,6 +105,11 @@ private:
   spv::Op opcode;  ///< OpCode of the constant
   uint32_t typeId; ///< <result-id> of the type of the constant
   llvm::SmallVector<uint32_t, 4> args; ///< Arguments defining the constant
+  size_t hash;
+
+  /// The <result-id> defined for this constant; zero until the SPIRVContext
+  /// assigns one.
+  mutable uint32_t resultId;
 };
 
 } // end namespace spirv
@@ -40,6 +40,8 @@ public:
   spv::Decoration getValue() const { return id; }
   const llvm::SmallVector<uint32_t, 2> &getArgs() const { return args; }
   llvm::Optional<uint32_t> getMemberIndex() const { return memberIndex; }
+  /// \brief Returns a hash of the decoration, its arguments and member index.
+  size_t getHash() const;
 
   static const Decoration *getRelaxedPrecision(SPIRVContext &ctx);
   static const Decoration *getSpecId(SPIRVContext &ctx, uint32_t id);
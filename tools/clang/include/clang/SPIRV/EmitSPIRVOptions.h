@@ -45,6 +45,9 @@ struct EmitSPIRVOptions {
   llvm::SmallVector<int32_t, 4> uShift;
   llvm::SmallVector<llvm::StringRef, 4> allowedExtensions;
   llvm::StringRef targetEnv;
+  /// SPIRV-Tools pass flags (e.g. "--inline-entry-points-exhaustive") to run
+  /// instead of the optimization preset selected by the -O level
+  llvm::SmallVector<llvm::StringRef, 4> optConfig;
   spirv::LayoutRule cBufferLayoutRule;
   spirv::LayoutRule tBufferLayoutRule;
   spirv::LayoutRule sBufferLayoutRule;
@@ -9,32 +9,35 @@
 #ifndef LLVM_CLANG_SPIRV_SPIRVCONTEXT_H
 #define LLVM_CLANG_SPIRV_SPIRVCONTEXT_H
 
-#include <unordered_map>
-
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/SPIRV/Constant.h"
 #include "clang/SPIRV/Decoration.h"
 #include "clang/SPIRV/Type.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/Allocator.h"
 
 namespace clang {
 namespace spirv {
 
-struct TypeHash {
-  std::size_t operator()(const Type &t) const {
-    // TODO: We could improve this hash function if necessary.
-    return std::hash<uint32_t>{}(static_cast<uint32_t>(t.getOpcode()));
+/// \brief DenseMapInfo for sets of interned objects, which are looked up
+/// through pointers to equal objects that need not be interned themselves.
+template <typename T> struct InternedPtrInfo {
+  static const T *getEmptyKey() {
+    return llvm::DenseMapInfo<const T *>::getEmptyKey();
   }
-};
-struct DecorationHash {
-  std::size_t operator()(const Decoration &d) const {
-    // TODO: We could probably improve this hash function if needed.
-    return std::hash<uint32_t>{}(static_cast<uint32_t>(d.getValue()));
+  static const T *getTombstoneKey() {
+    return llvm::DenseMapInfo<const T *>::getTombstoneKey();
   }
-};
-struct ConstantHash {
-  std::size_t operator()(const Constant &c) const {
-    // TODO: We could improve this hash function if necessary.
-    return std::hash<uint32_t>{}(static_cast<uint32_t>(c.getTypeId()));
+  static unsigned getHashValue(const T *p) {
+    return static_cast<unsigned>(p->getHash());
+  }
+  static bool isEqual(const T *lhs, const T *rhs) {
+    if (lhs == rhs)
+      return true;
+    if (lhs == getEmptyKey() || lhs == getTombstoneKey() ||
+        rhs == getEmptyKey() || rhs == getTombstoneKey())
+      return false;
+    return *lhs == *rhs;
   }
 };
 
@@ -80,31 +83,31 @@ public:
   const Decoration *registerDecoration(const Decoration &);
 
 private:
-  using TypeSet = std::unordered_set<Type, TypeHash>;
-  using ConstantSet = std::unordered_set<Constant, ConstantHash>;
-  using DecorationSet = std::unordered_set<Decoration, DecorationHash>;
+  using TypeSet = llvm::DenseSet<const Type *, InternedPtrInfo<Type>>;
+  using ConstantSet =
+      llvm::DenseSet<const Constant *, InternedPtrInfo<Constant>>;
+  using DecorationSet =
+      llvm::DenseSet<const Decoration *, InternedPtrInfo<Decoration>>;
 
   uint32_t nextId;
 
+  /// \brief Storage for the unique objects below. Interned objects live as
+  /// long as the context, and are destroyed with it.
+  llvm::SpecificBumpPtrAllocator<Decoration> decorationAllocator;
+  llvm::SpecificBumpPtrAllocator<Type> typeAllocator;
+  llvm::SpecificBumpPtrAllocator<Constant> constantAllocator;
+
   /// \brief All the unique Decorations defined in the current context.
   DecorationSet existingDecorations;
 
-  /// \brief All the unique types defined in the current context.
+  /// \brief All the unique types defined in the current context. The
+  /// <result-id> defined for a type, if any, is kept in the type.
   TypeSet existingTypes;
 
   /// \brief All constants defined in the current context.
   /// These can be boolean, integer, float, or composite constants.
+  /// The <result-id> defined for a constant, if any, is kept in the constant.
   ConstantSet existingConstants;
-
-  /// \brief Maps a given type to the <result-id> that is defined for
-  /// that type. If a Type* does not exist in the map, the type
-  /// is not yet defined and is not associated with a <result-id>.
-  std::unordered_map<const Type *, uint32_t> typeResultIdMap;
-
-  /// \brief Maps a given constant to the <result-id> that is defined for
-  /// that constant. If a Constant* does not exist in the map, the constant
-  /// is not yet defined and is not associated with a <result-id>.
-  std::unordered_map<const Constant *, uint32_t> constantResultIdMap;
 };
 
 SPIRVContext::SPIRVContext() : nextId(1) {}
@@ -9,15 +9,14 @@
 #ifndef LLVM_CLANG_SPIRV_TYPE_H
 #define LLVM_CLANG_SPIRV_TYPE_H
 
-#include <set>
-#include <unordered_set>
 #include <vector>
 
 #include "spirv/unified1/spirv.hpp11"
 #include "clang/SPIRV/Decoration.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
-#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 
 namespace clang {
 namespace spirv {
@@ -35,14 +34,22 @@ class SPIRVContext;
 /// needed type. A unique type has a unique pointer (e.g. calling
 /// 'getBoolean' function will always return the same pointer for the given
 /// context).
+///
+/// Types are interned by the SPIRVContext, which also records the <result-id>
+/// defined for a type in the type itself.
 class Type {
 public:
   using DecorationSet = llvm::ArrayRef<const Decoration *>;
 
   spv::Op getOpcode() const { return opcode; }
-  const std::vector<uint32_t> &getArgs() const { return args; }
-  const auto &getDecorations() const { return decorations; }
+  const llvm::SmallVector<uint32_t, 4> &getArgs() const { return args; }
+  const llvm::SmallVector<const Decoration *, 2> &getDecorations() const {
+    return decorations;
+  }
   bool hasDecoration(const Decoration *) const;
+  /// \brief Returns a hash of the opcode, arguments and decorations, which
+  /// doesn't depend on the order of the decorations.
+  size_t getHash() const { return hash; }
 
   bool isBooleanType() const;
   bool isIntegerType() const;
@@ -112,12 +119,12 @@ public:
                                        spv::StorageClass storage_class,
                                        DecorationSet decs = {});
   bool operator==(const Type &other) const {
-    if (opcode == other.opcode && args == other.args &&
+    if (hash == other.hash && opcode == other.opcode && args == other.args &&
         decorations.size() == other.decorations.size()) {
       // If two types have the same decorations, but in different order,
       // they are in fact the same type.
-      for (const Decoration* dec : decorations) {
-        if (other.decorations.count(dec) == 0)
+      for (const Decoration *dec : decorations) {
+        if (!other.hasDecoration(dec))
           return false;
       }
       return true;
@@ -129,21 +136,31 @@ public:
   std::vector<uint32_t> withResultId(uint32_t resultId) const;
 
 private:
+  friend class SPIRVContext;
+
   /// \brief Private constructor.
-  Type(spv::Op op, std::vector<uint32_t> arg = {}, DecorationSet dec = {});
+  Type(spv::Op op, llvm::ArrayRef<uint32_t> arg = {}, DecorationSet dec = {});
 
   /// \brief Returns the unique Type pointer within the given context.
   static const Type *getUniqueType(SPIRVContext &, const Type &);
 
 private:
-  spv::Op opcode;             ///< OpCode of the Type defined in SPIR-V Spec
-  std::vector<uint32_t> args; ///< Arguments needed to define the type
+  spv::Op opcode; ///< OpCode of the Type defined in SPIR-V Spec
+  llvm::SmallVector<uint32_t, 4> args; ///< Arguments needed to define the type
 
   /// The decorations that are applied to a type.
-  /// Note: we use a SetVector because:
-  /// a) Duplicate decorations should be removed.
-  /// b) Order of insertion matters for deterministic SPIR-V emitting
-  llvm::SetVector<const Decoration *> decorations;
+  /// Note: duplicate decorations are removed, and the order of insertion is
+  /// kept for deterministic SPIR-V emitting. Struct types carry several
+  /// decorations per member, so membership is checked through a set kept
+  /// alongside the ordered list.
+  llvm::SmallVector<const Decoration *, 2> decorations;
+  llvm::SmallPtrSet<const Decoration *, 2> decorationSet;
+
+  size_t hash;
+
+  /// The <result-id> defined for this type; zero until the SPIRVContext
+  /// assigns one.
+  mutable uint32_t resultId;
 };
 
 } // end namespace spirv
@@ -24,6 +24,7 @@
 #include "dxc/Support/Global.h"
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/HLSL/DxilSemantic.h"
+#include <algorithm>
 
 using namespace clang;
 using namespace hlsl;
@@ -928,6 +929,19 @@ bool hlsl::GetIntrinsicLowering(const clang::FunctionDecl *FD, llvm::StringRef &
   return true;
 }
 
+bool hlsl::IsSpecializationConstant(const clang::VarDecl *VD) {
+  if (VD == nullptr)
+    return false;
+  const std::vector<std::string> &names =
+      VD->getASTContext().getLangOpts().HLSLSpecializationConstants;
+  if (names.empty() || VD->getStorageClass() != SC_Static ||
+      !VD->getType().isConstQualified() ||
+      !VD->getDeclContext()->isFileContext())
+    return false;
+  std::string name = VD->getQualifiedNameAsString();
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
 /// <summary>Parses a column or row digit.</summary>
 static
 bool TryParseColOrRowChar(const char digit, _Out_ int* count) {
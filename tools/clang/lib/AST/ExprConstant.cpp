@@ -2042,6 +2042,9 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   if (VD->hasExternalFormalLinkage() &&
       !isa<EnumConstantDecl>(VD))
     return false;
+  // Specialization constants are bound after codegen.
+  if (hlsl::IsSpecializationConstant(VD))
+    return false;
   // HLSL Change End.
 
   // Check that we can fold the initializer. In C++, we will have already done
@@ -9065,6 +9068,9 @@ static ICEDiag CheckICE(const Expr* E, const ASTContext &Ctx) {
       if (const VarDecl *Dcl = dyn_cast<VarDecl>(D)) {
         if (!Dcl->getType()->isIntegralOrEnumerationType())
           return ICEDiag(IK_NotICE, cast<DeclRefExpr>(E)->getLocation());
+        // HLSL Change - specialization constants are bound after codegen.
+        if (hlsl::IsSpecializationConstant(Dcl))
+          return ICEDiag(IK_NotICE, cast<DeclRefExpr>(E)->getLocation());
 
         const VarDecl *VD;
         // Look for a declaration of this variable that has an initializer, and
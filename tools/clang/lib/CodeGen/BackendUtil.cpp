@@ -27,6 +27,7 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/PhaseTimeReport.h" // HLSL Change
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/Timer.h"
@@ -43,6 +44,7 @@
 #include <memory>
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h"  // HLSL Change
+#include "dxc/HLSL/HLModule.h"           // HLSL Change
 
 using namespace clang;
 using namespace llvm;
@@ -75,7 +77,7 @@ private:
     if (TM)
       return TM->getTargetIRAnalysis();
 
-    return TargetIRAnalysis();
+    return createDxilTargetIRAnalysis(); // HLSL Change
   }
 
   legacy::PassManager *getCodeGenPasses() const {
@@ -125,6 +127,9 @@ private:
   /// \return True on success.
   bool AddEmitPasses(BackendAction Action, raw_pwrite_stream &OS);
 
+  /// Prints the passes added so far, as -Odump does. // HLSL Change
+  void PrintPassesConfig(raw_ostream &OS) const;
+
 public:
   EmitAssemblyHelper(DiagnosticsEngine &_Diags,
                      const CodeGenOptions &CGOpts,
@@ -639,6 +644,26 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
   return true;
 }
 
+// HLSL Change Starts
+void EmitAssemblyHelper::PrintPassesConfig(raw_ostream &OS) const {
+  if (PerFunctionPasses) {
+    OS << "# Per-function passes\n"
+          "-opt-fn-passes\n";
+    OS << PerFunctionPassesConfigOS.str();
+  }
+  if (PerModulePasses) {
+    OS << "# Per-module passes\n"
+          "-opt-mod-passes\n";
+    OS << PerModulePassesConfigOS.str();
+  }
+  if (CodeGenPasses) {
+    OS << "# Code generation passes\n"
+          "-opt-mod-passes\n";
+    OS << CodeGenPassesConfigOS.str();
+  }
+}
+// HLSL Change Ends
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       raw_pwrite_stream *OS) {
   TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : nullptr);
@@ -681,21 +706,7 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   // HLSL Change Starts
   if (Action == Backend_EmitPasses) {
-    if (PerFunctionPasses) {
-      *OS << "# Per-function passes\n"
-             "-opt-fn-passes\n";
-      *OS << PerFunctionPassesConfigOS.str();
-    }
-    if (PerModulePasses) {
-      *OS << "# Per-module passes\n"
-             "-opt-mod-passes\n";
-      *OS << PerModulePassesConfigOS.str();
-    }
-    if (CodeGenPasses) {
-      *OS << "# Code generation passes\n"
-             "-opt-mod-passes\n";
-      *OS << CodeGenPassesConfigOS.str();
-    }
+    PrintPassesConfig(*OS);
     return;
   }
   // HLSL Change Ends
@@ -705,6 +716,7 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerFunctionPasses) {
     PrettyStackTraceString CrashInfo("Per-function optimization");
+    PhaseTimeRegion PassesRegion("Per-function passes"); // HLSL Change
 
     PerFunctionPasses->doInitialization();
     for (Function &F : *TheModule)
@@ -715,11 +727,13 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerModulePasses) {
     PrettyStackTraceString CrashInfo("Per-module optimization passes");
+    PhaseTimeRegion PassesRegion("Per-module passes"); // HLSL Change
     PerModulePasses->run(*TheModule);
   }
 
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
+    PhaseTimeRegion PassesRegion("Code generation passes"); // HLSL Change
     CodeGenPasses->run(*TheModule);
   }
 }
@@ -732,6 +746,22 @@ void clang::EmitBackendOutput(DiagnosticsEngine &Diags,
                               raw_pwrite_stream *OS) {
   EmitAssemblyHelper AsmHelper(Diags, CGOpts, TOpts, LOpts, M);
 
+  // HLSL Change Starts
+  // A high-level module with specialization constants carries the passes of
+  // the full compilation, to be run once values are bound.
+  if (CGOpts.HLSLHighLevel && !LOpts.HLSLSpecializationConstants.empty()) {
+    CodeGenOptions FullCGOpts(CGOpts);
+    FullCGOpts.HLSLHighLevel = false;
+    EmitAssemblyHelper PassesHelper(Diags, FullCGOpts, TOpts, LOpts, M);
+    SmallString<1024> Passes;
+    raw_svector_ostream PassesOS(Passes);
+    PassesHelper.EmitAssembly(Backend_EmitPasses, &PassesOS);
+    hlsl::HLModule::SetSpecializationPasses(*M, PassesOS.str());
+    hlsl::HLModule::SetSpecializationSerializeFlags(
+        *M, CGOpts.HLSLSpecializationSerializeFlags);
+  }
+  // HLSL Change Ends
+
   AsmHelper.EmitAssembly(Action, OS);
 
   // If an optional clang TargetInfo description string was passed in, use it to
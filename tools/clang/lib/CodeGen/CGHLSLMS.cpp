@@ -33,6 +33,8 @@
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/Support/PhaseTimeReport.h"
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -145,6 +147,8 @@ private:
   std::unordered_map<GlobalVariable *, std::vector<Constant *>>
       staticConstGlobalInitListMap;
   std::unordered_map<GlobalVariable *, Function *> staticConstGlobalCtorMap;
+  // Static const globals left unresolved by -specialize-constant.
+  std::vector<const VarDecl *> specializationConstants;
   // List for functions with clip plane.
   std::vector<Function *> clipPlaneFuncList;
   std::unordered_map<Value *, DebugLoc> debugInfoMap;
@@ -1902,6 +1906,19 @@ void CGMSHLSLRuntime::addResource(Decl *D) {
       return;
     // skip static global.
     if (!VD->hasExternalFormalLinkage()) {
+      if (hlsl::IsSpecializationConstant(VD)) {
+        // Values are bound from text, so only scalars are supported.
+        if (!VD->getType()->isBuiltinType() || !VD->hasInit()) {
+          DiagnosticsEngine &Diags = CGM.getDiags();
+          unsigned DiagID = Diags.getCustomDiagID(
+              DiagnosticsEngine::Error,
+              "specialization constant '%0' must be an initialized scalar");
+          Diags.Report(VD->getLocation(), DiagID) << VD->getName();
+          return;
+        }
+        specializationConstants.emplace_back(VD);
+        return;
+      }
       if (VD->hasInit() && VD->getType().isConstQualified()) {
         Expr* InitExp = VD->getInit();
         GlobalVariable *GV = cast<GlobalVariable>(CGM.GetAddrOfGlobalVar(VD));
@@ -4221,6 +4238,8 @@ void CGMSHLSLRuntime::SetPatchConstantFunctionWithAttr(
 }
 
 void CGMSHLSLRuntime::FinishCodeGen() {
+  PhaseTimeRegion FinishRegion("HLSL module finalization");
+
   // Library don't have entry.
   if (!m_bIsLib) {
     SetEntryFunction();
@@ -4337,6 +4356,29 @@ void CGMSHLSLRuntime::FinishCodeGen() {
     }
   }
 
+  // Record the specialization constants, so their values can be bound to the
+  // high-level module later. Constants the program doesn't use have no global.
+  {
+    std::vector<std::string> unmatched(
+        CGM.getLangOpts().HLSLSpecializationConstants);
+    for (const VarDecl *VD : specializationConstants) {
+      std::string name = VD->getQualifiedNameAsString();
+      unmatched.erase(std::remove(unmatched.begin(), unmatched.end(), name),
+                      unmatched.end());
+      GlobalVariable *GV = TheModule.getNamedGlobal(CGM.getMangledName(VD));
+      if (GV && !GV->hasInitializer())
+        GV = nullptr;
+      HLModule::AddSpecializationConstant(TheModule, name, GV);
+    }
+    DiagnosticsEngine &Diags = CGM.getDiags();
+    for (const std::string &name : unmatched) {
+      unsigned DiagID = Diags.getCustomDiagID(
+          DiagnosticsEngine::Error,
+          "specialization constant '%0' is not a static const global");
+      Diags.Report(DiagID) << name;
+    }
+  }
+
   // At this point, we have a high-level DXIL module - record this.
   SetPauseResumePasses(*m_pHLModule->GetModule(), "hlsl-hlemit", "hlsl-hlensure");
 }
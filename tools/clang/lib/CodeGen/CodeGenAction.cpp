@@ -32,6 +32,7 @@
 #include "llvm/Linker/Linker.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PhaseTimeReport.h" // HLSL Change
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Timer.h"
 #include <memory>
@@ -113,6 +114,7 @@ namespace clang {
                                      Context->getSourceManager(),
                                      "LLVM IR generation of declaration");
 
+      llvm::PhaseTimeRegion IRGenRegion("IR generation"); // HLSL Change
       if (llvm::TimePassesIsEnabled)
         LLVMIRGeneration.startTimer();
 
@@ -128,6 +130,7 @@ namespace clang {
       PrettyStackTraceDecl CrashInfo(D, SourceLocation(),
                                      Context->getSourceManager(),
                                      "LLVM IR generation of inline method");
+      llvm::PhaseTimeRegion IRGenRegion("IR generation"); // HLSL Change
       if (llvm::TimePassesIsEnabled)
         LLVMIRGeneration.startTimer();
 
@@ -140,6 +143,7 @@ namespace clang {
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
+        llvm::PhaseTimeRegion IRGenRegion("IR generation"); // HLSL Change
         if (llvm::TimePassesIsEnabled)
           LLVMIRGeneration.startTimer();
 
@@ -187,6 +191,7 @@ namespace clang {
       void *OldDiagnosticContext = Ctx.getDiagnosticContext();
       Ctx.setDiagnosticHandler(DiagnosticHandler, this);
 
+      llvm::PhaseTimeRegion BackendRegion("Optimization"); // HLSL Change
       EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts,
                         C.getTargetInfo().getTargetDescription(),
                         TheModule.get(), Action, AsmOutStream);
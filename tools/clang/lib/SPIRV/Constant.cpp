@@ -10,6 +10,7 @@
 #include "clang/SPIRV/Constant.h"
 #include "clang/SPIRV/BitwiseCast.h"
 #include "clang/SPIRV/SPIRVContext.h"
+#include "llvm/ADT/Hashing.h"
 
 namespace {
 uint32_t zeroExtendTo32Bits(uint16_t value) {
@@ -46,7 +47,10 @@ namespace clang {
 namespace spirv {
 
 Constant::Constant(spv::Op op, uint32_t type, llvm::ArrayRef<uint32_t> arg)
-    : opcode(op), typeId(type), args(arg.begin(), arg.end()) {}
+    : opcode(op), typeId(type), args(arg.begin(), arg.end()), resultId(0) {
+  hash = llvm::hash_combine(static_cast<uint32_t>(opcode), typeId,
+                            llvm::hash_combine_range(args.begin(), args.end()));
+}
 
 const Constant *Constant::getUniqueConstant(SPIRVContext &context,
                                             const Constant &c) {
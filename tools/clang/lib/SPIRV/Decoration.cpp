@@ -10,6 +10,7 @@
 #include "clang/SPIRV/Decoration.h"
 #include "clang/SPIRV/SPIRVContext.h"
 #include "clang/SPIRV/String.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/llvm_assert/assert.h"
 
 namespace clang {
@@ -297,6 +298,13 @@ Decoration::getHlslSemanticGOOGLE(SPIRVContext &context,
   return getUniqueDecoration(context, d);
 }
 
+size_t Decoration::getHash() const {
+  return llvm::hash_combine(static_cast<uint32_t>(id),
+                            llvm::hash_combine_range(args.begin(), args.end()),
+                            memberIndex.hasValue(),
+                            memberIndex.hasValue() ? *memberIndex : 0u);
+}
+
 std::vector<uint32_t> Decoration::withTargetId(uint32_t targetId) const {
   std::vector<uint32_t> words;
 
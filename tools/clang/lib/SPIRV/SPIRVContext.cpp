@@ -7,71 +7,59 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include <tuple>
-
 #include "clang/SPIRV/SPIRVContext.h"
 #include "llvm/llvm_assert/assert.h"
 
 namespace clang {
 namespace spirv {
 
+namespace {
+/// \brief Returns the interned copy of the given object, creating it from the
+/// given allocator if there is none yet. The object's hash is computed once
+/// for the lookup.
+template <typename T, typename SetT>
+const T *intern(const T &obj, SetT &existing,
+                llvm::SpecificBumpPtrAllocator<T> &allocator) {
+  auto iter = existing.find(&obj);
+  if (iter != existing.end())
+    return *iter;
+
+  const T *interned = new (allocator.Allocate()) T(obj);
+  existing.insert(interned);
+  return interned;
+}
+} // namespace
+
 uint32_t SPIRVContext::getResultIdForType(const Type *t, bool *isRegistered) {
   assert(t != nullptr);
-  uint32_t result_id = 0;
-
-  auto iter = typeResultIdMap.find(t);
-  if (iter == typeResultIdMap.end()) {
+  if (isRegistered)
+    *isRegistered = t->resultId != 0;
+  if (t->resultId == 0) {
     // The Type has not been defined yet. Reserve an ID for it.
-    result_id = takeNextId();
-    typeResultIdMap[t] = result_id;
-    if (isRegistered)
-      *isRegistered = false;
-  } else {
-    result_id = iter->second;
-    if (isRegistered)
-      *isRegistered = true;
+    t->resultId = takeNextId();
   }
-
-  assert(result_id != 0);
-  return result_id;
+  return t->resultId;
 }
 
 uint32_t SPIRVContext::getResultIdForConstant(const Constant *c) {
   assert(c != nullptr);
-  uint32_t result_id = 0;
-
-  auto iter = constantResultIdMap.find(c);
-  if (iter == constantResultIdMap.end()) {
+  if (c->resultId == 0) {
     // The constant has not been defined yet. Reserve an ID for it.
-    result_id = takeNextId();
-    constantResultIdMap[c] = result_id;
-  } else {
-    result_id = iter->second;
+    c->resultId = takeNextId();
   }
-
-  assert(result_id != 0);
-  return result_id;
+  return c->resultId;
 }
 
 const Type *SPIRVContext::registerType(const Type &t) {
-  // Insert function will only insert if it doesn't already exist in the set.
-  TypeSet::iterator it;
-  std::tie(it, std::ignore) = existingTypes.insert(t);
-  return &*it;
+  return intern(t, existingTypes, typeAllocator);
 }
 
 const Constant *SPIRVContext::registerConstant(const Constant &c) {
-  // Insert function will only insert if it doesn't already exist in the set.
-  ConstantSet::iterator it;
-  std::tie(it, std::ignore) = existingConstants.insert(c);
-  return &*it;
+  return intern(c, existingConstants, constantAllocator);
 }
 
 const Decoration *SPIRVContext::registerDecoration(const Decoration &d) {
-  // Insert function will only insert if it doesn't already exist in the set.
-  DecorationSet::iterator it;
-  std::tie(it, std::ignore) = existingDecorations.insert(d);
-  return &*it;
+  return intern(d, existingDecorations, decorationAllocator);
 }
 
 } // end namespace spirv
@@ -16,6 +16,7 @@
 #include "dxc/HlslIntrinsicOp.h"
 #include "spirv-tools/optimizer.hpp"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/PhaseTimeReport.h"
 
 #include "InitListHandler.h"
 
@@ -217,8 +218,24 @@ bool spirvToolsLegalize(spv_target_env env, std::vector<uint32_t> *module,
   return optimizer.Run(module->data(), module->size(), module);
 }
 
-bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
-                        std::string *messages) {
+/// Returns the SPIRV-Tools pass flags to run for the given options. -Oconfig=
+/// replaces the performance recipe that all -O levels above zero run; that
+/// recipe is the "-O" flag to spirv-opt, so both are lists of flags from here
+/// on.
+std::vector<std::string> getOptimizationFlags(const EmitSPIRVOptions &options) {
+  std::vector<std::string> flags;
+  if (options.optConfig.empty()) {
+    flags.push_back("-O");
+  } else {
+    for (const auto flag : options.optConfig)
+      flags.push_back(flag.str());
+  }
+  return flags;
+}
+
+bool spirvToolsCheckPassFlags(spv_target_env env,
+                              const std::vector<std::string> &flags,
+                              std::string *messages) {
   spvtools::Optimizer optimizer(env);
 
   optimizer.SetMessageConsumer(
@@ -226,13 +243,50 @@ bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
                  const spv_position_t & /*position*/,
                  const char *message) { *messages += message; });
 
-  optimizer.RegisterPerformancePasses();
+  return optimizer.RegisterPassesFromFlags(flags);
+}
 
-  optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
+bool spirvToolsRunPasses(spv_target_env env, std::vector<uint32_t> *module,
+                         const std::vector<std::string> &flags,
+                         bool compactIds, std::string *messages) {
+  spvtools::Optimizer optimizer(env);
+
+  optimizer.SetMessageConsumer(
+      [messages](spv_message_level_t /*level*/, const char * /*source*/,
+                 const spv_position_t & /*position*/,
+                 const char *message) { *messages += message; });
+
+  if (!optimizer.RegisterPassesFromFlags(flags))
+    return false;
+
+  if (compactIds)
+    optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
 
   return optimizer.Run(module->data(), module->size(), module);
 }
 
+bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
+                        const std::vector<std::string> &flags,
+                        std::string *messages) {
+  // Without a time report, run the whole pipeline in one go.
+  if (!llvm::PhaseTimeReport::getCurrent())
+    return spirvToolsRunPasses(env, module, flags, /*compactIds*/ true,
+                               messages);
+
+  // With -ftime-report, give each flag its own optimizer so that it shows up
+  // as its own row. The module is reparsed between flags; that cost is
+  // included in the rows and only paid when timing was asked for.
+  for (const auto &flag : flags) {
+    llvm::PhaseTimeRegion passRegion(flag);
+    if (!spirvToolsRunPasses(env, module, {flag}, /*compactIds*/ false,
+                             messages))
+      return false;
+  }
+
+  llvm::PhaseTimeRegion passRegion("--compact-ids");
+  return spirvToolsRunPasses(env, module, {}, /*compactIds*/ true, messages);
+}
+
 bool spirvToolsValidate(spv_target_env env, std::vector<uint32_t> *module,
                         std::string *messages, bool relaxLogicalPointer) {
   spvtools::SpirvTools tools(env);
@@ -626,6 +680,7 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
   if (!spirvOptions.codeGenHighLevel) {
     // Run legalization passes
     if (needsLegalization || declIdMapper.requiresLegalization()) {
+      llvm::PhaseTimeRegion legalizeRegion("SPIR-V legalization");
       std::string messages;
       if (!spirvToolsLegalize(targetEnv, &m, &messages)) {
         emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
@@ -640,9 +695,18 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
     }
 
     // Run optimization passes
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
+    const unsigned optLevel =
+        theCompilerInstance.getCodeGenOpts().OptimizationLevel;
+    if (optLevel > 0 || !spirvOptions.optConfig.empty()) {
+      llvm::PhaseTimeRegion optRegion("SPIR-V optimization");
+      const auto flags = getOptimizationFlags(spirvOptions);
       std::string messages;
-      if (!spirvToolsOptimize(targetEnv, &m, &messages)) {
+      if (!spirvOptions.optConfig.empty() &&
+          !spirvToolsCheckPassFlags(targetEnv, flags, &messages)) {
+        emitError("invalid -Oconfig: %0", {}) << messages;
+        return;
+      }
+      if (!spirvToolsOptimize(targetEnv, &m, flags, &messages)) {
         emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
         emitNote("please file a bug report on "
                  "https://github.com/Microsoft/DirectXShaderCompiler/issues "
@@ -655,6 +719,7 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
 
   // Validate the generated SPIR-V code
   if (!spirvOptions.disableValidation) {
+    llvm::PhaseTimeRegion validateRegion("SPIR-V validation");
     std::string messages;
     if (!spirvToolsValidate(targetEnv, &m, &messages,
                             declIdMapper.requiresLegalization())) {
@@ -10,13 +10,24 @@
 #include "clang/SPIRV/Type.h"
 #include "clang/SPIRV/SPIRVContext.h"
 #include "clang/SPIRV/String.h"
+#include "llvm/ADT/Hashing.h"
 
 namespace clang {
 namespace spirv {
 
-Type::Type(spv::Op op, std::vector<uint32_t> arg, DecorationSet decs)
-    : opcode(op), args(std::move(arg)) {
-  decorations = llvm::SetVector<const Decoration *>(decs.begin(), decs.end());
+Type::Type(spv::Op op, llvm::ArrayRef<uint32_t> arg, DecorationSet decs)
+    : opcode(op), args(arg.begin(), arg.end()), resultId(0) {
+  // Decorations are combined so that their order doesn't change the hash.
+  size_t decorationHash = 0;
+  for (const Decoration *d : decs) {
+    if (decorationSet.insert(d).second) {
+      decorations.push_back(d);
+      decorationHash += llvm::hash_value(d);
+    }
+  }
+  hash = llvm::hash_combine(static_cast<uint32_t>(opcode),
+                            llvm::hash_combine_range(args.begin(), args.end()),
+                            decorationHash);
 }
 
 const Type *Type::getUniqueType(SPIRVContext &context, const Type &t) {
@@ -127,7 +138,7 @@ const Type *Type::getRuntimeArray(SPIRVContext &context,
 }
 const Type *Type::getStruct(SPIRVContext &context,
                             llvm::ArrayRef<uint32_t> members, DecorationSet d) {
-  Type t = Type(spv::Op::OpTypeStruct, std::vector<uint32_t>(members), d);
+  Type t = Type(spv::Op::OpTypeStruct, members, d);
   return getUniqueType(context, t);
 }
 const Type *Type::getOpaque(SPIRVContext &context, std::string name,
@@ -198,7 +209,7 @@ bool Type::isCompositeType() const {
 bool Type::isImageType() const { return opcode == spv::Op::OpTypeImage; }
 
 bool Type::hasDecoration(const Decoration *d) const {
-  return decorations.count(d);
+  return decorationSet.count(d) != 0;
 }
 
 std::vector<uint32_t> Type::withResultId(uint32_t resultId) const {
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/DeclCXX.h"
@@ -37,6 +38,7 @@
 #include "gen_intrin_main_tables_15.h"
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/HLSL/DxilShaderModel.h"
+#include <algorithm>
 #include <array>
 
 enum ArBasicKind {
@@ -2168,101 +2170,73 @@ bool TemplateHasDefaultType(ArBasicKind kind)
   return false;
 }
 
+/// <summary>
+/// Intrinsics found in external tables for a type and function name, in table
+/// order and then lookup order within each table.
+/// </summary>
+typedef std::vector<std::pair<unsigned, const HLSL_INTRINSIC*>> IntrinsicTableMatches;
+
 /// <summary>
 /// Use this class to iterate over intrinsic definitions that come from an external source.
 /// </summary>
 class IntrinsicTableDefIter
 {
 private:
-  StringRef _typeName;
-  StringRef _functionName;
   llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& _tables;
-  const HLSL_INTRINSIC* _tableIntrinsic;
-  UINT64 _tableLookupCookie;
-  unsigned _tableIndex;
+  const IntrinsicTableMatches* _matches;
+  size_t _matchIndex;
   unsigned _argCount;
-  bool _firstChecked;
 
   IntrinsicTableDefIter(
     llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& tables,
-    StringRef typeName,
-    StringRef functionName,
+    const IntrinsicTableMatches* matches,
     unsigned argCount) :
-    _typeName(typeName), _functionName(functionName), _tables(tables),
-    _tableIntrinsic(nullptr), _tableLookupCookie(0), _tableIndex(0),
-    _argCount(argCount), _firstChecked(false)
+    _tables(tables), _matches(matches), _matchIndex(0), _argCount(argCount)
   {
+    SkipMismatches();
   }
 
-  void CheckForIntrinsic() {
-    if (_tableIndex >= _tables.size()) {
-      return;
-    }
-
-    _firstChecked = true;
-
-    // TODO: review this - this will allocate at least once per string
-    CA2WEX<> typeName(_typeName.str().c_str(), CP_UTF8);
-    CA2WEX<> functionName(_functionName.str().c_str(), CP_UTF8);
-
-    if (FAILED(_tables[_tableIndex]->LookupIntrinsic(
-            typeName, functionName, &_tableIntrinsic, &_tableLookupCookie))) {
-      _tableLookupCookie = 0;
-      _tableIntrinsic = nullptr;
-    }
+  bool AtEnd() const
+  {
+    return _matches == nullptr || _matchIndex >= _matches->size();
   }
 
-  void MoveToNext() {
-    for (;;) {
-      // If we don't have an intrinsic, try the following table.
-      if (_firstChecked && _tableIntrinsic == nullptr) {
-        _tableIndex++;
-      }
-
-      CheckForIntrinsic();
-      if (_tableIndex == _tables.size() ||
-          (_tableIntrinsic != nullptr &&
-           _tableIntrinsic->uNumArgs ==
-               (_argCount + 1))) // uNumArgs includes return
-        break;
-    }
+  void SkipMismatches() {
+    while (!AtEnd() &&
+           (*_matches)[_matchIndex].second->uNumArgs != (_argCount + 1)) // uNumArgs includes return
+      _matchIndex++;
   }
 
 public:
   static IntrinsicTableDefIter CreateStart(llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& tables,
-    StringRef typeName,
-    StringRef functionName,
+    const IntrinsicTableMatches* matches,
     unsigned argCount)
   {
-    IntrinsicTableDefIter result(tables, typeName, functionName, argCount);
+    IntrinsicTableDefIter result(tables, matches, argCount);
     return result;
   }
 
   static IntrinsicTableDefIter CreateEnd(llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& tables)
   {
-    IntrinsicTableDefIter result(tables, StringRef(), StringRef(), 0);
-    result._tableIndex = tables.size();
+    IntrinsicTableDefIter result(tables, nullptr, 0);
     return result;
   }
 
   bool operator!=(const IntrinsicTableDefIter& other)
   {
-    if (!_firstChecked) {
-      MoveToNext();
-    }
-    return _tableIndex != other._tableIndex; // More things could be compared but we only match end.
+    return AtEnd() != other.AtEnd(); // More things could be compared but we only match end.
   }
 
   const HLSL_INTRINSIC* operator*()
   {
-    DXASSERT(_firstChecked, "otherwise deref without comparing to end");
-    return _tableIntrinsic;
+    DXASSERT(!AtEnd(), "otherwise deref past the end");
+    return (*_matches)[_matchIndex].second;
   }
 
   LPCSTR GetTableName()
   {
     LPCSTR tableName = nullptr;
-    if (FAILED(_tables[_tableIndex]->GetTableName(&tableName))) {
+    if (FAILED(_tables[(*_matches)[_matchIndex].first]->GetTableName(&tableName))) {
       return nullptr;
     }
     return tableName;
@@ -2271,7 +2245,8 @@ public:
   LPCSTR GetLoweringStrategy()
   {
     LPCSTR lowering = nullptr;
-    if (FAILED(_tables[_tableIndex]->GetLoweringStrategy(_tableIntrinsic->Op, &lowering))) {
+    const std::pair<unsigned, const HLSL_INTRINSIC*>& match = (*_matches)[_matchIndex];
+    if (FAILED(_tables[match.first]->GetLoweringStrategy(match.second->Op, &lowering))) {
       return nullptr;
     }
     return lowering;
@@ -2279,7 +2254,8 @@ public:
 
   IntrinsicTableDefIter& operator++()
   {
-    MoveToNext();
+    _matchIndex++;
+    SkipMismatches();
     return *this;
   }
 };
@@ -2529,6 +2505,11 @@ private:
   // Intrinsic tables available externally.
   llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2> m_intrinsicTables;
 
+  // Lookups into the external tables by type and function name; a table
+  // returns the same intrinsics for a name every time it's asked, so each
+  // name is only looked up once.
+  llvm::StringMap<IntrinsicTableMatches> m_intrinsicTableMatches;
+
   // Scalar types indexed by HLSLScalarType.
   QualType m_scalarTypes[HLSLScalarTypeCount];
 
@@ -3493,6 +3474,7 @@ public:
   void RegisterIntrinsicTable(_In_ IDxcIntrinsicTable *table) {
     DXASSERT_NOMSG(table != nullptr);
     m_intrinsicTables.push_back(table);
+    m_intrinsicTableMatches.clear();
     // If already initialized, add methods immediately.
     if (m_sema != nullptr) {
       AddIntrinsicTableMethods(table);
@@ -3712,6 +3694,41 @@ public:
     _In_ const HLSL_INTRINSIC *pIntrinsic,
     _In_ QualType objectElement);
 
+  // Returns the intrinsics the external tables have for the given type and
+  // function name, or nullptr if there are no external tables.
+  const IntrinsicTableMatches* FindIntrinsicTableMatches(
+    StringRef typeName,
+    StringRef nameIdentifier)
+  {
+    if (m_intrinsicTables.empty()) {
+      return nullptr;
+    }
+
+    std::string key = typeName;
+    key += '\0';
+    key += nameIdentifier;
+    auto inserted = m_intrinsicTableMatches.insert(
+      std::make_pair(key, IntrinsicTableMatches()));
+    IntrinsicTableMatches& matches = inserted.first->second;
+    if (!inserted.second) {
+      return &matches;
+    }
+
+    CA2WEX<> wideTypeName(typeName.str().c_str(), CP_UTF8);
+    CA2WEX<> wideFunctionName(nameIdentifier.str().c_str(), CP_UTF8);
+    for (unsigned i = 0; i < m_intrinsicTables.size(); i++) {
+      const HLSL_INTRINSIC* pIntrinsic = nullptr;
+      UINT64 lookupCookie = 0;
+      while (SUCCEEDED(m_intrinsicTables[i]->LookupIntrinsic(
+                 wideTypeName, wideFunctionName, &pIntrinsic, &lookupCookie)) &&
+             pIntrinsic != nullptr) {
+        // Intrinsics are alive as long as the table is alive.
+        matches.push_back(std::make_pair(i, pIntrinsic));
+      }
+    }
+    return &matches;
+  }
+
   // Returns the iterator with the first entry that matches the requirement
   IntrinsicDefIter FindIntrinsicByNameAndArgCount(
     _In_count_(tableSize) const HLSL_INTRINSIC* table,
@@ -3720,31 +3737,25 @@ public:
     StringRef nameIdentifier,
     size_t argumentCount)
   {
-    // This is implemented by a linear scan for now.
-    // We tested binary search on tables, and there was no performance gain on
-    // samples probably for the following reasons.
-    // 1. The tables are not big enough to make noticable difference
-    // 2. The user of this function assumes that it returns the first entry in
-    // the table that matches name and argument count. So even in the binary
-    // search, we have to scan backwards until the entry does not match the name
-    // or arg count. For linear search this is not a problem
-    for (unsigned int i = 0; i < tableSize; i++) {
-      const HLSL_INTRINSIC* pIntrinsic = &table[i];
-
-      // Do some quick checks to verify size and name.
-      if (pIntrinsic->uNumArgs != 1 + argumentCount) {
-        continue;
-      }
-      if (!nameIdentifier.equals(StringRef(pIntrinsic->pArgs[0].pName))) {
-        continue;
-      }
-
+    // The generated tables are sorted by name and then argument count (see
+    // get_hlsl_intrinsics in hctdb_instrhelp.py), with overloads kept in
+    // table order, so the first entry that is not less than the key is the
+    // first match in the table.
+    unsigned numArgs = 1 + argumentCount;
+    const HLSL_INTRINSIC* pIntrinsic = std::lower_bound(
+      table, table + tableSize, nameIdentifier,
+      [numArgs](const HLSL_INTRINSIC& entry, StringRef name) {
+        int cmp = StringRef(entry.pArgs[0].pName).compare(name);
+        return cmp < 0 || (cmp == 0 && entry.uNumArgs < numArgs);
+      });
+    if (pIntrinsic != table + tableSize && pIntrinsic->uNumArgs == numArgs &&
+        nameIdentifier.equals(StringRef(pIntrinsic->pArgs[0].pName))) {
       return IntrinsicDefIter::CreateStart(table, tableSize, pIntrinsic,
-        IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
+        IntrinsicTableDefIter::CreateStart(m_intrinsicTables, FindIntrinsicTableMatches(typeName, nameIdentifier), argumentCount));
     }
 
     return IntrinsicDefIter::CreateStart(table, tableSize, table + tableSize,
-      IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
+      IntrinsicTableDefIter::CreateStart(m_intrinsicTables, FindIntrinsicTableMatches(typeName, nameIdentifier), argumentCount));
   }
 
   bool AddOverloadedCallCandidates(
@@ -0,0 +1,52 @@
+// RUN: %dxc -E main -T hs_6_1 %s | FileCheck %s
+
+// CHECK: Number of inputs: 4, outputs: 4, patchconst: 16
+// CHECK: Outputs dependent on ViewId: { 1 }
+// CHECK: PCOutputs dependent on ViewId: { 7, 11 }
+// CHECK: Inputs contributing to computation of Outputs:
+// CHECK:   output 0 depends on inputs: { 0 }
+// CHECK:   output 1 depends on inputs: { 1 }
+// CHECK:   output 2 depends on inputs: { 2 }
+// CHECK:   output 3 depends on inputs: { 3 }
+// CHECK: Inputs contributing to computation of PCOutputs:
+// CHECK:   output 3 depends on inputs: { 0 }
+// CHECK:   output 7 depends on inputs: { 1 }
+// CHECK:   output 15 depends on inputs: { 3 }
+
+struct ControlPoint
+{
+    float4 pos : POSITION;
+};
+
+struct PatchConstants
+{
+    float edges[3] : SV_TessFactor;
+    float inside   : SV_InsideTessFactor;
+};
+
+PatchConstants PatchFunc(InputPatch<ControlPoint, 3> ip,
+                         OutputPatch<ControlPoint, 3> op,
+                         uint vid : SV_ViewID)
+{
+    PatchConstants pc;
+    pc.edges[0] = ip[0].pos.x;
+    pc.edges[1] = op[1].pos.y;
+    pc.edges[2] = vid;
+    pc.inside = ip[2].pos.w;
+    return pc;
+}
+
+[domain("tri")]
+[partitioning("integer")]
+[outputtopology("triangle_cw")]
+[outputcontrolpoints(3)]
+[patchconstantfunc("PatchFunc")]
+ControlPoint main(InputPatch<ControlPoint, 3> ip,
+                  uint i : SV_OutputControlPointID,
+                  uint vid : SV_ViewID)
+{
+    ControlPoint cp;
+    cp.pos = ip[i].pos;
+    cp.pos.y += vid;
+    return cp;
+}
@@ -0,0 +1,59 @@
+// RUN: %dxc -E main -T gs_6_1 %s | FileCheck %s
+
+// CHECK: Number of inputs: 8, outputs per stream: { 4, 4, 2, 0 }
+// CHECK: Outputs for Stream 0 dependent on ViewId: { 3 }
+// CHECK: Outputs for Stream 1 dependent on ViewId: { 0, 1, 2, 3 }
+// CHECK: Outputs for Stream 2 dependent on ViewId: {  }
+// CHECK: Inputs contributing to computation of Outputs for Stream 0:
+// CHECK:   output 0 depends on inputs: { 0 }
+// CHECK:   output 1 depends on inputs: { 1 }
+// CHECK:   output 2 depends on inputs: { 2 }
+// CHECK:   output 3 depends on inputs: { 3 }
+// CHECK: Inputs contributing to computation of Outputs for Stream 1:
+// CHECK:   output 0 depends on inputs: { 4 }
+// CHECK:   output 1 depends on inputs: { 5 }
+// CHECK:   output 2 depends on inputs: { 6 }
+// CHECK:   output 3 depends on inputs: { 7 }
+// CHECK: Inputs contributing to computation of Outputs for Stream 2:
+// CHECK:   output 0 depends on inputs: { 0, 6 }
+// CHECK:   output 1 depends on inputs: { 1, 7 }
+
+struct InVertex {
+  float4 a : AAA;
+  float4 b : BBB;
+};
+
+struct OutVertex1 {
+  float4 p : PPP;
+};
+
+struct OutVertex2 {
+  float4 q : QQQ;
+};
+
+struct OutVertex3 {
+  float2 r : RRR;
+};
+
+[maxvertexcount(1)]
+void main(
+  point InVertex verts[1],
+  uint vid : SV_ViewID,
+  inout PointStream<OutVertex1> myStream1,
+  inout PointStream<OutVertex2> myStream2,
+  inout PointStream<OutVertex3> myStream3 )
+{
+    OutVertex1 myVert1;
+    OutVertex2 myVert2;
+    OutVertex3 myVert3;
+    myVert1.p = verts[0].a;
+    [branch]
+    if (vid == 1) {
+      myVert1.p.w = 0;
+    }
+    myVert2.q = verts[0].b * vid;
+    myVert3.r = verts[0].a.xy + verts[0].b.zw;
+    myStream1.Append( myVert1 );
+    myStream2.Append( myVert2 );
+    myStream3.Append( myVert3 );
+}
@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T ps_6_1 %s | FileCheck %s
+
+// CHECK: Number of inputs: 9, outputs: 4
+// CHECK: Outputs dependent on ViewId: { 2 }
+// CHECK: Inputs contributing to computation of Outputs:
+// CHECK:   output 0 depends on inputs: { 0, 1, 8 }
+// CHECK:   output 1 depends on inputs: { 6 }
+
+// Values carried around the loop through the local array reach output 0
+// only through loads of earlier iterations' stores.
+
+float4 main(float4 a : AAA, float4 b : BBB, uint vid : SV_ViewID,
+            nointerpolation uint n : NNN) : SV_Target
+{
+    float arr[4] = { a.x, a.y, 0, 0 };
+    [loop]
+    for (uint i = 2; i < n; ++i) {
+        arr[i % 4] = arr[(i - 1) % 4] + arr[(i - 2) % 4];
+    }
+    return float4(arr[n % 4], b.z, vid, 1);
+}
@@ -0,0 +1,13 @@
+// Run: %dxc -T ps_6_0 -E main -Oconfig=--strip-debug
+
+// The passes given via -Oconfig replace the -O recipe, which keeps debug
+// instructions around.
+
+// CHECK:     OpEntryPoint Fragment
+// CHECK-NOT: OpSource
+// CHECK-NOT: OpName
+// CHECK:     OpFunction
+
+float4 main(float4 color : COLOR) : SV_Target {
+    return color;
+}
@@ -0,0 +1,7 @@
+// Run: %dxc -T ps_6_0 -E main -Oconfig=--strip-debug,--no-such-pass
+
+float4 main(float4 color : COLOR) : SV_Target {
+    return color;
+}
+
+// CHECK: error: invalid -Oconfig:
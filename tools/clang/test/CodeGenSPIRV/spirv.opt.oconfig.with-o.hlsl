@@ -0,0 +1,7 @@
+// Run: %dxc -T ps_6_0 -E main -O3 -Oconfig=--strip-debug
+
+float4 main(float4 color : COLOR) : SV_Target {
+    return color;
+}
+
+// CHECK: -Oconfig should not be specified together with -O
@@ -0,0 +1,38 @@
+; RUN: %opt %s -hlsl-dxilload -analyze -cost-model | FileCheck %s
+
+; DXIL operations are costed by what they do rather than by their number of
+; arguments.
+
+target datalayout = "e-m:e-p:32:32-i64:64-f80:32-n8:16:32-a:0:32-S32"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.ResRet.f32 = type { float, float, float, float, i32 }
+
+define void @main() {
+entry:
+  ; CHECK: estimated cost of 0 for instruction: %tid = call i32 @dx.op.threadId.i32(i32 93,
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)  ; ThreadId(component)
+  %x = uitofp i32 %tid to float
+
+  ; CHECK: estimated cost of 1 for instruction: %abs = call float @dx.op.unary.f32(i32 6,
+  %abs = call float @dx.op.unary.f32(i32 6, float %x)  ; FAbs(value)
+
+  ; CHECK: estimated cost of 4 for instruction: %sin = call float @dx.op.unary.f32(i32 13,
+  %sin = call float @dx.op.unary.f32(i32 13, float %abs)  ; Sin(value)
+
+  %tex = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+  %smp = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 3, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+
+  ; CHECK: estimated cost of 8 for instruction: %sample = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+  %sample = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %sin, float %sin, float undef, float undef, i32 0, i32 0, i32 undef, float undef)  ; Sample(srv,sampler,coord0,coord1,coord2,coord3,offset0,offset1,offset2,clamp)
+  ret void
+}
+
+declare i32 @dx.op.threadId.i32(i32, i32) #0
+declare float @dx.op.unary.f32(i32, float) #0
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #1
+declare %dx.types.ResRet.f32 @dx.op.sample.f32(i32, %dx.types.Handle, %dx.types.Handle, float, float, float, float, i32, i32, i32, float) #1
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind readonly }
@@ -0,0 +1,17 @@
+// RUN: %dxc -E main -T ps_6_0 %s | %FileCheck %s
+
+// The loop indexes a local array, which is kept in indexable registers. It is
+// too large to unroll under the default threshold, but the higher one for
+// such loops lets it unroll fully, so every store gets a constant index.
+
+// CHECK: define void @main()
+// CHECK-NOT: phi
+// CHECK-NOT: br i1
+// CHECK: ret void
+
+float main(float a : A, uint n : N) : SV_Target {
+  float arr[32];
+  for (uint i = 0; i < 32; ++i)
+    arr[i] = a * i;
+  return arr[n];
+}
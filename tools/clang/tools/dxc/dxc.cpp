@@ -55,6 +55,7 @@
 #include "dxc/Support/microcom.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Option/ArgList.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <dia2.h>
@@ -210,6 +211,7 @@ public:
   int  Compile();
   void Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args, IDxcOperationResult **pCompileResult);
   int DumpBinary();
+  int DumpBinaries();
   void Preprocess();
   void GetCompilerVersionInfo(llvm::raw_string_ostream &OS);
 };
@@ -820,6 +822,16 @@ int DxcContext::Compile() {
     WriteOperationErrorsToConsole(pCompileResult, m_Opts.OutputWarnings);
   }
 
+  if (m_Opts.TimeReport) {
+    // Compilers that predate -ftime-report don't return a report.
+    CComPtr<IDxcTimeReport> pTimeReport;
+    CComPtr<IDxcBlobEncoding> pReport;
+    if (SUCCEEDED(pCompileResult.QueryInterface(&pTimeReport)) &&
+        pTimeReport->GetTimeReport(&pReport) == S_OK) {
+      WriteBlobToConsole(pReport, STD_ERROR_HANDLE);
+    }
+  }
+
   HRESULT status;
   IFT(pCompileResult->GetStatus(&status));
   if (SUCCEEDED(status) || m_Opts.AstDump || m_Opts.OptDump) {
@@ -835,11 +847,128 @@ int DxcContext::Compile() {
 }
 
 int DxcContext::DumpBinary() {
+  if (m_Opts.InputFiles.size() > 1)
+    return DumpBinaries();
   CComPtr<IDxcBlobEncoding> pSource;
   ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
   return ActOnBlob(pSource.p);
 }
 
+// Writes the disassembly of each binary, after a line with its file name, to
+// a file or the console.
+class DumpBinaryWriter : public IDxcDisassemblyWriter {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  const llvm::SmallVectorImpl<llvm::StringRef> &m_fileNames;
+  HANDLE m_hFile; // INVALID_HANDLE_VALUE for the console.
+  LPCWSTR m_pOutputName;
+  UINT32 m_firstIndex = 0;
+  unsigned m_failures = 0;
+
+  void Write(const char *pText, size_t size) {
+    if (m_hFile == INVALID_HANDLE_VALUE) {
+      WriteUtf8ToConsoleSizeT(pText, size);
+      return;
+    }
+    DWORD written;
+    if (FALSE == WriteFile(m_hFile, pText, size, &written, nullptr))
+      IFT_Data(HRESULT_FROM_WIN32(GetLastError()), m_pOutputName);
+  }
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DumpBinaryWriter(const llvm::SmallVectorImpl<llvm::StringRef> &fileNames,
+                   HANDLE hFile, LPCWSTR pOutputName)
+      : m_dwRef(0), m_fileNames(fileNames), m_hFile(hFile),
+        m_pOutputName(pOutputName) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcDisassemblyWriter>(this, iid, ppvObject);
+  }
+
+  // Binaries are passed to the compiler in chunks; indices are relative to
+  // the first file of the current one.
+  void SetFirstIndex(UINT32 index) { m_firstIndex = index; }
+  unsigned GetFailureCount() const { return m_failures; }
+
+  __override HRESULT STDMETHODCALLTYPE WriteDisassembly(UINT32 index,
+      HRESULT status, _In_reads_(textSize) LPCSTR pText, SIZE_T textSize) {
+    try {
+      std::string header;
+      llvm::raw_string_ostream OS(header);
+      OS << "; " << m_fileNames[m_firstIndex + index] << "\n";
+      if (FAILED(status)) {
+        ++m_failures;
+        OS << "; disassembly failed: error code "
+           << llvm::format_hex((uint32_t)status, 10) << "\n";
+      }
+      OS.flush();
+      Write(header.data(), header.size());
+      Write(pText, textSize);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+};
+
+// Disassembles every input file into one output, in the order given. Files
+// are read a chunk at a time so that large batches don't have to be held in
+// memory at once.
+int DxcContext::DumpBinaries() {
+  static const size_t ChunkSize = 1024;
+#ifdef ENABLE_SPIRV_CODEGEN
+  IFTBOOLMSG(!m_Opts.GenSPIRV, E_INVALIDARG,
+             "-spirv cannot be used when reading several binary files");
+#endif
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBatchDisassembler> pBatch;
+  IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  // Compilers that predate batch disassembly get one call per file.
+  if (FAILED(pCompiler.QueryInterface(&pBatch)))
+    pBatch = nullptr;
+
+  CHandle file;
+  StringRefUtf16 outputName(m_Opts.AssemblyCode);
+  if (!m_Opts.AssemblyCode.empty()) {
+    file.Attach(CreateFile2(outputName, GENERIC_WRITE, FILE_SHARE_READ,
+                            CREATE_ALWAYS, nullptr));
+    if (file == INVALID_HANDLE_VALUE)
+      IFT_Data(HRESULT_FROM_WIN32(GetLastError()), outputName);
+  }
+  CComPtr<DumpBinaryWriter> pWriter = new DumpBinaryWriter(
+      m_Opts.InputFiles,
+      m_Opts.AssemblyCode.empty() ? INVALID_HANDLE_VALUE : (HANDLE)file,
+      outputName);
+
+  const size_t fileCount = m_Opts.InputFiles.size();
+  for (size_t first = 0; first < fileCount; first += ChunkSize) {
+    size_t count = std::min(ChunkSize, fileCount - first);
+    std::vector<CComPtr<IDxcBlobEncoding>> sources(count);
+    std::vector<IDxcBlob *> blobs(count);
+    for (size_t i = 0; i < count; ++i) {
+      ReadFileIntoBlob(m_dxcSupport,
+                       StringRefUtf16(m_Opts.InputFiles[first + i]),
+                       &sources[i]);
+      blobs[i] = sources[i];
+    }
+
+    pWriter->SetFirstIndex(first);
+    if (pBatch) {
+      IFT(pBatch->DisassembleMany(count, blobs.data(), 0, pWriter));
+      continue;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      CComPtr<IDxcBlobEncoding> pText;
+      HRESULT status = pCompiler->Disassemble(blobs[i], &pText);
+      IFT(pWriter->WriteDisassembly(
+          i, status, pText ? (LPCSTR)pText->GetBufferPointer() : nullptr,
+          pText ? pText->GetBufferSize() : 0));
+    }
+  }
+  return pWriter->GetFailureCount() ? 1 : 0;
+}
+
 void DxcContext::Preprocess() {
   DXASSERT(!m_Opts.Preprocess.empty(), "else option reading should have failed");
   CComPtr<IDxcCompiler> pCompiler;
@@ -21,6 +21,7 @@
 #include <memory>
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcCompilerSession(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcDiaDataSource(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcIntelliSense(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLibrary(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -30,6 +31,7 @@ HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
@@ -62,6 +64,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcCompiler)) {
     hr = CreateDxcCompiler(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcCompilerSession)) {
+    hr = CreateDxcCompilerSession(riid, ppv);
+  }
   else if (IsEqualCLSID(rclsid, CLSID_DxcLibrary)) {
     hr = CreateDxcLibrary(riid, ppv);
   }
@@ -90,6 +95,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
     hr = CreateDxcContainerBuilder(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcIncludeCache)) {
+    hr = CreateDxcIncludeCache(riid, ppv);
+  }
   else {
     hr = REGDB_E_CLASSNOTREG;
   }
@@ -0,0 +1,491 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compilation results.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/dxcapi.h"
+#include "dxccompilecache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+static const uint32_t CacheFileMagic = 0x43435844; // 'DXCC'
+static const uint32_t CacheFileVersion = 2;
+static const char CacheFileExtension[] = ".dxcc";
+static const uint32_t CacheIndexMagic = 0x49435844; // 'DXCI'
+static const uint32_t CacheIndexVersion = 1;
+static const char CacheIndexFileName[] = "index.dxcci";
+// Other processes may store into the same directory, and their updates to
+// the index can race with ours; rescanning now and then bounds the drift.
+static const uint32_t CacheStoresPerScan = 256;
+
+// Entries are laid out as:
+//   DxcCompileCacheFileHeader
+//   IncludeCount x (DxcCompileCacheIncludeRecord, name bytes, padding)
+//   container, errors, debug blob, debug name (each 4-byte aligned)
+// All offsets are relative to the start of the file so that a mapped view can
+// be used directly.
+struct DxcCompileCacheFileHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint8_t Key[16];
+  uint8_t IncludeTableHash[16]; // Guards the table before it is replayed.
+  uint32_t IncludeCount;
+  uint32_t IncludeTableSize;
+  uint32_t ContainerOffset;
+  uint32_t ContainerSize;
+  uint32_t ErrorsOffset;
+  uint32_t ErrorsSize;
+  uint32_t DebugBlobOffset;
+  uint32_t DebugBlobSize;
+  uint32_t DebugNameOffset;
+  uint32_t DebugNameSize;
+};
+
+// The index keeps the total size of the entries so that a store doesn't have
+// to enumerate the directory while the cache is within its budget.
+struct DxcCompileCacheIndex {
+  uint32_t Magic;
+  uint32_t Version;
+  uint64_t TotalSize;
+  uint32_t StoresSinceScan;
+  uint32_t Reserved;
+};
+
+static const uint32_t IncludeRecordFlag_Found = 1;
+
+struct DxcCompileCacheIncludeRecord {
+  uint8_t Hash[16];
+  uint32_t Flags;
+  uint32_t NameSize; // UTF-8 bytes following the record, not null-terminated.
+};
+
+uint32_t AlignTo4(uint32_t value) { return (value + 3) & ~3u; }
+
+void HashBytes(const void *pData, size_t size, MD5::MD5Result &result) {
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pData, size));
+  md5.final(result);
+}
+
+void HashBlob(IDxcBlob *pBlob, MD5::MD5Result &result) {
+  HashBytes(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), result);
+}
+
+bool IsRangeValid(const MemoryBuffer &buffer, uint32_t offset, uint32_t size) {
+  return (uint64_t)offset + (uint64_t)size <= buffer.getBufferSize();
+}
+
+void WritePadding(raw_ostream &OS, uint32_t size) {
+  static const char zeros[4] = {0, 0, 0, 0};
+  OS.write(zeros, AlignTo4(size) - size);
+}
+
+uint32_t BlobSize(IDxcBlob *pBlob) {
+  return pBlob ? (uint32_t)pBlob->GetBufferSize() : 0;
+}
+
+void WriteBlob(raw_ostream &OS, IDxcBlob *pBlob) {
+  if (pBlob == nullptr)
+    return;
+  uint32_t size = BlobSize(pBlob);
+  OS.write((const char *)pBlob->GetBufferPointer(), size);
+  WritePadding(OS, size);
+}
+
+} // namespace
+
+namespace dxcutil {
+
+DxcCompileCacheKeyBuilder::DxcCompileCacheKeyBuilder() {
+  AddUInt32(CacheFileVersion);
+}
+
+void DxcCompileCacheKeyBuilder::AddBytes(const void *pData, size_t size) {
+  // Length-prefix every item so that adjacent values can't alias.
+  AddUInt32((uint32_t)size);
+  m_md5.update(ArrayRef<uint8_t>((const uint8_t *)pData, size));
+}
+
+void DxcCompileCacheKeyBuilder::AddString(StringRef value) {
+  AddBytes(value.data(), value.size());
+}
+
+void DxcCompileCacheKeyBuilder::AddWideString(LPCWSTR value) {
+  std::string utf8;
+  if (value != nullptr)
+    utf8 = Unicode::UTF16ToUTF8StringOrThrow(value);
+  AddString(utf8);
+}
+
+void DxcCompileCacheKeyBuilder::AddUInt32(uint32_t value) {
+  m_md5.update(ArrayRef<uint8_t>((const uint8_t *)&value, sizeof(value)));
+}
+
+void DxcCompileCacheKeyBuilder::Finish(MD5::MD5Result &key) {
+  m_md5.final(key);
+}
+
+DxcCompileCache::DxcCompileCache(StringRef directory, uint64_t maxSizeInBytes)
+    : m_directory(directory), m_maxSizeInBytes(maxSizeInBytes) {}
+
+std::string DxcCompileCache::GetEntryPath(const MD5::MD5Result &key) const {
+  static const char digits[] = "0123456789abcdef";
+  SmallString<128> path(m_directory);
+  std::string name;
+  for (unsigned i = 0; i < sizeof(MD5::MD5Result); ++i) {
+    name.push_back(digits[key[i] >> 4]);
+    name.push_back(digits[key[i] & 0xf]);
+  }
+  name += CacheFileExtension;
+  sys::path::append(path, name);
+  return path.str();
+}
+
+bool DxcCompileCache::Lookup(const MD5::MD5Result &key,
+                             IDxcIncludeHandler *pIncludeHandler,
+                             std::vector<DxcIncludedFileRecord> &loadedFiles,
+                             DxcCompileCacheResult &result,
+                             DxcCompileCacheCounters &counters) {
+  std::string entryPath = GetEntryPath(key);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> bufferOrErr = MemoryBuffer::getFile(
+      entryPath, /*FileSize*/ -1, /*RequiresNullTerminator*/ false);
+  if (!bufferOrErr) {
+    ++counters.Misses;
+    return false;
+  }
+
+  // Validate the header and every range before trusting any of the contents;
+  // entries may be truncated or written by a different version.
+  const MemoryBuffer &buffer = *bufferOrErr.get();
+  const char *pStart = buffer.getBufferStart();
+  const DxcCompileCacheFileHeader *pHeader =
+      reinterpret_cast<const DxcCompileCacheFileHeader *>(pStart);
+  if (buffer.getBufferSize() < sizeof(DxcCompileCacheFileHeader) ||
+      pHeader->Magic != CacheFileMagic ||
+      pHeader->Version != CacheFileVersion ||
+      0 != memcmp(pHeader->Key, key, sizeof(pHeader->Key)) ||
+      !IsRangeValid(buffer, sizeof(*pHeader), pHeader->IncludeTableSize) ||
+      !IsRangeValid(buffer, pHeader->ContainerOffset, pHeader->ContainerSize) ||
+      !IsRangeValid(buffer, pHeader->ErrorsOffset, pHeader->ErrorsSize) ||
+      !IsRangeValid(buffer, pHeader->DebugBlobOffset, pHeader->DebugBlobSize) ||
+      !IsRangeValid(buffer, pHeader->DebugNameOffset, pHeader->DebugNameSize) ||
+      pHeader->ContainerSize == 0) {
+    ++counters.Misses;
+    return false;
+  }
+
+  // Parse the whole include table before calling the handler, so that a
+  // damaged entry is rejected without loading anything.
+  struct IncludeRecord {
+    const DxcCompileCacheIncludeRecord *pRecord;
+    const char *pName;
+  };
+  std::vector<IncludeRecord> includes;
+  includes.reserve(pHeader->IncludeCount);
+  const char *pRecord = pStart + sizeof(*pHeader);
+  const char *pRecordEnd = pRecord + pHeader->IncludeTableSize;
+  for (uint32_t i = 0; i < pHeader->IncludeCount; ++i) {
+    if ((size_t)(pRecordEnd - pRecord) < sizeof(DxcCompileCacheIncludeRecord)) {
+      ++counters.Misses;
+      return false;
+    }
+    const DxcCompileCacheIncludeRecord *pInclude =
+        reinterpret_cast<const DxcCompileCacheIncludeRecord *>(pRecord);
+    const char *pName = pRecord + sizeof(*pInclude);
+    if ((size_t)(pRecordEnd - pName) < pInclude->NameSize ||
+        (size_t)(pRecordEnd - pName) < AlignTo4(pInclude->NameSize)) {
+      ++counters.Misses;
+      return false;
+    }
+    includes.push_back({ pInclude, pName });
+    pRecord = pName + AlignTo4(pInclude->NameSize);
+  }
+  MD5::MD5Result tableHash;
+  HashBytes(pStart + sizeof(*pHeader), pHeader->IncludeTableSize, tableHash);
+  if (0 != memcmp(tableHash, pHeader->IncludeTableHash, sizeof(tableHash)) ||
+      (!includes.empty() && pIncludeHandler == nullptr)) {
+    ++counters.Misses;
+    return false;
+  }
+
+  // Replay the include closure against the content hashes recorded when the
+  // entry was stored; any difference means the preprocessed source would
+  // differ. Every file loaded here is handed back so that the compilation
+  // that follows a miss doesn't ask the handler for it again.
+  for (const IncludeRecord &include : includes) {
+    std::wstring name;
+    if (!Unicode::UTF8ToUTF16String(include.pName, include.pRecord->NameSize,
+                                    &name)) {
+      ++counters.Misses;
+      return false;
+    }
+    CComPtr<IDxcBlob> pFileBlob;
+    if (FAILED(pIncludeHandler->LoadSource(name.c_str(), &pFileBlob))) {
+      ++counters.Misses;
+      return false;
+    }
+    CComPtr<IDxcBlobEncoding> pFileUtf8;
+    if (pFileBlob != nullptr)
+      IFT(DxcGetBlobAsUtf8(pFileBlob, &pFileUtf8));
+    loadedFiles.emplace_back();
+    loadedFiles.back().Name = std::move(name);
+    loadedFiles.back().Blob = pFileUtf8;
+
+    bool found = pFileUtf8 != nullptr;
+    if (found != ((include.pRecord->Flags & IncludeRecordFlag_Found) != 0)) {
+      ++counters.Misses;
+      return false;
+    }
+    if (found) {
+      MD5::MD5Result fileHash;
+      HashBlob(pFileUtf8, fileHash);
+      if (0 != memcmp(fileHash, include.pRecord->Hash, sizeof(fileHash))) {
+        ++counters.Misses;
+        return false;
+      }
+    }
+  }
+
+  IFT(DxcCreateBlobOnHeapCopy(pStart + pHeader->ContainerOffset,
+                              pHeader->ContainerSize, &result.Container));
+  IFT(DxcCreateBlobWithEncodingOnHeapCopy(pStart + pHeader->ErrorsOffset,
+                                          pHeader->ErrorsSize, CP_UTF8,
+                                          &result.Errors));
+  if (pHeader->DebugBlobSize) {
+    IFT(DxcCreateBlobOnHeapCopy(pStart + pHeader->DebugBlobOffset,
+                                pHeader->DebugBlobSize, &result.DebugBlob));
+  }
+  if (pHeader->DebugNameSize) {
+    result.DebugBlobName.assign(pStart + pHeader->DebugNameOffset,
+                                pHeader->DebugNameSize);
+  }
+
+  // Refresh the timestamp so eviction keeps recently used entries around.
+  // Failing to do so only affects eviction order.
+  int fd;
+  if (!sys::fs::openFileForWrite(entryPath, fd, sys::fs::F_Append)) {
+    sys::fs::setLastModificationAndAccessTime(fd, sys::TimeValue::now());
+    sys::fs::msf_close(fd);
+  }
+
+  ++counters.Hits;
+  return true;
+}
+
+void DxcCompileCache::Store(const MD5::MD5Result &key,
+                            const std::vector<DxcIncludedFileRecord> &includedFiles,
+                            const DxcCompileCacheResult &result,
+                            DxcCompileCacheCounters &counters) {
+  DXASSERT_NOMSG(result.Container != nullptr);
+  if (sys::fs::create_directories(m_directory))
+    return;
+
+  const std::string &debugName = result.DebugBlobName;
+
+  // Build the include table first: the header carries its hash, and each
+  // record carries the hash of the file contents seen by this compilation.
+  std::string includeTable;
+  {
+    raw_string_ostream TableOS(includeTable);
+    for (const DxcIncludedFileRecord &file : includedFiles) {
+      std::string name = Unicode::UTF16ToUTF8StringOrThrow(file.Name.c_str());
+      DxcCompileCacheIncludeRecord record;
+      ZeroMemory(&record, sizeof(record));
+      if (file.Blob != nullptr) {
+        record.Flags = IncludeRecordFlag_Found;
+        HashBlob(file.Blob, record.Hash);
+      }
+      record.NameSize = (uint32_t)name.size();
+      TableOS.write((const char *)&record, sizeof(record));
+      TableOS.write(name.data(), record.NameSize);
+      WritePadding(TableOS, record.NameSize);
+    }
+  }
+  uint32_t includeTableSize = (uint32_t)includeTable.size();
+
+  DxcCompileCacheFileHeader header;
+  ZeroMemory(&header, sizeof(header));
+  header.Magic = CacheFileMagic;
+  header.Version = CacheFileVersion;
+  memcpy(header.Key, key, sizeof(header.Key));
+  HashBytes(includeTable.data(), includeTable.size(), header.IncludeTableHash);
+  header.IncludeCount = (uint32_t)includedFiles.size();
+  header.IncludeTableSize = includeTableSize;
+  header.ContainerOffset = sizeof(header) + includeTableSize;
+  header.ContainerSize = BlobSize(result.Container);
+  header.ErrorsOffset = header.ContainerOffset + AlignTo4(header.ContainerSize);
+  header.ErrorsSize = BlobSize(result.Errors);
+  header.DebugBlobOffset = header.ErrorsOffset + AlignTo4(header.ErrorsSize);
+  header.DebugBlobSize = BlobSize(result.DebugBlob);
+  header.DebugNameOffset = header.DebugBlobOffset + AlignTo4(header.DebugBlobSize);
+  header.DebugNameSize = (uint32_t)debugName.size();
+
+  // Write to a unique temporary and rename into place, so that concurrent
+  // readers never observe a partially written entry.
+  std::string entryPath = GetEntryPath(key);
+  uint64_t replacedSize = 0;
+  if (sys::fs::file_size(entryPath, replacedSize))
+    replacedSize = 0;
+  SmallString<128> tempPath;
+  int fd;
+  if (sys::fs::createUniqueFile(entryPath + "-%%%%%%%%.tmp", fd, tempPath))
+    return;
+  {
+    raw_fd_ostream OS(fd, /*shouldClose*/ true);
+    OS.write((const char *)&header, sizeof(header));
+    OS.write(includeTable.data(), includeTable.size());
+    WriteBlob(OS, result.Container);
+    WriteBlob(OS, result.Errors);
+    WriteBlob(OS, result.DebugBlob);
+    OS.write(debugName.data(), debugName.size());
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(tempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(tempPath, entryPath)) {
+    sys::fs::remove(tempPath);
+    return;
+  }
+
+  ++counters.Stores;
+  uint64_t storedSize = header.DebugNameOffset + header.DebugNameSize;
+  UpdateTotalSize(storedSize, replacedSize, counters);
+}
+
+std::string DxcCompileCache::GetIndexPath() const {
+  SmallString<128> path(m_directory);
+  sys::path::append(path, CacheIndexFileName);
+  return path.str();
+}
+
+bool DxcCompileCache::ReadIndex(uint64_t &totalSize, uint32_t &storesSinceScan) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> bufferOrErr = MemoryBuffer::getFile(
+      GetIndexPath(), /*FileSize*/ -1, /*RequiresNullTerminator*/ false);
+  if (!bufferOrErr)
+    return false;
+  const MemoryBuffer &buffer = *bufferOrErr.get();
+  if (buffer.getBufferSize() != sizeof(DxcCompileCacheIndex))
+    return false;
+  DxcCompileCacheIndex index;
+  memcpy(&index, buffer.getBufferStart(), sizeof(index));
+  if (index.Magic != CacheIndexMagic || index.Version != CacheIndexVersion)
+    return false;
+  totalSize = index.TotalSize;
+  storesSinceScan = index.StoresSinceScan;
+  return true;
+}
+
+void DxcCompileCache::WriteIndex(uint64_t totalSize, uint32_t storesSinceScan) {
+  DxcCompileCacheIndex index;
+  ZeroMemory(&index, sizeof(index));
+  index.Magic = CacheIndexMagic;
+  index.Version = CacheIndexVersion;
+  index.TotalSize = totalSize;
+  index.StoresSinceScan = storesSinceScan;
+
+  // Failing to write the index only means the next store scans again.
+  std::string indexPath = GetIndexPath();
+  SmallString<128> tempPath;
+  int fd;
+  if (sys::fs::createUniqueFile(indexPath + "-%%%%%%%%.tmp", fd, tempPath))
+    return;
+  {
+    raw_fd_ostream OS(fd, /*shouldClose*/ true);
+    OS.write((const char *)&index, sizeof(index));
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(tempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(tempPath, indexPath))
+    sys::fs::remove(tempPath);
+}
+
+void DxcCompileCache::UpdateTotalSize(uint64_t storedSize,
+                                      uint64_t replacedSize,
+                                      DxcCompileCacheCounters &counters) {
+  // Without an index, or after enough stores, fall back to scanning; the scan
+  // also writes a fresh index.
+  uint64_t totalSize;
+  uint32_t storesSinceScan;
+  if (!ReadIndex(totalSize, storesSinceScan) ||
+      storesSinceScan + 1 >= CacheStoresPerScan) {
+    EvictToBudget(counters);
+    return;
+  }
+
+  totalSize = totalSize + storedSize - std::min(totalSize, replacedSize);
+  if (totalSize > m_maxSizeInBytes) {
+    EvictToBudget(counters);
+    return;
+  }
+  WriteIndex(totalSize, storesSinceScan + 1);
+}
+
+void DxcCompileCache::EvictToBudget(DxcCompileCacheCounters &counters) {
+  struct EntryInfo {
+    std::string Path;
+    uint64_t Size;
+    sys::TimeValue LastUsed;
+  };
+  std::vector<EntryInfo> entries;
+  uint64_t totalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator it(m_directory, EC), end; !EC && it != end;
+       it.increment(EC)) {
+    if (sys::path::extension(it->path()) != CacheFileExtension)
+      continue;
+    sys::fs::file_status status;
+    if (it->status(status))
+      continue;
+    entries.push_back({ it->path(), status.getSize(),
+                        status.getLastModificationTime() });
+    totalSize += status.getSize();
+  }
+  if (totalSize <= m_maxSizeInBytes) {
+    WriteIndex(totalSize, 0);
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const EntryInfo &a, const EntryInfo &b) {
+              return a.LastUsed < b.LastUsed;
+            });
+  for (const EntryInfo &entry : entries) {
+    if (totalSize <= m_maxSizeInBytes)
+      break;
+    if (!sys::fs::remove(entry.Path)) {
+      totalSize -= entry.Size;
+      ++counters.Evictions;
+    }
+  }
+  WriteIndex(totalSize, 0);
+}
+
+} // namespace dxcutil
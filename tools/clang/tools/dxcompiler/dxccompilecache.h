@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compilation results.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace dxcutil {
+
+/// Files seen by a compilation through the include handler. Files that were
+/// probed but not found are recorded as well, as a later compile would pick
+/// them up if they were to appear.
+struct DxcIncludedFileRecord {
+  std::wstring Name;
+  CComPtr<IDxcBlob> Blob; // UTF-8 contents; nullptr if not found.
+};
+
+/// Counters for cache activity, updated atomically as compilations may run
+/// concurrently on the same compiler object.
+struct DxcCompileCacheCounters {
+  std::atomic<uint64_t> Hits;
+  std::atomic<uint64_t> Misses;
+  std::atomic<uint64_t> Stores;
+  std::atomic<uint64_t> Evictions;
+  DxcCompileCacheCounters() : Hits(0), Misses(0), Stores(0), Evictions(0) {}
+};
+
+/// Compilation outputs kept in a cache entry.
+struct DxcCompileCacheResult {
+  CComPtr<IDxcBlob> Container;
+  CComPtr<IDxcBlobEncoding> Errors;
+  CComPtr<IDxcBlob> DebugBlob;
+  std::string DebugBlobName; // UTF-8
+};
+
+/// Builds the key under which a compilation is stored. The key covers every
+/// direct input to the compiler; included files are validated separately on
+/// lookup, as they are only known once the preprocessor has run.
+class DxcCompileCacheKeyBuilder {
+private:
+  llvm::MD5 m_md5;
+public:
+  DxcCompileCacheKeyBuilder();
+  void AddBytes(const void *pData, size_t size);
+  void AddString(llvm::StringRef value);
+  void AddWideString(LPCWSTR value);
+  void AddUInt32(uint32_t value);
+  void Finish(llvm::MD5::MD5Result &key);
+};
+
+/// On-disk store of compilation results, one file per key.
+///
+/// Each entry is a flat file with fixed offsets (see DxcCompileCacheFileHeader
+/// in the implementation), so lookups memory-map the file and only copy the
+/// parts handed back to the caller. When the directory grows past the size
+/// budget, the least recently used entries are removed. The total size is
+/// kept in an index file next to the entries, so the directory is only
+/// enumerated when the index is missing, the total exceeds the budget, or
+/// after a fixed number of stores.
+///
+/// The caller is expected to have an MSFileSystem for disk access installed
+/// for the current thread.
+class DxcCompileCache {
+private:
+  std::string m_directory;
+  uint64_t m_maxSizeInBytes;
+
+  std::string GetEntryPath(const llvm::MD5::MD5Result &key) const;
+  std::string GetIndexPath() const;
+  bool ReadIndex(uint64_t &totalSize, uint32_t &storesSinceScan);
+  void WriteIndex(uint64_t totalSize, uint32_t storesSinceScan);
+  void UpdateTotalSize(uint64_t storedSize, uint64_t replacedSize,
+                       DxcCompileCacheCounters &counters);
+  void EvictToBudget(DxcCompileCacheCounters &counters);
+
+public:
+  DxcCompileCache(llvm::StringRef directory, uint64_t maxSizeInBytes);
+
+  /// Looks for an entry with the given key. Returns false on a miss.
+  ///
+  /// The include closure recorded with the entry is only replayed through
+  /// pIncludeHandler once the entry is known to be intact, and is checked
+  /// against the content hashes taken when it was stored. Files loaded while
+  /// doing so are appended to loadedFiles, so that a compilation following a
+  /// miss can reuse them instead of loading them again.
+  bool Lookup(const llvm::MD5::MD5Result &key,
+              _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+              std::vector<DxcIncludedFileRecord> &loadedFiles,
+              DxcCompileCacheResult &result,
+              DxcCompileCacheCounters &counters);
+
+  /// Stores the outputs of a successful compilation.
+  void Store(const llvm::MD5::MD5Result &key,
+             const std::vector<DxcIncludedFileRecord> &includedFiles,
+             const DxcCompileCacheResult &result,
+             DxcCompileCacheCounters &counters);
+};
+
+} // namespace dxcutil
@@ -27,7 +27,10 @@
 #include "dxc/HLSL/DxilPipelineStateValidation.h"
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/HLSL/DxilUtil.h"
+#include "llvm/Support/MSFileSystem.h"
 #include "dxcutil.h"
+#include <condition_variable>
+#include <mutex>
 
 using namespace llvm;
 using namespace hlsl;
@@ -1350,3 +1353,143 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
   return S_OK;
 }
 }
+
+namespace {
+// Shared by the threads of a DisassembleMany call. Programs are claimed in
+// order, and no further than Window ahead of the first one not written yet,
+// which bounds the texts waiting to be written.
+struct DisassembleManyState {
+  IMalloc *pMalloc;
+  IDxcBlob **ppBlobs;
+  UINT32 Count;
+  UINT32 Window;
+  IDxcDisassemblyWriter *pWriter;
+
+  struct Result {
+    bool Done = false;
+    HRESULT Status = E_FAIL;
+    std::string Text;
+  };
+  std::mutex Lock;
+  std::condition_variable CanClaim;
+  std::vector<Result> Results;
+  UINT32 NextToClaim = 0;
+  UINT32 NextToWrite = 0;
+  bool Writing = false;
+  HRESULT WriterStatus = S_OK;
+
+  bool Claim(UINT32 *pIndex);
+  void Complete(UINT32 Index, HRESULT Status, std::string &&Text);
+};
+} // namespace
+
+bool DisassembleManyState::Claim(UINT32 *pIndex) {
+  std::unique_lock<std::mutex> lock(Lock);
+  CanClaim.wait(lock, [this]() {
+    return NextToClaim >= Count || FAILED(WriterStatus) ||
+           NextToClaim - NextToWrite < Window;
+  });
+  if (NextToClaim >= Count || FAILED(WriterStatus))
+    return false;
+  *pIndex = NextToClaim++;
+  return true;
+}
+
+void DisassembleManyState::Complete(UINT32 Index, HRESULT Status,
+                                    std::string &&Text) {
+  std::unique_lock<std::mutex> lock(Lock);
+  Results[Index].Done = true;
+  Results[Index].Status = Status;
+  Results[Index].Text = std::move(Text);
+  // A single thread writes at a time; results completed meanwhile are
+  // picked up by the loop below.
+  if (Writing)
+    return;
+  Writing = true;
+  while (SUCCEEDED(WriterStatus) && NextToWrite < Count &&
+         Results[NextToWrite].Done) {
+    UINT32 i = NextToWrite;
+    std::string text;
+    text.swap(Results[i].Text);
+    lock.unlock();
+    HRESULT hr = pWriter->WriteDisassembly(i, Results[i].Status, text.data(),
+                                           text.size());
+    lock.lock();
+    ++NextToWrite;
+    if (FAILED(hr))
+      WriterStatus = hr;
+    CanClaim.notify_all();
+  }
+  Writing = false;
+}
+
+static DWORD WINAPI DisassembleManyThreadProc(LPVOID pParam) {
+  DisassembleManyState *pState =
+      reinterpret_cast<DisassembleManyState *>(pParam);
+  // Texts are handed to the writer from this thread, so allocations must go
+  // to the same IMalloc as the calling thread's.
+  DxcThreadMalloc TM(pState->pMalloc);
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf;
+  std::unique_ptr<::llvm::sys::fs::AutoPerThreadSystem> pts;
+  UINT32 i;
+  while (pState->Claim(&i)) {
+    HRESULT hr = S_OK;
+    std::string text;
+    try {
+      if (!msf) {
+        ::llvm::sys::fs::MSFileSystem *msfPtr;
+        IFT(CreateMSFileSystemForDisk(&msfPtr));
+        msf.reset(msfPtr);
+        pts.reset(new ::llvm::sys::fs::AutoPerThreadSystem(msf.get()));
+        IFTLLVM(pts->error_code());
+      }
+      // Each program is loaded into a context of its own. Named struct types
+      // are uniqued per context, so a reused one would rename them
+      // (dx.types.Handle.0 and so on) in later disassemblies.
+      raw_string_ostream Stream(text);
+      IFT(dxcutil::Disassemble(pState->ppBlobs[i], Stream));
+      Stream.flush();
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr))
+      text.clear();
+    pState->Complete(i, hr, std::move(text));
+  }
+  return 0;
+}
+
+namespace dxcutil {
+HRESULT DisassembleMany(IMalloc *pMalloc, UINT32 blobCount, IDxcBlob **ppBlobs,
+                        UINT32 threadCount, IDxcDisassemblyWriter *pWriter) {
+  if (threadCount == 0) {
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    threadCount = sysInfo.dwNumberOfProcessors;
+  }
+  threadCount = std::max<UINT32>(1, std::min<UINT32>(threadCount, blobCount));
+
+  DisassembleManyState state;
+  state.pMalloc = pMalloc;
+  state.ppBlobs = ppBlobs;
+  state.Count = blobCount;
+  state.Window = threadCount * 4;
+  state.pWriter = pWriter;
+  state.Results.resize(blobCount);
+
+  std::vector<HANDLE> threads;
+  for (UINT32 i = 1; i < threadCount; ++i) {
+    HANDLE hThread = CreateThread(nullptr, 0, DisassembleManyThreadProc,
+                                  &state, 0, nullptr);
+    // If a thread can't be started, the others pick up its share.
+    if (hThread == nullptr)
+      break;
+    threads.push_back(hThread);
+  }
+  DisassembleManyThreadProc(&state);
+  for (HANDLE hThread : threads) {
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+  }
+  return state.WriterStatus;
+}
+}
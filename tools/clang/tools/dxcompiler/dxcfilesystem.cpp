@@ -18,10 +18,13 @@
 #include "dxc/dxcapi.h"
 #include "llvm/Support/raw_ostream.h"
 #include "dxcutil.h"
+#include "dxccompilecache.h"
 
 #include "dxc/Support/dxcfilesystem.h"
 #include "dxc/Support/Unicode.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace llvm;
 using namespace hlsl;
@@ -74,8 +77,8 @@ enum class SpecialValue {
   Output = 4
 };
 struct HandleBits {
-  unsigned Offset : 8;
-  unsigned Length : 8;
+  unsigned Offset : 16;
+  unsigned Length : 12;
   unsigned Kind : 4;
 };
 struct DxcArgsHandle {
@@ -120,10 +123,10 @@ const DxcArgsHandle StdOutHandle(SpecialValue::StdOut);
 const DxcArgsHandle StdErrHandle(SpecialValue::StdErr);
 const DxcArgsHandle OutputHandle(SpecialValue::Output);
 
-/// Max number of included files (1:1 to their directories) or search directories.
-/// If programs include more than a handful, DxcArgsFileSystem will need to do better than linear scans.
+/// Max number of included files (1:1 to their directories) or search directories,
+/// as bounded by the index bits of a handle.
 /// If this is fired, ERROR_OUT_OF_STRUCTURES will be returned by an attempt to open a file.
-static const size_t MaxIncludedFiles = 1000;
+static const size_t MaxIncludedFiles = 1 << 16;
 
 bool IsAbsoluteOrCurDirRelativeW(LPCWSTR Path) {
   if (!Path || !Path[0]) return FALSE;
@@ -212,47 +215,70 @@ private:
       : Name(name), Blob(pBlob), BlobStream(pStream) { }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
-
-  static bool IsDirOf(LPCWSTR lpDir, size_t dirLen, const std::wstring &fileName) {
-    if (fileName.size() <= dirLen) return false;
-    if (0 != wcsncmp(lpDir, fileName.data(), dirLen)) return false;
-
-    // Prefix matches, c:\\ to c:\\foo.hlsl or ./bar to ./bar/file.hlsl
-    // Ensure there are no additional characters, don't match ./ba if ./bar.hlsl exists
-    if (lpDir[dirLen - 1] == '\\' || lpDir[dirLen - 1] == '/') {
-      // The file name was already terminated in a separator.
-      return true;
+  // Names the include handler was asked for but could not provide, in the
+  // order they were first requested.
+  std::vector<std::wstring> m_missingFiles;
+  std::unordered_set<std::wstring> m_missingFileSet;
+  // Files loaded through the include handler before the compilation
+  // started, such as while checking a compile cache entry.
+  std::unordered_map<std::wstring, CComPtr<IDxcBlob>> m_preloadedFiles;
+
+  // Lookup tables so that large include sets don't turn every open and
+  // attribute query into a scan over all files seen so far. Directory maps
+  // hold every directory prefix of a name and point at the first entry that
+  // has it, which is the entry a scan in insertion order would have found.
+  typedef std::unordered_map<std::wstring, size_t> NameIndexMap;
+  NameIndexMap m_includedFileIndex;
+  NameIndexMap m_includedFileDirs;
+  NameIndexMap m_searchEntryDirs;
+
+  static bool IsSeparator(wchar_t ch) { return ch == L'\\' || ch == L'/'; }
+
+  // Registers the directories a path is in: for c:\\a\\b.hlsl these are
+  // c:, c:\\, c:\\a and c:\\a\\, matching either spelling of a directory.
+  static void AddDirPrefixes(const std::wstring &path, size_t index,
+                             NameIndexMap &dirs) {
+    for (size_t i = 0; i < path.size(); ++i) {
+      if (!IsSeparator(path[i]))
+        continue;
+      if (i > 0)
+        dirs.emplace(path.substr(0, i), index);
+      if (i + 1 < path.size())
+        dirs.emplace(path.substr(0, i + 1), index);
     }
+  }
 
-    return fileName.data()[dirLen] == '\\' || fileName.data()[dirLen] == '/';
+  void AddIncludedFile(std::wstring &&name, IDxcBlob *pBlob, IStream *pStream) {
+    size_t index = m_includedFiles.size();
+    m_includedFileIndex.emplace(name, index);
+    AddDirPrefixes(name, index, m_includedFileDirs);
+    m_includedFiles.emplace_back(std::move(name), pBlob, pStream);
   }
 
-  static bool IsDirPrefixOrSame(LPCWSTR lpDir, size_t dirLen, const std::wstring &path) {
-    if (0 == wcscmp(lpDir, path.c_str())) return true;
-    return IsDirOf(lpDir, dirLen, path);
+  void AddSearchEntry(std::wstring &&path) {
+    size_t index = m_searchEntries.size();
+    AddDirPrefixes(path, index, m_searchEntryDirs);
+    m_searchEntryDirs.emplace(path, index);
+    m_searchEntries.emplace_back(std::move(path));
   }
 
   HANDLE TryFindDirHandle(LPCWSTR lpDir) const {
-    size_t dirLen = wcslen(lpDir);
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      const std::wstring &fileName = m_includedFiles[i].Name;
-      if (IsDirOf(lpDir, dirLen, fileName)) {
-        return DxcArgsHandle(HandleKind::FileDir, i, dirLen).Handle;
-      }
+    std::wstring dir(lpDir);
+    NameIndexMap::const_iterator it = m_includedFileDirs.find(dir);
+    if (it != m_includedFileDirs.end()) {
+      return DxcArgsHandle(HandleKind::FileDir, it->second, dir.size()).Handle;
     }
-    for (size_t i = 0; i < m_searchEntries.size(); ++i) {
-      if (IsDirPrefixOrSame(lpDir, dirLen, m_searchEntries[i])) {
-        return DxcArgsHandle(HandleKind::SearchDir, i, dirLen).Handle;
-      }
+    it = m_searchEntryDirs.find(dir);
+    if (it != m_searchEntryDirs.end()) {
+      return DxcArgsHandle(HandleKind::SearchDir, it->second, dir.size()).Handle;
     }
     return INVALID_HANDLE_VALUE;
   }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
-        index = i;
-        return ERROR_SUCCESS;
-      }
+    NameIndexMap::const_iterator it = m_includedFileIndex.find(lpFileName);
+    if (it != m_includedFileIndex.end()) {
+      index = it->second;
+      return ERROR_SUCCESS;
     }
 
     if (m_includeLoader.p != nullptr) {
@@ -261,9 +287,15 @@ private:
       }
 
       CComPtr<::IDxcBlob> fileBlob;
-      HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
-      if (FAILED(hr)) {
-        return ERROR_UNHANDLED_EXCEPTION;
+      auto preloaded = m_preloadedFiles.find(lpFileName);
+      if (preloaded != m_preloadedFiles.end()) {
+        fileBlob = preloaded->second;
+      }
+      else {
+        HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
+        if (FAILED(hr)) {
+          return ERROR_UNHANDLED_EXCEPTION;
+        }
       }
       if (fileBlob.p != nullptr) {
         CComPtr<IDxcBlobEncoding> fileBlobEncoded;
@@ -274,7 +306,7 @@ private:
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobEncoded, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
-        m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobEncoded, fileStream);
+        AddIncludedFile(std::wstring(lpFileName), fileBlobEncoded, fileStream);
         index = m_includedFiles.size() - 1;
 
         if (m_bDisplayIncludeProcess) {
@@ -290,6 +322,9 @@ private:
         }
         return ERROR_SUCCESS;
       }
+      if (m_missingFileSet.insert(lpFileName).second) {
+        m_missingFiles.emplace_back(lpFileName);
+      }
     }
     return ERROR_NOT_FOUND;
   }
@@ -311,7 +346,7 @@ public:
         m_pOutputStreamName(nullptr) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
-    m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
+    AddIncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream);
   }
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
@@ -367,16 +402,35 @@ public:
     for (unsigned i = 0, e = entries.size(); i != e; ++i) {
       const clang::HeaderSearchOptions::Entry &E = entries[i];
       if (IsAbsoluteOrCurDirRelative(E.Path.c_str())) {
-        m_searchEntries.emplace_back(Unicode::UTF8ToUTF16StringOrThrow(E.Path.c_str()));
+        AddSearchEntry(Unicode::UTF8ToUTF16StringOrThrow(E.Path.c_str()));
       }
       else {
         std::wstring ws(L"./");
         ws += Unicode::UTF8ToUTF16StringOrThrow(E.Path.c_str());
-        m_searchEntries.emplace_back(std::move(ws));
+        AddSearchEntry(std::move(ws));
       }
     }
   }
 
+  void GetIncludedFiles(std::vector<DxcIncludedFileRecord> &files) override {
+    // The first entry is the main source, which isn't provided by the handler.
+    for (size_t i = 1; i < m_includedFiles.size(); ++i) {
+      files.emplace_back();
+      files.back().Name = m_includedFiles[i].Name;
+      files.back().Blob = m_includedFiles[i].Blob;
+    }
+    for (const std::wstring &name : m_missingFiles) {
+      files.emplace_back();
+      files.back().Name = name;
+    }
+  }
+
+  void AddPreloadedFiles(std::vector<DxcIncludedFileRecord> &files) override {
+    for (DxcIncludedFileRecord &file : files) {
+      m_preloadedFiles.emplace(std::move(file.Name), file.Blob);
+    }
+  }
+
   HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) override {
     DXASSERT(m_pOutputStream.p == nullptr, "else multiple outputs registered");
     m_pOutputStream = pStream;
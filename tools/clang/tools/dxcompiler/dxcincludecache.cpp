@@ -0,0 +1,398 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincludecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements a cache of included files shared between compilations.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+
+#include "llvm/Support/MD5.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+struct DxcIncludeCacheEntry {
+  CComPtr<IDxcBlobEncoding> Blob; // UTF-8 contents; nullptr if not found.
+  MD5::MD5Result Hash;            // Hash of Blob, if any.
+  // Set for files the cache looked for on disk itself, found or not.
+  bool FromDisk = false;
+  FILETIME LastWriteTime;
+  uint64_t FileSize = 0;
+  // Set for entries kept for one inner handler, so that the handler's
+  // address in the key isn't reused by another handler while the entry lives.
+  CComPtr<IDxcIncludeHandler> Owner;
+};
+
+typedef std::shared_ptr<const DxcIncludeCacheEntry> DxcIncludeCacheEntryPtr;
+
+static void ReturnBlob(IDxcBlobEncoding *pBlob, IDxcBlob **ppResult) {
+  if (pBlob != nullptr)
+    pBlob->AddRef();
+  *ppResult = pBlob;
+}
+
+static bool IsNotFoundError(DWORD error) {
+  return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+}
+
+static void HashBlob(IDxcBlob *pBlob, MD5::MD5Result &hash) {
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                               pBlob->GetBufferSize()));
+  md5.final(hash);
+}
+
+// Files whose size or last write time keep changing while they are read are
+// given up on after this many attempts.
+static const unsigned kMaxFileReadAttempts = 3;
+
+// Reads a copy of a file from disk into the entry, so that later changes to
+// the file neither reach the cached contents nor are blocked by the cache. A
+// missing file leaves the entry's blob null.
+static HRESULT ReadFileIntoEntry(LPCWSTR pFileName,
+                                 DxcIncludeCacheEntry &entry) {
+  entry.FromDisk = true;
+  HANDLE hFile = CreateFileW(pFileName, GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                 FILE_SHARE_DELETE,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    DWORD error = GetLastError();
+    return IsNotFoundError(error) ? S_OK : HRESULT_FROM_WIN32(error);
+  }
+  CHandle file(hFile);
+
+  // Others may write to the file while it is read; the copy is only kept if
+  // the size and last write time are the same before and after reading.
+  for (unsigned attempt = 0; attempt < kMaxFileReadAttempts; ++attempt) {
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(hFile, &info)) {
+      return HRESULT_FROM_WIN32(GetLastError());
+    }
+    if (info.nFileSizeHigh != 0) {
+      return DXC_E_INPUT_FILE_TOO_LARGE;
+    }
+
+    // The blob frees the copy with the thread's allocator, which is the
+    // cache's while loading.
+    IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+    char *pData = (char *)pMalloc->Alloc(info.nFileSizeLow);
+    if (pData == nullptr && info.nFileSizeLow != 0) {
+      return E_OUTOFMEMORY;
+    }
+    DWORD bytesRead = 0;
+    LARGE_INTEGER start = {};
+    BY_HANDLE_FILE_INFORMATION after;
+    if (!SetFilePointerEx(hFile, start, nullptr, FILE_BEGIN) ||
+        !ReadFile(hFile, pData, info.nFileSizeLow, &bytesRead, nullptr) ||
+        !GetFileInformationByHandle(hFile, &after)) {
+      HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+      pMalloc->Free(pData);
+      return hr;
+    }
+    if (bytesRead != info.nFileSizeLow ||
+        after.nFileSizeHigh != info.nFileSizeHigh ||
+        after.nFileSizeLow != info.nFileSizeLow ||
+        0 != CompareFileTime(&after.ftLastWriteTime, &info.ftLastWriteTime)) {
+      pMalloc->Free(pData);
+      continue;
+    }
+
+    entry.LastWriteTime = info.ftLastWriteTime;
+    entry.FileSize = info.nFileSizeLow;
+    if (info.nFileSizeLow == 0) {
+      pMalloc->Free(pData);
+      IFR(DxcCreateBlobWithEncodingOnHeapCopy("", 0, CP_UTF8, &entry.Blob));
+    } else {
+      CComPtr<IDxcBlob> pBlob;
+      HRESULT hr = DxcCreateBlobOnHeap(pData, bytesRead, &pBlob);
+      if (FAILED(hr)) {
+        pMalloc->Free(pData);
+        return hr;
+      }
+      IFR(DxcGetBlobAsUtf8(pBlob, &entry.Blob));
+    }
+    HashBlob(entry.Blob, entry.Hash);
+    return S_OK;
+  }
+  return HRESULT_FROM_WIN32(ERROR_SHARING_VIOLATION);
+}
+
+// Checks whether a file read from disk still has the size and last write
+// time it was read with, or is still missing.
+static bool IsDiskEntryCurrent(LPCWSTR pFileName,
+                               const DxcIncludeCacheEntry &entry) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(pFileName, GetFileExInfoStandard, &data)) {
+    return entry.Blob == nullptr && IsNotFoundError(GetLastError());
+  }
+  if (entry.Blob == nullptr ||
+      (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+    return false;
+  }
+  uint64_t size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+  return size == entry.FileSize &&
+         0 == CompareFileTime(&data.ftLastWriteTime, &entry.LastWriteTime);
+}
+
+// Entries beyond this are evicted, oldest insertion first.
+static const size_t kMaxIncludeCacheEntries = 8192;
+
+static bool IsPathSeparator(wchar_t ch) { return ch == L'\\' || ch == L'/'; }
+
+// Spells a file name the same way however the include was written: one kind
+// of separator, no repeated separators and no '.' components, with '..'
+// applied where there is a component to remove. Case is kept, as inner
+// handlers need not be case-insensitive.
+static void AppendNormalizedFileName(LPCWSTR pFilename, std::wstring &key) {
+  size_t start = key.size();
+  std::vector<size_t> components;
+  LPCWSTR p = pFilename;
+  if (IsPathSeparator(*p)) {
+    // Keep the root, and the second separator of a UNC name.
+    key += L'\\';
+    ++p;
+    if (IsPathSeparator(*p)) {
+      key += L'\\';
+      ++p;
+    }
+  }
+  size_t rootEnd = key.size();
+  while (*p) {
+    LPCWSTR end = p;
+    while (*end && !IsPathSeparator(*end))
+      ++end;
+    size_t len = end - p;
+    if (len == 1 && p[0] == L'.') {
+      // Current directory; only kept when it is all there is.
+      if (*end == L'\0' && key.size() == rootEnd && components.empty())
+        key += L'.';
+    } else if (len == 2 && p[0] == L'.' && p[1] == L'.' &&
+               !components.empty() &&
+               key.compare(components.back(), std::wstring::npos, L"..") != 0) {
+      key.resize(components.back());
+      components.pop_back();
+      if (key.size() > rootEnd)
+        key.pop_back(); // The separator before the removed component.
+    } else if (len != 0) {
+      if (key.size() > rootEnd)
+        key += L'\\';
+      components.push_back(key.size());
+      key.append(p, len);
+    }
+    p = *end ? end + 1 : end;
+  }
+  if (key.size() == start)
+    key += L'.';
+}
+
+class DxcIncludeCache : public IDxcIncludeCache {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::mutex m_lock;
+  // Keys are the entry kind, the namespace and the normalized file name.
+  std::unordered_map<std::wstring, DxcIncludeCacheEntryPtr> m_entries;
+  std::deque<std::wstring> m_insertionOrder;
+
+  static std::wstring GetKey(bool fromDisk, const std::wstring &nameSpace,
+                             LPCWSTR pFilename) {
+    // Files read from disk and files from inner handlers are never mixed, and
+    // the namespace is terminated so it can't run into the file name.
+    std::wstring key(1, fromDisk ? L'D' : L'H');
+    key += nameSpace;
+    key += L'\0';
+    AppendNormalizedFileName(pFilename, key);
+    return key;
+  }
+
+  void StoreEntry(const std::wstring &key, DxcIncludeCacheEntryPtr pEntry) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto inserted = m_entries.emplace(key, pEntry);
+    if (!inserted.second) {
+      inserted.first->second = pEntry;
+      return;
+    }
+    m_insertionOrder.push_back(key);
+    while (m_entries.size() > kMaxIncludeCacheEntries) {
+      m_entries.erase(m_insertionOrder.front());
+      m_insertionOrder.pop_front();
+    }
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcIncludeCache)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeCache>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE CreateIncludeHandler(
+      _In_opt_ IDxcIncludeHandler *pInnerHandler, _In_opt_z_ LPCWSTR pNamespace,
+      UINT32 flags, _COM_Outptr_ IDxcIncludeHandler **ppResult);
+
+  __override HRESULT STDMETHODCALLTYPE Clear() {
+    DxcThreadMalloc TM(m_pMalloc);
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries.clear();
+    m_insertionOrder.clear();
+    return S_OK;
+  }
+
+  // Entries in a per-handler namespace keep pInnerHandler alive.
+  HRESULT Load(const std::wstring &nameSpace, bool perHandler,
+               IDxcIncludeHandler *pInnerHandler, UINT32 flags,
+               LPCWSTR pFilename, IDxcBlob **ppIncludeSource) {
+    std::wstring key = GetKey(pInnerHandler == nullptr, nameSpace, pFilename);
+
+    DxcIncludeCacheEntryPtr pCached;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      auto it = m_entries.find(key);
+      if (it != m_entries.end())
+        pCached = it->second;
+    }
+
+    if (pCached != nullptr &&
+        (flags & DxcIncludeCacheFlags_ValidateContent) == 0) {
+      if ((flags & DxcIncludeCacheFlags_ValidateTimestamp) == 0 ||
+          !pCached->FromDisk ||
+          IsDiskEntryCurrent(pFilename, *pCached)) {
+        ReturnBlob(pCached->Blob, ppIncludeSource);
+        return S_OK;
+      }
+    }
+
+    // Loading is done outside the lock, so concurrent compilations that miss
+    // on the same file may both load it; the last one stored wins.
+    std::shared_ptr<DxcIncludeCacheEntry> pEntry =
+        std::make_shared<DxcIncludeCacheEntry>();
+    if (pInnerHandler != nullptr) {
+      CComPtr<IDxcBlob> pBlob;
+      IFR(pInnerHandler->LoadSource(pFilename, &pBlob));
+      if (pBlob != nullptr) {
+        IFR(DxcGetBlobAsUtf8(pBlob, &pEntry->Blob));
+        HashBlob(pEntry->Blob, pEntry->Hash);
+      }
+    } else {
+      IFR(ReadFileIntoEntry(pFilename, *pEntry));
+    }
+    if (perHandler)
+      pEntry->Owner = pInnerHandler;
+
+    // Keep serving the cached copy while the contents are unchanged.
+    if (pCached != nullptr && pCached->Blob != nullptr &&
+        pEntry->Blob != nullptr &&
+        0 == memcmp(pCached->Hash, pEntry->Hash, sizeof(pEntry->Hash))) {
+      ReturnBlob(pCached->Blob, ppIncludeSource);
+      return S_OK;
+    }
+
+    StoreEntry(key, pEntry);
+    ReturnBlob(pEntry->Blob, ppIncludeSource);
+    return S_OK;
+  }
+};
+
+// Include handler handed out by DxcIncludeCache; it allocates from the
+// cache's IMalloc, as the entries outlive the compilation that loaded them.
+class DxcCachingIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<DxcIncludeCache> m_pCache;
+  CComPtr<IDxcIncludeHandler> m_pInnerHandler;
+  std::wstring m_namespace;
+  bool m_perHandler;
+  UINT32 m_flags;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcCachingIncludeHandler)
+  DxcCachingIncludeHandler(IMalloc *pMalloc, DxcIncludeCache *pCache,
+                           IDxcIncludeHandler *pInnerHandler,
+                           LPCWSTR pNamespace, UINT32 flags)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pCache(pCache),
+        m_pInnerHandler(pInnerHandler), m_perHandler(false), m_flags(flags) {
+    // Named namespaces start with 'N'. Without a name, files loaded through
+    // an inner handler are only shared with handlers created for the same
+    // inner handler, which is identified by its address.
+    if (pNamespace != nullptr) {
+      m_namespace = L'N';
+      m_namespace += pNamespace;
+    } else if (pInnerHandler != nullptr) {
+      m_namespace = L'P';
+      m_namespace += std::to_wstring((uintptr_t)pInnerHandler);
+      m_perHandler = true;
+    }
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_POINTER;
+    *ppIncludeSource = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      return m_pCache->Load(m_namespace, m_perHandler, m_pInnerHandler,
+                            m_flags, pFilename, ppIncludeSource);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcIncludeCache::CreateIncludeHandler(
+    _In_opt_ IDxcIncludeHandler *pInnerHandler, _In_opt_z_ LPCWSTR pNamespace,
+    UINT32 flags, _COM_Outptr_ IDxcIncludeHandler **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  if ((flags & ~DxcIncludeCacheFlags_ValidMask) != 0)
+    return E_INVALIDARG;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<DxcCachingIncludeHandler> pHandler =
+        DxcCachingIncludeHandler::Alloc(m_pMalloc, this, pInnerHandler,
+                                        pNamespace, flags);
+    IFROOM(pHandler.p);
+    *ppResult = pHandler.Detach();
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+} // namespace
+
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  *ppv = nullptr;
+  try {
+    CComPtr<DxcIncludeCache> result(
+        DxcIncludeCache::Alloc(DxcGetThreadMallocNoRef()));
+    IFROOM(result.p);
+    return result.p->QueryInterface(riid, ppv);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
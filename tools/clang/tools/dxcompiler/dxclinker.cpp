@@ -21,6 +21,7 @@
 
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <atomic>
 
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/HLSL/DxilValidation.h"
@@ -33,6 +34,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 
@@ -42,7 +44,35 @@ using namespace llvm;
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcLinker : public IDxcLinker, public IDxcContainerEvent {
+class DxcLinker;
+
+namespace {
+// State for linking one entry point, from the linked bitcode through to the
+// operation result.
+struct DxcLinkEntry {
+  CW2A Utf8EntryPoint;
+  CW2A Utf8TargetProfile;
+  CComPtr<AbstractMemoryStream> pOutputStream; // Bitcode of the linked module.
+  CComPtr<AbstractMemoryStream> pDiagStream;
+  CComPtr<IDxcBlob> pOutputBlob;
+  bool hasErrorOccurred = false;
+  HRESULT valHR = E_FAIL; // Validation status; set once validated.
+  HRESULT hr = S_OK;      // Failure to validate and assemble.
+
+  DxcLinkEntry(LPCWSTR pEntryName, LPCWSTR pTargetProfile)
+      : Utf8EntryPoint(pEntryName, CP_UTF8),
+        Utf8TargetProfile(pTargetProfile, CP_UTF8) {}
+};
+
+struct DxcLinkWorker {
+  DxcLinker *pLinker;
+  IMalloc *pMalloc;
+  std::vector<std::unique_ptr<DxcLinkEntry>> *pEntries;
+  std::atomic<unsigned> *pNext;
+};
+} // namespace
+
+class DxcLinker : public IDxcLinker2, public IDxcContainerEvent {
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcLinker)
@@ -68,6 +98,27 @@ public:
           *ppResult // Linker output status, buffer, and errors
   );
 
+  // Links several entry points against the same libraries.
+  __override HRESULT STDMETHODCALLTYPE LinkMany(
+      _In_ UINT32 entryCount, // Number of entry points to link
+      _In_count_(entryCount)
+          const LPCWSTR *pEntryNames, // Array of entry point names
+      _In_count_(entryCount)
+          const LPCWSTR *pTargetProfiles, // Shader profile for each entry point
+      _In_count_(libCount)
+          const LPCWSTR *pLibNames, // Array of library names to link
+      UINT32 libCount,              // Number of libraries to link
+      _In_count_(argCount)
+          const LPCWSTR *pArguments, // Array of pointers to arguments
+      _In_ UINT32 argCount,          // Number of arguments
+      _Out_writes_(entryCount) IDxcOperationResult *
+          *ppResults // Linker output status, buffer, and errors per entry
+  );
+
+  // Validates and assembles a linked module loaded from the entry's bitcode
+  // in a context of its own; called on worker threads by LinkMany.
+  void ValidateEntryInOwnContext(IMalloc *pMalloc, DxcLinkEntry &entry);
+
   __override HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(
       IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) {
     DxcThreadMalloc TM(m_pMalloc);
@@ -87,13 +138,16 @@ public:
   }
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcLinker>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcLinker, IDxcLinker2>(this, riid,
+                                                         ppvObject);
   }
 
   void Initialize() {
-    UINT32 valMajor, valMinor;
-    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
-    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, valMajor, valMinor));
+    // The validator is kept for the lifetime of the linker, so that linking
+    // again only validates the functions that changed.
+    dxcutil::CreateValidatorInstance(m_validator, /*bCacheValidation*/ true);
+    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, m_validator.Major,
+                                             m_validator.Minor));
   }
 
   ~DxcLinker() {
@@ -104,9 +158,18 @@ public:
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   LLVMContext m_Ctx;
+
+  bool AttachLibs(const LPCWSTR *pLibNames, UINT32 libCount);
+  std::unique_ptr<Module> LinkEntry(IMalloc *pMalloc, DxcLinkEntry &entry);
+  void ValidateEntry(IMalloc *pMalloc, DxcLinkEntry &entry,
+                     std::unique_ptr<Module> pM, raw_ostream &DiagStream);
+  void CreateEntryResult(DxcLinkEntry &entry,
+                         _COM_Outptr_ IDxcOperationResult **ppResult);
+
   std::unique_ptr<DxilLinker> m_pLinker;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
   std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  dxcutil::DxcValidatorInstance m_validator;
 };
 
 HRESULT
@@ -148,6 +211,122 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
   }
 }
 
+// Detaches previously attached libraries and attaches the given ones.
+bool DxcLinker::AttachLibs(const LPCWSTR *pLibNames, UINT32 libCount) {
+  m_pLinker->DetachAll();
+  bool bSuccess = true;
+  for (unsigned i = 0; i < libCount; i++) {
+    CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
+    bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+  }
+  return bSuccess;
+}
+
+// Links the entry point against the attached libraries and writes the
+// bitcode of the linked module to the entry's output stream. Link errors are
+// reported through the diagnostic handler of the linker's context.
+std::unique_ptr<Module> DxcLinker::LinkEntry(IMalloc *pMalloc,
+                                             DxcLinkEntry &entry) {
+  IFT(CreateMemoryStream(pMalloc, &entry.pOutputStream));
+
+  std::unique_ptr<Module> pM = m_pLinker->Link(
+      entry.Utf8EntryPoint.m_psz, entry.Utf8TargetProfile.m_psz);
+  if (!pM) {
+    entry.hasErrorOccurred = true;
+    return nullptr;
+  }
+
+  raw_stream_ostream outStream(entry.pOutputStream.p);
+  // Create bitcode of M.
+  WriteBitcodeToFile(pM.get(), outStream);
+  outStream.flush();
+  return pM;
+}
+
+// Validates the linked module and assembles it into a container, replacing
+// the bitcode in the entry's output stream.
+void DxcLinker::ValidateEntry(IMalloc *pMalloc, DxcLinkEntry &entry,
+                              std::unique_ptr<Module> pM,
+                              raw_ostream &DiagStream) {
+  const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+      new clang::DiagnosticIDs);
+  IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+      new clang::DiagnosticOptions();
+  // Construct our diagnostic client.
+  clang::TextDiagnosticPrinter *DiagClient =
+      new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+  clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+  // Validation.
+  entry.valHR = dxcutil::ValidateAndAssembleToContainer(
+      std::move(pM), entry.pOutputBlob, pMalloc, SerializeDxilFlags::None,
+      entry.pOutputStream,
+      /*bDebugInfo*/ false, Diag, &m_validator);
+
+  entry.hasErrorOccurred = Diag.hasErrorOccurred();
+}
+
+void DxcLinker::ValidateEntryInOwnContext(IMalloc *pMalloc,
+                                          DxcLinkEntry &entry) {
+  try {
+    // The linked module was written out in the linker's context; it's read
+    // back into a context of its own so entries can be validated
+    // concurrently.
+    LLVMContext Ctx;
+    raw_stream_ostream DiagStream(entry.pDiagStream);
+    llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    PrintDiagnosticContext DiagContext(DiagPrinter);
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                             &DiagContext, true);
+
+    StringRef bitcode((const char *)entry.pOutputStream->GetPtr(),
+                      entry.pOutputStream->GetPtrSize());
+    ErrorOr<std::unique_ptr<Module>> pM =
+        parseBitcodeFile(MemoryBufferRef(bitcode, "linked"), Ctx);
+    IFTBOOL(pM, DXC_E_IR_VERIFICATION_FAILED);
+    ValidateEntry(pMalloc, entry, std::move(pM.get()), DiagStream);
+  } catch (hlsl::Exception &e) {
+    entry.hr = e.hr;
+  } catch (std::bad_alloc &) {
+    entry.hr = E_OUTOFMEMORY;
+  } catch (...) {
+    entry.hr = E_FAIL;
+  }
+}
+
+void DxcLinker::CreateEntryResult(
+    DxcLinkEntry &entry, _COM_Outptr_ IDxcOperationResult **ppResult) {
+  if (FAILED(entry.hr)) {
+    // Validation couldn't run; report what was diagnosed up to that point.
+    CComPtr<IDxcBlob> pErrorStreamBlob;
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    IFT(entry.pDiagStream.QueryInterface(&pErrorStreamBlob));
+    IFT(DxcCreateBlobWithEncodingSet(pErrorStreamBlob, CP_UTF8, &pErrorBlob));
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, pErrorBlob,
+                                                        entry.hr, ppResult));
+    return;
+  }
+
+  // Callback after valid DXIL is produced
+  if (SUCCEEDED(entry.valHR)) {
+    CComPtr<IDxcBlob> pTargetBlob;
+    if (m_pDxcContainerEventsHandler != nullptr) {
+      HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
+          entry.pOutputBlob, &pTargetBlob);
+      if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
+        std::swap(entry.pOutputBlob, pTargetBlob);
+      }
+    }
+    // TODO: DFCC_ShaderDebugName
+  }
+
+  std::string warnings;
+  CComPtr<IStream> pStream = entry.pDiagStream;
+  dxcutil::CreateOperationResultFromOutputs(entry.pOutputBlob, pStream,
+                                            warnings, entry.hasErrorOccurred,
+                                            ppResult);
+}
+
 // Links the shader and produces a shader blob that the Direct3D runtime can
 // use.
 HRESULT STDMETHODCALLTYPE DxcLinker::Link(
@@ -163,91 +342,176 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         *ppResult // Linker output status, buffer, and errors
 ) {
   DxcThreadMalloc TM(m_pMalloc);
-  // Prepare UTF8-encoded versions of API values.
-  CW2A pUtf8EntryPoint(pEntryName, CP_UTF8);
-  CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
   // TODO: read and validate options.
 
-  CComPtr<AbstractMemoryStream> pOutputStream;
+  HRESULT hr = S_OK;
+  try {
+    CComPtr<IMalloc> pMalloc;
+    IFT(CoGetMalloc(1, &pMalloc));
+
+    DxcLinkEntry entry(pEntryName, pTargetProfile);
+    IFT(CreateMemoryStream(pMalloc, &entry.pDiagStream));
+    {
+      raw_stream_ostream DiagStream(entry.pDiagStream);
+      llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+      PrintDiagnosticContext DiagContext(DiagPrinter);
+      m_Ctx.setDiagnosticHandler(
+          PrintDiagnosticContext::PrintDiagnosticHandler, &DiagContext, true);
+
+      entry.hasErrorOccurred = !AttachLibs(pLibNames, libCount);
+      if (!entry.hasErrorOccurred) {
+        std::unique_ptr<Module> pM = LinkEntry(pMalloc, entry);
+        if (pM)
+          ValidateEntry(pMalloc, entry, std::move(pM), DiagStream);
+      }
+      m_Ctx.setDiagnosticHandler(nullptr, nullptr, true);
+    }
+    CreateEntryResult(entry, ppResult);
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  return hr;
+}
 
-  // Detach previous libraries.
-  m_pLinker->DetachAll();
+static DWORD WINAPI LinkValidationThreadProc(LPVOID pParam) {
+  DxcLinkWorker *pWorker = reinterpret_cast<DxcLinkWorker *>(pParam);
+  // Allocations must go to the same IMalloc as the calling thread's, as
+  // the results are freed there.
+  DxcThreadMalloc TM(pWorker->pMalloc);
+  std::vector<std::unique_ptr<DxcLinkEntry>> &entries = *pWorker->pEntries;
+  for (;;) {
+    unsigned next = (*pWorker->pNext)++;
+    if (next >= entries.size())
+      break;
+    DxcLinkEntry &entry = *entries[next];
+    if (entry.hasErrorOccurred)
+      continue;
+    CComPtr<IMalloc> pMalloc;
+    if (FAILED(CoGetMalloc(1, &pMalloc))) {
+      entry.hr = E_OUTOFMEMORY;
+      continue;
+    }
+    pWorker->pLinker->ValidateEntryInOwnContext(pMalloc, entry);
+  }
+  return 0;
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::LinkMany(
+    _In_ UINT32 entryCount, // Number of entry points to link
+    _In_count_(entryCount)
+        const LPCWSTR *pEntryNames, // Array of entry point names
+    _In_count_(entryCount)
+        const LPCWSTR *pTargetProfiles, // Shader profile for each entry point
+    _In_count_(libCount)
+        const LPCWSTR *pLibNames, // Array of library names to link
+    UINT32 libCount,              // Number of libraries to link
+    _In_count_(argCount)
+        const LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,          // Number of arguments
+    _Out_writes_(entryCount) IDxcOperationResult *
+        *ppResults // Linker output status, buffer, and errors per entry
+) {
+  if (ppResults == nullptr ||
+      (entryCount > 0 && (pEntryNames == nullptr || pTargetProfiles == nullptr)))
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < entryCount; ++i)
+    ppResults[i] = nullptr;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  // TODO: read and validate options.
 
   HRESULT hr = S_OK;
   try {
     CComPtr<IMalloc> pMalloc;
-    CComPtr<IDxcBlob> pOutputBlob;
-    CComPtr<AbstractMemoryStream> pDiagStream;
-
     IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
 
-    std::string warnings;
-    llvm::raw_string_ostream w(warnings);
-    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
-    raw_stream_ostream DiagStream(pDiagStream);
-    llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
-    PrintDiagnosticContext DiagContext(DiagPrinter);
-    m_Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
-                               &DiagContext, true);
-
-    // Attach libraries.
-    bool bSuccess = true;
-    for (unsigned i = 0; i < libCount; i++) {
-      CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
-      bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+    std::vector<std::unique_ptr<DxcLinkEntry>> entries;
+    entries.reserve(entryCount);
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      entries.emplace_back(
+          new DxcLinkEntry(pEntryNames[i], pTargetProfiles[i]));
+      IFT(CreateMemoryStream(pMalloc, &entries.back()->pDiagStream));
     }
 
-    bool hasErrorOccurred = !bSuccess;
-    if (bSuccess) {
-      std::unique_ptr<Module> pM =
-          m_pLinker->Link(pUtf8EntryPoint.m_psz, pUtf8TargetProfile.m_psz);
-      if (pM) {
-        const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
-            new clang::DiagnosticIDs);
-        IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
-            new clang::DiagnosticOptions();
-        // Construct our diagnostic client.
-        clang::TextDiagnosticPrinter *DiagClient =
-            new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
-        clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
-
-        raw_stream_ostream outStream(pOutputStream.p);
-        // Create bitcode of M.
-        WriteBitcodeToFile(pM.get(), outStream);
-        outStream.flush();
-
-        // Validation.
-        HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
-            std::move(pM), pOutputBlob, pMalloc, SerializeDxilFlags::None,
-            pOutputStream,
-            /*bDebugInfo*/ false, Diag);
-
-        // Callback after valid DXIL is produced
-        if (SUCCEEDED(valHR)) {
-          CComPtr<IDxcBlob> pTargetBlob;
-          if (m_pDxcContainerEventsHandler != nullptr) {
-            HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
-                pOutputBlob, &pTargetBlob);
-            if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
-              std::swap(pOutputBlob, pTargetBlob);
-            }
-          }
-          // TODO: DFCC_ShaderDebugName
-        }
-
-        hasErrorOccurred = Diag.hasErrorOccurred();
-
-      } else {
-        hasErrorOccurred = true;
+    // Libraries are attached once for the batch. The linker keeps function
+    // bodies and global usage loaded between entries, so the dependency walk
+    // only loads what the previous entries didn't need. Attach errors are
+    // reported for every entry.
+    bool bAttached;
+    {
+      CComPtr<AbstractMemoryStream> pAttachDiagStream;
+      IFT(CreateMemoryStream(pMalloc, &pAttachDiagStream));
+      raw_stream_ostream DiagStream(pAttachDiagStream);
+      llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+      PrintDiagnosticContext DiagContext(DiagPrinter);
+      m_Ctx.setDiagnosticHandler(
+          PrintDiagnosticContext::PrintDiagnosticHandler, &DiagContext, true);
+      bAttached = AttachLibs(pLibNames, libCount);
+      m_Ctx.setDiagnosticHandler(nullptr, nullptr, true);
+      DiagStream.flush();
+      for (auto &entry : entries) {
+        ULONG cbWritten;
+        IFT(entry->pDiagStream->Write(pAttachDiagStream->GetPtr(),
+                                      pAttachDiagStream->GetPtrSize(),
+                                      &cbWritten));
+        entry->hasErrorOccurred = !bAttached;
       }
     }
-    DiagStream.flush();
-    CComPtr<IStream> pStream = pDiagStream;
-    dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
-                                              hasErrorOccurred, ppResult);
+
+    // Linking shares the libraries' context, so it's done one entry at a
+    // time. The linked modules are only kept as bitcode.
+    if (bAttached) {
+      for (auto &entry : entries) {
+        raw_stream_ostream DiagStream(entry->pDiagStream);
+        llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+        PrintDiagnosticContext DiagContext(DiagPrinter);
+        m_Ctx.setDiagnosticHandler(
+            PrintDiagnosticContext::PrintDiagnosticHandler, &DiagContext,
+            true);
+        LinkEntry(pMalloc, *entry);
+        m_Ctx.setDiagnosticHandler(nullptr, nullptr, true);
+      }
+    }
+
+    // Validation and container assembly are independent for each entry and
+    // run concurrently, each entry in its own context.
+    std::atomic<unsigned> next(0);
+    DxcLinkWorker worker;
+    worker.pLinker = this;
+    worker.pMalloc = m_pMalloc;
+    worker.pEntries = &entries;
+    worker.pNext = &next;
+
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    unsigned threadCount =
+        std::min<unsigned>(sysInfo.dwNumberOfProcessors, entryCount);
+    std::vector<HANDLE> threads;
+    for (unsigned i = 1; i < threadCount; ++i) {
+      HANDLE hThread = CreateThread(nullptr, 0, LinkValidationThreadProc,
+                                    &worker, 0, nullptr);
+      // If a thread can't be started, the others pick up its share.
+      if (hThread == nullptr)
+        break;
+      threads.push_back(hThread);
+    }
+    LinkValidationThreadProc(&worker);
+    for (HANDLE hThread : threads) {
+      WaitForSingleObject(hThread, INFINITE);
+      CloseHandle(hThread);
+    }
+
+    for (UINT32 i = 0; i < entryCount; ++i)
+      CreateEntryResult(*entries[i], &ppResults[i]);
   }
   CATCH_CPP_ASSIGN_HRESULT();
+  if (FAILED(hr)) {
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      if (ppResults[i] != nullptr) {
+        ppResults[i]->Release();
+        ppResults[i] = nullptr;
+      }
+    }
+  }
   return hr;
 }
 
@@ -24,10 +24,14 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Option/Arg.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/PhaseTimeReport.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/HLSL/DxilRootSignature.h"
 #include "dxcutil.h"
+#include "dxccompilecache.h"
 #include "dxc/Support/dxcfilesystem.h"
 
 // SPIRV change starts
@@ -52,6 +56,7 @@
 #include "dxcetw.h"
 #include "dxillib.h"
 #include <algorithm>
+#include <atomic>
 
 #define CP_UTF16 1200
 
@@ -72,6 +77,10 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                              _In_ llvm::Module *pDebugModule,
                              _In_ IDxcBlob *pShader, UINT32 Flags,
                              _In_ IDxcOperationResult **ppResult);
+void GetInternalValidatorCacheStatistics(
+    _In_ IDxcValidator *pValidator,
+    _Out_ DxcValidationCacheStatistics *pStats);
+void ResetInternalValidatorCacheStatistics(_In_ IDxcValidator *pValidator);
 
 static void CreateOperationResultFromOutputs(
     IDxcBlob *pResultBlob, dxcutil::DxcArgsFileSystem *msfPtr,
@@ -94,6 +103,20 @@ static void CreateOperationResultFromOutputs(
                                    ppResult);
 }
 
+// Attaches the text of a phase timing report to a result created by
+// CreateOperationResultFromOutputs.
+static void AttachTimeReport(const llvm::PhaseTimeReport &report,
+                             IDxcOperationResult *pResult) {
+  std::string text;
+  raw_string_ostream OS(text);
+  report.print(OS);
+  OS.flush();
+  CComPtr<IDxcBlobEncoding> pReportBlob;
+  IFT(DxcCreateBlobWithEncodingOnHeapCopy(text.data(), text.size(), CP_UTF8,
+                                          &pReportBlob));
+  static_cast<DxcOperationResult *>(pResult)->m_timeReport = pReportBlob;
+}
+
 class HLSLExtensionsCodegenHelperImpl : public HLSLExtensionsCodegenHelper {
 private:
   CompilerInstance &m_CI;
@@ -194,11 +217,33 @@ public:
   }
 };
 
-class DxcCompiler : public IDxcCompiler2, public IDxcLangExtensions, public IDxcContainerEvent, public IDxcVersionInfo {
+// Aggregated over compilations that used -arena-alloc.
+struct DxcArenaCounters {
+  std::atomic<uint64_t> Compilations;
+  std::atomic<uint64_t> PeakLiveBytes;
+  std::atomic<uint64_t> PeakReservedBytes;
+  std::atomic<uint64_t> TotalReservedBytes;
+  DxcArenaCounters()
+      : Compilations(0), PeakLiveBytes(0), PeakReservedBytes(0),
+        TotalReservedBytes(0) {}
+};
+
+static void UpdatePeak(std::atomic<uint64_t> &peak, uint64_t value) {
+  uint64_t current = peak;
+  while (value > current && !peak.compare_exchange_weak(current, value)) {
+  }
+}
+
+class DxcCompiler : public IDxcCompiler2, public IDxcLangExtensions, public IDxcContainerEvent, public IDxcVersionInfo, public IDxcCompileCacheStatistics, public IDxcArenaStatistics, public IDxcValidationCacheStatistics, public IDxcBatchDisassembler, public IDxcSpecializer, public IDxcPipelineLinker {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+  dxcutil::DxcCompileCacheCounters m_cacheCounters;
+  DxcArenaCounters m_arenaCounters;
+  // Persistent validator of compiler sessions, which are used by one thread
+  // at a time. Nothing else is kept between compilations.
+  std::unique_ptr<dxcutil::DxcValidatorInstance> m_pSessionValidator;
 
   void CreateDefineStrings(_In_count_(defineCount) const DxcDefine *pDefines,
                            UINT defineCount,
@@ -236,6 +281,109 @@ private:
     DXASSERT(opts.HLSLVersion > 2015, "else ReadDxcOpts didn't fail for non-isense");
     finished = false;
   }
+
+  bool IsCacheableCompile(hlsl::options::DxcOpts &opts) {
+    // Only full DXIL compilations are cached; the other modes are cheap or
+    // meant for inspection.
+    if (opts.CacheDirectory.empty() || opts.CodeGenHighLevel || opts.AstDump ||
+        opts.OptDump || opts.IsRootSignatureProfile() || opts.TimeReport)
+      return false;
+#ifdef ENABLE_SPIRV_CODEGEN
+    if (opts.GenSPIRV)
+      return false;
+#endif
+    // Intrinsic tables, semantic define validators and container event
+    // handlers can change the output in ways the cache key doesn't capture.
+    return m_pDxcContainerEventsHandler == nullptr &&
+           m_langExtensionsHelper.GetIntrinsicTables().empty() &&
+           m_langExtensionsHelper.GetSemanticDefines().empty();
+  }
+
+  void ComputeCacheKey(_In_ IDxcBlobEncoding *pUtf8Source,
+                       _In_ LPCWSTR pSourceName, _In_ LPCWSTR pEntryPoint,
+                       _In_ LPCWSTR pTargetProfile,
+                       hlsl::options::DxcOpts &opts,
+                       _In_count_(defineCount) const DxcDefine *pDefines,
+                       UINT32 defineCount, bool debugBlobRequested,
+                       bool debugNameRequested, llvm::MD5::MD5Result &key) {
+    dxcutil::DxcCompileCacheKeyBuilder keyBuilder;
+    UINT32 valMajor, valMinor;
+    dxcutil::GetValidatorVersion(&valMajor, &valMinor, m_pSessionValidator.get());
+    keyBuilder.AddUInt32(DXIL::kDxilMajor);
+    keyBuilder.AddUInt32(DXIL::kDxilMinor);
+    keyBuilder.AddUInt32(valMajor);
+    keyBuilder.AddUInt32(valMinor);
+    keyBuilder.AddWideString(pSourceName);
+    keyBuilder.AddBytes(pUtf8Source->GetBufferPointer(),
+                        pUtf8Source->GetBufferSize());
+    keyBuilder.AddWideString(pEntryPoint);
+    keyBuilder.AddWideString(pTargetProfile);
+    for (const llvm::opt::Arg *A : opts.Args) {
+      // Where and how much to cache doesn't affect the output.
+      if (A->getOption().matches(options::OPT_cache_dir) ||
+          A->getOption().matches(options::OPT_cache_max_size))
+        continue;
+      keyBuilder.AddString(A->getAsString(opts.Args));
+    }
+    keyBuilder.AddUInt32(defineCount);
+    for (UINT32 i = 0; i < defineCount; ++i) {
+      keyBuilder.AddWideString(pDefines[i].Name);
+      keyBuilder.AddWideString(pDefines[i].Value);
+    }
+    for (const std::string &define : m_langExtensionsHelper.GetDefines())
+      keyBuilder.AddString(define);
+    keyBuilder.AddUInt32(debugBlobRequested ? 1 : 0);
+    keyBuilder.AddUInt32(debugNameRequested ? 1 : 0);
+    keyBuilder.Finish(key);
+  }
+
+  // Cache operations need the disk, while the compilation itself only sees
+  // the file system built from the API arguments. Failures are treated as
+  // misses, as the cache is only an accelerator.
+  bool LookupCachedResult(dxcutil::DxcCompileCache &cache,
+                          const llvm::MD5::MD5Result &key,
+                          _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                          dxcutil::DxcArgsFileSystem *msfPtr,
+                          dxcutil::DxcCompileCacheResult &result) {
+    std::vector<dxcutil::DxcIncludedFileRecord> loadedFiles;
+    bool hit = false;
+    try {
+      ::llvm::sys::fs::MSFileSystem *pDiskFS;
+      IFT(CreateMSFileSystemForDisk(&pDiskFS));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> diskFS(pDiskFS);
+      ::llvm::sys::fs::AutoPerThreadSystem pts(diskFS.get());
+      IFTLLVM(pts.error_code());
+      hit = cache.Lookup(key, pIncludeHandler, loadedFiles, result,
+                         m_cacheCounters);
+    }
+    catch (...) {
+      hit = false;
+    }
+    // On a miss, the compilation reads the files the lookup already loaded
+    // rather than asking the include handler for them a second time.
+    if (!hit)
+      msfPtr->AddPreloadedFiles(loadedFiles);
+    return hit;
+  }
+
+  void StoreCachedResult(dxcutil::DxcCompileCache &cache,
+                         const llvm::MD5::MD5Result &key,
+                         dxcutil::DxcArgsFileSystem *msfPtr,
+                         const dxcutil::DxcCompileCacheResult &result) {
+    try {
+      std::vector<dxcutil::DxcIncludedFileRecord> includedFiles;
+      msfPtr->GetIncludedFiles(includedFiles);
+      ::llvm::sys::fs::MSFileSystem *pDiskFS;
+      IFT(CreateMSFileSystemForDisk(&pDiskFS));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> diskFS(pDiskFS);
+      ::llvm::sys::fs::AutoPerThreadSystem pts(diskFS.get());
+      IFTLLVM(pts.error_code());
+      cache.Store(key, includedFiles, result, m_cacheCounters);
+    }
+    catch (...) {
+      // Not storing the result only costs a future compilation.
+    }
+  }
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcCompiler)
@@ -258,7 +406,13 @@ public:
                                  IDxcCompiler2,
                                  IDxcLangExtensions,
                                  IDxcContainerEvent,
-                                 IDxcVersionInfo>
+                                 IDxcVersionInfo,
+                                 IDxcCompileCacheStatistics,
+                                 IDxcArenaStatistics,
+                                 IDxcValidationCacheStatistics,
+                                 IDxcBatchDisassembler,
+                                 IDxcSpecializer,
+                                 IDxcPipelineLinker>
                                  (this, iid, ppvObject);
   }
 
@@ -308,6 +462,8 @@ public:
     CComPtr<IDxcBlobEncoding> utf8Source;
     CComPtr<AbstractMemoryStream> pOutputStream;
     CHeapPtr<wchar_t> DebugBlobName;
+    CComPtr<IMalloc> pArena; // Must outlive TM, which uninstalls it.
+    CComPtr<IMalloc> pCountingMalloc; // Likewise.
     DxcEtw_DXCompilerCompile_Start();
     pSourceName = (pSourceName && *pSourceName) ? pSourceName : L"hlsl.hlsl"; // declared optional, so pick a default
     DxcThreadMalloc TM(m_pMalloc);
@@ -341,6 +497,63 @@ public:
       if (opts.DisplayIncludeProcess)
         msfPtr->EnableDisplayIncludeProcess();
 
+      // Serve the compilation from the cache when every input matches a
+      // previous successful compilation.
+      std::unique_ptr<dxcutil::DxcCompileCache> pCache;
+      llvm::MD5::MD5Result cacheKey;
+      std::string cacheDebugBlobName;
+      if (IsCacheableCompile(opts)) {
+        pCache.reset(new dxcutil::DxcCompileCache(
+            opts.CacheDirectory, (uint64_t)opts.CacheMaxSizeInMB * 1024 * 1024));
+        ComputeCacheKey(utf8Source, pSourceName, pEntryPoint, pTargetProfile,
+                        opts, pDefines, defineCount, ppDebugBlob != nullptr,
+                        ppDebugBlobName != nullptr, cacheKey);
+        dxcutil::DxcCompileCacheResult cached;
+        if (LookupCachedResult(*pCache, cacheKey, pIncludeHandler, msfPtr,
+                               cached)) {
+          if (ppDebugBlobName && !cached.DebugBlobName.empty()) {
+            IFTBOOL(Unicode::UTF8BufferToUTF16ComHeap(
+                        cached.DebugBlobName.c_str(), &DebugBlobName),
+                    DXC_E_CONTAINER_INVALID);
+          }
+          IFT(DxcOperationResult::CreateFromResultErrorStatus(
+              cached.Container, cached.Errors, S_OK, ppResult));
+          if (ppDebugBlob) {
+            *ppDebugBlob = cached.DebugBlob.Detach();
+          }
+          if (ppDebugBlobName) {
+            *ppDebugBlobName = DebugBlobName.Detach();
+          }
+          hr = S_OK;
+          goto Cleanup;
+        }
+      }
+
+      // From here on, allocations come from an arena that is released in bulk
+      // when the call returns. It stays installed until then, so everything
+      // is freed through the allocator it came from; results handed back to
+      // the caller are created with m_pMalloc so they don't keep it alive.
+      if (opts.ArenaAlloc) {
+        IFT(DxcCreateArenaMalloc(m_pMalloc, &pArena));
+        DxcSwapThreadMalloc(pArena, nullptr);
+      }
+
+      // With -ftime-report, compilation phases are timed and the bytes
+      // allocated through the installed allocator are counted per phase.
+      std::unique_ptr<llvm::PhaseTimeReport> pTimeReport;
+      std::unique_ptr<llvm::PhaseTimeReportScope> pTimeReportScope;
+      if (opts.TimeReport) {
+        IFT(DxcCreateCountingMalloc(DxcGetThreadMallocNoRef(),
+                                    &pCountingMalloc));
+        DxcSwapThreadMalloc(pCountingMalloc, nullptr);
+        IMalloc *pCounter = pCountingMalloc;
+        pTimeReport.reset(new llvm::PhaseTimeReport());
+        pTimeReport->setAllocationCounter(
+            [pCounter]() { return DxcGetCountingMallocBytes(pCounter); });
+        pTimeReportScope.reset(
+            new llvm::PhaseTimeReportScope(pTimeReport.get()));
+      }
+
       // Prepare UTF8-encoded versions of API values.
       CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
       CW2A utf8SourceName(pSourceName, CP_UTF8);
@@ -415,7 +628,8 @@ public:
 
       if (needsValidation || (opts.CodeGenHighLevel && !opts.DisableValidation)) {
         UINT32 majorVer, minorVer;
-        dxcutil::GetValidatorVersion(&majorVer, &minorVer);
+        dxcutil::GetValidatorVersion(&majorVer, &minorVer,
+                                     m_pSessionValidator.get());
         compiler.getCodeGenOpts().HLSLValidatorMajorVer = majorVer;
         compiler.getCodeGenOpts().HLSLValidatorMinorVer = minorVer;
       }
@@ -480,6 +694,7 @@ public:
           spirvOpts.uShift = opts.VkUShift;
           spirvOpts.allowedExtensions = opts.SpvExtensions;
           spirvOpts.targetEnv = opts.SpvTargetEnv;
+          spirvOpts.optConfig = opts.SpvOconfig;
           spirvOpts.enable16BitTypes = opts.Enable16BitTypes;
           spirvOpts.enableDebugInfo = opts.DebugInfo;
           clang::EmitSPIRVAction action(spirvOpts);
@@ -492,19 +707,6 @@ public:
 #endif
       // SPIRV change ends
       else {
-        EmitBCAction action(&llvmContext);
-        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-        bool compileOK;
-        if (action.BeginSourceFile(compiler, file)) {
-          action.Execute();
-          action.EndSourceFile();
-          compileOK = !compiler.getDiagnostics().hasErrorOccurred();
-        }
-        else {
-          compileOK = false;
-        }
-        outStream.flush();
-
         SerializeDxilFlags SerializeFlags = SerializeDxilFlags::None;
         if (opts.DebugInfo) {
           SerializeFlags = SerializeDxilFlags::IncludeDebugNamePart;
@@ -516,6 +718,26 @@ public:
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        // A high-level module with specialization constants is put in a
+        // container once it's specialized, with the same parts.
+        compiler.getCodeGenOpts().HLSLSpecializationSerializeFlags =
+            (unsigned)SerializeFlags;
+
+        EmitBCAction action(&llvmContext);
+        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+        bool compileOK;
+        {
+          llvm::PhaseTimeRegion frontendRegion("Frontend");
+          if (action.BeginSourceFile(compiler, file)) {
+            action.Execute();
+            action.EndSourceFile();
+            compileOK = !compiler.getDiagnostics().hasErrorOccurred();
+          }
+          else {
+            compileOK = false;
+          }
+        }
+        outStream.flush();
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
@@ -525,7 +747,8 @@ public:
           if (needsValidation) {
             valHR = dxcutil::ValidateAndAssembleToContainer(
                 action.takeModule(), pOutputBlob, m_pMalloc, SerializeFlags,
-                pOutputStream, opts.DebugInfo, compiler.getDiagnostics());
+                pOutputStream, opts.DebugInfo, compiler.getDiagnostics(),
+                m_pSessionValidator.get());
           } else {
             dxcutil::AssembleToContainer(action.takeModule(),
                                                  pOutputBlob, m_pMalloc,
@@ -551,6 +774,7 @@ public:
                 const char *pDebugName;
                 if (GetDxilShaderDebugName(*it, &pDebugName, nullptr) && pDebugName && *pDebugName) {
                   IFTBOOL(Unicode::UTF8BufferToUTF16ComHeap(pDebugName, &DebugBlobName), DXC_E_CONTAINER_INVALID);
+                  cacheDebugBlobName = pDebugName;
                 }
               }
             }
@@ -561,8 +785,13 @@ public:
       // Add std err to warnings.
       msfPtr->WriteStdErrToStream(w);
 
-      CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
-                                       compiler.getDiagnostics(), ppResult);
+      {
+        DxcThreadMalloc TMResult(m_pMalloc);
+        CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
+                                         compiler.getDiagnostics(), ppResult);
+        if (pTimeReport)
+          AttachTimeReport(*pTimeReport, *ppResult);
+      }
 
       // On success, return values. After assigning ppResult, nothing should fail.
       HRESULT status;
@@ -574,6 +803,16 @@ public:
         if (ppDebugBlobName) {
           *ppDebugBlobName = DebugBlobName.Detach();
         }
+        if (pCache && pOutputBlob != nullptr) {
+          dxcutil::DxcCompileCacheResult toStore;
+          toStore.Container = pOutputBlob;
+          DXVERIFY_NOMSG(SUCCEEDED((*ppResult)->GetErrorBuffer(&toStore.Errors)));
+          if (opts.DebugInfo && ppDebugBlob) {
+            toStore.DebugBlob = *ppDebugBlob;
+          }
+          toStore.DebugBlobName = cacheDebugBlobName;
+          StoreCachedResult(*pCache, cacheKey, msfPtr, toStore);
+        }
       }
 
       hr = S_OK;
@@ -583,6 +822,7 @@ public:
       _Analysis_assume_(DXC_FAILED(e.hr));
       if (e.hr == DXC_E_ABORT_COMPILATION_ERROR) {
         e.hr = S_OK;
+        DxcThreadMalloc TMResult(m_pMalloc);
         CComPtr<IDxcBlobEncoding> pErrorBlob;
         IFT(DxcCreateBlobWithEncodingOnHeapCopy(e.msg.c_str(), e.msg.size(),
                                                 CP_UTF8, &pErrorBlob));
@@ -594,6 +834,14 @@ public:
       hr = E_FAIL;
     }
   Cleanup:
+    if (pArena) {
+      DxcArenaMallocStats arenaStats;
+      DxcGetArenaMallocStats(pArena, &arenaStats);
+      ++m_arenaCounters.Compilations;
+      m_arenaCounters.TotalReservedBytes += arenaStats.ReservedBytes;
+      UpdatePeak(m_arenaCounters.PeakLiveBytes, arenaStats.PeakLiveBytes);
+      UpdatePeak(m_arenaCounters.PeakReservedBytes, arenaStats.ReservedBytes);
+    }
     DxcEtw_DXCompilerCompile_Stop(hr);
     return hr;
   }
@@ -753,6 +1001,102 @@ public:
     return hr;
   }
 
+  // IDxcBatchDisassembler implementation.
+  __override HRESULT STDMETHODCALLTYPE DisassembleMany(
+    UINT32 blobCount, _In_count_(blobCount) IDxcBlob **ppBlobs,
+    UINT32 threadCount, _In_ IDxcDisassemblyWriter *pWriter) {
+    if (pWriter == nullptr || (blobCount > 0 && ppBlobs == nullptr))
+      return E_INVALIDARG;
+    if (blobCount == 0)
+      return S_OK;
+    for (UINT32 i = 0; i < blobCount; ++i) {
+      if (ppBlobs[i] == nullptr)
+        return E_INVALIDARG;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      return dxcutil::DisassembleMany(m_pMalloc, blobCount, ppBlobs,
+                                      threadCount, pWriter);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // IDxcSpecializer implementation.
+  __override HRESULT STDMETHODCALLTYPE Specialize(
+    _In_ IDxcBlob *pHighLevelModule,
+    UINT32 constantCount, _In_count_(constantCount) LPCWSTR *pConstantNames,
+    UINT32 specializationCount,
+    _In_count_(constantCount * specializationCount) LPCWSTR *pValues,
+    UINT32 threadCount,
+    _Out_writes_(specializationCount) IDxcOperationResult **ppResults) {
+    if (pHighLevelModule == nullptr || ppResults == nullptr ||
+        (constantCount > 0 && pConstantNames == nullptr) ||
+        (constantCount > 0 && specializationCount > 0 && pValues == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < specializationCount; ++i)
+      ppResults[i] = nullptr;
+    if (specializationCount == 0)
+      return S_OK;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    HRESULT hr = S_OK;
+    try {
+      hr = dxcutil::SpecializeMany(m_pMalloc, pHighLevelModule, constantCount,
+                                   pConstantNames, specializationCount,
+                                   pValues, threadCount,
+                                   m_pSessionValidator.get(), ppResults);
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < specializationCount; ++i) {
+        if (ppResults[i] != nullptr) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    return hr;
+  }
+
+  // IDxcPipelineLinker implementation.
+  __override HRESULT STDMETHODCALLTYPE LinkPipeline(
+    UINT32 stageCount, _In_count_(stageCount) IDxcBlob **ppStages,
+    UINT32 streamOutputEntryCount,
+    _In_count_(streamOutputEntryCount) const DxcStreamOutputEntry *pStreamOutputEntries,
+    _Out_writes_(stageCount) IDxcOperationResult **ppResults) {
+    if (stageCount == 0 || ppStages == nullptr || ppResults == nullptr ||
+        (streamOutputEntryCount > 0 && pStreamOutputEntries == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < streamOutputEntryCount; ++i) {
+      if (pStreamOutputEntries[i].SemanticName == nullptr)
+        return E_INVALIDARG;
+    }
+    for (UINT32 i = 0; i < stageCount; ++i) {
+      if (ppStages[i] == nullptr)
+        return E_INVALIDARG;
+      ppResults[i] = nullptr;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    HRESULT hr = S_OK;
+    try {
+      hr = dxcutil::LinkPipeline(m_pMalloc, stageCount, ppStages,
+                                 streamOutputEntryCount, pStreamOutputEntries,
+                                 m_pSessionValidator.get(), ppResults);
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < stageCount; ++i) {
+        if (ppResults[i] != nullptr) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    return hr;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                _In_ DxcLangExtensionsHelper *helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
@@ -825,6 +1169,8 @@ public:
     compiler.getLangOpts().HLSLVersion = (unsigned) Opts.HLSLVersion;
 
     compiler.getLangOpts().UseMinPrecision = !Opts.Enable16BitTypes;
+    for (StringRef name : Opts.SpecializationConstants)
+      compiler.getLangOpts().HLSLSpecializationConstants.push_back(name.str());
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -896,6 +1242,66 @@ public:
     compiler.getCodeGenOpts().HLSLExtensionsCodegen = std::make_shared<HLSLExtensionsCodegenHelperImpl>(compiler, m_langExtensionsHelper, Opts.RootSignatureDefine);
   }
 
+  // Creating the validator up front keeps it out of any per-compilation
+  // allocator, and keeps dxil.dll from being queried on every compilation.
+  void InitializeSession() {
+    m_pSessionValidator.reset(new dxcutil::DxcValidatorInstance());
+    dxcutil::CreateValidatorInstance(*m_pSessionValidator,
+                                     /*bCacheValidation*/ true);
+  }
+
+  // IDxcCompileCacheStatistics
+  __override HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ DxcCompileCacheStatistics *pStats) {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    pStats->Hits = m_cacheCounters.Hits;
+    pStats->Misses = m_cacheCounters.Misses;
+    pStats->Stores = m_cacheCounters.Stores;
+    pStats->Evictions = m_cacheCounters.Evictions;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE ResetStatistics() {
+    m_cacheCounters.Hits = 0;
+    m_cacheCounters.Misses = 0;
+    m_cacheCounters.Stores = 0;
+    m_cacheCounters.Evictions = 0;
+    return S_OK;
+  }
+
+  // IDxcArenaStatistics
+  __override HRESULT STDMETHODCALLTYPE GetArenaStatistics(_Out_ DxcArenaStatistics *pStats) {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    pStats->Compilations = m_arenaCounters.Compilations;
+    pStats->PeakLiveBytes = m_arenaCounters.PeakLiveBytes;
+    pStats->PeakReservedBytes = m_arenaCounters.PeakReservedBytes;
+    pStats->TotalReservedBytes = m_arenaCounters.TotalReservedBytes;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE ResetArenaStatistics() {
+    m_arenaCounters.Compilations = 0;
+    m_arenaCounters.PeakLiveBytes = 0;
+    m_arenaCounters.PeakReservedBytes = 0;
+    m_arenaCounters.TotalReservedBytes = 0;
+    return S_OK;
+  }
+
+  // IDxcValidationCacheStatistics
+  __override HRESULT STDMETHODCALLTYPE GetValidationCacheStatistics(_Out_ DxcValidationCacheStatistics *pStats) {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    pStats->FunctionsValidated = 0;
+    pStats->FunctionsCached = 0;
+    if (m_pSessionValidator && m_pSessionValidator->IsInternal)
+      GetInternalValidatorCacheStatistics(m_pSessionValidator->Validator, pStats);
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE ResetValidationCacheStatistics() {
+    if (m_pSessionValidator && m_pSessionValidator->IsInternal)
+      ResetInternalValidatorCacheStatistics(m_pSessionValidator->Validator);
+    return S_OK;
+  }
+
   // IDxcVersionInfo
   __override HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor) {
     if (pMajor == nullptr || pMinor == nullptr)
@@ -925,3 +1331,14 @@ HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID* ppv) {
   }
   CATCH_CPP_RETURN_HRESULT();
 }
+
+HRESULT CreateDxcCompilerSession(_In_ REFIID riid, _Out_ LPVOID* ppv) {
+  *ppv = nullptr;
+  try {
+    CComPtr<DxcCompiler> result(DxcCompiler::Alloc(DxcGetThreadMallocNoRef()));
+    IFROOM(result.p);
+    result->InitializeSession();
+    return result.p->QueryInterface(riid, ppv);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcpipelinelinker.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Links the compiled stages of a graphics pipeline.                         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilLinker.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/HLSL/DxilUtil.h"
+#include "dxc/Support/ErrorCodes.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "dxcutil.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace hlsl;
+using namespace llvm;
+
+namespace {
+struct DxcPipelineStage {
+  IDxcBlob *pInput;
+  std::unique_ptr<Module> pModule;
+  bool bChanged = false;
+};
+} // namespace
+
+// Loads the DXIL part of a compiled shader; any debug module is left behind.
+static HRESULT LoadStageModule(IDxcBlob *pBlob, LLVMContext &Ctx,
+                               std::unique_ptr<Module> &pModule) {
+  const DxilContainerHeader *pContainer =
+      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  if (pContainer == nullptr ||
+      !IsValidDxilContainer(pContainer, pBlob->GetBufferSize()))
+    return DXC_E_CONTAINER_INVALID;
+  const DxilProgramHeader *pProgramHeader =
+      GetDxilProgramHeader(pContainer, DFCC_DXIL);
+  if (pProgramHeader == nullptr)
+    return DXC_E_CONTAINER_MISSING_DXIL;
+
+  const char *pIL = nullptr;
+  uint32_t ILLength = 0;
+  GetDxilProgramBitcode(pProgramHeader, &pIL, &ILLength);
+  std::string DiagStr;
+  pModule = dxilutil::LoadModuleFromBitcode(StringRef(pIL, ILLength), Ctx,
+                                            DiagStr);
+  if (!pModule)
+    return DXC_E_IR_VERIFICATION_FAILED;
+  pModule->GetOrCreateDxilModule();
+  return S_OK;
+}
+
+// Position of each kind of shader in a graphics pipeline, or -1 for kinds
+// that can't be part of one.
+static int GetPipelineOrder(DXIL::ShaderKind kind) {
+  switch (kind) {
+  case DXIL::ShaderKind::Vertex:   return 0;
+  case DXIL::ShaderKind::Hull:     return 1;
+  case DXIL::ShaderKind::Domain:   return 2;
+  case DXIL::ShaderKind::Geometry: return 3;
+  case DXIL::ShaderKind::Pixel:    return 4;
+  default:                         return -1;
+  }
+}
+
+static bool IsValidPipeline(const std::vector<DxcPipelineStage> &stages) {
+  int prior = -1;
+  for (const DxcPipelineStage &stage : stages) {
+    int order = GetPipelineOrder(
+        stage.pModule->GetDxilModule().GetShaderModel()->GetKind());
+    if (order <= prior || (prior < 0 && order != 0))
+      return false;
+    // Hull and domain shaders come as a pair.
+    if ((prior == 1) != (order == 2))
+      return false;
+    prior = order;
+  }
+  return prior != 1;
+}
+
+static void CreateStageResult(IMalloc *pMalloc, DxcPipelineStage &stage,
+                              const dxcutil::DxcValidatorInstance *pValidator,
+                              _COM_Outptr_ IDxcOperationResult **ppResult) {
+  if (!stage.bChanged) {
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(stage.pInput, nullptr,
+                                                        S_OK, ppResult));
+    return;
+  }
+
+  CComPtr<AbstractMemoryStream> pDiagStream;
+  IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+  raw_stream_ostream DiagStream(pDiagStream);
+  const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+      new clang::DiagnosticIDs);
+  IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+      new clang::DiagnosticOptions();
+  clang::TextDiagnosticPrinter *DiagClient =
+      new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+  clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+  // Container assembly takes the bitcode of the final module.
+  CComPtr<AbstractMemoryStream> pOutputStream;
+  CComPtr<IDxcBlob> pOutputBlob;
+  IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+  {
+    raw_stream_ostream outStream(pOutputStream.p);
+    WriteBitcodeToFile(stage.pModule.get(), outStream);
+  }
+  dxcutil::ValidateAndAssembleToContainer(
+      std::move(stage.pModule), pOutputBlob, pMalloc, SerializeDxilFlags::None,
+      pOutputStream, /*bDebugInfo*/ false, Diag, pValidator);
+  DiagStream.flush();
+
+  std::string warnings;
+  CComPtr<IStream> pStream = pDiagStream;
+  dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
+                                            Diag.hasErrorOccurred(), ppResult);
+}
+
+namespace dxcutil {
+HRESULT LinkPipeline(IMalloc *pMalloc, UINT32 stageCount, IDxcBlob **ppStages,
+                     UINT32 streamOutputEntryCount,
+                     const DxcStreamOutputEntry *pStreamOutputEntries,
+                     const DxcValidatorInstance *pValidatorInstance,
+                     IDxcOperationResult **ppResults) {
+  // The stages are linked in turn, so they share a context.
+  LLVMContext Ctx;
+  std::vector<DxcPipelineStage> stages(stageCount);
+  for (UINT32 i = 0; i < stageCount; ++i) {
+    stages[i].pInput = ppStages[i];
+    IFR(LoadStageModule(ppStages[i], Ctx, stages[i].pModule));
+  }
+  if (!IsValidPipeline(stages))
+    return E_INVALIDARG;
+
+  // Stream output is written by the last stage before the rasterizer.
+  std::vector<DxilStreamOutputElement> streamOutput(streamOutputEntryCount);
+  for (UINT32 i = 0; i < streamOutputEntryCount; ++i) {
+    streamOutput[i].Stream = pStreamOutputEntries[i].Stream;
+    streamOutput[i].SemanticName = Unicode::UTF16ToUTF8StringOrThrow(
+        pStreamOutputEntries[i].SemanticName);
+    streamOutput[i].SemanticIndex = pStreamOutputEntries[i].SemanticIndex;
+  }
+  UINT32 streamOutputStage = stageCount - 1;
+  if (stages[streamOutputStage].pModule->GetDxilModule()
+          .GetShaderModel()->IsPS())
+    --streamOutputStage;
+
+  // Stages are linked from the back, so that inputs left unread by removing
+  // the outputs of a stage are removed with the outputs of the one before.
+  for (UINT32 i = stageCount; i-- > 0;) {
+    DxilModule &producer = stages[i].pModule->GetDxilModule();
+    DxilModule *pConsumer = nullptr;
+    if (i + 1 < stageCount)
+      pConsumer = &stages[i + 1].pModule->GetDxilModule();
+    else if (producer.GetShaderModel()->IsPS())
+      continue;
+    ArrayRef<DxilStreamOutputElement> producerStreamOutput;
+    if (i == streamOutputStage)
+      producerStreamOutput = streamOutput;
+    if (RemoveUnusedStageOutputs(producer, pConsumer, producerStreamOutput)) {
+      stages[i].bChanged = true;
+      if (i + 1 < stageCount)
+        stages[i + 1].bChanged = true;
+    }
+  }
+
+  DxcValidatorInstance batchValidator;
+  if (pValidatorInstance == nullptr) {
+    CreateValidatorInstance(batchValidator);
+    pValidatorInstance = &batchValidator;
+  }
+  for (UINT32 i = 0; i < stageCount; ++i)
+    CreateStageResult(pMalloc, stages[i], pValidatorInstance, &ppResults[i]);
+  return S_OK;
+}
+} // namespace dxcutil
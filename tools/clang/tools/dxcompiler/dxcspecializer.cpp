@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcspecializer.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Finishes compiling high-level modules with specialization constants.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilUtil.h"
+#include "dxc/HLSL/DxilValidation.h"
+#include "dxc/HLSL/HLModule.h"
+#include "dxc/Support/ErrorCodes.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "dxcutil.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+using namespace hlsl;
+using namespace llvm;
+
+// These declarations are used for the locally-linked optimizer.
+HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT RunDxcOptimizerPipeline(IDxcOptimizerPipeline *pPipeline, Module &M);
+
+namespace {
+// State for one set of values, from the bound module through to the
+// operation result.
+struct DxcSpecializationEntry {
+  std::vector<std::string> Values; // One per constant name, in UTF-8.
+  CComPtr<AbstractMemoryStream> pDiagStream;
+  CComPtr<AbstractMemoryStream> pOutputStream; // Bitcode of the final module.
+  CComPtr<IDxcBlob> pOutputBlob;
+  bool hasErrorOccurred = false;
+  HRESULT hr = S_OK; // Failure to compile and assemble.
+};
+
+struct DxcSpecializeWorker {
+  IMalloc *pMalloc;
+  IDxcBlob *pHighLevelModule;
+  const std::vector<std::string> *pNames;
+  IDxcOptimizerPipeline *pPipeline;
+  const dxcutil::DxcValidatorInstance *pValidatorInstance;
+  SerializeDxilFlags SerializeFlags; // As for the high-level compilation.
+  std::vector<DxcSpecializationEntry> *pEntries;
+  std::atomic<unsigned> *pNext;
+};
+} // namespace
+
+static std::unique_ptr<Module> LoadHighLevelModule(IDxcBlob *pBlob,
+                                                   LLVMContext &Ctx,
+                                                   std::string &DiagStr) {
+  StringRef bitcode((const char *)pBlob->GetBufferPointer(),
+                    pBlob->GetBufferSize());
+  return dxilutil::LoadModuleFromBitcode(bitcode, Ctx, DiagStr);
+}
+
+// Parses the value of a specialization constant of type Ty. Integers and
+// bools take a decimal or 0x-prefixed integer, or true or false;
+// floating-point types take a decimal number, with an optional f or h suffix.
+static Constant *ParseSpecializationValue(Type *Ty, StringRef Text) {
+  Text = Text.trim();
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty)) {
+    if (Text == "true")
+      return ConstantInt::get(ITy, 1);
+    if (Text == "false")
+      return ConstantInt::get(ITy, 0);
+    long long SValue;
+    if (!Text.getAsInteger(0, SValue))
+      return ConstantInt::get(ITy, SValue, /*isSigned*/ true);
+    unsigned long long UValue;
+    if (!Text.getAsInteger(0, UValue))
+      return ConstantInt::get(ITy, UValue);
+    return nullptr;
+  }
+  if (Ty->isFloatingPointTy()) {
+    if (Text.endswith("f") || Text.endswith("F") || Text.endswith("h") ||
+        Text.endswith("H"))
+      Text = Text.drop_back();
+    // strtod rather than APFloat, which asserts on malformed text.
+    std::string str = Text.str();
+    char *pEnd = nullptr;
+    double value = std::strtod(str.c_str(), &pEnd);
+    if (str.empty() || pEnd != str.c_str() + str.size())
+      return nullptr;
+    return ConstantFP::get(Ty, value);
+  }
+  return nullptr;
+}
+
+static void SpecializeEntry(const DxcSpecializeWorker &worker,
+                            DxcSpecializationEntry &entry) {
+  try {
+    // Each set of values is compiled in a context of its own, so entries are
+    // independent and run concurrently.
+    LLVMContext Ctx;
+    raw_stream_ostream DiagStream(entry.pDiagStream);
+    llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    PrintDiagnosticContext DiagContext(DiagPrinter);
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                             &DiagContext, true);
+
+    const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+        new clang::DiagnosticIDs);
+    IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+        new clang::DiagnosticOptions();
+    clang::TextDiagnosticPrinter *DiagClient =
+        new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+    clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+    std::string DiagStr;
+    std::unique_ptr<Module> pM =
+        LoadHighLevelModule(worker.pHighLevelModule, Ctx, DiagStr);
+    IFTBOOL(pM, DXC_E_IR_VERIFICATION_FAILED);
+
+    std::vector<std::pair<StringRef, GlobalVariable *>> constants;
+    HLModule::GetSpecializationConstants(*pM, constants);
+    const std::vector<std::string> &names = *worker.pNames;
+    for (size_t i = 0; i < names.size(); ++i) {
+      // Names were checked against the module up front.
+      auto it = std::find_if(constants.begin(), constants.end(),
+                             [&](const std::pair<StringRef, GlobalVariable *> &C) {
+                               return C.first == names[i];
+                             });
+      GlobalVariable *GV = it->second;
+      // The program doesn't use this constant.
+      if (GV == nullptr)
+        continue;
+      Constant *C = ParseSpecializationValue(GV->getType()->getElementType(),
+                                             entry.Values[i]);
+      if (C == nullptr) {
+        unsigned DiagID = Diag.getCustomDiagID(
+            clang::DiagnosticsEngine::Error,
+            "invalid value '%0' for specialization constant '%1'");
+        Diag.Report(DiagID) << entry.Values[i] << names[i];
+        continue;
+      }
+      GV->setInitializer(C);
+      GV->setConstant(true);
+    }
+    if (Diag.hasErrorOccurred()) {
+      entry.hasErrorOccurred = true;
+      return;
+    }
+
+    IFT(RunDxcOptimizerPipeline(worker.pPipeline, *pM));
+
+    // Container assembly takes the bitcode of the final module.
+    IFT(CreateMemoryStream(worker.pMalloc, &entry.pOutputStream));
+    {
+      raw_stream_ostream outStream(entry.pOutputStream.p);
+      WriteBitcodeToFile(pM.get(), outStream);
+    }
+
+    bool bDebugInfo =
+        (worker.SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) != 0;
+    dxcutil::ValidateAndAssembleToContainer(
+        std::move(pM), entry.pOutputBlob, worker.pMalloc,
+        worker.SerializeFlags, entry.pOutputStream, bDebugInfo, Diag,
+        worker.pValidatorInstance);
+    entry.hasErrorOccurred = Diag.hasErrorOccurred();
+  } catch (hlsl::Exception &e) {
+    entry.hr = e.hr;
+  } catch (std::bad_alloc &) {
+    entry.hr = E_OUTOFMEMORY;
+  } catch (...) {
+    entry.hr = E_FAIL;
+  }
+}
+
+static DWORD WINAPI SpecializeThreadProc(LPVOID pParam) {
+  DxcSpecializeWorker *pWorker = reinterpret_cast<DxcSpecializeWorker *>(pParam);
+  // Allocations must go to the same IMalloc as the calling thread's, as
+  // the results are freed there.
+  DxcThreadMalloc TM(pWorker->pMalloc);
+  std::vector<DxcSpecializationEntry> &entries = *pWorker->pEntries;
+  for (;;) {
+    unsigned next = (*pWorker->pNext)++;
+    if (next >= entries.size())
+      break;
+    SpecializeEntry(*pWorker, entries[next]);
+  }
+  return 0;
+}
+
+static void CreateEntryResult(DxcSpecializationEntry &entry,
+                              _COM_Outptr_ IDxcOperationResult **ppResult) {
+  if (FAILED(entry.hr)) {
+    // Compilation couldn't finish; report what was diagnosed up to that point.
+    CComPtr<IDxcBlob> pErrorStreamBlob;
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    IFT(entry.pDiagStream.QueryInterface(&pErrorStreamBlob));
+    IFT(DxcCreateBlobWithEncodingSet(pErrorStreamBlob, CP_UTF8, &pErrorBlob));
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, pErrorBlob,
+                                                        entry.hr, ppResult));
+    return;
+  }
+
+  std::string warnings;
+  CComPtr<IStream> pStream = entry.pDiagStream;
+  dxcutil::CreateOperationResultFromOutputs(entry.pOutputBlob, pStream,
+                                            warnings, entry.hasErrorOccurred,
+                                            ppResult);
+}
+
+// Splits a pass list in the format of -Odump into optimizer options, one per
+// line; comment lines start with '#'.
+static void SplitPassList(StringRef passes,
+                          std::vector<std::wstring> &options) {
+  SmallVector<StringRef, 64> lines;
+  passes.split(lines, "\n", /*MaxSplit*/ -1, /*KeepEmpty*/ false);
+  for (StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    std::wstring option;
+    IFTBOOL(Unicode::UTF8ToUTF16String(line.data(), line.size(), &option),
+            DXC_E_STRING_ENCODING_FAILED);
+    options.emplace_back(std::move(option));
+  }
+}
+
+namespace dxcutil {
+HRESULT SpecializeMany(IMalloc *pMalloc, IDxcBlob *pHighLevelModule,
+                       UINT32 constantCount, LPCWSTR *pConstantNames,
+                       UINT32 specializationCount, LPCWSTR *pValues,
+                       UINT32 threadCount,
+                       const DxcValidatorInstance *pValidatorInstance,
+                       IDxcOperationResult **ppResults) {
+  std::vector<std::string> names;
+  for (UINT32 i = 0; i < constantCount; ++i)
+    names.emplace_back(Unicode::UTF16ToUTF8StringOrThrow(pConstantNames[i]));
+
+  // The pass list, the container flags and the constants are read from the
+  // module once for the batch; a module without a pass list wasn't compiled
+  // with -specialize-constant.
+  std::vector<std::wstring> options;
+  SerializeDxilFlags serializeFlags;
+  {
+    LLVMContext Ctx;
+    std::string DiagStr;
+    std::unique_ptr<Module> pM =
+        LoadHighLevelModule(pHighLevelModule, Ctx, DiagStr);
+    if (!pM)
+      return E_INVALIDARG;
+    StringRef passes = HLModule::GetSpecializationPasses(*pM);
+    if (passes.empty())
+      return E_INVALIDARG;
+    SplitPassList(passes, options);
+    serializeFlags = static_cast<SerializeDxilFlags>(
+        HLModule::GetSpecializationSerializeFlags(*pM));
+
+    std::vector<std::pair<StringRef, GlobalVariable *>> constants;
+    HLModule::GetSpecializationConstants(*pM, constants);
+    for (const std::string &name : names) {
+      if (std::none_of(constants.begin(), constants.end(),
+                       [&](const std::pair<StringRef, GlobalVariable *> &C) {
+                         return C.first == name;
+                       }))
+        return E_INVALIDARG;
+    }
+  }
+
+  // The passes are looked up once and shared by all entries.
+  CComPtr<IDxcOptimizer2> pOptimizer;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  IFR(CreateDxcOptimizer(__uuidof(IDxcOptimizer2), (void **)&pOptimizer));
+  std::vector<LPCWSTR> optionPtrs;
+  for (const std::wstring &option : options)
+    optionPtrs.push_back(option.c_str());
+  IFR(pOptimizer->CreatePipeline(optionPtrs.data(), (UINT32)optionPtrs.size(),
+                                 &pPipeline));
+
+  std::vector<DxcSpecializationEntry> entries(specializationCount);
+  for (UINT32 i = 0; i < specializationCount; ++i) {
+    DxcSpecializationEntry &entry = entries[i];
+    for (UINT32 j = 0; j < constantCount; ++j)
+      entry.Values.emplace_back(Unicode::UTF16ToUTF8StringOrThrow(
+          pValues[i * constantCount + j]));
+    IFT(CreateMemoryStream(pMalloc, &entry.pDiagStream));
+  }
+
+  // Without a session validator, one is created for the batch rather than
+  // for each entry. Entries share every function that doesn't read a
+  // specialization constant, so it remembers what it has validated.
+  DxcValidatorInstance batchValidator;
+  if (pValidatorInstance == nullptr) {
+    CreateValidatorInstance(batchValidator, /*bCacheValidation*/ true);
+    pValidatorInstance = &batchValidator;
+  }
+
+  std::atomic<unsigned> next(0);
+  DxcSpecializeWorker worker;
+  worker.pMalloc = pMalloc;
+  worker.pHighLevelModule = pHighLevelModule;
+  worker.pNames = &names;
+  worker.pPipeline = pPipeline;
+  worker.pValidatorInstance = pValidatorInstance;
+  worker.SerializeFlags = serializeFlags;
+  worker.pEntries = &entries;
+  worker.pNext = &next;
+
+  if (threadCount == 0) {
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    threadCount = sysInfo.dwNumberOfProcessors;
+  }
+  threadCount = std::min<UINT32>(threadCount, specializationCount);
+  std::vector<HANDLE> threads;
+  for (UINT32 i = 1; i < threadCount; ++i) {
+    HANDLE hThread = CreateThread(nullptr, 0, SpecializeThreadProc, &worker,
+                                  0, nullptr);
+    // If a thread can't be started, the others pick up its share.
+    if (hThread == nullptr)
+      break;
+    threads.push_back(hThread);
+  }
+  SpecializeThreadProc(&worker);
+  for (HANDLE hThread : threads) {
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+  }
+
+  for (UINT32 i = 0; i < specializationCount; ++i)
+    CreateEntryResult(entries[i], &ppResults[i]);
+  return S_OK;
+}
+} // namespace dxcutil
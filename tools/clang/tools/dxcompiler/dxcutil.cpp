@@ -25,6 +25,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PhaseTimeReport.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/dxcapi.impl.h"
@@ -45,6 +46,8 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                              _In_ llvm::Module *pDebugModule,
                              _In_ IDxcBlob *pShader, UINT32 Flags,
                              _In_ IDxcOperationResult **ppResult);
+// Has the locally-linked validator remember functions that passed validation.
+void EnableInternalValidatorCache(_In_ IDxcValidator *pValidator);
 
 namespace {
 // AssembleToContainer helper functions.
@@ -76,6 +79,7 @@ public:
                                  AbstractMemoryStream *pModuleBitcode,
                                  CComPtr<IDxcBlob> &pDxilContainerBlob,
                                  SerializeDxilFlags Flags) {
+    llvm::PhaseTimeRegion AssemblyRegion("Container assembly");
     CComPtr<AbstractMemoryStream> pContainerStream;
     IFT(CreateMemoryStream(pMalloc, &pContainerStream));
     SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(),
@@ -96,23 +100,40 @@ private:
 } // namespace
 
 namespace dxcutil {
-void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
-  if (pMajor == nullptr || pMinor == nullptr)
-    return;
-
-  CComPtr<IDxcValidator> pValidator;
-  CreateValidator(pValidator);
+void CreateValidatorInstance(DxcValidatorInstance &instance,
+                             bool bCacheValidation) {
+  instance.Validator.Release();
+  instance.IsInternal = CreateValidator(instance.Validator);
+  if (instance.IsInternal && bCacheValidation)
+    EnableInternalValidatorCache(instance.Validator);
 
   CComPtr<IDxcVersionInfo> pVersionInfo;
-  if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
-    IFT(pVersionInfo->GetVersion(pMajor, pMinor));
+  if (SUCCEEDED(instance.Validator.QueryInterface(&pVersionInfo))) {
+    UINT32 major, minor;
+    IFT(pVersionInfo->GetVersion(&major, &minor));
+    instance.Major = major;
+    instance.Minor = minor;
   } else {
     // Default to 1.0
-    *pMajor = 1;
-    *pMinor = 0;
+    instance.Major = 1;
+    instance.Minor = 0;
   }
 }
 
+void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor,
+                         const DxcValidatorInstance *pValidatorInstance) {
+  if (pMajor == nullptr || pMinor == nullptr)
+    return;
+
+  DxcValidatorInstance localInstance;
+  if (pValidatorInstance == nullptr) {
+    CreateValidatorInstance(localInstance);
+    pValidatorInstance = &localInstance;
+  }
+  *pMajor = pValidatorInstance->Major;
+  *pMinor = pValidatorInstance->Minor;
+}
+
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputBlob,
                          IMalloc *pMalloc,
@@ -129,14 +150,21 @@ HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputBlob,
     IMalloc *pMalloc, SerializeDxilFlags SerializeFlags,
     CComPtr<AbstractMemoryStream> &pOutputStream, bool bDebugInfo,
-    clang::DiagnosticsEngine &Diag) {
+    clang::DiagnosticsEngine &Diag,
+    const DxcValidatorInstance *pValidatorInstance) {
   HRESULT valHR = S_OK;
 
   // Take ownership of the module from the action.
   DxilCompilerLLVMModuleOutput llvmModule(std::move(pM));
 
   CComPtr<IDxcValidator> pValidator;
-  bool bInternalValidator = CreateValidator(pValidator);
+  bool bInternalValidator;
+  if (pValidatorInstance != nullptr) {
+    pValidator = pValidatorInstance->Validator;
+    bInternalValidator = pValidatorInstance->IsInternal;
+  } else {
+    bInternalValidator = CreateValidator(pValidator);
+  }
   // Warning on internal Validator
 
   if (bInternalValidator) {
@@ -159,15 +187,18 @@ HRESULT ValidateAndAssembleToContainer(
                                        SerializeFlags);
 
   CComPtr<IDxcOperationResult> pValResult;
-  // Important: in-place edit is required so the blob is reused and thus
-  // dxil.dll can be released.
-  if (bInternalValidator) {
-    IFT(RunInternalValidator(pValidator, llvmModule.get(),
-                             llvmModule.getWithDebugInfo(), pOutputBlob,
-                             DxcValidatorFlags_InPlaceEdit, &pValResult));
-  } else {
-    IFT(pValidator->Validate(pOutputBlob, DxcValidatorFlags_InPlaceEdit,
-                             &pValResult));
+  {
+    llvm::PhaseTimeRegion ValidationRegion("Validation");
+    // Important: in-place edit is required so the blob is reused and thus
+    // dxil.dll can be released.
+    if (bInternalValidator) {
+      IFT(RunInternalValidator(pValidator, llvmModule.get(),
+                               llvmModule.getWithDebugInfo(), pOutputBlob,
+                               DxcValidatorFlags_InPlaceEdit, &pValResult));
+    } else {
+      IFT(pValidator->Validate(pOutputBlob, DxcValidatorFlags_InPlaceEdit,
+                               &pValResult));
+    }
   }
   IFT(pValResult->GetStatus(&valHR));
   if (FAILED(valHR)) {
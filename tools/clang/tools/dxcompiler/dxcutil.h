@@ -35,18 +35,46 @@ class AbstractMemoryStream;
 
 
 namespace dxcutil {
+// A validator that callers can keep alive across compilations instead of
+// creating one each time.
+struct DxcValidatorInstance {
+  CComPtr<IDxcValidator> Validator;
+  bool IsInternal = false; // The validator linked into dxcompiler is used.
+  unsigned Major = 1;
+  unsigned Minor = 0;
+};
+// bCacheValidation keeps the functions that passed validation, so that
+// validating similar modules later only checks what changed.
+void CreateValidatorInstance(DxcValidatorInstance &instance,
+                             bool bCacheValidation = false);
+
 HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputContainerBlob,
     IMalloc *pMalloc, hlsl::SerializeDxilFlags SerializeFlags,
     CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode, bool bDebugInfo,
-    clang::DiagnosticsEngine &Diag);
-void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
+    clang::DiagnosticsEngine &Diag,
+    const DxcValidatorInstance *pValidatorInstance = nullptr);
+void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor,
+                         const DxcValidatorInstance *pValidatorInstance = nullptr);
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputContainerBlob,
                          IMalloc *pMalloc,
                          hlsl::SerializeDxilFlags SerializeFlags,
                          CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode);
 HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+HRESULT DisassembleMany(IMalloc *pMalloc, UINT32 blobCount, IDxcBlob **ppBlobs,
+                        UINT32 threadCount, IDxcDisassemblyWriter *pWriter);
+HRESULT SpecializeMany(IMalloc *pMalloc, IDxcBlob *pHighLevelModule,
+                       UINT32 constantCount, LPCWSTR *pConstantNames,
+                       UINT32 specializationCount, LPCWSTR *pValues,
+                       UINT32 threadCount,
+                       const DxcValidatorInstance *pValidatorInstance,
+                       IDxcOperationResult **ppResults);
+HRESULT LinkPipeline(IMalloc *pMalloc, UINT32 stageCount, IDxcBlob **ppStages,
+                     UINT32 streamOutputEntryCount,
+                     const DxcStreamOutputEntry *pStreamOutputEntries,
+                     const DxcValidatorInstance *pValidatorInstance,
+                     IDxcOperationResult **ppResults);
 
 void CreateOperationResultFromOutputs(
     IDxcBlob *pResultBlob, CComPtr<IStream> &pErrorStream,
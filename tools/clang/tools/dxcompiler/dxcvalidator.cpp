@@ -49,6 +49,11 @@ struct DiagRestore {
 class DxcValidator : public IDxcValidator, public IDxcVersionInfo {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
+  // Functions that passed validation, so that validating similar modules
+  // with this object only checks what changed. Only created for validators
+  // that are kept across compilations, as building the keys costs a hash
+  // of the module that a one-shot validation can't win back.
+  std::unique_ptr<DxilValidationCache> m_pValidationCache;
 
   HRESULT RunValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
@@ -78,6 +83,15 @@ public:
     _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
   );
 
+  // For internal use only.
+  void EnableValidationCache() {
+    if (!m_pValidationCache)
+      m_pValidationCache.reset(new DxilValidationCache());
+  }
+  DxilValidationCache *GetValidationCache() {
+    return m_pValidationCache.get();
+  }
+
   // IDxcValidator
   __override HRESULT STDMETHODCALLTYPE Validate(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
@@ -188,7 +202,7 @@ HRESULT DxcValidator::RunValidation(
     if (Flags & DxcValidatorFlags_ModuleOnly) {
       return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream, m_pValidationCache.get());
     }
   }
 
@@ -196,7 +210,7 @@ HRESULT DxcValidator::RunValidation(
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(pModule->getContext(), &DiagContext);
 
-  IFR(hlsl::ValidateDxilModule(pModule, pDebugModule));
+  IFR(hlsl::ValidateDxilModule(pModule, pDebugModule, m_pValidationCache.get()));
   if (!(Flags & DxcValidatorFlags_ModuleOnly)) {
     IFR(ValidateDxilContainerParts(pModule, pDebugModule,
                       IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize()),
@@ -259,6 +273,29 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                                                     pDebugModule, ppResult);
 }
 
+void EnableInternalValidatorCache(_In_ IDxcValidator *pValidator) {
+  DXASSERT_NOMSG(pValidator != nullptr);
+  DxcValidator *pInternalValidator = (DxcValidator *)pValidator;
+  pInternalValidator->EnableValidationCache();
+}
+
+void GetInternalValidatorCacheStatistics(
+    _In_ IDxcValidator *pValidator,
+    _Out_ DxcValidationCacheStatistics *pStats) {
+  DXASSERT_NOMSG(pValidator != nullptr);
+  DxcValidator *pInternalValidator = (DxcValidator *)pValidator;
+  DxilValidationCache *pCache = pInternalValidator->GetValidationCache();
+  pStats->FunctionsValidated = pCache ? pCache->GetValidatedFunctionCount() : 0;
+  pStats->FunctionsCached = pCache ? pCache->GetCachedFunctionCount() : 0;
+}
+
+void ResetInternalValidatorCacheStatistics(_In_ IDxcValidator *pValidator) {
+  DXASSERT_NOMSG(pValidator != nullptr);
+  DxcValidator *pInternalValidator = (DxcValidator *)pValidator;
+  if (DxilValidationCache *pCache = pInternalValidator->GetValidationCache())
+    pCache->ResetStatistics();
+}
+
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID* ppv) {
   try {
       CComPtr<DxcValidator> result(DxcValidator::Alloc(DxcGetThreadMallocNoRef()));
@@ -381,6 +381,28 @@ public:
   }
 };
 
+class TestDisassemblyWriter : public IDxcDisassemblyWriter {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestDisassemblyWriter() : m_dwRef(0) { }
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) {
+    return DoBasicQueryInterface<IDxcDisassemblyWriter>(this, iid, ppvObject);
+  }
+
+  std::vector<UINT32> Indices;
+  std::vector<HRESULT> Statuses;
+  std::vector<std::string> Texts;
+
+  __override HRESULT STDMETHODCALLTYPE WriteDisassembly(
+    UINT32 index, HRESULT status, _In_reads_(textSize) LPCSTR pText, SIZE_T textSize) {
+    Indices.push_back(index);
+    Statuses.push_back(status);
+    Texts.push_back(std::string(pText, textSize));
+    return S_OK;
+  }
+};
+
 class CompilerTest {
 public:
   BEGIN_TEST_CLASS(CompilerTest)
@@ -398,6 +420,17 @@ public:
   TEST_METHOD(CompileWhenEmptyThenFails)
   TEST_METHOD(CompileWhenIncorrectThenFails)
   TEST_METHOD(CompileWhenWorksThenDisassembleWorks)
+  TEST_METHOD(CompileWhenDisassembleManyThenMatchesDisassemble)
+  TEST_METHOD(CompileWhenDisassembleManyOnOneThreadThenTypeNamesKept)
+  TEST_METHOD(CompileWhenSpecializeThenConstantsAreBound)
+  TEST_METHOD(CompileWhenSpecializeWithDebugInfoThenDebugNameKept)
+  TEST_METHOD(CompileWhenLinkPipelineThenUnreadOutputsRemoved)
+  TEST_METHOD(CompileWhenLinkPipelineWithStreamOutputThenDeclaredOutputsKept)
+  TEST_METHOD(CompileWhenArenaAllocThenSameOutput)
+  TEST_METHOD(CompileWhenTimeReportThenPhasesReported)
+  TEST_METHOD(CompileWhenSessionThenSameOutput)
+  TEST_METHOD(CompileWhenSessionAlternatesShadersThenSameOutput)
+  TEST_METHOD(CompileWhenSessionRecompilesThenOnlyChangedFunctionsValidated)
   TEST_METHOD(CompileWhenDebugWorksThenStripDebug)
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
@@ -406,6 +439,11 @@ public:
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
+  TEST_METHOD(CompileWhenCacheDirThenRepeatHitsCache)
+  TEST_METHOD(CompileWhenCacheOverBudgetThenEvicted)
+  TEST_METHOD(CompileWhenIncludeCacheThenLoadOnce)
+  TEST_METHOD(CompileWhenIncludeCacheReadsDiskThenFileCanChange)
+  TEST_METHOD(CompileWhenManyIncludesThenOK)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
   TEST_METHOD(CompileWhenIncludeSystemThenLoadNotRelative)
   TEST_METHOD(CompileWhenIncludeSystemMissingThenLoadAttempt)
@@ -418,6 +456,7 @@ public:
   TEST_METHOD(CompileWhenVdThenProducesDxilContainer)
 
   TEST_METHOD(CompileWhenNoMemThenOOM)
+  TEST_METHOD(CompileWhenArenaAllocThenNothingOutlivesArena)
   TEST_METHOD(CompileWhenShaderModelMismatchAttributeThenFail)
   TEST_METHOD(CompileBadHlslThenFail)
   TEST_METHOD(CompileLegacyShaderModelThenFail)
@@ -1133,6 +1172,7 @@ public:
   TEST_METHOD(DxilGen_StoreOutput)
   TEST_METHOD(ConstantFolding)
   TEST_METHOD(HoistConstantArray)
+  TEST_METHOD(DxilTargetTransformInfo)
   TEST_METHOD(VecElemConstEval)
   TEST_METHOD(ViewID)
   TEST_METHOD(ShaderCompatSuite)
@@ -2036,6 +2076,572 @@ TEST_F(CompilerTest, CompileWhenWorksThenDisassembleWorks) {
   // WEX::Logging::Log::Comment(disassembleStringW.m_psz);
 }
 
+TEST_F(CompilerTest, CompileWhenDisassembleManyThenMatchesDisassemble) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBatchDisassembler> pBatch;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pBatch));
+
+  // Several programs, with one that can't be disassembled in the middle.
+  const char *pSources[] = {
+    "float4 main() : SV_Target { return 0; }",
+    "float4 main(float4 a : A) : SV_Target { return a * 2; }",
+    nullptr,
+    "float4 main(float4 a : A) : SV_Position { return sqrt(a); }",
+  };
+  const LPCWSTR pProfiles[] = { L"ps_6_0", L"ps_6_0", nullptr, L"vs_6_0" };
+  const UINT32 count = _countof(pSources);
+  std::vector<CComPtr<IDxcBlob>> programs(count);
+  std::vector<IDxcBlob *> blobs(count);
+  for (UINT32 i = 0; i < count; ++i) {
+    if (pSources[i] == nullptr) {
+      CComPtr<IDxcBlobEncoding> pText;
+      CreateBlobFromText("not a program", &pText);
+      programs[i] = pText;
+    } else {
+      CComPtr<IDxcBlobEncoding> pSource;
+      CComPtr<IDxcOperationResult> pResult;
+      CreateBlobFromText(pSources[i], &pSource);
+      VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                          pProfiles[i], nullptr, 0, nullptr, 0,
+                                          nullptr, &pResult));
+      HRESULT result;
+      VERIFY_SUCCEEDED(pResult->GetStatus(&result));
+      VERIFY_SUCCEEDED(result);
+      VERIFY_SUCCEEDED(pResult->GetResult(&programs[i]));
+    }
+    blobs[i] = programs[i];
+  }
+
+  CComPtr<TestDisassemblyWriter> pWriter = new TestDisassemblyWriter();
+  VERIFY_SUCCEEDED(pBatch->DisassembleMany(count, blobs.data(), 2, pWriter));
+
+  // Texts arrive in order and match what Disassemble returns.
+  VERIFY_ARE_EQUAL((size_t)count, pWriter->Indices.size());
+  for (UINT32 i = 0; i < count; ++i) {
+    VERIFY_ARE_EQUAL(i, pWriter->Indices[i]);
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    HRESULT hr = pCompiler->Disassemble(blobs[i], &pDisassembly);
+    VERIFY_ARE_EQUAL(hr, pWriter->Statuses[i]);
+    if (FAILED(hr)) {
+      VERIFY_IS_TRUE(pWriter->Texts[i].empty());
+      continue;
+    }
+    std::string expected = BlobToUtf8(pDisassembly);
+    VERIFY_ARE_EQUAL_STR(expected.c_str(), pWriter->Texts[i].c_str());
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenDisassembleManyOnOneThreadThenTypeNamesKept) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBatchDisassembler> pBatch;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pBatch));
+
+  // Programs that all use resources, and so share named struct types like
+  // %dx.types.Handle, disassembled one after the other on the same thread.
+  const char *pSources[] = {
+    "Texture2D t; SamplerState s;"
+    "float4 main(float2 uv : UV) : SV_Target { return t.Sample(s, uv); }",
+    "cbuffer C { float4 c; };"
+    "float4 main() : SV_Target { return c; }",
+    "struct S { float4 f; }; StructuredBuffer<S> b;"
+    "float4 main(uint i : I) : SV_Target { return b[i].f; }",
+    "Texture2D t; SamplerState s; cbuffer C { float4 c; };"
+    "float4 main(float2 uv : UV) : SV_Target { return t.Sample(s, uv) * c; }",
+  };
+  const UINT32 count = _countof(pSources);
+  std::vector<CComPtr<IDxcBlob>> programs(count);
+  std::vector<IDxcBlob *> blobs(count);
+  for (UINT32 i = 0; i < count; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText(pSources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    HRESULT result;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&result));
+    VERIFY_SUCCEEDED(result);
+    VERIFY_SUCCEEDED(pResult->GetResult(&programs[i]));
+    blobs[i] = programs[i];
+  }
+
+  CComPtr<TestDisassemblyWriter> pWriter = new TestDisassemblyWriter();
+  VERIFY_SUCCEEDED(pBatch->DisassembleMany(count, blobs.data(), 1, pWriter));
+
+  VERIFY_ARE_EQUAL((size_t)count, pWriter->Texts.size());
+  for (UINT32 i = 0; i < count; ++i) {
+    VERIFY_SUCCEEDED(pWriter->Statuses[i]);
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(blobs[i], &pDisassembly));
+    std::string expected = BlobToUtf8(pDisassembly);
+    VERIFY_ARE_EQUAL_STR(expected.c_str(), pWriter->Texts[i].c_str());
+    VERIFY_IS_TRUE(std::string::npos !=
+                   pWriter->Texts[i].find("%dx.types.Handle = type"));
+    VERIFY_IS_TRUE(std::string::npos ==
+                   pWriter->Texts[i].find("%dx.types.Handle.0"));
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenSpecializeThenConstantsAreBound) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcSpecializer> pSpecializer;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pHighLevel;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pSpecializer));
+
+  CreateBlobFromText("static const int kMode = 0;\r\n"
+                     "static const float kScale = 1.0;\r\n"
+                     "float4 main(float4 a : A) : SV_Target {\r\n"
+                     "  if (kMode == 1) return a * kScale;\r\n"
+                     "  return a + kScale;\r\n"
+                     "}", &pSource);
+  LPCWSTR args[] = { L"/fcgl", L"/specialize-constant", L"kMode",
+                     L"/specialize-constant", L"kScale" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  HRESULT hrStatus;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevel));
+
+  // The last row has a value that doesn't parse as an int.
+  LPCWSTR names[] = { L"kMode", L"kScale" };
+  LPCWSTR values[] = { L"1", L"3.0",
+                       L"0", L"2.5",
+                       L"x", L"1" };
+  const UINT32 count = _countof(values) / _countof(names);
+  IDxcOperationResult *results[count];
+  VERIFY_SUCCEEDED(pSpecializer->Specialize(pHighLevel, _countof(names),
+                                            names, count, values, 2,
+                                            results));
+  std::vector<CComPtr<IDxcOperationResult>> owned(count);
+  for (UINT32 i = 0; i < count; ++i)
+    owned[i].Attach(results[i]);
+
+  const char *pExpectedOps[] = { "fmul", "fadd" };
+  const char *pExpectedValues[] = { "3.000000e+00", "2.500000e+00" };
+  for (UINT32 i = 0; i < 2; ++i) {
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(owned[i]->GetStatus(&hrStatus));
+    VERIFY_SUCCEEDED(hrStatus);
+    VERIFY_SUCCEEDED(owned[i]->GetResult(&pProgram));
+    std::string disassembly = DisassembleProgram(m_dllSupport, pProgram);
+    VERIFY_IS_TRUE(disassembly.find(pExpectedOps[i]) != std::string::npos);
+    VERIFY_IS_TRUE(disassembly.find(pExpectedValues[i]) != std::string::npos);
+  }
+  VERIFY_SUCCEEDED(owned[2]->GetStatus(&hrStatus));
+  VERIFY_FAILED(hrStatus);
+
+  // Names that weren't left unresolved are rejected up front.
+  LPCWSTR unknownNames[] = { L"kOther" };
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pSpecializer->Specialize(pHighLevel, 1, unknownNames, 1,
+                                            values, 1, results));
+}
+
+TEST_F(CompilerTest, CompileWhenSpecializeWithDebugInfoThenDebugNameKept) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcSpecializer> pSpecializer;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pSpecializer));
+
+  CreateBlobFromText("static const int kMode = 0;\r\n"
+                     "float4 main(float4 a : A) : SV_Target {\r\n"
+                     "  if (kMode == 1) return a * 2;\r\n"
+                     "  return a;\r\n"
+                     "}", &pSource);
+
+  // The specialized container has the debug parts only if the high-level
+  // compilation asked for them.
+  const bool debugInfo[] = { true, false };
+  for (bool withDebugInfo : debugInfo) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pHighLevel;
+    std::vector<LPCWSTR> args = { L"/fcgl", L"/specialize-constant",
+                                  L"kMode" };
+    if (withDebugInfo)
+      args.push_back(L"/Zi");
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", args.data(),
+                                        (UINT32)args.size(), nullptr, 0,
+                                        nullptr, &pResult));
+    HRESULT hrStatus;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&hrStatus));
+    VERIFY_SUCCEEDED(hrStatus);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevel));
+
+    LPCWSTR names[] = { L"kMode" };
+    LPCWSTR values[] = { L"1" };
+    IDxcOperationResult *results[1];
+    VERIFY_SUCCEEDED(pSpecializer->Specialize(pHighLevel, 1, names, 1,
+                                              values, 1, results));
+    CComPtr<IDxcOperationResult> pSpecialized;
+    pSpecialized.Attach(results[0]);
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pSpecialized->GetStatus(&hrStatus));
+    VERIFY_SUCCEEDED(hrStatus);
+    VERIFY_SUCCEEDED(pSpecialized->GetResult(&pProgram));
+
+    hlsl::DxilContainerHeader *pContainerHeader =
+      (hlsl::DxilContainerHeader *)(pProgram->GetBufferPointer());
+    hlsl::DxilPartHeader *pDebugName = hlsl::GetDxilPartByType(
+      pContainerHeader, hlsl::DxilFourCC::DFCC_ShaderDebugName);
+    hlsl::DxilPartHeader *pDebugInfo = hlsl::GetDxilPartByType(
+      pContainerHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL);
+    VERIFY_ARE_EQUAL(withDebugInfo, pDebugName != nullptr);
+    VERIFY_ARE_EQUAL(withDebugInfo, pDebugInfo != nullptr);
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenLinkPipelineThenUnreadOutputsRemoved) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcPipelineLinker> pLinker;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pLinker));
+
+  // The pixel shader declares both texture coordinates but reads only one.
+  const char *pSources[] = {
+    "struct VSOut { float4 pos : SV_Position; float4 a : TEXCOORD0; float4 b : TEXCOORD1; };\r\n"
+    "VSOut main(float4 p : POSITION, float4 n : NORMAL) {\r\n"
+    "  VSOut o; o.pos = p; o.a = n * 2; o.b = p + 1; return o;\r\n"
+    "}",
+    "float4 main(float4 pos : SV_Position, float4 a : TEXCOORD0,\r\n"
+    "            float4 b : TEXCOORD1) : SV_Target { return b; }",
+  };
+  const LPCWSTR pProfiles[] = { L"vs_6_0", L"ps_6_0" };
+  CComPtr<IDxcBlob> pPrograms[2];
+  for (UINT32 i = 0; i < 2; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText(pSources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        pProfiles[i], nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pPrograms[i]));
+  }
+  std::string original = DisassembleProgram(m_dllSupport, pPrograms[0]);
+  VERIFY_IS_TRUE(original.find("fmul") != std::string::npos);
+
+  IDxcBlob *stages[] = { pPrograms[0], pPrograms[1] };
+  IDxcOperationResult *results[2];
+  VERIFY_SUCCEEDED(pLinker->LinkPipeline(2, stages, 0, nullptr, results));
+  CComPtr<IDxcOperationResult> pVSResult, pPSResult;
+  pVSResult.Attach(results[0]);
+  pPSResult.Attach(results[1]);
+
+  // TEXCOORD0 and the multiply computing it are gone from the vertex
+  // shader, and the pixel shader no longer declares it.
+  HRESULT hrStatus;
+  CComPtr<IDxcBlob> pVS, pPS;
+  VERIFY_SUCCEEDED(pVSResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pVSResult->GetResult(&pVS));
+  VERIFY_SUCCEEDED(pPSResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pPSResult->GetResult(&pPS));
+  std::string vs = DisassembleProgram(m_dllSupport, pVS);
+  std::string ps = DisassembleProgram(m_dllSupport, pPS);
+  VERIFY_IS_TRUE(vs.find("fmul") == std::string::npos);
+  VERIFY_IS_TRUE(vs.find("TEXCOORD                 0") == std::string::npos);
+  VERIFY_IS_TRUE(vs.find("TEXCOORD                 1") != std::string::npos);
+  VERIFY_IS_TRUE(ps.find("TEXCOORD                 0") == std::string::npos);
+  VERIFY_IS_TRUE(ps.find("TEXCOORD                 1") != std::string::npos);
+
+  // Stages must come in pipeline order.
+  IDxcBlob *reversed[] = { pPrograms[1], pPrograms[0] };
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pLinker->LinkPipeline(2, reversed, 0, nullptr, results));
+}
+
+TEST_F(CompilerTest, CompileWhenLinkPipelineWithStreamOutputThenDeclaredOutputsKept) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcPipelineLinker> pLinker;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pLinker));
+
+  // A vertex shader feeding stream output, with no pixel shader.
+  CreateBlobFromText(
+    "struct VSOut { float4 pos : SV_Position; float4 a : TEXCOORD0; float4 b : TEXCOORD1; };\r\n"
+    "VSOut main(float4 p : POSITION, float4 n : NORMAL) {\r\n"
+    "  VSOut o; o.pos = p; o.a = n * 2; o.b = p + 1; return o;\r\n"
+    "}", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"vs_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // Only TEXCOORD0 is streamed out, so TEXCOORD1 is the only output removed.
+  DxcStreamOutputEntry entries[] = { { 0, L"TEXCOORD", 0 } };
+  IDxcBlob *stages[] = { pProgram };
+  IDxcOperationResult *results[1];
+  VERIFY_SUCCEEDED(pLinker->LinkPipeline(1, stages, _countof(entries),
+                                         entries, results));
+  CComPtr<IDxcOperationResult> pVSResult;
+  pVSResult.Attach(results[0]);
+  HRESULT hrStatus;
+  CComPtr<IDxcBlob> pVS;
+  VERIFY_SUCCEEDED(pVSResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pVSResult->GetResult(&pVS));
+  std::string vs = DisassembleProgram(m_dllSupport, pVS);
+  VERIFY_IS_TRUE(vs.find("fmul") != std::string::npos);
+  VERIFY_IS_TRUE(vs.find("TEXCOORD                 0") != std::string::npos);
+  VERIFY_IS_TRUE(vs.find("TEXCOORD                 1") == std::string::npos);
+
+  // Entries must name a semantic.
+  DxcStreamOutputEntry unnamed[] = { { 0, nullptr, 0 } };
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pLinker->LinkPipeline(1, stages, _countof(unnamed),
+                                         unnamed, results));
+}
+
+TEST_F(CompilerTest, CompileWhenArenaAllocThenSameOutput) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcArenaStatistics> pStatistics;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult, pArenaResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStatistics));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 2;\r\n"
+                     "}", &pSource);
+
+  LPCWSTR args[] = { L"-arena-alloc" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, nullptr, &pArenaResult));
+  VerifyOperationSucceeded(pResult);
+  VerifyOperationSucceeded(pArenaResult);
+
+  CComPtr<IDxcBlob> pProgram, pArenaProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  VERIFY_SUCCEEDED(pArenaResult->GetResult(&pArenaProgram));
+  VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pArenaProgram->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(),
+                             pArenaProgram->GetBufferPointer(),
+                             pProgram->GetBufferSize()));
+
+  DxcArenaStatistics stats;
+  VERIFY_SUCCEEDED(pStatistics->GetArenaStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)1, stats.Compilations);
+  VERIFY_IS_TRUE(stats.PeakLiveBytes > 0);
+  VERIFY_IS_TRUE(stats.PeakReservedBytes >= stats.PeakLiveBytes);
+}
+
+TEST_F(CompilerTest, CompileWhenTimeReportThenPhasesReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult, pReportResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 2;\r\n"
+                     "}", &pSource);
+
+  LPCWSTR args[] = { L"-ftime-report" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, nullptr, &pReportResult));
+  VerifyOperationSucceeded(pResult);
+  VerifyOperationSucceeded(pReportResult);
+
+  // No report unless requested.
+  CComPtr<IDxcTimeReport> pTimeReport;
+  CComPtr<IDxcBlobEncoding> pReport;
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+  VERIFY_ARE_EQUAL(S_FALSE, pTimeReport->GetTimeReport(&pReport));
+  VERIFY_IS_TRUE(pReport == nullptr);
+
+  pTimeReport.Release();
+  VERIFY_SUCCEEDED(pReportResult.QueryInterface(&pTimeReport));
+  VERIFY_ARE_EQUAL(S_OK, pTimeReport->GetTimeReport(&pReport));
+  std::string report = BlobToUtf8(pReport);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("Frontend"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("Parse and Sema"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("HLSL module finalization"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("DXIL Generator"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("Validation"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("Container assembly"));
+
+  // The output doesn't depend on the report.
+  CComPtr<IDxcBlob> pProgram, pReportProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  VERIFY_SUCCEEDED(pReportResult->GetResult(&pReportProgram));
+  VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pReportProgram->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(),
+                             pReportProgram->GetBufferPointer(),
+                             pProgram->GetBufferSize()));
+}
+
+TEST_F(CompilerTest, CompileWhenSessionThenSameOutput) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 2;\r\n"
+                     "}", &pSource);
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // Every compilation in the session must match the standalone compiler.
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pSessionResult;
+    VERIFY_SUCCEEDED(pSession->Compile(pSource, L"source.hlsl", L"main",
+                                       L"ps_6_0", nullptr, 0, nullptr, 0,
+                                       nullptr, &pSessionResult));
+    VerifyOperationSucceeded(pSessionResult);
+    CComPtr<IDxcBlob> pSessionProgram;
+    VERIFY_SUCCEEDED(pSessionResult->GetResult(&pSessionProgram));
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pSessionProgram->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(),
+                               pSessionProgram->GetBufferPointer(),
+                               pProgram->GetBufferSize()));
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenSessionAlternatesShadersThenSameOutput) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcBlobEncoding> pSources[2];
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 2;\r\n"
+                     "}", &pSources[0]);
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 3;\r\n"
+                     "}", &pSources[1]);
+
+  auto compile = [&](IDxcCompiler *pCompilerToUse, IDxcBlobEncoding *pSource,
+                     IDxcBlob **ppProgram) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompilerToUse->Compile(pSource, L"source.hlsl", L"main",
+                                             L"ps_6_0", nullptr, 0, nullptr, 0,
+                                             nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppProgram));
+  };
+
+  CComPtr<IDxcBlob> pPrograms[2];
+  compile(pCompiler, pSources[0], &pPrograms[0]);
+  compile(pCompiler, pSources[1], &pPrograms[1]);
+
+  // The session's validator remembers the functions it has validated; going
+  // back and forth between shaders must not change what either produces.
+  for (int i = 0; i < 4; ++i) {
+    CComPtr<IDxcBlob> pSessionProgram;
+    compile(pSession, pSources[i % 2], &pSessionProgram);
+    IDxcBlob *pProgram = pPrograms[i % 2];
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pSessionProgram->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(),
+                               pSessionProgram->GetBufferPointer(),
+                               pProgram->GetBufferSize()));
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenSessionRecompilesThenOnlyChangedFunctionsValidated) {
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcValidationCacheStatistics> pStatistics;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  VERIFY_SUCCEEDED(pSession.QueryInterface(&pStatistics));
+
+  // The hull shader has two function bodies, the entry and the patch
+  // constant function; only the latter changes between compilations.
+  auto compile = [&](const char *pInside, IDxcOperationResult **ppResult) {
+    std::string source =
+      "struct ControlPoint { float4 pos : POSITION; };\r\n"
+      "struct PatchConstants {\r\n"
+      "  float edges[3] : SV_TessFactor;\r\n"
+      "  float inside : SV_InsideTessFactor;\r\n"
+      "};\r\n"
+      "PatchConstants PatchFunc(InputPatch<ControlPoint, 3> ip) {\r\n"
+      "  PatchConstants pc;\r\n"
+      "  float a;\r\n"
+      "  pc.edges[0] = pc.edges[1] = pc.edges[2] = ip[0].pos.x;\r\n"
+      "  pc.inside = ";
+    source += pInside;
+    source +=
+      ";\r\n"
+      "  return pc;\r\n"
+      "}\r\n"
+      "[domain(\"tri\")]\r\n"
+      "[partitioning(\"fractional_odd\")]\r\n"
+      "[outputtopology(\"triangle_cw\")]\r\n"
+      "[outputcontrolpoints(3)]\r\n"
+      "[patchconstantfunc(\"PatchFunc\")]\r\n"
+      "ControlPoint main(InputPatch<ControlPoint, 3> ip,\r\n"
+      "                  uint i : SV_OutputControlPointID) {\r\n"
+      "  ControlPoint cp;\r\n"
+      "  cp.pos = ip[i].pos * 2;\r\n"
+      "  return cp;\r\n"
+      "}\r\n";
+    CComPtr<IDxcBlobEncoding> pSource;
+    CreateBlobFromText(source.c_str(), &pSource);
+    VERIFY_SUCCEEDED(pStatistics->ResetValidationCacheStatistics());
+    VERIFY_SUCCEEDED(pSession->Compile(pSource, L"source.hlsl", L"main",
+                                       L"hs_6_0", nullptr, 0, nullptr, 0,
+                                       nullptr, ppResult));
+  };
+  auto verifyStatistics = [&](UINT64 validated, UINT64 cached) {
+    DxcValidationCacheStatistics stats;
+    VERIFY_SUCCEEDED(pStatistics->GetValidationCacheStatistics(&stats));
+    VERIFY_ARE_EQUAL(validated, stats.FunctionsValidated);
+    VERIFY_ARE_EQUAL(cached, stats.FunctionsCached);
+  };
+
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    compile("ip[1].pos.y + 2", &pResult);
+    VerifyOperationSucceeded(pResult);
+    verifyStatistics(2, 0);
+  }
+
+  // Only the changed patch constant function is validated again.
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    compile("ip[1].pos.y + 3", &pResult);
+    VerifyOperationSucceeded(pResult);
+    verifyStatistics(1, 1);
+  }
+
+  // A function that fails validation is never taken from the cache, so its
+  // diagnostics are reported each time it is compiled.
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    compile("ip[1].pos.y + a", &pResult);
+    std::string failLog(VerifyOperationFailed(pResult));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+      failLog.find("Instructions should not read uninitialized value"));
+    verifyStatistics(1, 1);
+  }
+}
+
 TEST_F(CompilerTest, CompileWhenDebugWorksThenStripDebug) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2289,6 +2895,332 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
   VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
+TEST_F(CompilerTest, CompileWhenCacheDirThenRepeatHitsCache) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompileCacheStatistics> pStatistics;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStatistics));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  wchar_t TempPath[MAX_PATH];
+  DWORD length = GetTempPathW(MAX_PATH, TempPath);
+  VERIFY_WIN32_BOOL_SUCCEEDED(length != 0);
+  std::wstring cacheDir(TempPath);
+  cacheDir += L"dxc_cache_test_";
+  cacheDir += std::to_wstring(GetTickCount64());
+  LPCWSTR args[] = { L"-cache-dir", cacheDir.c_str() };
+
+  // Remove the cache directory however the test exits.
+  struct CacheDirCleanup {
+    const std::wstring &Dir;
+    ~CacheDirCleanup() {
+      WIN32_FIND_DATAW findData;
+      HANDLE hFind = FindFirstFileW((Dir + L"\\*").c_str(), &findData);
+      if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+          if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            DeleteFileW((Dir + L"\\" + findData.cFileName).c_str());
+        } while (FindNextFileW(hFind, &findData));
+        FindClose(hFind);
+      }
+      RemoveDirectoryW(Dir.c_str());
+    }
+  } cleanup = { cacheDir };
+
+  // Each compilation must ask the include handler for helper.h exactly once,
+  // whether it is served from the cache or not.
+  auto compile = [&](const char *pHelper, IDxcBlob **ppContainer) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    CComPtr<IDxcOperationResult> pResult;
+    pInclude->CallResults.emplace_back(pHelper);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+    VERIFY_SUCCEEDED(pResult->GetResult(ppContainer));
+  };
+
+  CComPtr<IDxcBlob> pFirst, pSecond, pChanged;
+  DxcCompileCacheStatistics stats;
+  compile("#define ZERO 0", &pFirst);
+  compile("#define ZERO 0", &pSecond);
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)1, stats.Hits);
+  VERIFY_ARE_EQUAL((UINT64)1, stats.Stores);
+  VERIFY_ARE_EQUAL(pFirst->GetBufferSize(), pSecond->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pFirst->GetBufferPointer(),
+                             pSecond->GetBufferPointer(),
+                             pFirst->GetBufferSize()));
+
+  // A change to an included file must not be served from the cache.
+  compile("#define ZERO 1", &pChanged);
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)1, stats.Hits);
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Misses);
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Stores);
+  VERIFY_IS_FALSE(pChanged->GetBufferSize() == pFirst->GetBufferSize() &&
+                  0 == memcmp(pChanged->GetBufferPointer(),
+                              pFirst->GetBufferPointer(),
+                              pFirst->GetBufferSize()));
+}
+
+TEST_F(CompilerTest, CompileWhenCacheOverBudgetThenEvicted) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompileCacheStatistics> pStatistics;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStatistics));
+
+  wchar_t TempPath[MAX_PATH];
+  DWORD length = GetTempPathW(MAX_PATH, TempPath);
+  VERIFY_WIN32_BOOL_SUCCEEDED(length != 0);
+  std::wstring cacheDir(TempPath);
+  cacheDir += L"dxc_cache_budget_test_";
+  cacheDir += std::to_wstring(GetTickCount64());
+
+  // Remove the cache directory however the test exits.
+  struct CacheDirCleanup {
+    const std::wstring &Dir;
+    ~CacheDirCleanup() {
+      WIN32_FIND_DATAW findData;
+      HANDLE hFind = FindFirstFileW((Dir + L"\\*").c_str(), &findData);
+      if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+          if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            DeleteFileW((Dir + L"\\" + findData.cFileName).c_str());
+        } while (FindNextFileW(hFind, &findData));
+        FindClose(hFind);
+      }
+      RemoveDirectoryW(Dir.c_str());
+    }
+  } cleanup = { cacheDir };
+
+  auto compile = [&](const char *pText, LPCWSTR pMaxSizeInMB) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    LPCWSTR args[] = { L"-cache-dir", cacheDir.c_str(),
+                       L"-cache-max-size", pMaxSizeInMB };
+    CreateBlobFromText(pText, &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+  };
+  auto fileExists = [&](LPCWSTR pName) {
+    std::wstring path = cacheDir + L"\\" + pName;
+    return GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+  };
+  const char *pShaderA = "float4 main() : SV_Target { return 1; }";
+  const char *pShaderB = "float4 main() : SV_Target { return 2; }";
+  const char *pShaderC = "float4 main() : SV_Target { return 3; }";
+
+  // Without room for anything, each stored entry is evicted right away.
+  DxcCompileCacheStatistics stats;
+  compile(pShaderA, L"0");
+  compile(pShaderA, L"0");
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)0, stats.Hits);
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Stores);
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Evictions);
+  VERIFY_IS_TRUE(fileExists(L"index.dxcci"));
+
+  // Within the budget, stores add to the total kept in the index instead of
+  // enumerating the directory, so a 2MB entry written behind the cache's
+  // back goes unnoticed.
+  compile(pShaderA, L"1");
+  {
+    std::ofstream file(cacheDir + L"\\foreign.dxcc",
+                       std::ios::binary | std::ios::trunc);
+    std::string contents(2 * 1024 * 1024, '\0');
+    file.write(contents.data(), contents.size());
+    file.close();
+    VERIFY_IS_FALSE(file.fail());
+  }
+  compile(pShaderB, L"1");
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)4, stats.Stores);
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Evictions);
+  VERIFY_IS_TRUE(fileExists(L"foreign.dxcc"));
+
+  // Once the index is gone, the next store scans the directory and evicts
+  // until the cache fits, which can't include the 2MB entry.
+  VERIFY_WIN32_BOOL_SUCCEEDED(
+    DeleteFileW((cacheDir + L"\\index.dxcci").c_str()));
+  compile(pShaderC, L"1");
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)5, stats.Stores);
+  VERIFY_IS_TRUE(stats.Evictions > 2);
+  VERIFY_IS_FALSE(fileExists(L"foreign.dxcc"));
+  VERIFY_IS_TRUE(fileExists(L"index.dxcci"));
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheThenLoadOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcIncludeCache> pCache;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcIncludeCache, &pCache));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  auto createInclude = [&](const char *pHelper) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back(pHelper);
+    return pInclude;
+  };
+  auto compile = [&](TestIncludeHandler *pInclude, LPCWSTR pNamespace,
+                     IDxcBlob **ppContainer) -> std::wstring {
+    CComPtr<IDxcIncludeHandler> pCachingInclude;
+    CComPtr<IDxcOperationResult> pResult;
+    pInclude->CallInfos.clear();
+    VERIFY_SUCCEEDED(pCache->CreateIncludeHandler(
+      pInclude, pNamespace, DxcIncludeCacheFlags_None, &pCachingInclude));
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pCachingInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppContainer));
+    return pInclude->GetAllFileNames();
+  };
+  auto isSameBlob = [](IDxcBlob *pA, IDxcBlob *pB) {
+    return pA->GetBufferSize() == pB->GetBufferSize() &&
+           0 == memcmp(pA->GetBufferPointer(), pB->GetBufferPointer(),
+                       pA->GetBufferSize());
+  };
+
+  // Like most callers, every compilation creates its own inner handler, each
+  // with at most one result to give. Within a namespace, the second compile
+  // is served from the cache even though its inner handler is different.
+  CComPtr<TestIncludeHandler> pShared[] = {
+    createInclude("#define ZERO 0"), createInclude("#define ZERO 0") };
+  CComPtr<IDxcBlob> pFirst, pSecond;
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;",
+                        compile(pShared[0], L"shared", &pFirst).c_str());
+  VERIFY_ARE_EQUAL_WSTR(L"",
+                        compile(pShared[1], L"shared", &pSecond).c_str());
+  VERIFY_IS_TRUE(isSameBlob(pFirst, pSecond));
+
+  // A different namespace doesn't see those entries.
+  CComPtr<TestIncludeHandler> pOtherInclude = createInclude("#define ZERO 1");
+  CComPtr<IDxcBlob> pOther;
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;",
+                        compile(pOtherInclude, L"other", &pOther).c_str());
+  VERIFY_IS_FALSE(isSameBlob(pFirst, pOther));
+
+  // Without a namespace, entries are only shared between handlers created for
+  // the same inner handler; a different inner handler sees its own contents.
+  CComPtr<TestIncludeHandler> pOwn[] = {
+    createInclude("#define ZERO 0"), createInclude("#define ZERO 1") };
+  CComPtr<IDxcBlob> pOwnFirst, pOwnAgain, pOwnOther;
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;",
+                        compile(pOwn[0], nullptr, &pOwnFirst).c_str());
+  VERIFY_ARE_EQUAL_WSTR(L"",
+                        compile(pOwn[0], nullptr, &pOwnAgain).c_str());
+  VERIFY_IS_TRUE(isSameBlob(pOwnFirst, pOwnAgain));
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;",
+                        compile(pOwn[1], nullptr, &pOwnOther).c_str());
+  VERIFY_IS_TRUE(isSameBlob(pOwnOther, pOther));
+  VERIFY_IS_FALSE(isSameBlob(pOwnFirst, pOwnOther));
+
+  // Once cleared, the file is loaded through the inner handler again.
+  CComPtr<TestIncludeHandler> pClearedInclude = createInclude("#define ZERO 0");
+  CComPtr<IDxcBlob> pCleared;
+  VERIFY_SUCCEEDED(pCache->Clear());
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;",
+                        compile(pClearedInclude, L"shared", &pCleared).c_str());
+  VERIFY_IS_TRUE(isSameBlob(pFirst, pCleared));
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheReadsDiskThenFileCanChange) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcIncludeCache> pCache;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcIncludeCache, &pCache));
+
+  wchar_t TempPath[MAX_PATH];
+  DWORD length = GetTempPathW(MAX_PATH, TempPath);
+  VERIFY_WIN32_BOOL_SUCCEEDED(length != 0);
+  std::wstring fileName(TempPath);
+  fileName += L"dxc_include_cache_test_";
+  fileName += std::to_wstring(GetTickCount64());
+  fileName += L".h";
+  struct FileCleanup {
+    const std::wstring &Name;
+    ~FileCleanup() { DeleteFileW(Name.c_str()); }
+  } cleanup = { fileName };
+
+  auto writeFile = [&](const char *pContents) {
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file << pContents;
+    file.close();
+    VERIFY_IS_FALSE(file.fail());
+  };
+
+  std::string source = "#include \"";
+  source += CW2A(fileName.c_str());
+  source += "\"\r\n"
+            "float4 main() : SV_Target { return ZERO; }";
+  CreateBlobFromText(source.c_str(), &pSource);
+
+  auto compile = [&](IDxcBlob **ppContainer) {
+    CComPtr<IDxcIncludeHandler> pCachingInclude;
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCache->CreateIncludeHandler(
+      nullptr, nullptr, DxcIncludeCacheFlags_ValidateTimestamp,
+      &pCachingInclude));
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pCachingInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppContainer));
+  };
+
+  // The cache keeps a copy of the file, so the file can be rewritten, even to
+  // a shorter length, while its contents are cached; the new contents are
+  // picked up once the size and write time differ.
+  CComPtr<IDxcBlob> pFirst, pChanged;
+  writeFile("#define ZERO 10");
+  compile(&pFirst);
+  writeFile("#define ZERO 1");
+  compile(&pChanged);
+  VERIFY_IS_FALSE(pFirst->GetBufferSize() == pChanged->GetBufferSize() &&
+                  0 == memcmp(pFirst->GetBufferPointer(),
+                              pChanged->GetBufferPointer(),
+                              pFirst->GetBufferSize()));
+}
+
+TEST_F(CompilerTest, CompileWhenManyIncludesThenOK) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  // More files than fit in the handle encoding this used to have.
+  const unsigned FileCount = 1200;
+  std::string source;
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  for (unsigned i = 0; i < FileCount; ++i) {
+    source += "#include \"inc" + std::to_string(i) + ".h\"\r\n";
+    std::string body = "static const float V" + std::to_string(i) + " = " +
+                       std::to_string(i) + ";\r\n";
+    pInclude->CallResults.emplace_back(body.c_str());
+  }
+  source += "float4 main() : SV_Target { return V" +
+            std::to_string(FileCount - 1) + "; }";
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(source.c_str(), &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(FileCount, (unsigned)pInclude->CallInfos.size());
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2782,6 +3714,48 @@ TEST_F(CompilerTest, CompileWhenNoMemThenOOM) {
   }
 }
 
+TEST_F(CompilerTest, CompileWhenArenaAllocThenNothingOutlivesArena) {
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobFromText(
+    "float4 main(float4 pos : SV_Position, uint n : N) : SV_Target {\r\n"
+    "  float4 r = pos;\r\n"
+    "  [loop] for (uint i = 0; i < n; ++i) r = r * r.yzwx + i;\r\n"
+    "  return r;\r\n"
+    "}", &pSource);
+
+  InstrumentedHeapMalloc InstrMalloc;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcArenaStatistics> pStatistics;
+  CComPtr<IDxcOperationResult> pResult;
+  InstrMalloc.ResetHeap();
+  VERIFY_IS_TRUE(m_dllSupport.HasCreateWithMalloc());
+
+  // The arena takes its blocks from the compiler's allocator. Once the
+  // result and the compiler are released, every block and every large
+  // allocation must have been handed back, and no reference to the arena
+  // may be left behind in global state.
+  ULONG initialRefCount = InstrMalloc.GetRefCount();
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance2(&InstrMalloc, CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStatistics));
+  LPCWSTR args[] = { L"-arena-alloc" };
+  for (int i = 0; i < 2; ++i) {
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    pResult.Release();
+  }
+
+  DxcArenaStatistics stats;
+  VERIFY_SUCCEEDED(pStatistics->GetArenaStatistics(&stats));
+  VERIFY_ARE_EQUAL((UINT64)2, stats.Compilations);
+  VERIFY_IS_TRUE(stats.PeakLiveBytes > 0);
+
+  pStatistics.Release();
+  pCompiler.Release();
+  VERIFY_IS_TRUE(0 == InstrMalloc.GetSize());
+  VERIFY_ARE_EQUAL(initialRefCount, InstrMalloc.GetRefCount());
+}
+
 TEST_F(CompilerTest, CompileWhenShaderModelMismatchAttributeThenFail) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -5894,6 +6868,11 @@ TEST_F(CompilerTest, HoistConstantArray) {
   CodeGenTestCheck(L"hca\\15.ll");
 }
 
+TEST_F(CompilerTest, DxilTargetTransformInfo) {
+  CodeGenTestCheck(L"tti\\dxil_op_cost.ll");
+  CodeGenTestCheck(L"tti\\unroll_local_array.hlsl");
+}
+
 TEST_F(CompilerTest, VecElemConstEval) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\vec_elem_const_eval.hlsl");
 }
@@ -6046,6 +7025,9 @@ TEST_F(CompilerTest, ViewID) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid17.hlsl");
   CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid18.hlsl");
   CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid19.hlsl");
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid20.hlsl");
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid21.hlsl");
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\viewid\\viewid22.hlsl");
 }
 
 TEST_F(CompilerTest, ShaderCompatSuite) {
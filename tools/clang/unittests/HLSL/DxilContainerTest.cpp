@@ -67,6 +67,7 @@ public:
   END_TEST_CLASS()
 
   TEST_METHOD(CompileWhenDebugSourceThenSourceMatters)
+  TEST_METHOD(CompileWhenDebugInfoAndRootSigThenPartsAreConsistent)
   TEST_METHOD(CompileWhenOKThenIncludesFeatureInfo)
   TEST_METHOD(CompileWhenOKThenIncludesSignatures)
   TEST_METHOD(CompileWhenSigSquareThenIncludeSplit)
@@ -78,6 +79,7 @@ public:
   TEST_METHOD(DxilContainerUnitTest)
 
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
+  TEST_METHOD(ReflectionWhenBitcodeNotNeededThenNotParsed)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
     TEST_METHOD_PROPERTY(L"Priority", L"1")
   END_TEST_METHOD()
@@ -559,6 +561,42 @@ TEST_F(DxilContainerTest, CompileWhenDebugSourceThenSourceMatters) {
   VERIFY_IS_FALSE(0 == strcmp(sourceName1Zss.c_str(), binName1.c_str()));
 }
 
+TEST_F(DxilContainerTest, CompileWhenDebugInfoAndRootSigThenPartsAreConsistent) {
+  // With a root signature and debug info, both program parts are serialized
+  // straight into the container and the debug name is patched in afterwards.
+  char program1[] =
+    "[RootSignature(\"RootFlags(0)\")]\n"
+    "float4 main(float4 a : A) : SV_Target { return a * 2; }";
+  char program2[] =
+    "[RootSignature(\"RootFlags(0)\")]\n"
+    "  float4 main(float4 a : A) : SV_Target { return a * 2; }  ";
+  LPCWSTR ZiZsb[] = { L"/Zi", L"/Zsb" };
+  CComPtr<IDxcBlob> pProgram;
+
+  CompileToProgram(program1, L"main", L"ps_6_0", ZiZsb, _countof(ZiZsb), &pProgram);
+  hlsl::DxilContainerView view;
+  VERIFY_IS_TRUE(view.Initialize(pProgram->GetBufferPointer(), pProgram->GetBufferSize()));
+  VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), view.GetHeader()->ContainerSizeInBytes);
+  VERIFY_IS_FALSE(view.FindPartSpan(hlsl::DFCC_RootSignature).empty());
+
+  const hlsl::DxilProgramHeader *pProgramHeader = view.FindProgramHeader(hlsl::DFCC_DXIL);
+  const hlsl::DxilProgramHeader *pDebugHeader = view.FindProgramHeader(hlsl::DFCC_ShaderDebugInfoDXIL);
+  VERIFY_IS_NOT_NULL(pProgramHeader);
+  VERIFY_IS_NOT_NULL(pDebugHeader);
+  VERIFY_ARE_EQUAL(view.FindPart(hlsl::DFCC_DXIL)->PartSize, pProgramHeader->SizeInUint32 * 4);
+  VERIFY_ARE_EQUAL(view.FindPart(hlsl::DFCC_ShaderDebugInfoDXIL)->PartSize, pDebugHeader->SizeInUint32 * 4);
+  VERIFY_IS_TRUE(hlsl::GetDxilBitcodeSize(pProgramHeader) < hlsl::GetDxilBitcodeSize(pDebugHeader));
+
+  if (!DoesValidatorSupportDebugName())
+    return;
+
+  // The binary debug name follows the stripped program, not the source.
+  std::string binName1 = CompileToDebugName(program1, L"main", L"ps_6_0", ZiZsb, _countof(ZiZsb));
+  std::string binName2 = CompileToDebugName(program2, L"main", L"ps_6_0", ZiZsb, _countof(ZiZsb));
+  VERIFY_IS_FALSE(binName1.empty());
+  VERIFY_ARE_EQUAL_STR(binName1.c_str(), binName2.c_str());
+}
+
 TEST_F(DxilContainerTest, CompileWhenOKThenIncludesSignatures) {
   char program[] =
     "struct PSInput {\r\n"
@@ -945,6 +983,41 @@ TEST_F(DxilContainerTest, ReflectionMatchesDXBC_Full) {
   }
 }
 
+TEST_F(DxilContainerTest, ReflectionWhenBitcodeNotNeededThenNotParsed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<ID3D12ShaderReflection> pShaderReflection;
+  D3D12_SHADER_DESC desc;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "struct GSOut { float4 pos : SV_Position; };\n"
+    "[maxvertexcount(3)]\n"
+    "void main(triangle float4 pos[3] : SV_Position, inout TriangleStream<GSOut> s) {\n"
+    "  GSOut o; o.pos = pos[0]; s.Append(o);\n"
+    "}", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"gs_6_0",
+    nullptr, 0, nullptr, 0, nullptr,
+    &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // Corrupt everything after the bitcode magic, so that any query that
+  // parses the module fails.
+  hlsl::DxilContainerView view;
+  VERIFY_IS_TRUE(view.Initialize(pProgram->GetBufferPointer(), pProgram->GetBufferSize()));
+  const hlsl::DxilProgramHeader *pProgramHeader = view.FindProgramHeader(hlsl::DFCC_DXIL);
+  VERIFY_IS_NOT_NULL(pProgramHeader);
+  char *pBitcode = const_cast<char *>(hlsl::GetDxilBitcodeData(pProgramHeader));
+  memset(pBitcode + 4, 0xff, hlsl::GetDxilBitcodeSize(pProgramHeader) - 4);
+
+  CreateReflectionFromBlob(pProgram, &pShaderReflection);
+  VERIFY_ARE_EQUAL(D3D_PRIMITIVE_TRIANGLE, pShaderReflection->GetGSInputPrimitive());
+  VERIFY_ARE_EQUAL((UINT64)0, pShaderReflection->GetRequiresFlags());
+  VERIFY_FAILED(pShaderReflection->GetDesc(&desc));
+}
+
 TEST_F(DxilContainerTest, ValidateFromLL_Abs2) {
   CodeGenTestCheck(L"abs2_m.ll");
 }
@@ -971,6 +1044,18 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NOT_NULL(hlsl::GetDxilProgramHeader(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
   VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+
+  hlsl::DxilContainerView view;
+  VERIFY_IS_TRUE(view.Initialize(pProgram->GetBufferPointer(), pProgram->GetBufferSize()));
+  VERIFY_ARE_EQUAL(pHeader->PartCount, view.GetPartCount());
+  VERIFY_ARE_EQUAL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_DXIL), view.FindPart(hlsl::DxilFourCC::DFCC_DXIL));
+  VERIFY_IS_NOT_NULL(view.FindProgramHeader(hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+  hlsl::DxilPartSpan featureInfo = view.FindPartSpan(hlsl::DxilFourCC::DFCC_FeatureInfo);
+  VERIFY_IS_FALSE(featureInfo.empty());
+  VERIFY_ARE_EQUAL(sizeof(uint64_t), featureInfo.Size);
+  VERIFY_IS_TRUE(view.FindPartSpan(hlsl::DxilFourCC::DFCC_RootSignature).empty());
+  VERIFY_IS_FALSE(view.Initialize(pProgram->GetBufferPointer(), sizeof(hlsl::DxilContainerHeader) - 1));
+  VERIFY_IS_FALSE(view.IsValid());
   
   pResult.Release();
   pProgram.Release();
@@ -19,6 +19,7 @@
 #include "dxc/HLSL/DxilInstructions.h"
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
@@ -27,6 +28,7 @@
 #include "llvm/BitCode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IRBuilder.h"
 
 using namespace hlsl;
 using namespace llvm;
@@ -47,6 +49,7 @@ public:
   TEST_METHOD(LoadDxilModule_1_0);
   TEST_METHOD(LoadDxilModule_1_1);
   TEST_METHOD(LoadDxilModule_1_2);
+  TEST_METHOD(LoadDxilModule_LazyMetadata);
 
   // Precise query tests.
   TEST_METHOD(Precise1);
@@ -56,6 +59,9 @@ public:
   TEST_METHOD(Precise5);
   TEST_METHOD(Precise6);
   TEST_METHOD(Precise7);
+
+  // ViewID state tests.
+  TEST_METHOD(ViewIdState_RecomputeAfterStore);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -216,6 +222,40 @@ TEST_F(DxilModuleTest, LoadDxilModule_1_2) {
   VERIFY_IS_TRUE(vMinor == 2);
 }
 
+TEST_F(DxilModuleTest, LoadDxilModule_LazyMetadata) {
+  Compiler c(m_dllSupport);
+  c.Compile(
+    "struct S { float4 a; int b; };\n"
+    "cbuffer CB { S s; };\n"
+    "float4 main() : SV_Target {\n"
+    "  return s.a * s.b;\n"
+    "}\n"
+    ,
+    L"ps_6_0"
+  );
+
+  DxilModule &DM = c.GetDxilModule();
+  Module &M = *DM.GetModule();
+  NamedMDNode *pTypes = M.getNamedMetadata(DxilMDHelper::kDxilTypeSystemMDName);
+  VERIFY_IS_NOT_NULL(pTypes);
+  std::vector<MDNode *> typeNodes(pTypes->op_begin(), pTypes->op_end());
+
+  // Re-emitting without touching the type system keeps the loaded nodes.
+  M.ResetDxilModule();
+  DxilModule &LazyDM = M.GetOrCreateDxilModule();
+  LazyDM.EmitDxilMetadata();
+  pTypes = M.getNamedMetadata(DxilMDHelper::kDxilTypeSystemMDName);
+  VERIFY_IS_NOT_NULL(pTypes);
+  VERIFY_ARE_EQUAL(typeNodes.size(), (size_t)pTypes->getNumOperands());
+  for (unsigned i = 0; i < typeNodes.size(); ++i)
+    VERIFY_ARE_EQUAL(typeNodes[i], pTypes->getOperand(i));
+
+  // The type system is still available on first use.
+  DxilTypeSystem &TS = LazyDM.GetTypeSystem();
+  VERIFY_IS_NOT_NULL(TS.GetFunctionAnnotation(LazyDM.GetEntryFunction()));
+  VERIFY_IS_FALSE(TS.GetStructAnnotationMap().empty());
+}
+
 TEST_F(DxilModuleTest, Precise1) {
   Compiler c(m_dllSupport);
   c.Compile(
@@ -414,3 +454,58 @@ TEST_F(DxilModuleTest, Precise7) {
   }
   VERIFY_ARE_EQUAL(numChecks, 4);
 }
+
+TEST_F(DxilModuleTest, ViewIdState_RecomputeAfterStore) {
+  Compiler c(m_dllSupport);
+  if (c.SkipDxil_Test(1,1)) return;
+  c.Compile(
+    "float4 main(float4 a : A, float b : B, nointerpolation uint n : N) : SV_Target {\n"
+    "  float arr[4] = { a.x, a.y, a.z, a.w };\n"
+    "  return float4(arr[n % 4], b, 0, 1);\n"
+    "}\n"
+    ,
+    L"ps_6_1"
+  );
+
+  // Find the array, the load that reads it for output 0, and the value
+  // written to output 1.
+  DxilModule &DM = c.GetDxilModule();
+  Function *F = DM.GetEntryFunction();
+  AllocaInst *pArray = nullptr;
+  LoadInst *pArrayLoad = nullptr;
+  Value *pB = nullptr;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    Instruction *Inst = &*I;
+    if (AllocaInst *AI = dyn_cast<AllocaInst>(Inst)) {
+      pArray = AI;
+    }
+    else if (LoadInst *LI = dyn_cast<LoadInst>(Inst)) {
+      pArrayLoad = LI;
+    }
+    else if (DxilInst_StoreOutput SO = DxilInst_StoreOutput(Inst)) {
+      ConstantInt *pCol = dyn_cast<ConstantInt>(SO.get_colIndex());
+      if (pCol && pCol->getLimitedValue() == 1)
+        pB = SO.get_value();
+    }
+  }
+  VERIFY_IS_NOT_NULL(pArray);
+  VERIFY_IS_NOT_NULL(pArrayLoad);
+  VERIFY_IS_NOT_NULL(pB);
+
+  DxilViewIdState &VIS = DM.GetViewIdState();
+  VIS.Compute();
+  const std::set<unsigned> InputsB = VIS.getInputsContributingToOutputs(0).at(1);
+  VERIFY_ARE_EQUAL((size_t)1, InputsB.size());
+  unsigned bIdx = *InputsB.begin();
+  VERIFY_ARE_EQUAL((size_t)0, VIS.getInputsContributingToOutputs(0).at(0).count(bIdx));
+
+  // Store b into the array ahead of the load. Recomputing must see the new
+  // store rather than the stores collected by the first computation.
+  IRBuilder<> Builder(pArrayLoad);
+  Value *pZero = Builder.getInt32(0);
+  Value *pElt = Builder.CreateInBoundsGEP(pArray, { pZero, pZero });
+  Builder.CreateStore(pB, pElt);
+
+  VIS.Compute();
+  VERIFY_ARE_EQUAL((size_t)1, VIS.getInputsContributingToOutputs(0).at(0).count(bIdx));
+}
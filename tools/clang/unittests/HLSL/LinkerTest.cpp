@@ -48,6 +48,8 @@ public:
   TEST_METHOD(RunLinkFailProfileMismatch);
   TEST_METHOD(RunLinkFailEntryNoProps);
   TEST_METHOD(RunLinkFailSelectRes);
+  TEST_METHOD(RunLinkMany);
+  TEST_METHOD(RunLinkSameClosureTwice);
 
 
   dxc::DxcDllSupport m_dllSupport;
@@ -299,3 +301,87 @@ TEST_F(LinkerTest, RunLinkFailSelectRes) {
   LinkCheckMsg(L"main", L"ps_6_0", pLinker, {libName, libName2},
                {"Local resource must map to global resource"});
 }
+
+TEST_F(LinkerTest, RunLinkMany) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinker2> pLinker2;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+
+  LPCWSTR libName = L"entry";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  // cs_main needs resources from another library, so it fails to link
+  // without affecting the other entries.
+  LPCWSTR entryNames[] = {L"vs_main", L"ps_main", L"cs_main", L"gs_main"};
+  LPCWSTR profiles[] = {L"vs_6_0", L"ps_6_0", L"cs_6_0", L"gs_6_0"};
+  const UINT32 entryCount = _countof(entryNames);
+  IDxcOperationResult *pResults[entryCount];
+  VERIFY_SUCCEEDED(pLinker2->LinkMany(entryCount, entryNames, profiles,
+                                      &libName, 1, nullptr, 0, pResults));
+  std::vector<CComPtr<IDxcOperationResult>> results;
+  for (UINT32 i = 0; i < entryCount; ++i) {
+    results.emplace_back();
+    results.back().Attach(pResults[i]);
+  }
+
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  for (UINT32 i = 0; i < entryCount; ++i) {
+    if (i == 2) {
+      const char *pErrorMsg = "Cannot find definition of function";
+      CheckOperationResultMsgs(results[i], &pErrorMsg, 1, false, false);
+      continue;
+    }
+    // Each entry matches what linking it on its own produces.
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(results[i], &pProgram);
+    CComPtr<IDxcOperationResult> pSingleResult;
+    VERIFY_SUCCEEDED(pLinker->Link(entryNames[i], profiles[i], &libName, 1,
+                                   nullptr, 0, &pSingleResult));
+    CComPtr<IDxcBlob> pSingleProgram;
+    CheckOperationSucceeded(pSingleResult, &pSingleProgram);
+
+    CComPtr<IDxcBlobEncoding> pDisassembly, pSingleDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembly));
+    VERIFY_SUCCEEDED(
+        pCompiler->Disassemble(pSingleProgram, &pSingleDisassembly));
+    VERIFY_ARE_EQUAL(BlobToUtf8(pSingleDisassembly), BlobToUtf8(pDisassembly));
+  }
+}
+
+TEST_F(LinkerTest, RunLinkSameClosureTwice) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_global.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+  LPCWSTR libResName = L"res";
+  RegisterDxcModule(libResName, pResLib, pLinker);
+
+  // The second link has an unrelated library attached but the same closure,
+  // so it's served from the linked module cache; the output must not change.
+  LPCWSTR libSets[][2] = {{libName, nullptr}, {libName, libResName}};
+  UINT32 libCounts[] = {1, 2};
+  std::string IR[2];
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  for (unsigned i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(L"test", L"ps_6_0", libSets[i],
+                                   libCounts[i], nullptr, 0, &pResult));
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembly));
+    IR[i] = BlobToUtf8(pDisassembly);
+  }
+  VERIFY_ARE_EQUAL(IR[0], IR[1]);
+  VERIFY_IS_TRUE(IR[1].find("dx.op.cbufferLoad") != std::string::npos);
+}
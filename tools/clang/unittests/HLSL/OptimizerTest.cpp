@@ -89,6 +89,7 @@ public:
   TEST_METHOD(OptimizerWhenSlice1ThenOK)
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
+  TEST_METHOD(OptimizerWhenPipelineThenMatchesRunOptimizer)
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCWSTR pText, LPCWSTR pTarget);
@@ -130,6 +131,92 @@ TEST_F(OptimizerTest, OptimizerWhenSlice1ThenOK) { OptimizerWhenSliceNThenOK(1);
 TEST_F(OptimizerTest, OptimizerWhenSlice2ThenOK) { OptimizerWhenSliceNThenOK(2); }
 TEST_F(OptimizerTest, OptimizerWhenSlice3ThenOK) { OptimizerWhenSliceNThenOK(3); }
 
+TEST_F(OptimizerTest, OptimizerWhenPipelineThenMatchesRunOptimizer) {
+  LPCWSTR SampleProgram =
+    L"Texture2D g_Tex;\r\n"
+    L"SamplerState g_Sampler;\r\n"
+    L"float4 main(float4 pos : SV_Position, float4 user : USER, bool b : B) : SV_Target {\r\n"
+    L"  if (b) user = g_Tex.Sample(g_Sampler, pos.xy);\r\n"
+    L"  return user * pos;\r\n"
+    L"}";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer2> pOptimizer;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pHighLevelBlob;
+  CComPtr<IDxcBlob> pOptDump;
+  std::vector<LPCWSTR> passList;
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+
+  Utf16ToBlob(m_dllSupport, SampleProgram, &pSource);
+  LPCWSTR optDumpArgs[] = { L"/Vd", L"/Odump" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", optDumpArgs, _countof(optDumpArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pOptDump));
+  pResult.Release();
+  std::string passes = BlobToUtf8(pOptDump);
+  CA2W passesW(passes.c_str(), CP_UTF8);
+  SplitPassList(passesW.m_psz, passList);
+
+  LPCWSTR highLevelArgs[] = { L"/Vd", L"/fcgl" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlob));
+  pResult.Release();
+
+  // The pass list run once through RunOptimizer is the reference.
+  CComPtr<IDxcBlob> pExpectedModule;
+  CComPtr<IDxcBlob> pExpectedContainer;
+  VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pHighLevelBlob, passList.data(),
+    (UINT32)passList.size(), &pExpectedModule, nullptr));
+  AssembleToContainer(m_dllSupport, pExpectedModule, &pExpectedContainer);
+  std::string expected = DisassembleProgram(m_dllSupport, pExpectedContainer);
+
+  VERIFY_SUCCEEDED(pOptimizer->CreatePipeline(passList.data(),
+    (UINT32)passList.size(), &pPipeline));
+
+  // Several copies of the module on more than one thread.
+  const UINT32 blobCount = 4;
+  IDxcBlob *blobs[blobCount];
+  HRESULT status[blobCount];
+  IDxcBlob *outputModules[blobCount];
+  for (UINT32 i = 0; i < blobCount; ++i)
+    blobs[i] = pHighLevelBlob;
+  VERIFY_SUCCEEDED(pPipeline->RunMany(blobCount, blobs, 2, status,
+                                      outputModules, nullptr));
+  for (UINT32 i = 0; i < blobCount; ++i) {
+    CComPtr<IDxcBlob> pModule;
+    pModule.Attach(outputModules[i]);
+    CComPtr<IDxcBlob> pContainer;
+    VERIFY_SUCCEEDED(status[i]);
+    AssembleToContainer(m_dllSupport, pModule, &pContainer);
+    std::string assembly = DisassembleProgram(m_dllSupport, pContainer);
+    VERIFY_ARE_EQUAL_STR(expected.c_str(), assembly.c_str());
+  }
+
+  // A module kept in memory, written out only at the end.
+  CComPtr<IDxcOptimizerModule> pModule;
+  CComPtr<IDxcBlob> pModuleBitcode;
+  CComPtr<IDxcBlob> pModuleContainer;
+  VERIFY_SUCCEEDED(pPipeline->LoadModule(pHighLevelBlob, &pModule));
+  VERIFY_SUCCEEDED(pPipeline->RunOnModule(pModule, nullptr));
+  VERIFY_SUCCEEDED(pModule->GetBitcode(&pModuleBitcode));
+  AssembleToContainer(m_dllSupport, pModuleBitcode, &pModuleContainer);
+  std::string assembly = DisassembleProgram(m_dllSupport, pModuleContainer);
+  VERIFY_ARE_EQUAL_STR(expected.c_str(), assembly.c_str());
+
+  // Options are checked when the pipeline is created.
+  CComPtr<IDxcOptimizerPipeline> pBadPipeline;
+  LPCWSTR badOptions[] = { L"-no-such-pass" };
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pOptimizer->CreatePipeline(badOptions,
+    _countof(badOptions), &pBadPipeline));
+}
+
 void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel) {
   LPCWSTR SampleProgram =
     L"Texture2D g_Tex;\r\n"
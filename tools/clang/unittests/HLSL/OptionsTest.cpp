@@ -147,6 +147,22 @@ TEST_F(OptionsTest, ReadOptionsConflict) {
       L"hlsl.hlsl"};
   MainArgsArr libArr(libArgs);
   ReadOptsTest(libArr, DxrFlags, "cannot specify entry point for a library");
+
+#ifdef ENABLE_SPIRV_CODEGEN
+  const wchar_t *oconfigArgs[] = {
+      L"exe.exe",   L"/E",        L"main",    L"/T",           L"ps_6_0",
+      L"-Oconfig=--strip-debug",
+      L"hlsl.hlsl"};
+  MainArgsArr oconfigArr(oconfigArgs);
+  ReadOptsTest(oconfigArr, DxrFlags, "-Oconfig requires -spirv");
+
+  const wchar_t *oconfigOptArgs[] = {
+      L"exe.exe",   L"/E",        L"main",    L"/T",           L"ps_6_0",
+      L"-spirv", L"-O1", L"-Oconfig=--strip-debug",
+      L"hlsl.hlsl"};
+  MainArgsArr oconfigOptArr(oconfigOptArgs);
+  ReadOptsTest(oconfigOptArr, DxrFlags, "-Oconfig should not be specified together with -O");
+#endif
 }
 
 TEST_F(OptionsTest, ReadOptionsWhenHelpThenShortcut) {
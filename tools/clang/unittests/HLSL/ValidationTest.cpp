@@ -320,6 +320,8 @@ public:
   TEST_METHOD(WhenProgramPCSigMissingThenFail);
   TEST_METHOD(WhenPSVMismatchThenFail);
   TEST_METHOD(WhenFeatureInfoMismatchThenFail);
+  TEST_METHOD(WhenLargeModuleThenAllFunctionsValidated);
+  TEST_METHOD(WhenValidatorReusedThenChangedFunctionsRevalidated);
 
   TEST_METHOD(ViewIDInCSFail)
   TEST_METHOD(ViewIDIn60Fail)
@@ -3008,6 +3010,83 @@ TEST_F(ValidationTest, WhenFeatureInfoMismatchThenFail) {
   );
 }
 
+TEST_F(ValidationTest, WhenLargeModuleThenAllFunctionsValidated) {
+  // The entry and patch constant functions are large enough for their
+  // bodies to be validated concurrently; both must still be reported.
+  RewriteAssemblyCheckMsg(
+    "struct ControlPoint { float4 pos : POSITION; };\n"
+    "struct PatchConstants {\n"
+    "  float edges[3] : SV_TessFactor;\n"
+    "  float inside : SV_InsideTessFactor;\n"
+    "};\n"
+    "cbuffer cb { float4 g_coeffs[1024]; };\n"
+    "float Expand(float x) {\n"
+    "  [unroll] for (int i = 0; i < 1024; ++i)\n"
+    "    x = x * g_coeffs[i].x + g_coeffs[i].y;\n"
+    "  return x;\n"
+    "}\n"
+    "PatchConstants PatchFunc(InputPatch<ControlPoint, 3> ip) {\n"
+    "  PatchConstants pc;\n"
+    "  pc.edges[0] = pc.edges[1] = pc.edges[2] = Expand(ip[0].pos.x);\n"
+    "  pc.inside = Expand(ip[1].pos.y);\n"
+    "  return pc;\n"
+    "}\n"
+    "[domain(\"tri\")]\n"
+    "[partitioning(\"fractional_odd\")]\n"
+    "[outputtopology(\"triangle_cw\")]\n"
+    "[outputcontrolpoints(3)]\n"
+    "[patchconstantfunc(\"PatchFunc\")]\n"
+    "ControlPoint main(InputPatch<ControlPoint, 3> ip,\n"
+    "                  uint i : SV_OutputControlPointID) {\n"
+    "  ControlPoint cp;\n"
+    "  cp.pos = ip[i].pos * Expand(ip[i].pos.w);\n"
+    "  return cp;\n"
+    "}\n",
+    "hs_6_0",
+    {"ret void"},
+    {"unreachable"},
+    {"Instructions must be of an allowed type(.|\n)*"
+     "Instructions must be of an allowed type"},
+    true);
+}
+
+TEST_F(ValidationTest, WhenValidatorReusedThenChangedFunctionsRevalidated) {
+  CComPtr<IDxcValidator> pValidator;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+
+  CComPtr<IDxcBlobEncoding> pSource;
+  Utf8ToBlob(m_dllSupport,
+             "float4 main(float4 a : A) : SV_Target { return a * 2; }",
+             &pSource);
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(pSource, "ps_6_0", &pProgram);
+
+  // Validating the same container again with the same object gives the
+  // same result.
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pValidator->Validate(pProgram, DxcValidatorFlags_Default,
+                                          &pResult));
+    CheckOperationResultMsgs(pResult, nullptr, false, false);
+  }
+
+  // A changed function must not be matched to the cached one.
+  CComPtr<IDxcBlob> pText;
+  RewriteAssemblyToText(pSource, "ps_6_0", nullptr, 0, nullptr, 0,
+                        {"ret void"}, {"unreachable"}, &pText);
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcOperationResult> pAssembleResult;
+  CComPtr<IDxcBlob> pChanged;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pText, &pAssembleResult));
+  VERIFY_SUCCEEDED(pAssembleResult->GetResult(&pChanged));
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pValidator->Validate(pChanged, DxcValidatorFlags_Default,
+                                        &pResult));
+  CheckOperationResultMsgs(pResult, {"Instructions must be of an allowed type"},
+                           false, false);
+}
+
 TEST_F(ValidationTest, ViewIDInCSFail) {
   if (m_ver.SkipDxilVersion(1,1)) return;
   RewriteAssemblyCheckMsg(" \
@@ -1266,6 +1266,18 @@ TEST_F(FileTest, SpirvLegalizationTextureBuffer) {
               /*runValidation=*/false);
 }
 
+TEST_F(FileTest, SpirvOptimizationOconfig) {
+  runLegalizationAndOptimization();
+  runFileTest("spirv.opt.oconfig.hlsl");
+}
+TEST_F(FileTest, SpirvOptimizationOconfigInvalidPass) {
+  runLegalizationAndOptimization();
+  runFileTest("spirv.opt.oconfig.invalid.hlsl", Expect::Failure);
+}
+TEST_F(FileTest, SpirvOptimizationOconfigWithO) {
+  runFileTest("spirv.opt.oconfig.with-o.hlsl", Expect::Failure);
+}
+
 TEST_F(FileTest, SpirvDebugOpSource) {
   runFileTest("spirv.debug.opsource.hlsl");
 }
@@ -75,7 +75,7 @@ void FileTest::runFileTest(llvm::StringRef filename, Expect expect,
   // Feed the HLSL source into the Compiler.
   const bool compileOk = utils::runCompilerWithSpirvGeneration(
       inputFilePath, entryPoint, targetProfile, restArgs, &generatedBinary,
-      &errorMessages);
+      &errorMessages, beLegalized);
 
   effcee::Result result(effcee::Result::Status::Ok);
 
@@ -26,9 +26,11 @@ public:
     Failure, // Failure (with errors) - check error message
   };
 
-  FileTest() : targetEnv(SPV_ENV_VULKAN_1_0) {}
+  FileTest() : targetEnv(SPV_ENV_VULKAN_1_0), beLegalized(false) {}
 
   void useVulkan1p1() { targetEnv = SPV_ENV_VULKAN_1_1; }
+  /// \brief Runs legalization and optimization instead of passing -fcgl.
+  void runLegalizationAndOptimization() { beLegalized = true; }
 
   /// \brief Runs a File Test! (See class description for more info)
   void runFileTest(llvm::StringRef path, Expect expect = Expect::Success,
@@ -46,6 +48,7 @@ private:
   std::string checkCommands;             ///< CHECK commands that verify output
   std::string generatedSpirvAsm;         ///< Disassembled binary (SPIR-V code)
   spv_target_env targetEnv;              ///< Environment to validate against
+  bool beLegalized;                      ///< Whether to omit -fcgl
 };
 
 } // end namespace spirv
@@ -110,7 +110,8 @@ bool runCompilerWithSpirvGeneration(const llvm::StringRef inputFilePath,
                                     const llvm::StringRef targetProfile,
                                     const std::vector<std::string> &restArgs,
                                     std::vector<uint32_t> *generatedBinary,
-                                    std::string *errorMessages) {
+                                    std::string *errorMessages,
+                                    bool runLegalization) {
   std::wstring srcFile(inputFilePath.begin(), inputFilePath.end());
   std::wstring entry(entryPoint.begin(), entryPoint.end());
   std::wstring profile(targetProfile.begin(), targetProfile.end());
@@ -141,7 +142,8 @@ bool runCompilerWithSpirvGeneration(const llvm::StringRef inputFilePath,
     flags.push_back(profile.c_str());
     flags.push_back(L"-spirv");
     // Disable legalization and optimization for testing
-    flags.push_back(L"-fcgl");
+    if (!runLegalization)
+      flags.push_back(L"-fcgl");
     // Disable validation. We'll run it manually.
     flags.push_back(L"-Vd");
     for (const auto &arg : rest)
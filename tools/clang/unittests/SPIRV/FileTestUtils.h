@@ -55,13 +55,15 @@ std::string getAbsPathOfInputDataFile(const llvm::StringRef filename);
 /// \brief Passes the HLSL input file to the DXC compiler with SPIR-V CodeGen.
 /// Returns the generated SPIR-V binary via 'generatedBinary' argument.
 /// Returns true on success, and false on failure. Writes error messages to
-/// errorMessages and stderr on failure.
+/// errorMessages and stderr on failure. Legalization and optimization are
+/// skipped via -fcgl unless runLegalization is true.
 bool runCompilerWithSpirvGeneration(const llvm::StringRef inputFilePath,
                                     const llvm::StringRef entryPoint,
                                     const llvm::StringRef targetProfile,
                                     const std::vector<std::string> &restArgs,
                                     std::vector<uint32_t> *generatedBinary,
-                                    std::string *errorMessages);
+                                    std::string *errorMessages,
+                                    bool runLegalization = false);
 
 } // end namespace utils
 } // end namespace spirv
@@ -75,6 +75,34 @@ TEST(SPIRVContext, UniqueIdForUniqueAggregateType) {
   EXPECT_EQ(struct_1_id, struct_2_id);
 }
 
+TEST(SPIRVContext, DistinctIdForDistinctlyDecoratedTypes) {
+  SPIRVContext ctx;
+  // Structs that only differ in the offset of a member are different types,
+  // and so are the decorations themselves.
+  const uint32_t intt_id = ctx.getResultIdForType(Type::getInt32(ctx));
+  const auto mem_0_offset = Decoration::getOffset(ctx, 0u, 0);
+  const auto mem_1_offset_4 = Decoration::getOffset(ctx, 4u, 1);
+  const auto mem_1_offset_16 = Decoration::getOffset(ctx, 16u, 1);
+  EXPECT_NE(mem_1_offset_4, mem_1_offset_16);
+  EXPECT_EQ(mem_1_offset_4, Decoration::getOffset(ctx, 4u, 1));
+
+  const Type *struct_1 = Type::getStruct(ctx, {intt_id, intt_id},
+                                         {mem_0_offset, mem_1_offset_4});
+  const Type *struct_2 = Type::getStruct(ctx, {intt_id, intt_id},
+                                         {mem_0_offset, mem_1_offset_16});
+  EXPECT_NE(struct_1, struct_2);
+
+  bool isRegistered = true;
+  const uint32_t struct_1_id = ctx.getResultIdForType(struct_1, &isRegistered);
+  EXPECT_FALSE(isRegistered);
+  const uint32_t struct_2_id = ctx.getResultIdForType(struct_2, &isRegistered);
+  EXPECT_FALSE(isRegistered);
+  EXPECT_NE(struct_1_id, struct_2_id);
+
+  EXPECT_EQ(ctx.getResultIdForType(struct_1, &isRegistered), struct_1_id);
+  EXPECT_TRUE(isRegistered);
+}
+
 TEST(SPIRVContext, UniqueIdForUniqueConstants) {
   SPIRVContext ctx;
 
@@ -30,11 +30,15 @@
 #include "dxc/dxctools.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <chrono>
 #include <comdef.h>
+#include <deque>
+#include <limits>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 
@@ -68,7 +72,9 @@ class DxcContext {
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+  CComPtr<IDxcCompiler> m_pCompiler; // Optional compiler to reuse.
 
+  void CreateCompiler(IDxcCompiler **ppCompiler);
   int ActOnBlob(IDxcBlob *pBlob);
   int ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugBlobName);
   void UpdatePart(IDxcBlob *pBlob, IDxcBlob **ppResult);
@@ -82,8 +88,9 @@ private:
   int VerifyRootSignature();
 
 public:
-  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport)
-      : m_Opts(Opts), m_dxcSupport(dxcSupport) {}
+  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport,
+             IDxcCompiler *pCompiler = nullptr)
+      : m_Opts(Opts), m_dxcSupport(dxcSupport), m_pCompiler(pCompiler) {}
 
   int Compile(llvm::StringRef path, bool bLibLink);
   int DumpBinary();
@@ -137,7 +144,8 @@ static void PrintHlslException(const ::hlsl::Exception &hlslException,
 }
 
 static int Compile(llvm::StringRef command, DxcDllSupport &dxcSupport,
-                   llvm::StringRef path, bool bLinkLib) {
+                   llvm::StringRef path, bool bLinkLib,
+                   IDxcCompiler *pCompiler) {
   const OptTable *optionTable = getHlslOptTable();
   llvm::SmallVector<llvm::StringRef, 4> args;
   command.split(args, " ");
@@ -163,7 +171,7 @@ static int Compile(llvm::StringRef command, DxcDllSupport &dxcSupport,
 
   int retVal = 0;
   try {
-    DxcContext context(dxcOpts, dxcSupport);
+    DxcContext context(dxcOpts, dxcSupport, pCompiler);
     // TODO: implement all other actions.
     if (!dxcOpts.Preprocess.empty()) {
       context.Preprocess();
@@ -217,6 +225,15 @@ static void WritePartToFile(IDxcBlob *pBlob, hlsl::DxilFourCC CC,
   }
 }
 
+void DxcContext::CreateCompiler(IDxcCompiler **ppCompiler) {
+  if (m_pCompiler) {
+    *ppCompiler = m_pCompiler;
+    m_pCompiler->AddRef();
+    return;
+  }
+  IFT(m_dxcSupport.CreateInstance(CLSID_DxcCompiler, ppCompiler));
+}
+
 // This function is called either after the compilation is done or /dumpbin
 // option is provided Performing options that are used to process dxil
 // container.
@@ -300,7 +317,7 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob,
         (LPBYTE)&Message[0], Message.size(), CP_ACP, &pDisassembleResult));
   } else {
     CComPtr<IDxcCompiler> pCompiler;
-    IFT(m_dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    CreateCompiler(&pCompiler);
     IFT(pCompiler->Disassemble(pBlob, &pDisassembleResult));
   }
 
@@ -598,7 +615,7 @@ int DxcContext::Compile(llvm::StringRef path, bool bLibLink) {
 
     CComPtr<IDxcLibrary> pLibrary;
     IFT(m_dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
-    IFT(m_dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    CreateCompiler(&pCompiler);
     if (path.empty()) {
       ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile),
                        &pSource);
@@ -692,7 +709,7 @@ void DxcContext::Preprocess() {
   IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
 
   ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
-  IFT(m_dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  CreateCompiler(&pCompiler);
   IFT(pCompiler->Preprocess(pSource, StringRefUtf16(m_Opts.InputFile),
                             args.data(), args.size(), m_Opts.Defines.data(),
                             m_Opts.Defines.size(), pIncludeHandler,
@@ -765,22 +782,160 @@ void DxcContext::WriteHeader(IDxcBlobEncoding *pDisassembly, IDxcBlob *pCode,
   }
 }
 
+// Outcome of a single batch command, as written to the timing report.
+struct BatchCommandResult {
+  int Status = 0;
+  double DurationMs = 0;
+  bool Ran = false;
+};
+
+// Hands out batch commands to worker threads.
+//
+// Commands are dealt round-robin, longest first, into one deque per worker,
+// so each deque is bounded by ceil(commands / workers) entries and never
+// grows. A worker takes from the front of its own deque; once that is empty
+// it steals the front of the fullest remaining deque, so a single slow
+// command only delays the worker running it.
+class BatchWorkQueue {
+public:
+  BatchWorkQueue(unsigned workerCount, const std::vector<unsigned> &order)
+      : m_queues(workerCount) {
+    for (unsigned i = 0; i < order.size(); ++i)
+      m_queues[i % workerCount].Tasks.push_back(order[i]);
+  }
+
+  bool Pop(unsigned worker, unsigned &task) {
+    if (TryTakeFront(m_queues[worker], task))
+      return true;
+    for (;;) {
+      WorkerQueue *pVictim = nullptr;
+      size_t victimSize = 0;
+      for (WorkerQueue &queue : m_queues) {
+        std::lock_guard<std::mutex> lock(queue.Lock);
+        if (queue.Tasks.size() > victimSize) {
+          pVictim = &queue;
+          victimSize = queue.Tasks.size();
+        }
+      }
+      if (pVictim == nullptr)
+        return false;
+      // The victim may have been drained since it was picked; look again.
+      if (TryTakeFront(*pVictim, task))
+        return true;
+    }
+  }
+
+private:
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<unsigned> Tasks;
+  };
+  std::vector<WorkerQueue> m_queues;
+
+  static bool TryTakeFront(WorkerQueue &queue, unsigned &task) {
+    std::lock_guard<std::mutex> lock(queue.Lock);
+    if (queue.Tasks.empty())
+      return false;
+    task = queue.Tasks.front();
+    queue.Tasks.pop_front();
+    return true;
+  }
+};
+
 class DxcBatchContext {
 public:
   DxcBatchContext(DxcOpts &Opts, DxcDllSupport &dxcSupport)
       : m_Opts(Opts), m_dxcSupport(dxcSupport) {}
 
-  int BatchCompile(bool bMultiThread, bool bLibLink);
+  int BatchCompile(bool bMultiThread, bool bLibLink,
+                   llvm::StringRef timingReport);
 
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+
+  void RunWorker(unsigned worker, BatchWorkQueue &queue,
+                 llvm::ArrayRef<llvm::StringRef> commands,
+                 llvm::StringRef path, bool bLibLink,
+                 std::vector<BatchCommandResult> &results);
+  static void ReadTimingReport(llvm::StringRef fileName,
+                               std::unordered_map<std::string, double> &timings);
+  static void WriteTimingReport(llvm::StringRef fileName,
+                                llvm::ArrayRef<llvm::StringRef> commands,
+                                llvm::ArrayRef<BatchCommandResult> results);
 };
 
-int DxcBatchContext::BatchCompile(bool bMultiThread, bool bLibLink) {
-  DxcOpts tmp_Opts;
-  // tmp_Opts = m_Opts;
-  m_Opts.InputFile;
+void DxcBatchContext::RunWorker(unsigned worker, BatchWorkQueue &queue,
+                                llvm::ArrayRef<llvm::StringRef> commands,
+                                llvm::StringRef path, bool bLibLink,
+                                std::vector<BatchCommandResult> &results) {
+  // Compiler objects are reusable across compilations, so each worker keeps
+  // one for its lifetime. If it can't be created, every command falls back to
+  // creating its own and reports the failure.
+  CComPtr<IDxcCompiler> pCompiler;
+  m_dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler);
+
+  unsigned task;
+  while (queue.Pop(worker, task)) {
+    auto t_start = std::chrono::high_resolution_clock::now();
+    results[task].Status =
+        ::Compile(commands[task], m_dxcSupport, path, bLibLink, pCompiler);
+    auto t_end = std::chrono::high_resolution_clock::now();
+    results[task].DurationMs =
+        std::chrono::duration<double, std::milli>(t_end - t_start).count();
+    results[task].Ran = true;
+  }
+}
+
+// The timing report is a tab-separated file with one line per command:
+// index, status, duration in milliseconds and the command itself. Lines
+// starting with '#' are comments.
+void DxcBatchContext::ReadTimingReport(
+    llvm::StringRef fileName,
+    std::unordered_map<std::string, double> &timings) {
+  if (!llvm::sys::fs::exists(fileName))
+    return;
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> report =
+      llvm::MemoryBuffer::getFile(fileName);
+  if (!report)
+    return;
+  llvm::SmallVector<llvm::StringRef, 32> lines;
+  report.get()->getBuffer().split(lines, "\n", -1, false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    llvm::SmallVector<llvm::StringRef, 4> fields;
+    line.split(fields, "\t", 3);
+    if (fields.size() != 4)
+      continue;
+    std::string duration = fields[2].str();
+    char *pEnd;
+    double durationMs = strtod(duration.c_str(), &pEnd);
+    if (duration.empty() || *pEnd != '\0')
+      continue;
+    timings[fields[3].str()] = durationMs;
+  }
+}
+
+void DxcBatchContext::WriteTimingReport(
+    llvm::StringRef fileName, llvm::ArrayRef<llvm::StringRef> commands,
+    llvm::ArrayRef<BatchCommandResult> results) {
+  std::error_code ec;
+  llvm::raw_fd_ostream OS(fileName, ec, llvm::sys::fs::F_Text);
+  IFTBOOLMSG(!ec, E_FAIL, "unable to write timing report");
+  OS << "# index\tstatus\tduration_ms\tcommand\n";
+  for (unsigned i = 0; i < commands.size(); ++i) {
+    if (!results[i].Ran)
+      continue;
+    OS << i << '\t' << results[i].Status << '\t';
+    OS << llvm::format("%.3f", results[i].DurationMs) << '\t' << commands[i]
+       << '\n';
+  }
+}
+
+int DxcBatchContext::BatchCompile(bool bMultiThread, bool bLibLink,
+                                  llvm::StringRef timingReport) {
   SmallString<128> path(m_Opts.InputFile.begin(), m_Opts.InputFile.end());
   llvm::sys::path::remove_filename(path);
 
@@ -788,44 +943,71 @@ int DxcBatchContext::BatchCompile(bool bMultiThread, bool bLibLink) {
   ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
   llvm::StringRef source((char *)pSource->GetBufferPointer(),
                          pSource->GetBufferSize());
-  llvm::SmallVector<llvm::StringRef, 4> commands;
-  source.split(commands, "\n");
-
-  if (bMultiThread) {
-    unsigned int threadNum = std::min<unsigned>(
-        std::thread::hardware_concurrency(), commands.size());
-    auto empty_fn = []() {};
-    std::vector<std::thread> threads(threadNum);
-    for (unsigned i = 0; i < threadNum; i++)
-      threads[i] = std::thread(empty_fn);
-
-    for (unsigned i = 0; i < commands.size(); i++) {
-      // trim to remove /r if exist.
-      llvm::StringRef command = commands[i].trim();
-      if (command.empty())
-        continue;
-      if (command.startswith("//"))
-        continue;
-
-      unsigned threadIdx = i % threadNum;
-      threads[threadIdx].join();
+  llvm::SmallVector<llvm::StringRef, 4> lines;
+  source.split(lines, "\n");
+
+  // trim to remove /r if exist.
+  std::vector<llvm::StringRef> commands;
+  for (llvm::StringRef line : lines) {
+    llvm::StringRef command = line.trim();
+    if (command.empty())
+      continue;
+    if (command.startswith("//"))
+      continue;
+    commands.emplace_back(command);
+  }
+  if (commands.empty())
+    return 0;
 
-      threads[threadIdx] = std::thread(
-          ::Compile, command, std::ref(m_dxcSupport), path.str(), bLibLink);
-    }
+  llvm::sys::fs::MSFileSystem *msfPtr;
+  IFT(CreateMSFileSystemForDisk(&msfPtr));
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+  IFTLLVM(pts.error_code());
+
+  // Schedule the longest commands of the previous run first. Commands without
+  // history are assumed to be long, as nothing is known about them.
+  std::unordered_map<std::string, double> timings;
+  if (!timingReport.empty())
+    ReadTimingReport(timingReport, timings);
+  std::vector<double> estimates(commands.size(),
+                                std::numeric_limits<double>::max());
+  for (unsigned i = 0; i < commands.size(); ++i) {
+    auto it = timings.find(commands[i].str());
+    if (it != timings.end())
+      estimates[i] = it->second;
+  }
+  std::vector<unsigned> order(commands.size());
+  for (unsigned i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&estimates](unsigned a, unsigned b) {
+                     return estimates[a] > estimates[b];
+                   });
+
+  unsigned threadNum =
+      bMultiThread ? std::max<unsigned>(
+                         1, std::min<unsigned>(
+                                std::thread::hardware_concurrency(),
+                                commands.size()))
+                   : 1;
+  BatchWorkQueue queue(threadNum, order);
+  std::vector<BatchCommandResult> results(commands.size());
+  if (threadNum == 1) {
+    RunWorker(0, queue, commands, path.str(), bLibLink, results);
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(threadNum);
+    for (unsigned i = 0; i < threadNum; i++)
+      threads.emplace_back(&DxcBatchContext::RunWorker, this, i,
+                           std::ref(queue), llvm::ArrayRef<llvm::StringRef>(commands),
+                           path.str(), bLibLink, std::ref(results));
     for (auto &th : threads)
       th.join();
-  } else {
-    for (llvm::StringRef command : commands) {
-      if (command.empty())
-        continue;
-      if (command.startswith("//"))
-        continue;
-      llvm::SmallVector<llvm::StringRef, 4> args;
-      command.split(args, " ");
-      Compile(command, m_dxcSupport, path.str(), bLibLink);
-    }
   }
+
+  if (!timingReport.empty())
+    WriteTimingReport(timingReport, commands, results);
   return 0;
 }
 
@@ -846,6 +1028,8 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     bool bMultiThread = false;
     const char *kLibLinkArg = "-lib-link";
     bool bLibLink = false;
+    const char *kTimingReportArg = "-timing-report";
+    std::string timingReport;
     // Parse command line options.
     const OptTable *optionTable = getHlslOptTable();
     MainArgs argStrings(argc, argv_);
@@ -857,13 +1041,21 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
 
     std::vector<StringRef> refArgs;
     refArgs.reserve(args.size());
-    for (auto &arg : args) {
-      if (arg != kMultiThreadArg && arg != kLibLinkArg) {
-        refArgs.emplace_back(arg.c_str());
-      } else if (arg == kLibLinkArg) {
+    for (unsigned i = 0; i < args.size(); ++i) {
+      const std::string &arg = args[i];
+      if (arg == kLibLinkArg) {
         bLibLink = true;
-      } else {
+      } else if (arg == kMultiThreadArg) {
         bMultiThread = true;
+      } else if (arg == kTimingReportArg) {
+        if (i + 1 == args.size() || args[i + 1] == "-T") {
+          fprintf(stderr, "dxc_batch failed : %s requires a file name\n",
+                  kTimingReportArg);
+          return 1;
+        }
+        timingReport = args[++i];
+      } else {
+        refArgs.emplace_back(arg.c_str());
       }
     }
 
@@ -893,7 +1085,10 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
       std::string helpString;
       llvm::raw_string_ostream helpStream(helpString);
       optionTable->PrintHelp(helpStream, "dxc_bach.exe", "HLSL Compiler", "");
-      helpStream << "multi-thread";
+      helpStream << "\ndxc_batch options:\n"
+                 << "  -lib-link               Link shaders from a shared library\n"
+                 << "  -multi-thread           Compile commands in parallel\n"
+                 << "  -timing-report <file>   Schedule from and write per-command timings\n";
       helpStream.flush();
       dxc::WriteUtf8ToConsoleSizeT(helpString.data(), helpString.size());
       return 0;
@@ -915,7 +1110,7 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     EnsureEnabled(dxcSupport);
     DxcBatchContext context(dxcOpts, dxcSupport);
     pStage = "BatchCompilation";
-    retVal = context.BatchCompile(bMultiThread, bLibLink);
+    retVal = context.BatchCompile(bMultiThread, bLibLink, timingReport);
     {
       auto t_end = std::chrono::high_resolution_clock::now();
       double duration_ms =
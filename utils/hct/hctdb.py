@@ -51,6 +51,7 @@ class db_dxil_inst(object):
         self.requires_uniform_inputs = False  # whether this operation requires that all of its inputs are uniform across the wave
         self.shader_stages = "*"        # shader stages to which this applies, * or one or more of cdghpv
         self.shader_model = 6,0         # minimum shader model required
+        self.cost_class = ""            # relative throughput class used by the cost model, for DXIL operations
         self.inst_helper_prefix = None
         self.fully_qualified_name_prefix = "hlsl::OP::OpCode"
         for k,v in list(kwargs.items()):
@@ -145,6 +146,7 @@ class db_dxil(object):
         self.build_indices()
         self.populate_extended_docs()
         self.populate_categories_and_models()
+        self.populate_cost_classes()
         self.build_opcode_enum()
         self.mark_disallowed_operations()
         self.populate_metadata()
@@ -296,6 +298,33 @@ class db_dxil(object):
         for i in "RawBufferLoad,RawBufferStore".split(","):
             self.name_idx[i].shader_model = 6,2
 
+    def populate_cost_classes(self):
+        "Populate the cost_class member of DXIL operations, relative to a full-rate ALU operation."
+        for i in self.get_dxil_insts():
+            i.cost_class = "ALU"
+        # System values and reinterpreting bits take no instruction of their own.
+        for i in "ThreadId,GroupId,ThreadIdInGroup,FlattenedThreadIdInGroup,GSInstanceID,DomainLocation,OutputControlPointID,PrimitiveID,SampleIndex,Coverage,InnerCoverage,ViewID,MakeDouble,SplitDouble".split(","):
+            self.name_idx[i].cost_class = "Free"
+        for i in self.get_dxil_insts():
+            if i.name.startswith("Bitcast"):
+                i.cost_class = "Free"
+        # Transcendentals, integer division and double precision run at a fraction of the ALU rate.
+        for i in "Cos,Sin,Tan,Acos,Asin,Atan,Hcos,Hsin,Htan,Exp,Log,Sqrt,Rsqrt,UDiv,Fma,LegacyDoubleToFloat,LegacyDoubleToSInt32,LegacyDoubleToUInt32".split(","):
+            self.name_idx[i].cost_class = "Complex"
+        # Derivatives exchange values within a quad.
+        for i in self.get_dxil_insts():
+            if i.is_deriv:
+                i.cost_class = "Derivative"
+        self.name_idx["CalculateLOD"].cost_class = "Derivative"
+        for i in self.get_dxil_insts():
+            if i.is_wave:
+                i.cost_class = "Wave"
+        # Constant buffer reads are served by a constant cache, and are left as ALU.
+        for i in "TempRegLoad,TempRegStore,MinPrecXRegLoad,MinPrecXRegStore,TextureLoad,TextureStore,BufferLoad,BufferStore,BufferUpdateCounter,GetDimensions,AtomicBinOp,AtomicCompareExchange,RawBufferLoad,RawBufferStore".split(","):
+            self.name_idx[i].cost_class = "Memory"
+        for i in "Sample,SampleBias,SampleLevel,SampleGrad,SampleCmp,SampleCmpLevelZero,TextureGather,TextureGatherCmp".split(","):
+            self.name_idx[i].cost_class = "Sample"
+
     def populate_llvm_instructions(self):
         # Add instructions that map to LLVM instructions.
         # This is basically include\llvm\IR\Instruction.def
@@ -1244,6 +1273,7 @@ class db_dxil(object):
         add_pass("scoped-noalias", "ScopedNoAliasAA", "Scoped NoAlias Alias Analysis", [
             {'n':"enable-scoped-noalias", 'i':'EnableScopedNoAlias', 't':'bool', 'd':'Use to disable scoped no-alias'}])
         add_pass("basicaa", "BasicAliasAnalysis", "Basic Alias Analysis (stateless AA impl)", [])
+        add_pass("cost-model", "CostModelAnalysis", "Cost Model Analysis", [])
         add_pass("reg2mem_hlsl", "RegToMemHlsl", "Demote values with phi-node usage to stack slots", [])
         add_pass("simplifycfg", "CFGSimplifyPass", "Simplify the CFG", [
             {'n':'Threshold', 't':'int', 'c':1},
@@ -1907,7 +1937,9 @@ class db_hlsl_intrinsic(object):
         if unsigned_op != "":
             self.unsigned_op = "%s_%s" % (id_prefix, unsigned_op)
         self.overload_param_index = overload_idx        # Parameter determines the overload type, -1 means ret type
-        self.key = ("%3d" % ns_idx) + "!" + name + "!" + ("%2d" % len(params)) + "!" + ("%3d" % idx)    # Unique key
+        # Unique key; tables are emitted in key order, which Sema relies on to
+        # binary search by name and argument count.
+        self.key = ("%3d" % ns_idx) + "!" + name + "!" + ("%2d" % len(params)) + "!" + ("%3d" % idx)
         self.vulkanSpecific = ns.startswith("Vk")       # Vulkan specific intrinsic - SPIRV change
 
 class db_hlsl_namespace(object):
@@ -653,7 +653,15 @@ def get_hlsl_intrinsics():
     id_prefix = ""
     arg_idx = 0
     opcode_namespace = db.opcode_namespace
+    last_lookup_key = None
     for i in sorted(db.intrinsics, key=lambda x: x.key):
+        # Sema binary searches each table for the first entry with a given
+        # name and argument count, so entries must be ordered by the bytes of
+        # the name and then by argument count.
+        lookup_key = (i.ns, i.params[0].name.encode("ascii"), len(i.params))
+        assert last_lookup_key is None or last_lookup_key[0] != i.ns or last_lookup_key <= lookup_key, \
+            "intrinsic table %s is not sorted for lookup at %s" % (i.ns, i.name)
+        last_lookup_key = lookup_key
         if last_ns != i.ns:
             last_ns = i.ns
             id_prefix = "IOP" if last_ns == "Intrinsics" else "MOP"
@@ -786,6 +794,17 @@ def get_instrs_pred(varname, pred, attr_name="dxil_opid"):
     result += "\n"
     return result
 
+def get_op_cost_classes(varname):
+    "Create a series of statements returning the cost class of a DXIL operation."
+    db = get_db_dxil()
+    result = ""
+    for cost_class in ["Free", "Derivative", "Complex", "Wave", "Memory", "Sample"]:
+        instrs = [i for i in db.get_dxil_insts() if i.cost_class == cost_class]
+        result += format_comment("// ", "%s: %s" % (cost_class, ", ".join([i.name + "=" + str(i.dxil_opid) for i in instrs])))
+        result += "if (%s)\n  return DxilOpCostClass::%s;\n" % (build_range_code(varname, [i.dxil_opid for i in instrs]), cost_class)
+    result += "return DxilOpCostClass::ALU;\n"
+    return result
+
 def get_instrs_rst():
     "Create an rst table of allowed LLVM instructions."
     db = get_db_dxil()
@@ -1053,6 +1072,7 @@ if __name__ == "__main__":
             'include/dxc/HLSL/DxilInstructions.h',
             'lib/HLSL/DxcOptimizer.cpp',
             'lib/HLSL/DxilValidation.cpp',
+            'lib/HLSL/DxilTargetTransformInfo.cpp',
             'tools/clang/lib/Sema/gen_intrin_main_tables_15.h',
             'include/dxc/HlslIntrinsicOp.h',
             'tools/clang/tools/dxcompiler/dxcdisassembler.cpp',